@@ -0,0 +1,117 @@
+#include "CacheFiles.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#endif
+
+std::wstring GetCacheFileName(const std::wstring& directory, uint64_t key, const std::wstring& extension)
+{
+	wchar_t name[17];
+	for (int i = 0; i < 16; i++)
+	{
+		name[i] = L"0123456789abcdef"[(key >> (60 - i * 4)) & 0xf];
+	}
+	name[16] = L'\0';
+	return directory + L"/" + name + extension;
+}
+
+#if defined(_WIN32)
+
+void CreateCacheDirectory(const std::wstring& directory)
+{
+	CreateDirectoryW(directory.c_str(), nullptr);
+}
+
+bool GetFileStamp(const std::wstring& fileName, uint64_t& size, uint64_t& lastWriteTime)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesExW(fileName.c_str(), GetFileExInfoStandard, &attributes))
+	{
+		return false;
+	}
+	size = (static_cast<uint64_t>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+	lastWriteTime = (static_cast<uint64_t>(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+	return true;
+}
+
+bool WriteWholeFile(const std::wstring& fileName, const void * data, size_t size)
+{
+	// Write to a temporary file first, so that a partly written file is never seen
+	std::wstring temporaryName = fileName + L".tmp";
+	HANDLE file = CreateFileW(temporaryName.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	DWORD written = 0;
+	bool succeeded = WriteFile(file, data, static_cast<DWORD>(size), &written, nullptr) && written == size;
+	CloseHandle(file);
+	if (!succeeded || !MoveFileExW(temporaryName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING))
+	{
+		DeleteFileW(temporaryName.c_str());
+		return false;
+	}
+	return true;
+}
+
+#else
+
+static std::string NarrowFileName(const std::wstring& fileName)
+{
+	// Convert the name to the narrow encoding used by the file system
+	std::vector<char> narrowName(fileName.size() * MB_CUR_MAX + 1);
+	if (wcstombs(narrowName.data(), fileName.c_str(), narrowName.size()) == static_cast<size_t>(-1))
+	{
+		return std::string();
+	}
+	return std::string(narrowName.data());
+}
+
+void CreateCacheDirectory(const std::wstring& directory)
+{
+	mkdir(NarrowFileName(directory).c_str(), 0755);
+}
+
+bool GetFileStamp(const std::wstring& fileName, uint64_t& size, uint64_t& lastWriteTime)
+{
+	struct stat fileStatus;
+	if (stat(NarrowFileName(fileName).c_str(), &fileStatus) != 0)
+	{
+		return false;
+	}
+	size = static_cast<uint64_t>(fileStatus.st_size);
+	// In nanoseconds
+#if defined(__APPLE__)
+	lastWriteTime = static_cast<uint64_t>(fileStatus.st_mtimespec.tv_sec) * 1000000000u + static_cast<uint64_t>(fileStatus.st_mtimespec.tv_nsec);
+#else
+	lastWriteTime = static_cast<uint64_t>(fileStatus.st_mtim.tv_sec) * 1000000000u + static_cast<uint64_t>(fileStatus.st_mtim.tv_nsec);
+#endif
+	return true;
+}
+
+bool WriteWholeFile(const std::wstring& fileName, const void * data, size_t size)
+{
+	// Write to a temporary file first, so that a partly written file is never seen
+	std::string narrowName = NarrowFileName(fileName);
+	std::string temporaryName = narrowName + ".tmp";
+	FILE * file = fopen(temporaryName.c_str(), "wb");
+	if (file == nullptr)
+	{
+		return false;
+	}
+	bool succeeded = fwrite(data, 1, size, file) == size;
+	succeeded = fclose(file) == 0 && succeeded;
+	if (!succeeded || rename(temporaryName.c_str(), narrowName.c_str()) != 0)
+	{
+		remove(temporaryName.c_str());
+		return false;
+	}
+	return true;
+}
+
+#endif
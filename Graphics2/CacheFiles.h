@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Helpers shared by the caches that keep processed data on disk between runs (compiled
+// shaders and baked models).  Cache files are named after a 64-bit key, which is made by
+// hashing everything the cached data depends on.
+
+// 64-bit FNV-1a
+static const uint64_t FnvOffsetBasis = 14695981039346656037ull;
+static const uint64_t FnvPrime = 1099511628211ull;
+
+inline void HashBytes(uint64_t& hash, const void * data, size_t size)
+{
+	const unsigned char * bytes = static_cast<const unsigned char *>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= FnvPrime;
+	}
+}
+
+inline void HashValue(uint64_t& hash, uint64_t value)
+{
+	HashBytes(hash, &value, sizeof(value));
+}
+
+// The length goes in first, so that ("ab", "c") and ("a", "bc") hash differently
+inline void HashString(uint64_t& hash, const std::string& text)
+{
+	HashValue(hash, text.size());
+	HashBytes(hash, text.data(), text.size());
+}
+
+inline void HashString(uint64_t& hash, const std::wstring& text)
+{
+	HashValue(hash, text.size());
+	HashBytes(hash, text.data(), text.size() * sizeof(wchar_t));
+}
+
+// Does nothing if the directory already exists
+void			CreateCacheDirectory(const std::wstring& directory);
+
+// The size and last write time of a file, as a cheap check of whether it has changed since it
+// was last read.  The time is in the file system's own units.  Returns false if the file
+// cannot be found.
+bool			GetFileStamp(const std::wstring& fileName, uint64_t& size, uint64_t& lastWriteTime);
+
+// Returns <directory>/<key as 16 hex digits><extension>
+std::wstring	GetCacheFileName(const std::wstring& directory, uint64_t key, const std::wstring& extension);
+
+// Writes to a temporary file first and then renames it, so that a partly written file is
+// never seen by another run.  Returns false if the file could not be written.
+bool			WriteWholeFile(const std::wstring& fileName, const void * data, size_t size);
@@ -0,0 +1,108 @@
+#include "ClusteredLighting.h"
+#include "ConstantBuffers.h"
+#include "ThreadPool.h"
+#include "core.h"
+#include <cmath>
+
+ClusteredLighting::ClusteredLighting(ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> deviceContext)
+{
+	_device = device;
+	_deviceContext = deviceContext;
+	_lightBuffer.Capacity = 0;
+	_clusterRangeBuffer.Capacity = 0;
+	_lightIndexBuffer.Capacity = 0;
+
+	D3D11_BUFFER_DESC bufferDesc;
+	ZeroMemory(&bufferDesc, sizeof(bufferDesc));
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.ByteWidth = sizeof(ClusterConstants);
+	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	ThrowIfFailed(_device->CreateBuffer(&bufferDesc, NULL, _constantBuffer.GetAddressOf()));
+	bufferDesc.ByteWidth = sizeof(FrameConstants);
+	ThrowIfFailed(_device->CreateBuffer(&bufferDesc, NULL, _frameConstantBuffer.GetAddressOf()));
+
+	_ambientLight = XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f);
+	SetDirectionalLight(XMVectorSet(0.0f, -1.0f, 1.0f, 0.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f));
+}
+
+void ClusteredLighting::SetDirectionalLight(FXMVECTOR lightVector, XMFLOAT4 lightColour)
+{
+	XMStoreFloat4(&_directionalLightVector, XMVector4Normalize(lightVector));
+	_directionalLightColour = lightColour;
+}
+
+void ClusteredLighting::Update(FXMVECTOR cameraPosition, FXMMATRIX view, CXMMATRIX projection, unsigned int screenWidth, unsigned int screenHeight, ThreadPool * threadPool)
+{
+	FrameConstants frameConstants;
+	XMStoreFloat4(&frameConstants.CameraPosition, cameraPosition);
+	frameConstants.LightVector = _directionalLightVector;
+	frameConstants.LightColor = _directionalLightColour;
+	frameConstants.AmbientColor = _ambientLight;
+	D3D11_MAPPED_SUBRESOURCE mappedFrameConstants;
+	ThrowIfFailed(_deviceContext->Map(_frameConstantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedFrameConstants));
+	memcpy(mappedFrameConstants.pData, &frameConstants, sizeof(FrameConstants));
+	_deviceContext->Unmap(_frameConstantBuffer.Get(), 0);
+
+	_clusters.Build(_lights, view, projection, threadPool);
+
+	Upload(_lightBuffer, _lights.data(), static_cast<unsigned int>(_lights.size()), sizeof(ClusterLight));
+	Upload(_clusterRangeBuffer, _clusters.GetClusterRanges().data(), _clusters.GetClusterCount(), sizeof(ClusterRange));
+	Upload(_lightIndexBuffer, _clusters.GetLightIndices().data(), static_cast<unsigned int>(_clusters.GetLightIndices().size()), sizeof(unsigned int));
+
+	// The shader finds a pixel's slice from its view depth with a log, a multiply and an add
+	float logDepthRange = std::log(_clusters.GetFar() / _clusters.GetNear());
+	ClusterConstants constants;
+	constants.TileCountX = _clusters.GetTilesX();
+	constants.TileCountY = _clusters.GetTilesY();
+	constants.SliceCount = _clusters.GetSlices();
+	constants.LightCount = static_cast<UINT>(_lights.size());
+	constants.TileScale = XMFLOAT2(static_cast<float>(_clusters.GetTilesX()) / screenWidth, static_cast<float>(_clusters.GetTilesY()) / screenHeight);
+	float sliceCount = static_cast<float>(_clusters.GetSlices());
+	constants.SliceScale = sliceCount / logDepthRange;
+	constants.SliceBias = -sliceCount * std::log(_clusters.GetNear()) / logDepthRange;
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	ThrowIfFailed(_deviceContext->Map(_constantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
+	memcpy(mappedResource.pData, &constants, sizeof(ClusterConstants));
+	_deviceContext->Unmap(_constantBuffer.Get(), 0);
+
+	// Nothing else uses these slots, so they stay bound for the whole frame
+	ID3D11ShaderResourceView * views[3] = { _lightBuffer.View.Get(), _clusterRangeBuffer.View.Get(), _lightIndexBuffer.View.Get() };
+	_deviceContext->PSSetShaderResources(ClusterLightsSlot, 3, views);
+	_deviceContext->PSSetConstantBuffers(ClusterConstantsSlot, 1, _constantBuffer.GetAddressOf());
+}
+
+void ClusteredLighting::Upload(StructuredBuffer& buffer, const void * data, unsigned int count, unsigned int stride)
+{
+	if (count > buffer.Capacity || buffer.Buffer == nullptr)
+	{
+		unsigned int capacity = buffer.Capacity * 2 > count ? buffer.Capacity * 2 : count;
+		capacity = capacity > 0 ? capacity : 1;
+		D3D11_BUFFER_DESC bufferDesc;
+		ZeroMemory(&bufferDesc, sizeof(bufferDesc));
+		bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+		bufferDesc.ByteWidth = capacity * stride;
+		bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		bufferDesc.StructureByteStride = stride;
+		ThrowIfFailed(_device->CreateBuffer(&bufferDesc, NULL, buffer.Buffer.ReleaseAndGetAddressOf()));
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc;
+		ZeroMemory(&viewDesc, sizeof(viewDesc));
+		viewDesc.Format = DXGI_FORMAT_UNKNOWN;
+		viewDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		viewDesc.Buffer.FirstElement = 0;
+		viewDesc.Buffer.NumElements = capacity;
+		ThrowIfFailed(_device->CreateShaderResourceView(buffer.Buffer.Get(), &viewDesc, buffer.View.ReleaseAndGetAddressOf()));
+		buffer.Capacity = capacity;
+	}
+	if (count == 0)
+	{
+		return;
+	}
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	ThrowIfFailed(_deviceContext->Map(buffer.Buffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
+	memcpy(mappedResource.pData, data, static_cast<size_t>(count) * stride);
+	_deviceContext->Unmap(buffer.Buffer.Get(), 0);
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "DirectXCore.h"
+#include "LightClusters.h"
+#include <vector>
+
+class ThreadPool;
+
+// The lights of the scene: an ambient light and one directional light, which every renderer
+// shares through FrameConstants, and the point and spot lights with the GPU copies of their
+// clusters.
+//
+// Update writes FrameConstants once a frame from the camera's position and the two scene
+// lights.  Renderers put GetFrameConstantBuffer in their pipelines rather than keeping
+// buffers of their own.
+//
+// Each frame, Update bins the lights for the camera (see LightClusters.h) and writes the lights,
+// each cluster's range of the light index list and the list itself into dynamic structured
+// buffers, which are bound to t1, t2 and t3 of the pixel shader along with ClusterConstants in
+// b3.  TexturedShaders.hlsl finds the cluster each pixel is in and only shades its lights.  The
+// buffers grow by doubling and are otherwise kept from frame to frame.
+
+class ClusteredLighting
+{
+public:
+	ClusteredLighting(ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> deviceContext);
+
+	// Lights are in world space and can be added, moved and removed between frames
+	inline std::vector<ClusterLight>&	GetLights() { return _lights; }
+	inline const LightClusters&			GetClusters() const { return _clusters; }
+
+	// The ambient light defaults to mid grey, and the directional light to white light shining
+	// down and away from the camera.  lightVector is the way the light travels.
+	inline void							SetAmbientLight(XMFLOAT4 ambientLight) { _ambientLight = ambientLight; }
+	void								SetDirectionalLight(FXMVECTOR lightVector, XMFLOAT4 lightColour);
+	// FrameConstants, bound to b0 (see ConstantBuffers.h)
+	inline ComPtr<ID3D11Buffer>			GetFrameConstantBuffer() { return _frameConstantBuffer; }
+
+	// Called once a frame, before anything that uses the lights is drawn
+	void								Update(FXMVECTOR cameraPosition, FXMMATRIX view, CXMMATRIX projection, unsigned int screenWidth, unsigned int screenHeight, ThreadPool * threadPool);
+
+private:
+	struct StructuredBuffer
+	{
+		ComPtr<ID3D11Buffer>				Buffer;
+		ComPtr<ID3D11ShaderResourceView>	View;
+		unsigned int						Capacity;		// In elements
+	};
+
+	ComPtr<ID3D11Device>				_device;
+	ComPtr<ID3D11DeviceContext>			_deviceContext;
+	std::vector<ClusterLight>			_lights;
+	LightClusters						_clusters;
+	StructuredBuffer					_lightBuffer;
+	StructuredBuffer					_clusterRangeBuffer;
+	StructuredBuffer					_lightIndexBuffer;
+	ComPtr<ID3D11Buffer>				_constantBuffer;
+	XMFLOAT4							_ambientLight;
+	XMFLOAT4							_directionalLightVector;
+	XMFLOAT4							_directionalLightColour;
+	ComPtr<ID3D11Buffer>				_frameConstantBuffer;
+
+	// An empty list still gets a buffer of one element, since nothing can be bound otherwise
+	void								Upload(StructuredBuffer& buffer, const void * data, unsigned int count, unsigned int stride);
+};
@@ -0,0 +1,55 @@
+#pragma once
+#include "DirectXCore.h"
+
+// The constants used by TexturedShaders.hlsl, split by how often they change.  The layouts
+// and registers must match the cbuffers in the shader.
+//
+//   b0  FrameConstants     - camera and scene lights, written once a frame by ClusteredLighting
+//   b1  MaterialConstants  - created once for each material and never changed
+//   b2  ObjectConstants    - written for every draw into the frame's part of a ring buffer
+//   b3  ClusterConstants   - the layout of the light clusters, written once a frame
+//
+// t0 is the material's texture, and t1 to t3 hold the light clusters (see ClusteredLighting.h).
+
+static const UINT FrameConstantsSlot = 0;
+static const UINT MaterialConstantsSlot = 1;
+static const UINT ObjectConstantsSlot = 2;
+static const UINT ClusterConstantsSlot = 3;
+static const UINT ClusterLightsSlot = 1;
+
+struct FrameConstants
+{
+	XMFLOAT4	CameraPosition;
+	XMFLOAT4	LightVector;
+	XMFLOAT4	LightColor;
+	XMFLOAT4	AmbientColor;
+};
+
+struct MaterialConstants
+{
+	XMFLOAT4	DiffuseCoefficient;
+	XMFLOAT4	SpecularCoefficient;
+	float		Shininess;
+	float		Opacity;
+	float		Padding[2];
+};
+
+struct ObjectConstants
+{
+	XMFLOAT4X4	CompleteTransformation;
+	XMFLOAT4X4	WorldTransformation;
+	// Only used for quantized vertices (see VertexPacker.h)
+	XMFLOAT4	PositionScale;
+	XMFLOAT4	PositionOffset;
+};
+
+struct ClusterConstants
+{
+	UINT		TileCountX;
+	UINT		TileCountY;
+	UINT		SliceCount;
+	UINT		LightCount;
+	XMFLOAT2	TileScale;		// Takes a pixel position to a tile
+	float		SliceScale;		// slice = log(view depth) * SliceScale + SliceBias
+	float		SliceBias;
+};
@@ -0,0 +1,37 @@
+#include "D3DShaderCompiler.h"
+
+std::string D3DShaderCompiler::GetVersion()
+{
+	return "d3dcompiler_" + std::to_string(D3D_COMPILER_VERSION);
+}
+
+bool D3DShaderCompiler::Compile(const ShaderCompileOptions& options, ShaderByteCode& byteCode, std::string& messages)
+{
+	// The list of defines ends with an empty entry
+	std::vector<D3D_SHADER_MACRO> defines;
+	for (const ShaderDefine& define : options.Defines)
+	{
+		defines.push_back({ define.Name.c_str(), define.Value.c_str() });
+	}
+	defines.push_back({ nullptr, nullptr });
+
+	ComPtr<ID3DBlob> compiledCode;
+	ComPtr<ID3DBlob> compilationMessages;
+	HRESULT hr = D3DCompileFromFile(options.FileName.c_str(),
+									&defines[0], D3D_COMPILE_STANDARD_FILE_INCLUDE,
+									options.EntryPoint.c_str(), options.Target.c_str(),
+									options.Flags, 0,
+									compiledCode.GetAddressOf(),
+									compilationMessages.GetAddressOf());
+	if (compilationMessages.Get() != nullptr)
+	{
+		messages.assign(static_cast<const char *>(compilationMessages->GetBufferPointer()), compilationMessages->GetBufferSize());
+	}
+	if (FAILED(hr) || compiledCode.Get() == nullptr)
+	{
+		return false;
+	}
+	const unsigned char * code = static_cast<const unsigned char *>(compiledCode->GetBufferPointer());
+	byteCode.assign(code, code + compiledCode->GetBufferSize());
+	return true;
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include "DirectXCore.h"
+#include "ShaderCache.h"
+
+// Compiles shaders for the ShaderCache with D3DCompileFromFile.  Included files are found
+// relative to the file that includes them.
+
+class D3DShaderCompiler : public ShaderCompiler
+{
+public:
+	std::string							GetVersion();
+	bool								Compile(const ShaderCompileOptions& options, ShaderByteCode& byteCode, std::string& messages);
+};
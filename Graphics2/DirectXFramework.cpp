@@ -34,13 +34,8 @@ ComPtr<ID3D11VertexShader> DirectXFramework::CompileVertexShader(wstring FileNam
 	ComPtr<ID3D10Blob> CompileBlop;
 	ComPtr<ID3D10Blob> compileMessageBlob;
 
-	DWORD ShaderCompileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
-
-	hrResult = D3DCompileFromFile(
-		FileName.c_str(),
-		nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE,
-		entryPoint.c_str(), shaderTarget.c_str(),
-		ShaderCompileFlags, NULL,
+	hrResult = CompileShader(
+		FileName, entryPoint, shaderTarget,
 		CompileBlop.GetAddressOf(),
 		compileMessageBlob.GetAddressOf()
 	);
@@ -67,13 +62,8 @@ ComPtr<ID3D11PixelShader> DirectXFramework::CompilePixelShader(wstring FileName,
 	ComPtr<ID3D10Blob> CompileBlop;
 	ComPtr<ID3D10Blob> compileMessageBlob;
 
-	DWORD ShaderCompileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
-
-	hrResult = D3DCompileFromFile(
-		FileName.c_str(),
-		nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE,
-		entryPoint.c_str(), shaderTarget.c_str(),
-		ShaderCompileFlags, NULL,
+	hrResult = CompileShader(
+		FileName, entryPoint, shaderTarget,
 		CompileBlop.GetAddressOf(),
 		compileMessageBlob.GetAddressOf()
 	);
@@ -93,6 +83,38 @@ ComPtr<ID3D11PixelShader> DirectXFramework::CompilePixelShader(wstring FileName,
 	return returnShader;
 }
 
+HRESULT DirectXFramework::CompileShader(wstring fileName, string entryPoint, string shaderTarget, ID3DBlob ** byteCode, ID3DBlob ** compilationMessages)
+{
+	ShaderCompileOptions options;
+	options.FileName = fileName;
+	options.EntryPoint = entryPoint;
+	options.Target = shaderTarget;
+#if defined( _DEBUG )
+	options.Flags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#else
+	options.Flags = D3DCOMPILE_OPTIMIZATION_LEVEL3;
+#endif
+
+	string messages;
+	shared_ptr<const ShaderByteCode> shader = _shaderCache->GetByteCode(options, messages);
+
+	// Hand back copies in blobs, as D3DCompileFromFile would
+	*compilationMessages = nullptr;
+	if (!messages.empty())
+	{
+		ThrowIfFailed(D3DCreateBlob(messages.size() + 1, compilationMessages));
+		memcpy((*compilationMessages)->GetBufferPointer(), messages.c_str(), messages.size() + 1);
+	}
+	*byteCode = nullptr;
+	if (!shader)
+	{
+		return E_FAIL;
+	}
+	ThrowIfFailed(D3DCreateBlob(shader->size(), byteCode));
+	memcpy((*byteCode)->GetBufferPointer(), shader->data(), shader->size());
+	return S_OK;
+}
+
 XMMATRIX DirectXFramework::GetViewTransformation()
 {
 	return _camera->GetViewMatrix();
@@ -138,6 +160,12 @@ bool DirectXFramework::Initialise()
 
 
 	_camera = make_shared<Camera>();
+	_threadPool = make_shared<ThreadPool>();
+	_renderQueue = make_shared<RenderQueue>();
+	_occlusionCuller = make_shared<OcclusionCuller>();
+	_clusteredLighting = make_shared<ClusteredLighting>(_device, _deviceContext);
+	_renderCommandSink = make_shared<DirectXRenderCommandSink>(_device, _deviceContext);
+	_shaderCache = make_shared<ShaderCache>(make_shared<D3DShaderCompiler>(), L"ShaderCache");
 	_resourceManager = make_shared<ResourceManager>();
 
 	// Create camera and projection matrices (we will look at how the 
@@ -174,9 +202,17 @@ void DirectXFramework::Update()
 
 	// Do any updates to the scene graph nodes
 	UpdateSceneGraph();
-	// Now apply any updates that have been made to world transformations
-	// to all the nodes
-	_sceneGraph->Update(XMMatrixIdentity());
+	// Now apply any updates that have been made to world transformations.
+	// Only the nodes that have moved (and anything below them) are recalculated
+	_updatedNodeCount = 0;
+	if (_parallelSceneUpdate)
+	{
+		_sceneGraph->UpdateIfChangedParallel(XMMatrixIdentity(), false, _updatedNodeCount, *_threadPool);
+	}
+	else
+	{
+		_sceneGraph->UpdateIfChanged(XMMatrixIdentity(), false, _updatedNodeCount);
+	}
 	_camera->Update();
 }
 
@@ -185,8 +221,21 @@ void DirectXFramework::Render()
 	// Clear the render target and the depth stencil view
 	_deviceContext->ClearRenderTargetView(_renderTargetView.Get(), _backgroundColour);
 	_deviceContext->ClearDepthStencilView(_depthStencilView.Get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+	// Create the Direct3D resources for any models that have finished loading
+	_resourceManager->CreatePendingMeshes();
+	// and give materials the textures that have been streamed in
+	_resourceManager->UpdateTextureStreaming();
+	// Draw the occluders on the CPU so that meshes hidden behind them can be skipped
+	_occlusionCuller->BeginFrame(GetViewTransformation() * GetProjectionTransformation());
+	// Set the camera and scene lights for the frame, and bin the point and spot lights into
+	// clusters for the pixel shader
+	_clusteredLighting->Update(_camera->GetCameraPosition(), GetViewTransformation(), GetProjectionTransformation(), GetWindowWidth(), GetWindowHeight(), _threadPool.get());
 	// Now recurse through the scene graph, rendering each object
 	_sceneGraph->Render();
+	// Draw each mesh once for all of the nodes that use it
+	_resourceManager->RenderMeshInstances();
+	// Then make the draws that were queued, sorted to keep state changes down
+	_renderQueue->Flush(*_renderCommandSink);
 	// Now display the scene
 	ThrowIfFailed(_swapChain->Present(0, 0));
 }
@@ -7,6 +7,13 @@
 #include <time.h>
 #include <chrono>
 #include "Camera.h"
+#include "ThreadPool.h"
+#include "RenderQueue.h"
+#include "OcclusionCuller.h"
+#include "ClusteredLighting.h"
+#include "DirectXRenderCommandSink.h"
+#include "ShaderCache.h"
+#include "D3DShaderCompiler.h"
 
 class DirectXFramework : public Framework
 {
@@ -29,12 +36,28 @@ public:
 
 	ComPtr<ID3D11VertexShader> CompileVertexShader(wstring FileName, string entryPoint, string shaderTarget);
 	ComPtr<ID3D11PixelShader> CompilePixelShader(wstring FileName, string entryPoint, string shaderTarget);
+	// Works like D3DCompileFromFile, but each shader is only compiled once and the byte code is
+	// kept on disk in the ShaderCache directory for next time
+	HRESULT CompileShader(wstring fileName, string entryPoint, string shaderTarget, ID3DBlob ** byteCode, ID3DBlob ** compilationMessages);
+	inline shared_ptr<ShaderCache>		GetShaderCache() { return _shaderCache; }
 
 	inline SceneGraphPointer			GetSceneGraph() { return _sceneGraph; }
+	// Number of scene graph nodes whose transforms were recalculated last frame
+	inline unsigned int					GetUpdatedNodeCount() { return _updatedNodeCount; }
+	// Update the children of the scene graph root on the thread pool.  Only worth it for large scenes
+	inline void							SetParallelSceneUpdate(bool parallelSceneUpdate) { _parallelSceneUpdate = parallelSceneUpdate; }
 	inline ComPtr<ID3D11Device>			GetDevice() { return _device; }
 	inline ComPtr<ID3D11DeviceContext>	GetDeviceContext() { return _deviceContext; }
 
 	inline shared_ptr<ResourceManager> GetResourceManager() { return _resourceManager; }
+	inline shared_ptr<ThreadPool>		GetThreadPool() { return _threadPool; }
+	// Draws submitted here are sorted and made after the scene graph has been rendered
+	inline shared_ptr<RenderQueue>		GetRenderQueue() { return _renderQueue; }
+	// Occluders are drawn into it at the start of each frame's render, and meshes are tested
+	// against it before they are submitted
+	inline shared_ptr<OcclusionCuller>	GetOcclusionCuller() { return _occlusionCuller; }
+	// Point and spot lights.  They are binned into clusters at the start of each frame's render.
+	inline shared_ptr<ClusteredLighting>	GetClusteredLighting() { return _clusteredLighting; }
 
 	XMMATRIX							GetViewTransformation();
 	XMMATRIX							GetProjectionTransformation();
@@ -74,7 +97,15 @@ private:
 	XMFLOAT4X4							_projectionTransformation;
 
 	SceneGraphPointer					_sceneGraph;
+	unsigned int						_updatedNodeCount = 0;
+	bool								_parallelSceneUpdate = false;
 	shared_ptr<ResourceManager>		_resourceManager;
+	shared_ptr<ThreadPool>				_threadPool;
+	shared_ptr<RenderQueue>				_renderQueue;
+	shared_ptr<OcclusionCuller>			_occlusionCuller;
+	shared_ptr<ClusteredLighting>		_clusteredLighting;
+	shared_ptr<DirectXRenderCommandSink>	_renderCommandSink;
+	shared_ptr<ShaderCache>				_shaderCache;
 
 
 	float							    _backgroundColour[4];
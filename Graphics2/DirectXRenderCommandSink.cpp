@@ -0,0 +1,171 @@
+#include "DirectXRenderCommandSink.h"
+#include "ConstantBuffers.h"
+#include "core.h"
+
+// Big enough for a few thousand draws a frame.  The ring grows if a frame needs more.
+static const size_t InitialRingSize = 1024 * 1024;
+
+DirectXRenderCommandSink::DirectXRenderCommandSink(ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> deviceContext) : _ringAllocator(0)
+{
+	_device = device;
+	_deviceContext = deviceContext;
+	_frameIndex = 0;
+	_ringOffset = 0;
+	_objectConstantsSize = 0;
+	_ringDiscardCount = 0;
+	_ringNeedsDiscard = false;
+	_objectConstantBufferSize = 0;
+
+	// Binding part of a constant buffer and mapping one with NO_OVERWRITE both need Direct3D 11.1
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options;
+	ZeroMemory(&options, sizeof(options));
+	_useRing = SUCCEEDED(_device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))) &&
+			   options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer &&
+			   SUCCEEDED(_deviceContext.As(&_deviceContext1));
+	if (_useRing)
+	{
+		CreateRingBuffer(InitialRingSize);
+	}
+}
+
+void DirectXRenderCommandSink::CreateRingBuffer(size_t size)
+{
+	D3D11_BUFFER_DESC bufferDesc;
+	ZeroMemory(&bufferDesc, sizeof(bufferDesc));
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.ByteWidth = static_cast<UINT>(size);
+	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	ThrowIfFailed(_device->CreateBuffer(&bufferDesc, NULL, _ringBuffer.ReleaseAndGetAddressOf()));
+	_ringAllocator = RingAllocator(size);
+	_ringNeedsDiscard = true;
+}
+
+void DirectXRenderCommandSink::BeginFlush(const void * constants, size_t constantsSize)
+{
+	_frameIndex++;
+	_objectConstantsSize = constantsSize;
+	if (constantsSize == 0 || !_useRing)
+	{
+		return;
+	}
+
+	// Make sure the ring can hold this many frames' worth of constants
+	size_t ringSize = _ringAllocator.GetCapacity();
+	while (ringSize < RingAllocator::AlignSize(constantsSize) * (MaxFramesInFlight + 1))
+	{
+		ringSize *= 2;
+	}
+	if (ringSize != _ringAllocator.GetCapacity())
+	{
+		CreateRingBuffer(ringSize);
+	}
+
+	// The frames the GPU has finished with can be overwritten
+	if (_frameIndex > MaxFramesInFlight)
+	{
+		_ringAllocator.RetireFrames(_frameIndex - MaxFramesInFlight - 1);
+	}
+	_ringAllocator.BeginFrame(_frameIndex);
+	D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+	_ringOffset = _ringAllocator.Allocate(constantsSize);
+	if (_ringNeedsDiscard || _ringOffset == RingAllocator::InvalidOffset)
+	{
+		// Everything left may still be in use (or the buffer is new), so ask the driver for
+		// fresh memory instead.  The old contents stay with the draws that use them.
+		_ringAllocator.Reset();
+		_ringOffset = _ringAllocator.Allocate(constantsSize);
+		mapType = D3D11_MAP_WRITE_DISCARD;
+		_ringDiscardCount++;
+		_ringNeedsDiscard = false;
+	}
+	_ringAllocator.EndFrame();
+
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	ThrowIfFailed(_deviceContext->Map(_ringBuffer.Get(), 0, mapType, 0, &mappedResource));
+	memcpy(static_cast<unsigned char *>(mappedResource.pData) + _ringOffset, constants, constantsSize);
+	_deviceContext->Unmap(_ringBuffer.Get(), 0);
+}
+
+void DirectXRenderCommandSink::EndFlush()
+{
+	// Put back the default states in case another renderer relies on them
+	float blendFactors[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	_deviceContext->OMSetBlendState(nullptr, blendFactors, 0xffffffff);
+	_deviceContext->RSSetState(nullptr);
+}
+
+void DirectXRenderCommandSink::SetPipeline(const void * pipeline)
+{
+	const RenderPipeline * renderPipeline = static_cast<const RenderPipeline *>(pipeline);
+	_deviceContext->VSSetShader(renderPipeline->VertexShader.Get(), 0, 0);
+	_deviceContext->PSSetShader(renderPipeline->PixelShader.Get(), 0, 0);
+	_deviceContext->IASetInputLayout(renderPipeline->InputLayout.Get());
+	_deviceContext->IASetPrimitiveTopology(renderPipeline->Topology);
+	float blendFactors[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	_deviceContext->OMSetBlendState(renderPipeline->BlendState.Get(), blendFactors, 0xffffffff);
+	_deviceContext->RSSetState(renderPipeline->RasterizerState.Get());
+	// The camera and lights are only used by the pixel shader
+	_deviceContext->PSSetConstantBuffers(FrameConstantsSlot, 1, renderPipeline->FrameConstantBuffer.GetAddressOf());
+}
+
+void DirectXRenderCommandSink::SetMaterialConstantBuffer(const void * constantBuffer)
+{
+	ID3D11Buffer * buffer = static_cast<ID3D11Buffer *>(const_cast<void *>(constantBuffer));
+	_deviceContext->PSSetConstantBuffers(MaterialConstantsSlot, 1, &buffer);
+}
+
+void DirectXRenderCommandSink::SetTexture(const void * texture)
+{
+	ID3D11ShaderResourceView * shaderResourceView = static_cast<ID3D11ShaderResourceView *>(const_cast<void *>(texture));
+	_deviceContext->PSSetShaderResources(0, 1, &shaderResourceView);
+}
+
+void DirectXRenderCommandSink::SetGeometry(const void * vertexBuffer, unsigned int vertexStride, const void * indexBuffer, unsigned int indexSize, const void * instanceBuffer)
+{
+	ID3D11Buffer * buffers[2] = { static_cast<ID3D11Buffer *>(const_cast<void *>(vertexBuffer)),
+								  static_cast<ID3D11Buffer *>(const_cast<void *>(instanceBuffer)) };
+	UINT strides[2] = { vertexStride, sizeof(XMFLOAT4X4) };
+	UINT offsets[2] = { 0, 0 };
+	_deviceContext->IASetVertexBuffers(0, instanceBuffer != nullptr ? 2 : 1, buffers, strides, offsets);
+	_deviceContext->IASetIndexBuffer(static_cast<ID3D11Buffer *>(const_cast<void *>(indexBuffer)), indexSize == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT, 0);
+}
+
+void DirectXRenderCommandSink::Draw(const DrawPacket& packet, const void * constants)
+{
+	if (constants != nullptr && _useRing)
+	{
+		// Constant buffer ranges are given in 16 byte constants
+		UINT firstConstant = static_cast<UINT>((_ringOffset + packet.ConstantsOffset) / 16);
+		UINT constantCount = static_cast<UINT>(RingAllocator::AlignSize(packet.ConstantsSize) / 16);
+		ID3D11Buffer * buffer = _ringBuffer.Get();
+		_deviceContext1->VSSetConstantBuffers1(ObjectConstantsSlot, 1, &buffer, &firstConstant, &constantCount);
+	}
+	else if (constants != nullptr)
+	{
+		if (packet.ConstantsSize > _objectConstantBufferSize)
+		{
+			_objectConstantBufferSize = RingAllocator::AlignSize(packet.ConstantsSize);
+			D3D11_BUFFER_DESC bufferDesc;
+			ZeroMemory(&bufferDesc, sizeof(bufferDesc));
+			bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+			bufferDesc.ByteWidth = static_cast<UINT>(_objectConstantBufferSize);
+			bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+			bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+			ThrowIfFailed(_device->CreateBuffer(&bufferDesc, NULL, _objectConstantBuffer.ReleaseAndGetAddressOf()));
+		}
+		D3D11_MAPPED_SUBRESOURCE mappedResource;
+		ThrowIfFailed(_deviceContext->Map(_objectConstantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
+		memcpy(mappedResource.pData, constants, packet.ConstantsSize);
+		_deviceContext->Unmap(_objectConstantBuffer.Get(), 0);
+		_deviceContext->VSSetConstantBuffers(ObjectConstantsSlot, 1, _objectConstantBuffer.GetAddressOf());
+	}
+	if (packet.InstanceCount > 0)
+	{
+		_deviceContext->DrawIndexedInstanced(packet.IndexCount, packet.InstanceCount, packet.StartIndex, packet.BaseVertex, packet.StartInstance);
+	}
+	else
+	{
+		_deviceContext->DrawIndexed(packet.IndexCount, packet.StartIndex, packet.BaseVertex);
+	}
+}
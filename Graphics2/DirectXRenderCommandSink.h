@@ -0,0 +1,76 @@
+#pragma once
+#include "DirectXCore.h"
+#include "RenderQueue.h"
+#include "RingAllocator.h"
+#include <d3d11_1.h>
+
+// The states a renderer sets once for all of its draws.  Renderers own one of these and pass
+// its address as the pipeline handle of their draw packets.
+struct RenderPipeline
+{
+	ComPtr<ID3D11VertexShader>			VertexShader;
+	ComPtr<ID3D11PixelShader>			PixelShader;
+	ComPtr<ID3D11InputLayout>			InputLayout;
+	ComPtr<ID3D11BlendState>			BlendState;			// Null for no blending
+	ComPtr<ID3D11RasterizerState>		RasterizerState;	// Null for the default state
+	D3D11_PRIMITIVE_TOPOLOGY			Topology;
+	ComPtr<ID3D11Buffer>				FrameConstantBuffer;	// FrameConstants, bound to b0
+	RenderStateId						SortId;
+};
+
+// Sends the draws from a RenderQueue to a Direct3D device context.  The handles in the draw
+// packets are:
+//   Pipeline        - RenderPipeline *
+//   MaterialConstantBuffer - ID3D11Buffer * holding MaterialConstants, bound to b1
+//   Texture         - ID3D11ShaderResourceView *
+//   VertexBuffer    - ID3D11Buffer * holding vertices of VertexStride bytes (VERTEX or PackedVertex)
+//   IndexBuffer     - ID3D11Buffer * holding 16 or 32-bit indices
+//   InstanceBuffer  - ID3D11Buffer * holding an XMFLOAT4X4 world transform per instance, bound to slot 1
+//
+// The per-object constants of the whole flush are copied into a dynamic ring buffer with a
+// single map, and each draw binds its own 256 byte aligned range of it to b2.  The ring is
+// mapped with NO_OVERWRITE, so the driver does not have to wait for or copy the parts the GPU is
+// still reading.  The GPU is assumed to be no more than MaxFramesInFlight frames behind; if the
+// ring is still full, it is mapped with DISCARD instead, which is always safe.  Drivers that
+// cannot bind constant buffer ranges get a small buffer that is rewritten for every draw.
+
+class DirectXRenderCommandSink : public RenderCommandSink
+{
+public:
+	DirectXRenderCommandSink(ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> deviceContext);
+
+	void								BeginFlush(const void * constants, size_t constantsSize);
+	void								EndFlush();
+
+	void								SetPipeline(const void * pipeline);
+	void								SetMaterialConstantBuffer(const void * constantBuffer);
+	void								SetTexture(const void * texture);
+	void								SetGeometry(const void * vertexBuffer, unsigned int vertexStride, const void * indexBuffer, unsigned int indexSize, const void * instanceBuffer);
+	void								Draw(const DrawPacket& packet, const void * constants);
+
+	// Bytes used in the ring by the last flush, and the number of times the ring had to be discarded
+	inline size_t						GetObjectConstantsSize() const { return _objectConstantsSize; }
+	inline unsigned int					GetRingDiscardCount() const { return _ringDiscardCount; }
+
+private:
+	static const unsigned int			MaxFramesInFlight = 3;
+
+	ComPtr<ID3D11Device>				_device;
+	ComPtr<ID3D11DeviceContext>			_deviceContext;
+	ComPtr<ID3D11DeviceContext1>		_deviceContext1;
+	bool								_useRing;
+
+	ComPtr<ID3D11Buffer>				_ringBuffer;
+	RingAllocator						_ringAllocator;
+	unsigned long long					_frameIndex;
+	size_t								_ringOffset;
+	size_t								_objectConstantsSize;
+	unsigned int						_ringDiscardCount;
+	bool								_ringNeedsDiscard;
+
+	// Used instead of the ring when constant buffer ranges cannot be bound
+	ComPtr<ID3D11Buffer>				_objectConstantBuffer;
+	size_t								_objectConstantBufferSize;
+
+	void								CreateRingBuffer(size_t size);
+};
@@ -0,0 +1,146 @@
+#include "FlatSceneGraph.h"
+
+bool FlatSceneGraph::Initialise(void)
+{
+	for (size_t index = 0; index < _transforms.GetCount(); index++)
+	{
+		TransformHierarchy::Handle handle = _transforms.GetHandle(index);
+		if (!_groups[handle] && !_nodes[handle]->Initialise())
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void FlatSceneGraph::Update(FXMMATRIX& currentWorldTransformation)
+{
+	SceneNode::Update(currentWorldTransformation);
+	_transforms.Update(XMLoadFloat4x4(&_combinedWorldTransformation));
+
+	for (size_t index = 0; index < _transforms.GetCount(); index++)
+	{
+		_nodes[_transforms.GetHandle(index)]->SetCombinedWorldTransform(_transforms.GetWorldTransformAt(index));
+	}
+}
+
+void FlatSceneGraph::UpdateIfChanged(FXMMATRIX& currentWorldTransformation, bool parentChanged, unsigned int& updatedCount)
+{
+	Update(currentWorldTransformation);
+	_transformDirty = false;
+	updatedCount += static_cast<unsigned int>(_transforms.GetCount()) + 1;
+}
+
+void FlatSceneGraph::Render(void)
+{
+	for (size_t index = 0; index < _transforms.GetCount(); index++)
+	{
+		TransformHierarchy::Handle handle = _transforms.GetHandle(index);
+		if (!_groups[handle])
+		{
+			_nodes[handle]->Render();
+		}
+	}
+}
+
+void FlatSceneGraph::Shutdown(void)
+{
+	for (size_t index = 0; index < _transforms.GetCount(); index++)
+	{
+		TransformHierarchy::Handle handle = _transforms.GetHandle(index);
+		if (!_groups[handle])
+		{
+			_nodes[handle]->Shutdown();
+		}
+	}
+}
+
+void FlatSceneGraph::Add(SceneNodePointer node)
+{
+	Add(node, nullptr);
+}
+
+void FlatSceneGraph::Add(SceneNodePointer node, SceneNodePointer parent)
+{
+	TransformHierarchy::Handle parentHandle = parent == nullptr ? TransformHierarchy::InvalidHandle : parent->GetTransformHandle();
+	AddSubtree(node, parentHandle, false);
+	// A SceneGraph moves the names of everything below it into the new index as well
+	_nameIndex->Add(node->GetInternedName(), node);
+	node->SetNameIndex(_nameIndex);
+}
+
+void FlatSceneGraph::AddSubtree(SceneNodePointer node, TransformHierarchy::Handle parentHandle, bool nested)
+{
+	TransformHierarchy::Handle handle = _transforms.Add(parentHandle);
+	if (static_cast<size_t>(handle) >= _nodes.size())
+	{
+		_nodes.resize(handle + 1);
+		_groups.resize(handle + 1);
+		_nested.resize(handle + 1);
+	}
+	_nodes[handle] = node;
+	node->AttachTransforms(&_transforms, handle);
+
+	SceneGraphPointer group = dynamic_pointer_cast<SceneGraph>(node);
+	_groups[handle] = group != nullptr;
+	_nested[handle] = nested;
+	if (group != nullptr)
+	{
+		for (const SceneNodePointer& child : group->GetChildren())
+		{
+			AddSubtree(child, handle, true);
+		}
+	}
+}
+
+void FlatSceneGraph::Remove(SceneNodePointer node)
+{
+	// The handle may belong to another graph's hierarchy
+	TransformHierarchy::Handle handle = node->GetTransformHandle();
+	if (handle == TransformHierarchy::InvalidHandle || static_cast<size_t>(handle) >= _nodes.size() || _nodes[handle] != node)
+	{
+		return;
+	}
+	std::vector<TransformHierarchy::Handle> removed;
+	_transforms.Remove(handle, removed);
+	for (TransformHierarchy::Handle removedHandle : removed)
+	{
+		SceneNodePointer removedNode = _nodes[removedHandle];
+		removedNode->AttachTransforms(nullptr, TransformHierarchy::InvalidHandle);
+		_nameIndex->Remove(removedNode->GetInternedName(), removedNode);
+		_nodes[removedHandle] = nullptr;
+		_groups[removedHandle] = false;
+		_nested[removedHandle] = false;
+	}
+	// The removed subtree gets an index of its own.  A flattened SceneGraph takes the names
+	// of its children with it.
+	node->SetNameIndex(make_shared<SceneNameIndex>());
+}
+
+SceneNodePointer FlatSceneGraph::Find(wstring name)
+{
+	if (name == *_name)
+	{
+		return shared_from_this();
+	}
+	return _nameIndex->Find(name);
+}
+
+void FlatSceneGraph::SetNameIndex(shared_ptr<SceneNameIndex> nameIndex)
+{
+	// Nodes from a flattened SceneGraph are moved by the SceneGraph
+	for (size_t index = 0; index < _transforms.GetCount(); index++)
+	{
+		TransformHierarchy::Handle handle = _transforms.GetHandle(index);
+		if (_nested[handle])
+		{
+			continue;
+		}
+		SceneNodePointer node = _nodes[handle];
+		_nameIndex->Remove(node->GetInternedName(), node);
+		nameIndex->Add(node->GetInternedName(), node);
+		node->SetNameIndex(nameIndex);
+	}
+	_nameIndex = nameIndex;
+	SceneNode::SetNameIndex(nameIndex);
+}
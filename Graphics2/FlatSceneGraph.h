@@ -0,0 +1,53 @@
+#pragma once
+#include "SceneGraph.h"
+#include "TransformHierarchy.h"
+#include <vector>
+
+// An alternative to SceneGraph for scenes with a large number of nodes.  Rather than each
+// composite holding a list of children and updating them recursively, all of the nodes are
+// held in one array and their transforms live in a TransformHierarchy.  Update works out
+// every world transform in a single linear pass and then hands each node its result, so
+// existing SceneNode classes can be added without any changes.
+//
+// The hierarchy is described by the parent passed to Add rather than by nesting composites.
+// A SceneGraph added here is flattened: each of its children (and theirs, and so on) becomes
+// a node of this graph below it, and the SceneGraph itself is only used for its transform and
+// name index, not initialised, rendered or shut down.  Children added to a nested SceneGraph
+// after it has been added here are not picked up - add them to this graph instead.
+
+class FlatSceneGraph : public SceneNode
+{
+public:
+	FlatSceneGraph() : SceneNode(L"Root") { _nameIndex = make_shared<SceneNameIndex>(); };
+	FlatSceneGraph(wstring name) : SceneNode(name) { _nameIndex = make_shared<SceneNameIndex>(); };
+	~FlatSceneGraph(void) {};
+
+	virtual bool Initialise(void);
+	virtual void Update(FXMMATRIX& currentWorldTransformation);
+	// The linear pass is cheap enough that every node is updated whether it has changed or not
+	virtual void UpdateIfChanged(FXMMATRIX& currentWorldTransformation, bool parentChanged, unsigned int& updatedCount);
+	virtual void Render(void);
+	virtual void Shutdown(void);
+
+	void Add(SceneNodePointer node);
+	// The parent must already have been added to this graph
+	void Add(SceneNodePointer node, SceneNodePointer parent);
+	// Removes the node and all of its descendants.  Nodes that are not in this graph are ignored.
+	void Remove(SceneNodePointer node);
+	SceneNodePointer Find(wstring name);
+	void SetNameIndex(shared_ptr<SceneNameIndex> nameIndex);
+
+	inline const TransformHierarchy& GetTransforms() const { return _transforms; }
+
+private:
+	TransformHierarchy					_transforms;
+	// Indexed by transform handle
+	std::vector<SceneNodePointer>		_nodes;
+	std::vector<bool>					_groups;			// Flattened SceneGraphs
+	std::vector<bool>					_nested;			// Named through a flattened SceneGraph
+	shared_ptr<SceneNameIndex>			_nameIndex;
+
+	void AddSubtree(SceneNodePointer node, TransformHierarchy::Handle parentHandle, bool nested);
+};
+
+typedef shared_ptr<FlatSceneGraph>		FlatSceneGraphPointer;
@@ -0,0 +1,96 @@
+#include "Frustum.h"
+#include <cmath>
+
+using namespace DirectX;
+
+Frustum::Frustum()
+{
+	// An empty frustum accepts everything
+	for (int i = 0; i < 6; i++)
+	{
+		_planes[i] = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+}
+
+Frustum::Frustum(FXMMATRIX viewProjection)
+{
+	SetFromMatrix(viewProjection);
+}
+
+void Frustum::SetFromMatrix(FXMMATRIX viewProjection)
+{
+	// DirectXMath uses row vectors, so each plane is a combination of the
+	// columns of the matrix (Gribb & Hartmann).  Direct3D clips z to 0..w,
+	// so the near plane is just the third column.
+	XMFLOAT4X4 m;
+	XMStoreFloat4x4(&m, viewProjection);
+
+	_planes[0] = XMFLOAT4(m._14 + m._11, m._24 + m._21, m._34 + m._31, m._44 + m._41);	// Left
+	_planes[1] = XMFLOAT4(m._14 - m._11, m._24 - m._21, m._34 - m._31, m._44 - m._41);	// Right
+	_planes[2] = XMFLOAT4(m._14 + m._12, m._24 + m._22, m._34 + m._32, m._44 + m._42);	// Bottom
+	_planes[3] = XMFLOAT4(m._14 - m._12, m._24 - m._22, m._34 - m._32, m._44 - m._42);	// Top
+	_planes[4] = XMFLOAT4(m._13, m._23, m._33, m._43);									// Near
+	_planes[5] = XMFLOAT4(m._14 - m._13, m._24 - m._23, m._34 - m._33, m._44 - m._43);	// Far
+
+	// Normalise the planes so that sphere tests can use the distance directly
+	for (int i = 0; i < 6; i++)
+	{
+		XMFLOAT4& plane = _planes[i];
+		float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+		if (length > 0.0f)
+		{
+			plane.x /= length;
+			plane.y /= length;
+			plane.z /= length;
+			plane.w /= length;
+		}
+	}
+}
+
+bool Frustum::IntersectsBox(const XMFLOAT3& boxMin, const XMFLOAT3& boxMax) const
+{
+	for (int i = 0; i < 6; i++)
+	{
+		const XMFLOAT4& plane = _planes[i];
+		// Test the corner of the box that is furthest along the plane normal.  If even
+		// that corner is outside, the whole box is outside.
+		float x = plane.x >= 0.0f ? boxMax.x : boxMin.x;
+		float y = plane.y >= 0.0f ? boxMax.y : boxMin.y;
+		float z = plane.z >= 0.0f ? boxMax.z : boxMin.z;
+		if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0.0f)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Frustum::IntersectsSphere(const XMFLOAT3& centre, float radius) const
+{
+	for (int i = 0; i < 6; i++)
+	{
+		const XMFLOAT4& plane = _planes[i];
+		if (plane.x * centre.x + plane.y * centre.y + plane.z * centre.z + plane.w < -radius)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Frustum::ContainsBox(const XMFLOAT3& boxMin, const XMFLOAT3& boxMax) const
+{
+	for (int i = 0; i < 6; i++)
+	{
+		const XMFLOAT4& plane = _planes[i];
+		// This time test the corner that is furthest behind the plane
+		float x = plane.x >= 0.0f ? boxMin.x : boxMax.x;
+		float y = plane.y >= 0.0f ? boxMin.y : boxMax.y;
+		float z = plane.z >= 0.0f ? boxMin.z : boxMax.z;
+		if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0.0f)
+		{
+			return false;
+		}
+	}
+	return true;
+}
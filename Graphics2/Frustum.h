@@ -0,0 +1,26 @@
+#pragma once
+#include <DirectXMath.h>
+
+// The six clipping planes of a view frustum, extracted from a combined (world *) view * projection
+// matrix.  The planes are in the space the matrix transforms from, so passing
+// world * view * projection gives a frustum that can be tested against object space bounds.
+
+class Frustum
+{
+public:
+	Frustum();
+	Frustum(DirectX::FXMMATRIX viewProjection);
+
+	void						SetFromMatrix(DirectX::FXMMATRIX viewProjection);
+
+	// These tests are conservative - they may report that a box or sphere that is just outside
+	// a corner of the frustum is visible, but never the reverse.
+	bool						IntersectsBox(const DirectX::XMFLOAT3& boxMin, const DirectX::XMFLOAT3& boxMax) const;
+	bool						IntersectsSphere(const DirectX::XMFLOAT3& centre, float radius) const;
+	// True only if the whole box is inside, so anything inside the box does not need testing
+	bool						ContainsBox(const DirectX::XMFLOAT3& boxMin, const DirectX::XMFLOAT3& boxMax) const;
+
+private:
+	// Each plane is stored as (a, b, c, d) where ax + by + cz + d >= 0 inside the frustum
+	DirectX::XMFLOAT4			_planes[6];
+};
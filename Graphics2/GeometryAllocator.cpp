@@ -0,0 +1,191 @@
+#include "GeometryAllocator.h"
+#include <iterator>
+
+// RangeAllocator methods
+
+RangeAllocator::RangeAllocator(size_t capacity)
+{
+	_capacity = capacity;
+	_used = 0;
+	if (capacity > 0)
+	{
+		_freeRanges[0] = capacity;
+	}
+}
+
+size_t RangeAllocator::Allocate(size_t size, size_t alignment)
+{
+	if (size == 0)
+	{
+		return InvalidOffset;
+	}
+	// Take the smallest free range that the allocation fits in once aligned
+	std::map<size_t, size_t>::iterator best = _freeRanges.end();
+	size_t bestOffset = 0;
+	for (std::map<size_t, size_t>::iterator it = _freeRanges.begin(); it != _freeRanges.end(); ++it)
+	{
+		size_t alignedOffset = (it->first + alignment - 1) / alignment * alignment;
+		size_t end = it->first + it->second;
+		if (alignedOffset + size <= end && (best == _freeRanges.end() || it->second < best->second))
+		{
+			best = it;
+			bestOffset = alignedOffset;
+		}
+	}
+	if (best == _freeRanges.end())
+	{
+		return InvalidOffset;
+	}
+
+	// Whatever is left before and after the allocation stays free
+	size_t rangeOffset = best->first;
+	size_t rangeEnd = best->first + best->second;
+	_freeRanges.erase(best);
+	if (bestOffset > rangeOffset)
+	{
+		_freeRanges[rangeOffset] = bestOffset - rangeOffset;
+	}
+	if (bestOffset + size < rangeEnd)
+	{
+		_freeRanges[bestOffset + size] = rangeEnd - (bestOffset + size);
+	}
+	_used += size;
+	return bestOffset;
+}
+
+void RangeAllocator::Free(size_t offset, size_t size)
+{
+	if (size == 0)
+	{
+		return;
+	}
+	_used -= size;
+
+	// Merge with the free ranges either side
+	std::map<size_t, size_t>::iterator next = _freeRanges.lower_bound(offset);
+	if (next != _freeRanges.end() && offset + size == next->first)
+	{
+		size += next->second;
+		next = _freeRanges.erase(next);
+	}
+	if (next != _freeRanges.begin())
+	{
+		std::map<size_t, size_t>::iterator previous = std::prev(next);
+		if (previous->first + previous->second == offset)
+		{
+			previous->second += size;
+			return;
+		}
+	}
+	_freeRanges[offset] = size;
+}
+
+size_t RangeAllocator::GetLargestFreeRange() const
+{
+	size_t largest = 0;
+	for (const std::pair<const size_t, size_t>& range : _freeRanges)
+	{
+		largest = range.second > largest ? range.second : largest;
+	}
+	return largest;
+}
+
+float RangeAllocator::GetFragmentation() const
+{
+	size_t freeSpace = _capacity - _used;
+	if (freeSpace == 0)
+	{
+		return 0.0f;
+	}
+	return 1.0f - static_cast<float>(GetLargestFreeRange()) / static_cast<float>(freeSpace);
+}
+
+// GeometryAllocator methods
+
+GeometryAllocator::GeometryAllocator(size_t vertexPageSize, size_t indexPageSize)
+{
+	_vertexPageSize = RoundUp(vertexPageSize, VertexAlignment);
+	_indexPageSize = RoundUp(indexPageSize, IndexAlignment);
+	_allocationCount = 0;
+}
+
+size_t GeometryAllocator::RoundUp(size_t size, size_t alignment)
+{
+	// Sizes are rounded up as well as offsets, so that the free ranges stay aligned
+	size = size > 0 ? size : 1;
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+GeometryAllocation GeometryAllocator::Allocate(size_t vertexSize, size_t indexSize)
+{
+	GeometryAllocation allocation;
+	allocation.VertexSize = RoundUp(vertexSize, VertexAlignment);
+	allocation.IndexSize = RoundUp(indexSize, IndexAlignment);
+	for (unsigned int page = 0; page < _pages.size(); page++)
+	{
+		// Both ranges have to come from the same page
+		size_t vertexOffset = _pages[page].Vertices.Allocate(allocation.VertexSize, VertexAlignment);
+		if (vertexOffset == RangeAllocator::InvalidOffset)
+		{
+			continue;
+		}
+		size_t indexOffset = _pages[page].Indices.Allocate(allocation.IndexSize, IndexAlignment);
+		if (indexOffset == RangeAllocator::InvalidOffset)
+		{
+			_pages[page].Vertices.Free(vertexOffset, allocation.VertexSize);
+			continue;
+		}
+		allocation.Page = page;
+		allocation.VertexOffset = vertexOffset;
+		allocation.IndexOffset = indexOffset;
+		_allocationCount++;
+		return allocation;
+	}
+
+	// Nothing has room, so add a page that is big enough
+	size_t vertexPageSize = allocation.VertexSize > _vertexPageSize ? allocation.VertexSize : _vertexPageSize;
+	size_t indexPageSize = allocation.IndexSize > _indexPageSize ? allocation.IndexSize : _indexPageSize;
+	_pages.push_back({ RangeAllocator(vertexPageSize), RangeAllocator(indexPageSize) });
+	allocation.Page = static_cast<unsigned int>(_pages.size() - 1);
+	allocation.VertexOffset = _pages.back().Vertices.Allocate(allocation.VertexSize, VertexAlignment);
+	allocation.IndexOffset = _pages.back().Indices.Allocate(allocation.IndexSize, IndexAlignment);
+	_allocationCount++;
+	return allocation;
+}
+
+void GeometryAllocator::Free(const GeometryAllocation& allocation)
+{
+	if (allocation.Page >= _pages.size())
+	{
+		return;
+	}
+	// Pages are kept once they have been added, since their buffers are likely to be needed again
+	_pages[allocation.Page].Vertices.Free(allocation.VertexOffset, allocation.VertexSize);
+	_pages[allocation.Page].Indices.Free(allocation.IndexOffset, allocation.IndexSize);
+	_allocationCount--;
+}
+
+GeometryArenaStatistics GeometryAllocator::GetStatistics() const
+{
+	GeometryArenaStatistics statistics = {};
+	statistics.PageCount = GetPageCount();
+	statistics.AllocationCount = _allocationCount;
+	for (const Page& page : _pages)
+	{
+		statistics.VertexCapacity += page.Vertices.GetCapacity();
+		statistics.VertexBytesUsed += page.Vertices.GetUsed();
+		statistics.IndexCapacity += page.Indices.GetCapacity();
+		statistics.IndexBytesUsed += page.Indices.GetUsed();
+		statistics.FreeRangeCount += page.Vertices.GetFreeRangeCount() + page.Indices.GetFreeRangeCount();
+		size_t largestVertexRange = page.Vertices.GetLargestFreeRange();
+		size_t largestIndexRange = page.Indices.GetLargestFreeRange();
+		statistics.LargestFreeVertexRange = largestVertexRange > statistics.LargestFreeVertexRange ? largestVertexRange : statistics.LargestFreeVertexRange;
+		statistics.LargestFreeIndexRange = largestIndexRange > statistics.LargestFreeIndexRange ? largestIndexRange : statistics.LargestFreeIndexRange;
+	}
+	// Free space in different pages is in different buffers, so it counts as fragmented
+	size_t freeVertexBytes = statistics.VertexCapacity - statistics.VertexBytesUsed;
+	size_t freeIndexBytes = statistics.IndexCapacity - statistics.IndexBytesUsed;
+	statistics.VertexFragmentation = freeVertexBytes > 0 ? 1.0f - static_cast<float>(statistics.LargestFreeVertexRange) / static_cast<float>(freeVertexBytes) : 0.0f;
+	statistics.IndexFragmentation = freeIndexBytes > 0 ? 1.0f - static_cast<float>(statistics.LargestFreeIndexRange) / static_cast<float>(freeIndexBytes) : 0.0f;
+	return statistics;
+}
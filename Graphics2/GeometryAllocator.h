@@ -0,0 +1,102 @@
+#pragma once
+#include <cstddef>
+#include <map>
+#include <vector>
+
+// Hands out ranges of the shared vertex and index buffers that sub-meshes are stored in.
+//
+// RangeAllocator keeps a free list of byte ranges in one buffer.  Allocations take the smallest
+// free range they fit in, and freed ranges are merged with the free ranges either side of them,
+// so space given back by meshes that are released can be used again.
+//
+// GeometryAllocator pairs a vertex and an index RangeAllocator into a page, and adds pages when
+// none have room.  Each page becomes one vertex buffer and one index buffer (see GeometryArena.h),
+// so sub-meshes in the same page are drawn without changing buffers, only the base vertex and
+// start index.  Neither class uses Direct3D, so the fragmentation and utilisation can be checked
+// without a GPU.
+
+class RangeAllocator
+{
+public:
+	static const size_t					InvalidOffset = static_cast<size_t>(-1);
+
+	RangeAllocator(size_t capacity);
+
+	// Returns the offset of the range, which is a multiple of alignment, or InvalidOffset if
+	// there is no free range big enough
+	size_t								Allocate(size_t size, size_t alignment);
+	// size must be the size that was given to Allocate
+	void								Free(size_t offset, size_t size);
+
+	inline size_t						GetCapacity() const { return _capacity; }
+	inline size_t						GetUsed() const { return _used; }
+	inline size_t						GetFreeRangeCount() const { return _freeRanges.size(); }
+	size_t								GetLargestFreeRange() const;
+	// 0 when all of the free space is in one range, getting closer to 1 as it is split up
+	float								GetFragmentation() const;
+
+private:
+	size_t								_capacity;
+	size_t								_used;
+	std::map<size_t, size_t>			_freeRanges;		// Offset to size
+};
+
+struct GeometryAllocation
+{
+	unsigned int						Page;
+	size_t								VertexOffset;		// In bytes
+	size_t								VertexSize;
+	size_t								IndexOffset;
+	size_t								IndexSize;
+};
+
+struct GeometryArenaStatistics
+{
+	unsigned int						PageCount;
+	unsigned int						AllocationCount;
+	size_t								VertexCapacity;
+	size_t								VertexBytesUsed;
+	size_t								IndexCapacity;
+	size_t								IndexBytesUsed;
+	size_t								FreeRangeCount;
+	size_t								LargestFreeVertexRange;
+	size_t								LargestFreeIndexRange;
+	// As RangeAllocator::GetFragmentation, over the free space of all pages
+	float								VertexFragmentation;
+	float								IndexFragmentation;
+};
+
+class GeometryAllocator
+{
+public:
+	// Vertex ranges start on a multiple of 32 bytes, so both the 32 byte VERTEX and the 16 byte
+	// PackedVertex can be reached with a base vertex.  Index ranges start on a multiple of 4
+	// bytes, which suits both 16 and 32-bit indices.
+	static const size_t					VertexAlignment = 32;
+	static const size_t					IndexAlignment = 4;
+
+	GeometryAllocator(size_t vertexPageSize, size_t indexPageSize);
+
+	// Adds a page if no page has room.  Geometry bigger than a page gets a page of its own.
+	GeometryAllocation					Allocate(size_t vertexSize, size_t indexSize);
+	void								Free(const GeometryAllocation& allocation);
+
+	inline unsigned int					GetPageCount() const { return static_cast<unsigned int>(_pages.size()); }
+	inline size_t						GetVertexPageSize(unsigned int page) const { return _pages[page].Vertices.GetCapacity(); }
+	inline size_t						GetIndexPageSize(unsigned int page) const { return _pages[page].Indices.GetCapacity(); }
+	GeometryArenaStatistics				GetStatistics() const;
+
+private:
+	struct Page
+	{
+		RangeAllocator					Vertices;
+		RangeAllocator					Indices;
+	};
+
+	size_t								_vertexPageSize;
+	size_t								_indexPageSize;
+	std::vector<Page>					_pages;
+	unsigned int						_allocationCount;
+
+	static size_t						RoundUp(size_t size, size_t alignment);
+};
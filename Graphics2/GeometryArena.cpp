@@ -0,0 +1,82 @@
+#include "GeometryArena.h"
+
+GeometryArena::GeometryArena(ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> deviceContext, size_t vertexPageSize, size_t indexPageSize) :
+	_allocator(vertexPageSize, indexPageSize)
+{
+	_device = device;
+	_deviceContext = deviceContext;
+}
+
+bool GeometryArena::Allocate(const PackedGeometry& geometry, GeometryAllocation& allocation)
+{
+	allocation = _allocator.Allocate(geometry.Vertices.size(), geometry.Indices.size());
+	if ((allocation.Page >= _vertexBuffers.size() || _vertexBuffers[allocation.Page] == nullptr) && !CreatePageBuffers(allocation.Page))
+	{
+		_allocator.Free(allocation);
+		return false;
+	}
+	CopyToBuffer(_vertexBuffers[allocation.Page].Get(), allocation.VertexOffset, geometry.Vertices);
+	CopyToBuffer(_indexBuffers[allocation.Page].Get(), allocation.IndexOffset, geometry.Indices);
+	return true;
+}
+
+void GeometryArena::Free(const GeometryAllocation& allocation)
+{
+	_allocator.Free(allocation);
+}
+
+bool GeometryArena::CreatePageBuffers(unsigned int page)
+{
+	// The buffers are default usage rather than immutable so that ranges can be filled
+	// again after they have been freed
+	D3D11_BUFFER_DESC vertexBufferDescriptor;
+	vertexBufferDescriptor.Usage = D3D11_USAGE_DEFAULT;
+	vertexBufferDescriptor.ByteWidth = static_cast<UINT>(_allocator.GetVertexPageSize(page));
+	vertexBufferDescriptor.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vertexBufferDescriptor.CPUAccessFlags = 0;
+	vertexBufferDescriptor.MiscFlags = 0;
+	vertexBufferDescriptor.StructureByteStride = 0;
+	ComPtr<ID3D11Buffer> vertexBuffer;
+	if (FAILED(_device->CreateBuffer(&vertexBufferDescriptor, nullptr, vertexBuffer.GetAddressOf())))
+	{
+		return false;
+	}
+
+	D3D11_BUFFER_DESC indexBufferDescriptor;
+	indexBufferDescriptor.Usage = D3D11_USAGE_DEFAULT;
+	indexBufferDescriptor.ByteWidth = static_cast<UINT>(_allocator.GetIndexPageSize(page));
+	indexBufferDescriptor.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	indexBufferDescriptor.CPUAccessFlags = 0;
+	indexBufferDescriptor.MiscFlags = 0;
+	indexBufferDescriptor.StructureByteStride = 0;
+	ComPtr<ID3D11Buffer> indexBuffer;
+	if (FAILED(_device->CreateBuffer(&indexBufferDescriptor, nullptr, indexBuffer.GetAddressOf())))
+	{
+		return false;
+	}
+
+	if (page >= _vertexBuffers.size())
+	{
+		_vertexBuffers.resize(page + 1);
+		_indexBuffers.resize(page + 1);
+	}
+	_vertexBuffers[page] = vertexBuffer;
+	_indexBuffers[page] = indexBuffer;
+	return true;
+}
+
+void GeometryArena::CopyToBuffer(ID3D11Buffer * buffer, size_t offset, const vector<unsigned char>& data)
+{
+	if (data.empty())
+	{
+		return;
+	}
+	D3D11_BOX box;
+	box.left = static_cast<UINT>(offset);
+	box.right = static_cast<UINT>(offset + data.size());
+	box.top = 0;
+	box.bottom = 1;
+	box.front = 0;
+	box.back = 1;
+	_deviceContext->UpdateSubresource(buffer, 0, &box, data.data(), 0, 0);
+}
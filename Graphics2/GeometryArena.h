@@ -0,0 +1,42 @@
+#pragma once
+#include "core.h"
+#include "DirectXCore.h"
+#include "GeometryAllocator.h"
+#include "VertexPacker.h"
+
+// The vertex and index buffers that every mesh's sub-meshes are stored in.  Each page of the
+// GeometryAllocator is one large vertex buffer and one large index buffer, and sub-meshes are
+// copied into ranges of them.  A sub-mesh gives its range back when it is destroyed, so meshes
+// can be loaded and released without the buffers being made again.
+//
+// Sub-meshes are drawn with the page's buffers, using the base vertex and start index of their
+// range, so sub-meshes in the same page do not change the buffers that are set.
+
+class GeometryArena
+{
+public:
+	// 16MB of vertices and 8MB of indices in each page
+	static const size_t					DefaultVertexPageSize = 16 * 1024 * 1024;
+	static const size_t					DefaultIndexPageSize = 8 * 1024 * 1024;
+
+	GeometryArena(ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> deviceContext,
+				  size_t vertexPageSize = DefaultVertexPageSize, size_t indexPageSize = DefaultIndexPageSize);
+
+	// Copies the geometry into the arena.  Must be called on the device thread.
+	bool								Allocate(const PackedGeometry& geometry, GeometryAllocation& allocation);
+	void								Free(const GeometryAllocation& allocation);
+
+	inline ComPtr<ID3D11Buffer>			GetVertexBuffer(unsigned int page) { return _vertexBuffers[page]; }
+	inline ComPtr<ID3D11Buffer>			GetIndexBuffer(unsigned int page) { return _indexBuffers[page]; }
+	inline GeometryArenaStatistics		GetStatistics() const { return _allocator.GetStatistics(); }
+
+private:
+	ComPtr<ID3D11Device>				_device;
+	ComPtr<ID3D11DeviceContext>			_deviceContext;
+	GeometryAllocator					_allocator;
+	vector<ComPtr<ID3D11Buffer>>		_vertexBuffers;
+	vector<ComPtr<ID3D11Buffer>>		_indexBuffers;
+
+	bool								CreatePageBuffers(unsigned int page);
+	void								CopyToBuffer(ID3D11Buffer * buffer, size_t offset, const vector<unsigned char>& data);
+};
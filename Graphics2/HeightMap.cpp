@@ -0,0 +1,36 @@
+#include "HeightMap.h"
+#include <cmath>
+
+HeightMap::HeightMap()
+{
+	_samples = nullptr;
+	_width = 0;
+}
+
+bool HeightMap::Load(const std::wstring& fileName)
+{
+	Unload();
+	if (!_file.Open(fileName))
+	{
+		return false;
+	}
+	// The file holds two bytes per sample.  If it is not an exact square, only the
+	// largest square that fits in the file is used.
+	size_t sampleCount = _file.GetSize() / sizeof(uint16_t);
+	int width = static_cast<int>(std::sqrt(static_cast<double>(sampleCount)));
+	if (width == 0)
+	{
+		_file.Close();
+		return false;
+	}
+	_samples = static_cast<const uint16_t *>(_file.GetData());
+	_width = width;
+	return true;
+}
+
+void HeightMap::Unload()
+{
+	_file.Close();
+	_samples = nullptr;
+	_width = 0;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "MappedFile.h"
+#include <cstdint>
+
+// A square height map of 16-bit samples held in a raw file.  The file is mapped into memory
+// and the samples are read in place - they are only converted to floating point values
+// (in the range 0 - 1) when a height is requested.
+
+class HeightMap
+{
+public:
+	HeightMap();
+
+	bool						Load(const std::wstring& fileName);
+	void						Unload();
+
+	inline bool					IsLoaded() const { return _samples != nullptr; }
+	// Number of samples along each side of the height map
+	inline int					GetWidth() const { return _width; }
+	inline const uint16_t *		GetSamples() const { return _samples; }
+	inline float				GetHeight(int x, int z) const { return _samples[static_cast<size_t>(z) * _width + x] / 65536.0f; }
+
+private:
+	MappedFile					_file;
+	const uint16_t *			_samples;
+	int							_width;
+};
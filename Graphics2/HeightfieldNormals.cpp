@@ -0,0 +1,111 @@
+#include "HeightfieldNormals.h"
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define HEIGHTFIELD_NORMALS_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HEIGHTFIELD_NORMALS_SSE
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	inline void ComputeNormal(const float * rowAbove, const float * row, const float * rowBelow, int x, int left, int right,
+							  float cellSize, float zDistance, XMFLOAT3& normal)
+	{
+		float normalX = (row[left] - row[right]) / ((right - left) * cellSize);
+		float normalZ = (rowBelow[x] - rowAbove[x]) / zDistance;
+		float length = std::sqrt(normalX * normalX + 1.0f + normalZ * normalZ);
+		normal = XMFLOAT3(normalX / length, 1.0f / length, normalZ / length);
+	}
+}
+
+void ComputeNormalRowScalar(const float * rowAbove, const float * row, const float * rowBelow, int count,
+							float cellSize, int rowSpacing, XMFLOAT3 * normals)
+{
+	float zDistance = rowSpacing * cellSize;
+	for (int x = 0; x < count; x++)
+	{
+		int left = x > 0 ? x - 1 : x;
+		int right = x < count - 1 ? x + 1 : x;
+		ComputeNormal(rowAbove, row, rowBelow, x, left, right, cellSize, zDistance, normals[x]);
+	}
+}
+
+void ComputeNormalRow(const float * rowAbove, const float * row, const float * rowBelow, int count,
+					  float cellSize, int rowSpacing, XMFLOAT3 * normals)
+{
+#if defined(HEIGHTFIELD_NORMALS_AVX) || defined(HEIGHTFIELD_NORMALS_SSE)
+	if (count < 3)
+	{
+		ComputeNormalRowScalar(rowAbove, row, rowBelow, count, cellSize, rowSpacing, normals);
+		return;
+	}
+
+	// The two end vertices use one sided differences, so they are done separately
+	float zDistance = rowSpacing * cellSize;
+	ComputeNormal(rowAbove, row, rowBelow, 0, 0, 1, cellSize, zDistance, normals[0]);
+	ComputeNormal(rowAbove, row, rowBelow, count - 1, count - 2, count - 1, cellSize, zDistance, normals[count - 1]);
+
+	// The operations are done in the same order as the scalar path, and division and square
+	// root are correctly rounded, so the results match it exactly.  The normals are worked out
+	// for a block of vertices at a time and then interleaved into the output.
+	float xDistance = 2 * cellSize;
+	int x = 1;
+	int last = count - 1;
+#if defined(HEIGHTFIELD_NORMALS_AVX)
+	const int width = 8;
+	alignas(32) float normalX[width];
+	alignas(32) float normalY[width];
+	alignas(32) float normalZ[width];
+	__m256 xDistances = _mm256_set1_ps(xDistance);
+	__m256 zDistances = _mm256_set1_ps(zDistance);
+	__m256 ones = _mm256_set1_ps(1.0f);
+	for (; x + width <= last; x += width)
+	{
+		__m256 dx = _mm256_div_ps(_mm256_sub_ps(_mm256_loadu_ps(row + x - 1), _mm256_loadu_ps(row + x + 1)), xDistances);
+		__m256 dz = _mm256_div_ps(_mm256_sub_ps(_mm256_loadu_ps(rowBelow + x), _mm256_loadu_ps(rowAbove + x)), zDistances);
+		__m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), ones), _mm256_mul_ps(dz, dz)));
+		_mm256_store_ps(normalX, _mm256_div_ps(dx, length));
+		_mm256_store_ps(normalY, _mm256_div_ps(ones, length));
+		_mm256_store_ps(normalZ, _mm256_div_ps(dz, length));
+		for (int i = 0; i < width; i++)
+		{
+			normals[x + i] = XMFLOAT3(normalX[i], normalY[i], normalZ[i]);
+		}
+	}
+#else
+	const int width = 4;
+	alignas(16) float normalX[width];
+	alignas(16) float normalY[width];
+	alignas(16) float normalZ[width];
+	__m128 xDistances = _mm_set1_ps(xDistance);
+	__m128 zDistances = _mm_set1_ps(zDistance);
+	__m128 ones = _mm_set1_ps(1.0f);
+	for (; x + width <= last; x += width)
+	{
+		__m128 dx = _mm_div_ps(_mm_sub_ps(_mm_loadu_ps(row + x - 1), _mm_loadu_ps(row + x + 1)), xDistances);
+		__m128 dz = _mm_div_ps(_mm_sub_ps(_mm_loadu_ps(rowBelow + x), _mm_loadu_ps(rowAbove + x)), zDistances);
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), ones), _mm_mul_ps(dz, dz)));
+		_mm_store_ps(normalX, _mm_div_ps(dx, length));
+		_mm_store_ps(normalY, _mm_div_ps(ones, length));
+		_mm_store_ps(normalZ, _mm_div_ps(dz, length));
+		for (int i = 0; i < width; i++)
+		{
+			normals[x + i] = XMFLOAT3(normalX[i], normalY[i], normalZ[i]);
+		}
+	}
+#endif
+
+	// Whatever is left over at the end of the row
+	for (; x < last; x++)
+	{
+		ComputeNormal(rowAbove, row, rowBelow, x, x - 1, x + 1, cellSize, zDistance, normals[x]);
+	}
+#else
+	ComputeNormalRowScalar(rowAbove, row, rowBelow, count, cellSize, rowSpacing, normals);
+#endif
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <DirectXMath.h>
+
+// Smooth per-vertex normals for a regular heightfield, one row at a time.  Each normal is the
+// central difference of the heights either side of the vertex (a one sided difference at the
+// ends of the row).  Moving down a row moves towards -z, so the z component is taken from
+// (below - above).
+//
+// rowSpacing is the number of rows between rowAbove and rowBelow - 2 for an interior row, or 1
+// at the edges of the grid where one of them is the row itself.
+//
+// The SSE and AVX paths give bit-identical results to the scalar path, as long as the compiler
+// does not fuse multiplies and adds into FMA instructions (HeightfieldNormals.cpp is built with
+// /fp:precise or -ffp-contract=off).  They are used when the compiler targets them, otherwise
+// ComputeNormalRow falls back to the scalar version.
+
+void ComputeNormalRow(const float * rowAbove, const float * row, const float * rowBelow, int count,
+					  float cellSize, int rowSpacing, DirectX::XMFLOAT3 * normals);
+
+void ComputeNormalRowScalar(const float * rowAbove, const float * row, const float * rowBelow, int count,
+							float cellSize, int rowSpacing, DirectX::XMFLOAT3 * normals);
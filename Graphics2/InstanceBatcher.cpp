@@ -0,0 +1,52 @@
+#include "InstanceBatcher.h"
+
+using namespace DirectX;
+
+void InstanceBatcher::Add(const void * mesh, const XMFLOAT4X4& worldTransformation)
+{
+	auto it = _groupIndices.find(mesh);
+	unsigned int groupIndex;
+	if (it == _groupIndices.end())
+	{
+		groupIndex = static_cast<unsigned int>(_groups.size());
+		_groupIndices[mesh] = groupIndex;
+		_groups.push_back({ mesh, 0, 0 });
+	}
+	else
+	{
+		groupIndex = it->second;
+	}
+	_groups[groupIndex].InstanceCount++;
+	_instances.push_back({ groupIndex, worldTransformation });
+}
+
+void InstanceBatcher::Build()
+{
+	// A counting sort on the group index - the counts are already known, so each group's
+	// range is found first and then the transforms are copied straight into place
+	unsigned int firstInstance = 0;
+	for (InstanceGroup& group : _groups)
+	{
+		group.FirstInstance = firstInstance;
+		firstInstance += group.InstanceCount;
+	}
+
+	_instanceTransforms.resize(_instances.size());
+	std::vector<unsigned int> nextInstance(_groups.size());
+	for (size_t i = 0; i < _groups.size(); i++)
+	{
+		nextInstance[i] = _groups[i].FirstInstance;
+	}
+	for (const Instance& instance : _instances)
+	{
+		_instanceTransforms[nextInstance[instance.GroupIndex]++] = instance.WorldTransformation;
+	}
+}
+
+void InstanceBatcher::Clear()
+{
+	_instances.clear();
+	_groupIndices.clear();
+	_groups.clear();
+	_instanceTransforms.clear();
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <DirectXMath.h>
+#include <unordered_map>
+#include <vector>
+
+// Groups the objects drawn in a frame by the mesh they use, so that each mesh can be drawn once
+// for all of its instances.  The world transforms of each group are packed next to each other,
+// ready to be copied into a per-instance vertex buffer.
+//
+// Groups are in the order their mesh was first added, and instances keep the order they were
+// added in, so the output only depends on the order of the calls to Add.  No DirectX device is
+// needed, so the grouping can be checked on its own.
+
+struct InstanceGroup
+{
+	const void *							Mesh;
+	unsigned int							FirstInstance;
+	unsigned int							InstanceCount;
+};
+
+class InstanceBatcher
+{
+public:
+	void									Add(const void * mesh, const DirectX::XMFLOAT4X4& worldTransformation);
+
+	// Groups and packs everything added since the last call to Clear
+	void									Build();
+	void									Clear();
+
+	inline const std::vector<InstanceGroup>&			GetGroups() const { return _groups; }
+	inline const std::vector<DirectX::XMFLOAT4X4>&		GetInstanceTransforms() const { return _instanceTransforms; }
+	inline unsigned int						GetInstanceCount() const { return static_cast<unsigned int>(_instanceTransforms.size()); }
+
+private:
+	struct Instance
+	{
+		unsigned int						GroupIndex;
+		DirectX::XMFLOAT4X4					WorldTransformation;
+	};
+
+	std::vector<Instance>					_instances;
+	std::unordered_map<const void *, unsigned int>	_groupIndices;
+	std::vector<InstanceGroup>				_groups;
+	std::vector<DirectX::XMFLOAT4X4>		_instanceTransforms;
+};
@@ -0,0 +1,215 @@
+#include "LightClusters.h"
+#include "ThreadPool.h"
+#include <cmath>
+
+using namespace DirectX;
+
+LightClusters::LightClusters(unsigned int tilesX, unsigned int tilesY, unsigned int slices)
+{
+	_tilesX = tilesX > 0 ? tilesX : 1;
+	_tilesY = tilesY > 0 ? tilesY : 1;
+	_slices = slices > 0 ? slices : 1;
+	_near = 1.0f;
+	_far = 1000.0f;
+	_projectionScaleX = 1.0f;
+	_projectionScaleY = 1.0f;
+	_clusterLights.resize(GetClusterCount());
+	_clusterRanges.resize(GetClusterCount());
+	_statistics = {};
+}
+
+unsigned int LightClusters::GetSlice(float viewDepth) const
+{
+	if (viewDepth <= _near)
+	{
+		return 0;
+	}
+	int slice = static_cast<int>(std::log(viewDepth / _near) / std::log(_far / _near) * static_cast<float>(_slices));
+	return slice < static_cast<int>(_slices) ? static_cast<unsigned int>(slice) : _slices - 1;
+}
+
+float LightClusters::GetSliceDepth(unsigned int slice) const
+{
+	// The near edge of the slice.  Slice _slices gives the far plane.
+	return _near * std::pow(_far / _near, static_cast<float>(slice) / static_cast<float>(_slices));
+}
+
+void LightClusters::Build(const std::vector<ClusterLight>& lights, FXMMATRIX view, CXMMATRIX projection, ThreadPool * threadPool)
+{
+	// Take the near and far planes from the projection.  For a left handed perspective
+	// projection, _33 = f / (f - n) and _43 = -n * f / (f - n).
+	XMFLOAT4X4 projectionValues;
+	XMStoreFloat4x4(&projectionValues, projection);
+	_near = -projectionValues._43 / projectionValues._33;
+	_far = projectionValues._43 / (1.0f - projectionValues._33);
+	_projectionScaleX = projectionValues._11;
+	_projectionScaleY = projectionValues._22;
+
+	unsigned int lightCount = static_cast<unsigned int>(lights.size());
+	_centreX.resize(lightCount);
+	_centreY.resize(lightCount);
+	_centreZ.resize(lightCount);
+	_radius.resize(lightCount);
+	if (threadPool != nullptr)
+	{
+		threadPool->ParallelFor(lightCount, [&](unsigned int begin, unsigned int end) { TransformLights(lights, view, begin, end); });
+		threadPool->ParallelForEach(_slices, [&](unsigned int slice) { BinSlice(slice); });
+	}
+	else
+	{
+		TransformLights(lights, view, 0, lightCount);
+		for (unsigned int slice = 0; slice < _slices; slice++)
+		{
+			BinSlice(slice);
+		}
+	}
+
+	// Join the clusters' lists into one, in cluster order, so the result does not depend on
+	// which thread binned which slice
+	_statistics = {};
+	_statistics.LightCount = lightCount;
+	_lightIndices.clear();
+	for (unsigned int cluster = 0; cluster < GetClusterCount(); cluster++)
+	{
+		const std::vector<unsigned int>& clusterLights = _clusterLights[cluster];
+		unsigned int count = static_cast<unsigned int>(clusterLights.size());
+		_clusterRanges[cluster].Offset = static_cast<unsigned int>(_lightIndices.size());
+		_clusterRanges[cluster].Count = count;
+		_lightIndices.insert(_lightIndices.end(), clusterLights.begin(), clusterLights.end());
+		_statistics.MaximumLightsInCluster = count > _statistics.MaximumLightsInCluster ? count : _statistics.MaximumLightsInCluster;
+	}
+	_statistics.LightIndexCount = static_cast<unsigned int>(_lightIndices.size());
+	for (unsigned int light = 0; light < lightCount; light++)
+	{
+		if (_centreZ[light] + _radius[light] > _near && _centreZ[light] - _radius[light] < _far)
+		{
+			_statistics.LightsInView++;
+		}
+	}
+}
+
+void LightClusters::GetBoundingSphere(const ClusterLight& light, XMFLOAT3& centre, float& radius)
+{
+	centre = light.Position;
+	radius = light.Range;
+	if (light.SpotCosine > 0.0f)
+	{
+		// The smallest sphere around the cone.  Narrow cones fit a sphere that passes through
+		// the apex and the rim, wide ones a sphere centred on the middle of the rim.
+		float sine = std::sqrt(1.0f - light.SpotCosine * light.SpotCosine);
+		float distance;
+		if (light.SpotCosine > 0.70710678f)
+		{
+			distance = light.Range / (2.0f * light.SpotCosine);
+			radius = distance;
+		}
+		else
+		{
+			distance = light.Range * light.SpotCosine;
+			radius = light.Range * sine;
+		}
+		centre.x += light.Direction.x * distance;
+		centre.y += light.Direction.y * distance;
+		centre.z += light.Direction.z * distance;
+	}
+}
+
+void LightClusters::TransformLights(const std::vector<ClusterLight>& lights, FXMMATRIX view, unsigned int first, unsigned int last)
+{
+	XMFLOAT4X4 viewValues;
+	XMStoreFloat4x4(&viewValues, view);
+	for (unsigned int light = first; light < last; light++)
+	{
+		XMFLOAT3 centre;
+		float radius;
+		GetBoundingSphere(lights[light], centre, radius);
+		_centreX[light] = centre.x * viewValues._11 + centre.y * viewValues._21 + centre.z * viewValues._31 + viewValues._41;
+		_centreY[light] = centre.x * viewValues._12 + centre.y * viewValues._22 + centre.z * viewValues._32 + viewValues._42;
+		_centreZ[light] = centre.x * viewValues._13 + centre.y * viewValues._23 + centre.z * viewValues._33 + viewValues._43;
+		_radius[light] = radius;
+	}
+}
+
+float LightClusters::GetDistanceToTile(float centre, float minimum, float maximum, float projectionScale, float sliceNear, float sliceFar)
+{
+	// The tile's edges in normalised device coordinates are planes through the eye, so across
+	// the slice they are furthest out at its far end
+	float lowest = minimum * (minimum < 0.0f ? sliceFar : sliceNear) / projectionScale;
+	float highest = maximum * (maximum > 0.0f ? sliceFar : sliceNear) / projectionScale;
+	return lowest - centre > 0.0f ? lowest - centre : (centre - highest > 0.0f ? centre - highest : 0.0f);
+}
+
+void LightClusters::BinSlice(unsigned int slice)
+{
+	unsigned int firstCluster = GetClusterIndex(0, 0, slice);
+	unsigned int clusterCount = _tilesX * _tilesY;
+	for (unsigned int cluster = firstCluster; cluster < firstCluster + clusterCount; cluster++)
+	{
+		_clusterLights[cluster].clear();
+	}
+
+	float sliceNear = GetSliceDepth(slice);
+	float sliceFar = GetSliceDepth(slice + 1);
+	float halfTilesX = 0.5f * static_cast<float>(_tilesX);
+	float halfTilesY = 0.5f * static_cast<float>(_tilesY);
+	unsigned int lightCount = static_cast<unsigned int>(_radius.size());
+	for (unsigned int light = 0; light < lightCount; light++)
+	{
+		float centreZ = _centreZ[light];
+		float radius = _radius[light];
+		if (centreZ + radius < sliceNear || centreZ - radius > sliceFar)
+		{
+			continue;
+		}
+
+		// The part of the sphere's bounding box inside the slice, projected.  The x and y extents
+		// are largest (furthest from the centre of the screen) at whichever end of the slice is
+		// nearer to the camera.
+		float nearZ = centreZ - radius > sliceNear ? centreZ - radius : sliceNear;
+		float farZ = centreZ + radius < sliceFar ? centreZ + radius : sliceFar;
+		float minimumX = _centreX[light] - radius;
+		float maximumX = _centreX[light] + radius;
+		float minimumY = _centreY[light] - radius;
+		float maximumY = _centreY[light] + radius;
+		float left = _projectionScaleX * minimumX / (minimumX < 0.0f ? nearZ : farZ);
+		float right = _projectionScaleX * maximumX / (maximumX > 0.0f ? nearZ : farZ);
+		float bottom = _projectionScaleY * minimumY / (minimumY < 0.0f ? nearZ : farZ);
+		float top = _projectionScaleY * maximumY / (maximumY > 0.0f ? nearZ : farZ);
+		if (right < -1.0f || left > 1.0f || top < -1.0f || bottom > 1.0f)
+		{
+			continue;
+		}
+
+		// Tiles go left to right and top to bottom, as pixels do
+		int firstTileX = static_cast<int>(std::floor((left + 1.0f) * halfTilesX));
+		int lastTileX = static_cast<int>(std::floor((right + 1.0f) * halfTilesX));
+		int firstTileY = static_cast<int>(std::floor((1.0f - top) * halfTilesY));
+		int lastTileY = static_cast<int>(std::floor((1.0f - bottom) * halfTilesY));
+		firstTileX = firstTileX > 0 ? firstTileX : 0;
+		firstTileY = firstTileY > 0 ? firstTileY : 0;
+		lastTileX = lastTileX < static_cast<int>(_tilesX) - 1 ? lastTileX : static_cast<int>(_tilesX) - 1;
+		lastTileY = lastTileY < static_cast<int>(_tilesY) - 1 ? lastTileY : static_cast<int>(_tilesY) - 1;
+		// The rectangle is loose for large spheres near the camera, so each cluster in it is
+		// tested against the sphere with the view space box around the cluster
+		float centreX = _centreX[light];
+		float centreY = _centreY[light];
+		float distanceZ = sliceNear - centreZ > 0.0f ? sliceNear - centreZ : (centreZ - sliceFar > 0.0f ? centreZ - sliceFar : 0.0f);
+		float radiusSquared = radius * radius - distanceZ * distanceZ;
+		for (int tileY = firstTileY; tileY <= lastTileY; tileY++)
+		{
+			float distanceY = GetDistanceToTile(centreY, 1.0f - static_cast<float>(tileY + 1) / halfTilesY, 1.0f - static_cast<float>(tileY) / halfTilesY, _projectionScaleY, sliceNear, sliceFar);
+			if (distanceY * distanceY > radiusSquared)
+			{
+				continue;
+			}
+			for (int tileX = firstTileX; tileX <= lastTileX; tileX++)
+			{
+				float distanceX = GetDistanceToTile(centreX, static_cast<float>(tileX) / halfTilesX - 1.0f, static_cast<float>(tileX + 1) / halfTilesX - 1.0f, _projectionScaleX, sliceNear, sliceFar);
+				if (distanceX * distanceX + distanceY * distanceY <= radiusSquared)
+				{
+					_clusterLights[GetClusterIndex(tileX, tileY, slice)].push_back(light);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+
+class ThreadPool;
+
+// Bins point and spot lights into clusters for clustered forward shading.
+//
+// The view frustum is split into TilesX x TilesY tiles across the screen and Slices slices in
+// depth, giving one cluster (a "froxel") for each tile in each slice.  The slices are spaced
+// exponentially between the near and far planes, so clusters stay roughly cube shaped.  Each
+// frame, every light's bounding sphere is moved into view space.  In each slice it overlaps,
+// the clusters its screen rectangle covers are tested against the sphere, using the view space
+// box around each cluster, and those it reaches get the light's index.  The pixel shader works out
+// its cluster from its screen position and view depth, and only shades the lights in it.
+//
+// The test is conservative: a light can be listed for a cluster it does not quite reach, but is
+// never missing from one it does.  The view space spheres are kept as separate arrays of x, y,
+// z and radius so the loops over them can be vectorised, and the slices are binned in parallel
+// when a thread pool is given.  The result is the same however many threads are used.
+//
+// Nothing here uses Direct3D (see ClusteredLighting.h for the buffers).
+
+// A light in world space.  The layout matches ClusterLight in TexturedShaders.hlsl.
+struct ClusterLight
+{
+	DirectX::XMFLOAT3				Position;
+	float							Range;			// No light reaches further than this
+	DirectX::XMFLOAT3				Colour;
+	float							SpotCosine;		// Cosine of the spot's half angle.  -1 or less for a point light.
+	DirectX::XMFLOAT3				Direction;		// Only used by spot lights
+	float							Padding;
+};
+
+// Where a cluster's light indices start in the index list, and how many there are
+struct ClusterRange
+{
+	unsigned int					Offset;
+	unsigned int					Count;
+};
+
+struct LightClusterStatistics
+{
+	unsigned int					LightCount;
+	unsigned int					LightsInView;
+	unsigned int					LightIndexCount;
+	unsigned int					MaximumLightsInCluster;
+};
+
+class LightClusters
+{
+public:
+	LightClusters(unsigned int tilesX = 16, unsigned int tilesY = 8, unsigned int slices = 24);
+
+	// The projection must be a perspective projection, from which the near and far planes are
+	// taken.  Lights are in world space.
+	void							Build(const std::vector<ClusterLight>& lights, DirectX::FXMMATRIX view, DirectX::CXMMATRIX projection, ThreadPool * threadPool = nullptr);
+
+	inline unsigned int				GetTilesX() const { return _tilesX; }
+	inline unsigned int				GetTilesY() const { return _tilesY; }
+	inline unsigned int				GetSlices() const { return _slices; }
+	inline unsigned int				GetClusterCount() const { return _tilesX * _tilesY * _slices; }
+	inline float					GetNear() const { return _near; }
+	inline float					GetFar() const { return _far; }
+	// Tiles are counted from the top left of the screen, as pixels are
+	inline unsigned int				GetClusterIndex(unsigned int tileX, unsigned int tileY, unsigned int slice) const { return (slice * _tilesY + tileY) * _tilesX + tileX; }
+	// The slice a view space depth is in, clamped to the slices there are
+	unsigned int					GetSlice(float viewDepth) const;
+
+	// The sphere around everything the light reaches, in world space
+	static void						GetBoundingSphere(const ClusterLight& light, DirectX::XMFLOAT3& centre, float& radius);
+
+	inline const std::vector<ClusterRange>&	GetClusterRanges() const { return _clusterRanges; }
+	inline const std::vector<unsigned int>&	GetLightIndices() const { return _lightIndices; }
+	inline const LightClusterStatistics&	GetStatistics() const { return _statistics; }
+
+private:
+	unsigned int					_tilesX;
+	unsigned int					_tilesY;
+	unsigned int					_slices;
+	float							_near;
+	float							_far;
+	// Projection scales, used to take view space x and y to normalised device coordinates
+	float							_projectionScaleX;
+	float							_projectionScaleY;
+
+	// The lights' bounding spheres in view space
+	std::vector<float>				_centreX;
+	std::vector<float>				_centreY;
+	std::vector<float>				_centreZ;
+	std::vector<float>				_radius;
+
+	// Each cluster's lights, before they are joined into one list.  Kept between frames so
+	// they are not reallocated.
+	std::vector<std::vector<unsigned int>>	_clusterLights;
+	std::vector<ClusterRange>		_clusterRanges;
+	std::vector<unsigned int>		_lightIndices;
+	LightClusterStatistics			_statistics;
+
+	void							TransformLights(const std::vector<ClusterLight>& lights, DirectX::FXMMATRIX view, unsigned int first, unsigned int last);
+	void							BinSlice(unsigned int slice);
+	float							GetSliceDepth(unsigned int slice) const;
+	// How far a view space x or y is outside the box around a column or row of tiles in a
+	// slice.  The tiles span minimum to maximum in normalised device coordinates.
+	static float					GetDistanceToTile(float centre, float minimum, float maximum, float projectionScale, float sliceNear, float sliceFar);
+};
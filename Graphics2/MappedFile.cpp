@@ -0,0 +1,126 @@
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <vector>
+#endif
+
+MappedFile::MappedFile()
+{
+	_data = nullptr;
+	_size = 0;
+#if defined(_WIN32)
+	_fileHandle = INVALID_HANDLE_VALUE;
+	_mappingHandle = nullptr;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#if defined(_WIN32)
+
+bool MappedFile::Open(const std::wstring& fileName)
+{
+	Close();
+	_fileHandle = CreateFileW(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (_fileHandle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(_fileHandle, &fileSize) || fileSize.QuadPart == 0)
+	{
+		// An empty file cannot be mapped
+		Close();
+		return false;
+	}
+	_mappingHandle = CreateFileMappingW(_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (_mappingHandle == nullptr)
+	{
+		Close();
+		return false;
+	}
+	_data = MapViewOfFile(_mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if (_data == nullptr)
+	{
+		Close();
+		return false;
+	}
+	_size = static_cast<size_t>(fileSize.QuadPart);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (_data != nullptr)
+	{
+		UnmapViewOfFile(_data);
+		_data = nullptr;
+	}
+	if (_mappingHandle != nullptr)
+	{
+		CloseHandle(_mappingHandle);
+		_mappingHandle = nullptr;
+	}
+	if (_fileHandle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(_fileHandle);
+		_fileHandle = INVALID_HANDLE_VALUE;
+	}
+	_size = 0;
+}
+
+#else
+
+bool MappedFile::Open(const std::wstring& fileName)
+{
+	Close();
+	// Convert the name to the narrow encoding used by the file system
+	std::vector<char> narrowName(fileName.size() * MB_CUR_MAX + 1);
+	if (wcstombs(narrowName.data(), fileName.c_str(), narrowName.size()) == static_cast<size_t>(-1))
+	{
+		return false;
+	}
+	int file = open(narrowName.data(), O_RDONLY);
+	if (file < 0)
+	{
+		return false;
+	}
+	struct stat fileStatus;
+	if (fstat(file, &fileStatus) != 0 || fileStatus.st_size == 0)
+	{
+		close(file);
+		return false;
+	}
+	void * data = mmap(nullptr, static_cast<size_t>(fileStatus.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	// The mapping stays valid after the file descriptor is closed
+	close(file);
+	if (data == MAP_FAILED)
+	{
+		return false;
+	}
+	_data = data;
+	_size = static_cast<size_t>(fileStatus.st_size);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (_data != nullptr)
+	{
+		munmap(const_cast<void *>(_data), _size);
+		_data = nullptr;
+	}
+	_size = 0;
+}
+
+#endif
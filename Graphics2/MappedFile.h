@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// A read-only view of a file mapped into memory.  The contents are paged in by the operating
+// system as they are touched, so opening a large file does not copy it into our own memory.
+
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool						Open(const std::wstring& fileName);
+	void						Close();
+
+	inline bool					IsOpen() const { return _data != nullptr; }
+	inline const void *			GetData() const { return _data; }
+	inline size_t				GetSize() const { return _size; }
+
+private:
+	const void *				_data;
+	size_t						_size;
+
+#if defined(_WIN32)
+	void *						_fileHandle;
+	void *						_mappingHandle;
+#endif
+};
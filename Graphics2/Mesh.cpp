@@ -29,10 +29,40 @@ SubMesh::SubMesh(ComPtr<ID3D11Buffer> vertexBuffer,
 	_vertexCount = vertexCount;
 	_indexCount = indexCount;
 	_material = material;
+	_vertexStride = sizeof(VERTEX);
+	_indexSize = sizeof(UINT);
+	_baseVertex = 0;
+	_startIndex = 0;
+	_quantized = false;
+	_positionScale = XMFLOAT3(1.0f, 1.0f, 1.0f);
+	_positionOffset = XMFLOAT3(0.0f, 0.0f, 0.0f);
+}
+
+void SubMesh::SetPacking(const PackedGeometry& packed)
+{
+	_vertexStride = packed.VertexStride;
+	_indexSize = packed.IndexSize;
+	_quantized = packed.Quantized;
+	_positionScale = packed.PositionScale;
+	_positionOffset = packed.PositionOffset;
+}
+
+void SubMesh::SetArenaRange(shared_ptr<GeometryArena> arena, const GeometryAllocation& allocation)
+{
+	_arena = arena;
+	_arenaAllocation = allocation;
+	_vertexBuffer = arena->GetVertexBuffer(allocation.Page);
+	_indexBuffer = arena->GetIndexBuffer(allocation.Page);
+	_baseVertex = static_cast<unsigned int>(allocation.VertexOffset / _vertexStride);
+	_startIndex = static_cast<unsigned int>(allocation.IndexOffset / _indexSize);
 }
 
 SubMesh::~SubMesh(void)
 {
+	if (_arena != nullptr)
+	{
+		_arena->Free(_arenaAllocation);
+	}
 }
 
 // Mesh methods
@@ -68,3 +98,22 @@ void Mesh::SetRootNode(shared_ptr<Node> node)
 {
 	_rootNode = node;
 }
+
+void Mesh::CalculateBounds()
+{
+	_bounds = MeshBounds();
+	_subMeshBounds.clear();
+	vector<float> opacities;
+	for (shared_ptr<SubMesh>& subMesh : _subMeshList)
+	{
+		_subMeshBounds.push_back(subMesh->GetBounds());
+		opacities.push_back(subMesh->GetMaterial() != nullptr ? subMesh->GetMaterial()->GetOpacity() : 1.0f);
+	}
+	_subMeshSelector.Classify(opacities, _subMeshBounds);
+	if (_rootNode == nullptr)
+	{
+		return;
+	}
+	NodeCuller::CalculateBounds(*_rootNode, _subMeshBounds);
+	_bounds = _rootNode->GetBounds().Transform(XMLoadFloat4x4(&_rootNode->GetTransformation()));
+}
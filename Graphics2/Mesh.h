@@ -1,6 +1,14 @@
 #pragma once
 #include "core.h"
 #include "DirectXCore.h"
+#include "VertexPacker.h"
+#include "MeshOptimiser.h"
+#include "MeshBounds.h"
+#include "Node.h"
+#include "NodeCuller.h"
+#include "SubMeshSelector.h"
+#include "GeometryArena.h"
+#include "RenderQueue.h"
 #include <vector>
 
 // Core material class.  Ideally, this should be extended to include more material attributes that can be
@@ -9,6 +17,8 @@
 class Material
 {
 public:
+	static const unsigned int				NoStreamedTexture = 0xffffffff;
+
 	Material(wstring materialName, XMFLOAT4 diffuseColour, XMFLOAT4 specularColour, float shininess, float opacity, ComPtr<ID3D11ShaderResourceView> texture );
 	~Material();
 
@@ -18,6 +28,16 @@ public:
 	inline float							GetShininess() { return _shininess; }
 	inline float							GetOpacity() { return _opacity; }
 	inline ComPtr<ID3D11ShaderResourceView>	GetTexture() { return _texture; }
+	// Changed by the texture streaming as the material's texture is loaded and evicted
+	inline void								SetTexture(ComPtr<ID3D11ShaderResourceView> texture) { _texture = texture; }
+	// NoStreamedTexture if the material has no texture of its own
+	inline unsigned int						GetStreamedTextureId() { return _streamedTextureId; }
+	inline void								SetStreamedTextureId(unsigned int textureId) { _streamedTextureId = textureId; }
+	// Holds the material's MaterialConstants, so they do not have to be sent with every draw
+	inline ComPtr<ID3D11Buffer>				GetConstantBuffer() { return _constantBuffer; }
+	inline void								SetConstantBuffer(ComPtr<ID3D11Buffer> constantBuffer) { _constantBuffer = constantBuffer; }
+	// Groups the material's draws together in the render queue
+	inline unsigned int						GetSortId() const { return _sortId.Get(); }
 
 private:
 	wstring									_materialName;
@@ -26,6 +46,9 @@ private:
 	float									_shininess;
 	float									_opacity;
     ComPtr<ID3D11ShaderResourceView>		_texture;
+	ComPtr<ID3D11Buffer>					_constantBuffer;
+	unsigned int							_streamedTextureId = NoStreamedTexture;
+	RenderStateId							_sortId;
 };
 
 // Basic SubMesh class.  A Mesh consists of one or more sub-meshes.  The submesh provides everything that is needed to
@@ -46,6 +69,22 @@ public:
 	inline shared_ptr<Material>			GetMaterial() { return _material; }
 	inline size_t						GetVertexCount() { return _vertexCount; }
 	inline size_t						GetIndexCount() { return _indexCount; }
+	// How the buffers were packed (see VertexPacker.h).  By default, the vertex buffer holds VERTEX
+	// structures and the index buffer 32-bit indices.
+	inline unsigned int					GetVertexStride() { return _vertexStride; }
+	inline unsigned int					GetIndexSize() { return _indexSize; }
+	inline bool							IsQuantized() { return _quantized; }
+	inline XMFLOAT3						GetPositionScale() { return _positionScale; }
+	inline XMFLOAT3						GetPositionOffset() { return _positionOffset; }
+	void								SetPacking(const PackedGeometry& packed);
+	// The bounds of the vertices, in the space of the nodes that use the sub-mesh
+	inline const MeshBounds&			GetBounds() { return _bounds; }
+	inline void							SetBounds(const MeshBounds& bounds) { _bounds = bounds; }
+	// Where the sub-mesh is in the geometry arena's buffers (see GeometryArena.h).  The range is
+	// given back to the arena when the sub-mesh is destroyed.  Call after SetPacking.
+	void								SetArenaRange(shared_ptr<GeometryArena> arena, const GeometryAllocation& allocation);
+	inline unsigned int					GetBaseVertex() { return _baseVertex; }
+	inline unsigned int					GetStartIndex() { return _startIndex; }
 
 private:
    	ComPtr<ID3D11Buffer>				_vertexBuffer;
@@ -53,40 +92,54 @@ private:
 	shared_ptr<Material>				_material;
 	size_t								_vertexCount;
 	size_t								_indexCount;
+	unsigned int						_vertexStride;
+	unsigned int						_indexSize;
+	bool								_quantized;
+	XMFLOAT3							_positionScale;
+	XMFLOAT3							_positionOffset;
+	MeshBounds							_bounds;
+	shared_ptr<GeometryArena>			_arena;
+	GeometryAllocation					_arenaAllocation;
+	unsigned int						_baseVertex;
+	unsigned int						_startIndex;
 };
 
 // The core Mesh class.  A Mesh corresponds to a scene in ASSIMP. A mesh consists of one or more sub-meshes.
 
-class Node
-{
-public:
-	inline void						    SetName(wstring name) { _name = name; }
-	inline wstring						GetName() { return _name; }
-	inline size_t					    GetMeshCount() { return _meshIndices.size(); }
-	inline unsigned int					GetMesh(unsigned int index) { return _meshIndices[index]; }
-	inline void							AddMesh(unsigned int meshIndex) { _meshIndices.push_back(meshIndex); }
-	inline size_t					    GetChildrenCount() { return _children.size(); }
-	inline shared_ptr<Node>				GetChild(unsigned int index) { return _children[index]; }
-	inline void							AddChild(shared_ptr<Node> node) { _children.push_back(node); }
-
-private:
-	wstring								_name;
-	vector<unsigned int>				_meshIndices;
-	vector<shared_ptr<Node>>			_children;
-};
-
 class Mesh
 {
 public:
 	size_t								GetSubMeshCount();
 	shared_ptr<SubMesh>					GetSubMesh(unsigned int i);
 	void								AddSubMesh(shared_ptr<SubMesh> subMesh);
+	// True if any sub-mesh has to be blended, so cannot be drawn instanced
+	inline bool							HasTransparentSubMeshes() { return _subMeshSelector.HasTransparentSubMeshes(); }
 	shared_ptr<Node>				    GetRootNode();
 	void								SetRootNode(shared_ptr<Node> node);
+	// Works out the bounds of every node from the bounds of the sub-meshes, and classifies the
+	// sub-meshes as opaque or transparent.  Called once the sub-meshes and the root node have been set.
+	void								CalculateBounds();
+	// The bounds of the whole mesh in object space
+	inline const MeshBounds&			GetBounds() { return _bounds; }
+	// The bounds of each sub-mesh, in the order of GetSubMesh, as of CalculateBounds
+	inline const vector<MeshBounds>&	GetSubMeshBounds() { return _subMeshBounds; }
+	// Which sub-meshes are transparent, as of CalculateBounds
+	inline const SubMeshSelector&		GetSubMeshSelector() { return _subMeshSelector; }
+	// The memory used by the sub-meshes' buffers
+	inline const GeometryMemoryStatistics&	GetMemoryStatistics() const { return _memoryStatistics; }
+	inline void							SetMemoryStatistics(const GeometryMemoryStatistics& statistics) { _memoryStatistics = statistics; }
+	// What the optimisation done when the model was imported saved
+	inline const MeshOptimisationStatistics&	GetOptimisationStatistics() const { return _optimisationStatistics; }
+	inline void							SetOptimisationStatistics(const MeshOptimisationStatistics& statistics) { _optimisationStatistics = statistics; }
 
 private:
 	vector<shared_ptr<SubMesh>> 		_subMeshList;
 	shared_ptr<Node>					_rootNode;
+	GeometryMemoryStatistics			_memoryStatistics = {};
+	MeshOptimisationStatistics			_optimisationStatistics = {};
+	MeshBounds							_bounds;
+	vector<MeshBounds>					_subMeshBounds;
+	SubMeshSelector						_subMeshSelector;
 };
 
 
@@ -0,0 +1,113 @@
+#include "MeshBounds.h"
+#include <cmath>
+
+using namespace DirectX;
+
+MeshBounds::MeshBounds() :
+	Minimum(0.0f, 0.0f, 0.0f),
+	Maximum(0.0f, 0.0f, 0.0f),
+	Centre(0.0f, 0.0f, 0.0f),
+	Radius(-1.0f)
+{
+}
+
+MeshBounds MeshBounds::FromVertices(const VERTEX * vertices, size_t vertexCount)
+{
+	MeshBounds bounds;
+	if (vertexCount == 0)
+	{
+		return bounds;
+	}
+	bounds.Minimum = vertices[0].Position;
+	bounds.Maximum = vertices[0].Position;
+	for (size_t i = 1; i < vertexCount; i++)
+	{
+		const XMFLOAT3& position = vertices[i].Position;
+		bounds.Minimum.x = fminf(bounds.Minimum.x, position.x);
+		bounds.Minimum.y = fminf(bounds.Minimum.y, position.y);
+		bounds.Minimum.z = fminf(bounds.Minimum.z, position.z);
+		bounds.Maximum.x = fmaxf(bounds.Maximum.x, position.x);
+		bounds.Maximum.y = fmaxf(bounds.Maximum.y, position.y);
+		bounds.Maximum.z = fmaxf(bounds.Maximum.z, position.z);
+	}
+	bounds.Centre = XMFLOAT3((bounds.Minimum.x + bounds.Maximum.x) * 0.5f,
+							 (bounds.Minimum.y + bounds.Maximum.y) * 0.5f,
+							 (bounds.Minimum.z + bounds.Maximum.z) * 0.5f);
+	float radiusSquared = 0.0f;
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const XMFLOAT3& position = vertices[i].Position;
+		float x = position.x - bounds.Centre.x;
+		float y = position.y - bounds.Centre.y;
+		float z = position.z - bounds.Centre.z;
+		radiusSquared = fmaxf(radiusSquared, x * x + y * y + z * z);
+	}
+	bounds.Radius = sqrtf(radiusSquared);
+	return bounds;
+}
+
+void MeshBounds::Merge(const MeshBounds& other)
+{
+	if (other.IsEmpty())
+	{
+		return;
+	}
+	if (IsEmpty())
+	{
+		*this = other;
+		return;
+	}
+	Minimum = XMFLOAT3(fminf(Minimum.x, other.Minimum.x), fminf(Minimum.y, other.Minimum.y), fminf(Minimum.z, other.Minimum.z));
+	Maximum = XMFLOAT3(fmaxf(Maximum.x, other.Maximum.x), fmaxf(Maximum.y, other.Maximum.y), fmaxf(Maximum.z, other.Maximum.z));
+
+	// Keep the sphere centred on the box.  It has to reach the furthest point of both spheres.
+	XMFLOAT3 centre((Minimum.x + Maximum.x) * 0.5f, (Minimum.y + Maximum.y) * 0.5f, (Minimum.z + Maximum.z) * 0.5f);
+	float radius = 0.0f;
+	const MeshBounds * spheres[2] = { this, &other };
+	for (const MeshBounds * sphere : spheres)
+	{
+		float x = sphere->Centre.x - centre.x;
+		float y = sphere->Centre.y - centre.y;
+		float z = sphere->Centre.z - centre.z;
+		radius = fmaxf(radius, sqrtf(x * x + y * y + z * z) + sphere->Radius);
+	}
+	// The box's corners are also a limit, which is smaller when the spheres stick out of the box
+	float halfX = (Maximum.x - Minimum.x) * 0.5f;
+	float halfY = (Maximum.y - Minimum.y) * 0.5f;
+	float halfZ = (Maximum.z - Minimum.z) * 0.5f;
+	Centre = centre;
+	Radius = fminf(radius, sqrtf(halfX * halfX + halfY * halfY + halfZ * halfZ));
+}
+
+MeshBounds MeshBounds::Transform(FXMMATRIX transformation) const
+{
+	if (IsEmpty())
+	{
+		return *this;
+	}
+	XMFLOAT4X4 m;
+	XMStoreFloat4x4(&m, transformation);
+
+	// Each row of the matrix moves the box's centre along one axis by the box's half size in
+	// that axis, so the new half size is the sum of the absolute values (Arvo's method)
+	XMFLOAT3 boxCentre((Minimum.x + Maximum.x) * 0.5f, (Minimum.y + Maximum.y) * 0.5f, (Minimum.z + Maximum.z) * 0.5f);
+	XMFLOAT3 half((Maximum.x - Minimum.x) * 0.5f, (Maximum.y - Minimum.y) * 0.5f, (Maximum.z - Minimum.z) * 0.5f);
+	XMFLOAT3 newCentre(boxCentre.x * m._11 + boxCentre.y * m._21 + boxCentre.z * m._31 + m._41,
+					   boxCentre.x * m._12 + boxCentre.y * m._22 + boxCentre.z * m._32 + m._42,
+					   boxCentre.x * m._13 + boxCentre.y * m._23 + boxCentre.z * m._33 + m._43);
+	XMFLOAT3 newHalf(half.x * fabsf(m._11) + half.y * fabsf(m._21) + half.z * fabsf(m._31),
+					 half.x * fabsf(m._12) + half.y * fabsf(m._22) + half.z * fabsf(m._32),
+					 half.x * fabsf(m._13) + half.y * fabsf(m._23) + half.z * fabsf(m._33));
+
+	MeshBounds transformed;
+	transformed.Minimum = XMFLOAT3(newCentre.x - newHalf.x, newCentre.y - newHalf.y, newCentre.z - newHalf.z);
+	transformed.Maximum = XMFLOAT3(newCentre.x + newHalf.x, newCentre.y + newHalf.y, newCentre.z + newHalf.z);
+	transformed.Centre = XMFLOAT3(Centre.x * m._11 + Centre.y * m._21 + Centre.z * m._31 + m._41,
+								  Centre.x * m._12 + Centre.y * m._22 + Centre.z * m._32 + m._42,
+								  Centre.x * m._13 + Centre.y * m._23 + Centre.z * m._33 + m._43);
+	float scaleX = m._11 * m._11 + m._12 * m._12 + m._13 * m._13;
+	float scaleY = m._21 * m._21 + m._22 * m._22 + m._23 * m._23;
+	float scaleZ = m._31 * m._31 + m._32 * m._32 + m._33 * m._33;
+	transformed.Radius = Radius * sqrtf(fmaxf(scaleX, fmaxf(scaleY, scaleZ)));
+	return transformed;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "Vertex.h"
+#include <cstddef>
+
+// An axis aligned box and a bounding sphere around some geometry.  Each SubMesh has the bounds
+// of its vertices, and each Node the bounds of its sub-meshes and all of its children (in the
+// node's own space), so that MeshRenderer can reject a whole branch of a mesh with one test.
+//
+// The sphere is centred on the box, which is not the smallest sphere but is quick to work out
+// and never larger than the box's corners.
+
+struct MeshBounds
+{
+	DirectX::XMFLOAT3			Minimum;
+	DirectX::XMFLOAT3			Maximum;
+	DirectX::XMFLOAT3			Centre;
+	float						Radius;			// Less than 0 if the bounds are empty
+
+	// Empty bounds, which Merge replaces with whatever is merged into them
+	MeshBounds();
+
+	inline bool					IsEmpty() const { return Radius < 0.0f; }
+
+	static MeshBounds			FromVertices(const VERTEX * vertices, size_t vertexCount);
+	void						Merge(const MeshBounds& other);
+	// The bounds of these bounds once transformed.  The box is the box around the transformed
+	// box, and the sphere's radius is scaled by the largest scale in the transformation.
+	MeshBounds					Transform(DirectX::FXMMATRIX transformation) const;
+};
+
+// What MeshRenderer culled against the view frustum.  Meshes are tested once for each scene
+// node that uses them before they are batched, then each mesh drawn on its own has its nodes
+// and sub-meshes tested using their bounds.  A node that is outside is rejected with
+// everything below it.  Meshes drawn instanced are only tested as a whole.
+struct MeshCullingStatistics
+{
+	unsigned int				MeshesTested;
+	unsigned int				MeshesCulled;
+	// Meshes in view but hidden behind the occluders (see OcclusionCuller.h)
+	unsigned int				MeshesOccluded;
+	unsigned int				NodesCulled;
+	unsigned int				SubMeshesCulled;
+	unsigned int				SubMeshesDrawn;
+};
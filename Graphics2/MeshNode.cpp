@@ -4,9 +4,13 @@ bool MeshNode::Initialise()
 {
 	_resourceManager = DirectXFramework::GetDXFramework()->GetResourceManager();
 	_renderer = dynamic_pointer_cast<MeshRenderer>(_resourceManager->GetRenderer(L"PNT"));
-	_mesh = _resourceManager->GetMesh(_modelName);
-	if (_mesh == nullptr)
+	// The model is read on a worker thread, so scene start-up does not wait for it
+	_meshRequest = _resourceManager->GetMeshAsync(_modelName);
+	if (_meshRequest->HasFailed())
 	{
+		// The file does not exist.  A file that exists but cannot be read is only found to
+		// have failed later, when Render marks the node as failed.
+		_failed = true;
 		return false;
 	}
 	return _renderer->Initialise();
@@ -20,11 +24,19 @@ void MeshNode::Shutdown()
 
 void MeshNode::Render()
 {
-	_renderer->SetMesh(_mesh);
-	_renderer->SetWorldTransformation(XMLoadFloat4x4(&_combinedWorldTransformation));
-	_renderer->SetCameraPosition(XMFLOAT4(0.0f, 0.0f, -100.0f, 1.0f));
-	_renderer->SetAmbientLight(XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f));
-	_renderer->SetDirectionalLight(XMVectorSet(0.0f, -1.0f, 1.0f, 0.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f));
-	_renderer->Render();
+	// The mesh is drawn by the resource manager after the whole scene graph has been rendered,
+	// together with every other node that uses the same mesh.  Nothing is drawn if the model
+	// could not be loaded, and the node is marked as failed.
+	if (_meshRequest->HasFailed())
+	{
+		// The resource manager has already reported why
+		_failed = true;
+		return;
+	}
+	shared_ptr<Mesh> mesh = _meshRequest->GetMesh();
+	if (mesh != nullptr)
+	{
+		_resourceManager->AddMeshInstance(mesh, XMLoadFloat4x4(&_combinedWorldTransformation));
+	}
 }
 
@@ -13,11 +13,18 @@ public:
 	void Render();
 	void Shutdown();
 
+	inline const wstring& GetModelName() const { return _modelName; }
+	// True once the model has failed to load.  Initialise cannot report this, because the
+	// model is still being read when it returns.
+	inline bool HasFailed() const { return _failed; }
+
 private:
 	shared_ptr<MeshRenderer>		_renderer;
 
 	wstring							_modelName;
 	shared_ptr<ResourceManager>		_resourceManager;
-	shared_ptr<Mesh>				_mesh;
+	// Gives a placeholder mesh until the model has been loaded
+	shared_ptr<MeshLoadRequest>		_meshRequest;
+	bool							_failed = false;
 };
 
@@ -0,0 +1,484 @@
+#include "MeshOptimiser.h"
+#include "CacheFiles.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+using namespace DirectX;
+
+// The LRU cache that OptimiseVertexCache orders the triangles for, and the weights used to
+// score vertices.  These are the values from Tom Forsyth's description of the algorithm.
+static const int SimulatedCacheSize = 32;
+static const float CacheDecayPower = 1.5f;
+static const float LastTriangleScore = 0.75f;
+static const float ValenceBoostScale = 2.0f;
+static const float ValenceBoostPower = 0.5f;
+
+static const unsigned int NoVertex = 0xffffffff;
+
+void MeshOptimiser::Optimise(std::vector<VERTEX>& vertices, std::vector<unsigned int>& indices, MeshOptimisationStatistics& statistics)
+{
+	statistics.VertexCountBefore = vertices.size();
+	statistics.TriangleCount = indices.size() / 3;
+	statistics.TransformCountBefore = CountTransforms(indices, vertices.size(), AnalysisCacheSize);
+
+	WeldVertices(vertices, indices);
+	OptimiseVertexCache(indices, vertices.size());
+	OptimiseOverdraw(vertices, indices);
+	OptimiseVertexFetch(vertices, indices);
+
+	statistics.VertexCountAfter = vertices.size();
+	statistics.TransformCountAfter = CountTransforms(indices, vertices.size(), AnalysisCacheSize);
+}
+
+void MeshOptimiser::AddStatistics(const MeshOptimisationStatistics& subMeshStatistics, MeshOptimisationStatistics& statistics)
+{
+	statistics.VertexCountBefore += subMeshStatistics.VertexCountBefore;
+	statistics.VertexCountAfter += subMeshStatistics.VertexCountAfter;
+	statistics.TriangleCount += subMeshStatistics.TriangleCount;
+	statistics.TransformCountBefore += subMeshStatistics.TransformCountBefore;
+	statistics.TransformCountAfter += subMeshStatistics.TransformCountAfter;
+}
+
+// Vertices are only welded if every byte is the same, so welding never changes what is drawn
+
+struct VertexHash
+{
+	size_t operator()(const VERTEX * vertex) const
+	{
+		uint64_t hash = FnvOffsetBasis;
+		HashBytes(hash, vertex, sizeof(VERTEX));
+		return static_cast<size_t>(hash);
+	}
+};
+
+struct VertexEqual
+{
+	bool operator()(const VERTEX * first, const VERTEX * second) const
+	{
+		return memcmp(first, second, sizeof(VERTEX)) == 0;
+	}
+};
+
+void MeshOptimiser::WeldVertices(std::vector<VERTEX>& vertices, std::vector<unsigned int>& indices)
+{
+	std::vector<unsigned int> remap(vertices.size());
+	std::vector<VERTEX> welded;
+	welded.reserve(vertices.size());
+	// The keys point into vertices, which is not changed until the end
+	std::unordered_map<const VERTEX *, unsigned int, VertexHash, VertexEqual> firstCopy;
+	firstCopy.reserve(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		auto inserted = firstCopy.emplace(&vertices[i], static_cast<unsigned int>(welded.size()));
+		if (inserted.second)
+		{
+			welded.push_back(vertices[i]);
+		}
+		remap[i] = inserted.first->second;
+	}
+	if (welded.size() == vertices.size())
+	{
+		return;
+	}
+	for (unsigned int& index : indices)
+	{
+		index = remap[index];
+	}
+	vertices.swap(welded);
+}
+
+static float ScoreVertex(int cachePosition, unsigned int remainingTriangles)
+{
+	if (remainingTriangles == 0)
+	{
+		// Nothing left to draw with this vertex
+		return -1.0f;
+	}
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		if (cachePosition < 3)
+		{
+			// Used by the last triangle.  This is given a fixed score so that the algorithm
+			// does not favour drawing long strips.
+			score = LastTriangleScore;
+		}
+		else
+		{
+			float scale = 1.0f / (SimulatedCacheSize - 3);
+			score = powf(1.0f - (cachePosition - 3) * scale, CacheDecayPower);
+		}
+	}
+	// Favour vertices with few triangles left, so that they are finished and do not have
+	// to be transformed again later
+	score += ValenceBoostScale * powf(static_cast<float>(remainingTriangles), -ValenceBoostPower);
+	return score;
+}
+
+void MeshOptimiser::OptimiseVertexCache(std::vector<unsigned int>& indices, size_t vertexCount)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// The triangles that use each vertex.  The triangles not yet drawn are kept at the front
+	// of each vertex's list, with remainingTriangles of them.
+	std::vector<unsigned int> firstTriangle(vertexCount + 1, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		firstTriangle[indices[i] + 1]++;
+	}
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		firstTriangle[v + 1] += firstTriangle[v];
+	}
+	std::vector<unsigned int> vertexTriangles(triangleCount * 3);
+	std::vector<unsigned int> remainingTriangles(vertexCount, 0);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		for (size_t corner = 0; corner < 3; corner++)
+		{
+			unsigned int vertex = indices[t * 3 + corner];
+			vertexTriangles[firstTriangle[vertex] + remainingTriangles[vertex]] = static_cast<unsigned int>(t);
+			remainingTriangles[vertex]++;
+		}
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		vertexScore[v] = ScoreVertex(-1, remainingTriangles[v]);
+	}
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<bool> triangleDrawn(triangleCount, false);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+	}
+
+	// The cache holds three more vertices than it is scored for, so that the vertices pushed
+	// out by a triangle can still have their scores updated
+	unsigned int cache[SimulatedCacheSize + 3];
+	unsigned int newCache[SimulatedCacheSize + 3];
+	size_t cacheCount = 0;
+
+	std::vector<unsigned int> optimised;
+	optimised.reserve(triangleCount * 3);
+	size_t nextUndrawn = 0;
+	size_t bestTriangle = 0;
+	bool haveBest = true;
+	float bestScore = triangleScore[0];
+	for (size_t t = 1; t < triangleCount; t++)
+	{
+		if (triangleScore[t] > bestScore)
+		{
+			bestScore = triangleScore[t];
+			bestTriangle = t;
+		}
+	}
+	while (optimised.size() < triangleCount * 3)
+	{
+		if (!haveBest)
+		{
+			// None of the vertices in the cache have any triangles left, so start again
+			// from the first triangle that has not been drawn
+			while (triangleDrawn[nextUndrawn])
+			{
+				nextUndrawn++;
+			}
+			bestTriangle = nextUndrawn;
+		}
+		triangleDrawn[bestTriangle] = true;
+		const unsigned int * triangle = &indices[bestTriangle * 3];
+		size_t newCacheCount = 0;
+		for (size_t corner = 0; corner < 3; corner++)
+		{
+			unsigned int vertex = triangle[corner];
+			optimised.push_back(vertex);
+
+			// Move the triangle to the end of the vertex's undrawn triangles and drop it
+			unsigned int * triangles = &vertexTriangles[firstTriangle[vertex]];
+			unsigned int remaining = remainingTriangles[vertex];
+			for (unsigned int i = 0; i < remaining; i++)
+			{
+				if (triangles[i] == bestTriangle)
+				{
+					std::swap(triangles[i], triangles[remaining - 1]);
+					break;
+				}
+			}
+			remainingTriangles[vertex]--;
+			newCache[newCacheCount++] = vertex;
+		}
+		// The rest of the old cache follows the triangle's vertices
+		for (size_t i = 0; i < cacheCount; i++)
+		{
+			unsigned int vertex = cache[i];
+			if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+			{
+				newCache[newCacheCount++] = vertex;
+			}
+		}
+		// Rescore every vertex that is in the cache or has just left it, and find the best
+		// triangle that uses one of them
+		haveBest = false;
+		bestScore = -1.0f;
+		for (size_t i = 0; i < newCacheCount; i++)
+		{
+			unsigned int vertex = newCache[i];
+			int position = i < SimulatedCacheSize ? static_cast<int>(i) : -1;
+			cachePosition[vertex] = position;
+			float score = ScoreVertex(position, remainingTriangles[vertex]);
+			float change = score - vertexScore[vertex];
+			vertexScore[vertex] = score;
+			const unsigned int * triangles = &vertexTriangles[firstTriangle[vertex]];
+			for (unsigned int j = 0; j < remainingTriangles[vertex]; j++)
+			{
+				unsigned int t = triangles[j];
+				triangleScore[t] += change;
+				if (triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					bestTriangle = t;
+					haveBest = true;
+				}
+			}
+		}
+		cacheCount = std::min(newCacheCount, static_cast<size_t>(SimulatedCacheSize));
+		memcpy(cache, newCache, cacheCount * sizeof(unsigned int));
+	}
+	// Any indices after the last whole triangle are left where they are
+	std::copy(optimised.begin(), optimised.end(), indices.begin());
+}
+
+// The triangles between two places where the cache order could be broken.  The sums are
+// weighted by triangle area, so that clusters can be merged by adding them.
+struct TriangleCluster
+{
+	size_t				FirstTriangle;
+	size_t				TriangleCount;
+	XMFLOAT3			CentroidSum;
+	XMFLOAT3			NormalSum;
+	float				Area;
+	float				SortKey;
+};
+
+static void AddCluster(TriangleCluster& cluster, const TriangleCluster& other)
+{
+	cluster.TriangleCount += other.TriangleCount;
+	cluster.CentroidSum = XMFLOAT3(cluster.CentroidSum.x + other.CentroidSum.x, cluster.CentroidSum.y + other.CentroidSum.y, cluster.CentroidSum.z + other.CentroidSum.z);
+	cluster.NormalSum = XMFLOAT3(cluster.NormalSum.x + other.NormalSum.x, cluster.NormalSum.y + other.NormalSum.y, cluster.NormalSum.z + other.NormalSum.z);
+	cluster.Area += other.Area;
+}
+
+const float MeshOptimiser::OverdrawAcmrThreshold = 1.05f;
+
+void MeshOptimiser::OptimiseOverdraw(const std::vector<VERTEX>& vertices, std::vector<unsigned int>& indices, float acmrThreshold)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// The FIFO cache is simulated as in CountTransforms.  Moving time on by more than the
+	// cache size empties it.
+	std::vector<unsigned int> cacheTime(vertices.size(), 0);
+	unsigned int time = AnalysisCacheSize + 1;
+	auto drawTriangle = [&](size_t t)
+	{
+		unsigned int misses = 0;
+		for (size_t corner = 0; corner < 3; corner++)
+		{
+			unsigned int vertex = indices[t * 3 + corner];
+			if (time - cacheTime[vertex] > AnalysisCacheSize)
+			{
+				cacheTime[vertex] = time++;
+				misses++;
+			}
+		}
+		return misses;
+	};
+
+	// Hard boundaries are the triangles where none of the vertices are still in the cache, so
+	// the cache order is broken anyway.  Forsyth's order has few of these on a connected mesh.
+	std::vector<size_t> hardBoundaries;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		if (drawTriangle(t) == 3)
+		{
+			hardBoundaries.push_back(t);
+		}
+	}
+	if (hardBoundaries.empty() || hardBoundaries[0] != 0)
+	{
+		hardBoundaries.insert(hardBoundaries.begin(), 0);
+	}
+	hardBoundaries.push_back(triangleCount);
+
+	// Soft boundaries split the triangles between two hard boundaries wherever the ACMR of
+	// the cluster so far, starting from an empty cache, has come down to acmrThreshold times
+	// the ACMR of them all (Sander, Nehab and Barczak's fast linear clustering).  The cache is
+	// emptied at each one, so the clusters' ACMRs allow for starting from nothing.
+	std::vector<TriangleCluster> clusters;
+	for (size_t h = 0; h + 1 < hardBoundaries.size(); h++)
+	{
+		size_t start = hardBoundaries[h];
+		size_t end = hardBoundaries[h + 1];
+		time += AnalysisCacheSize + 1;
+		size_t hardMisses = 0;
+		for (size_t t = start; t < end; t++)
+		{
+			hardMisses += drawTriangle(t);
+		}
+		float missLimit = acmrThreshold * hardMisses / (end - start);
+
+		time += AnalysisCacheSize + 1;
+		size_t clusterMisses = 0;
+		clusters.push_back({ start, 0, XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f), 0.0f, 0.0f });
+		for (size_t t = start; t < end; t++)
+		{
+			TriangleCluster& cluster = clusters.back();
+			clusterMisses += drawTriangle(t);
+			cluster.TriangleCount++;
+			const XMFLOAT3& p0 = vertices[indices[t * 3]].Position;
+			const XMFLOAT3& p1 = vertices[indices[t * 3 + 1]].Position;
+			const XMFLOAT3& p2 = vertices[indices[t * 3 + 2]].Position;
+			XMFLOAT3 edge1(p1.x - p0.x, p1.y - p0.y, p1.z - p0.z);
+			XMFLOAT3 edge2(p2.x - p0.x, p2.y - p0.y, p2.z - p0.z);
+			// Twice the area, pointing out of the front face
+			XMFLOAT3 cross(edge1.y * edge2.z - edge1.z * edge2.y,
+						   edge1.z * edge2.x - edge1.x * edge2.z,
+						   edge1.x * edge2.y - edge1.y * edge2.x);
+			float area = sqrtf(cross.x * cross.x + cross.y * cross.y + cross.z * cross.z);
+			cluster.CentroidSum.x += (p0.x + p1.x + p2.x) * area;
+			cluster.CentroidSum.y += (p0.y + p1.y + p2.y) * area;
+			cluster.CentroidSum.z += (p0.z + p1.z + p2.z) * area;
+			cluster.NormalSum.x += cross.x;
+			cluster.NormalSum.y += cross.y;
+			cluster.NormalSum.z += cross.z;
+			cluster.Area += area;
+			if (t + 1 < end && clusterMisses <= missLimit * cluster.TriangleCount)
+			{
+				time += AnalysisCacheSize + 1;
+				clusterMisses = 0;
+				clusters.push_back({ t + 1, 0, XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f), 0.0f, 0.0f });
+			}
+		}
+	}
+	if (clusters.size() < 2)
+	{
+		return;
+	}
+
+	// The centroid of the whole mesh, weighted by triangle area
+	TriangleCluster mesh = { 0, 0, XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f), 0.0f, 0.0f };
+	for (const TriangleCluster& cluster : clusters)
+	{
+		AddCluster(mesh, cluster);
+	}
+	float meshScale = mesh.Area > 0.0f ? 1.0f / (mesh.Area * 3.0f) : 0.0f;
+	XMFLOAT3 meshCentroid(mesh.CentroidSum.x * meshScale, mesh.CentroidSum.y * meshScale, mesh.CentroidSum.z * meshScale);
+
+	// The soft boundaries only estimate the cost, since a cluster can also lose vertices that
+	// the cluster before it in the cache order left in the cache.  So the sorted order is
+	// measured, and if it transforms too many more vertices than the cache order, the clusters
+	// are merged in pairs and sorted again.  If even two clusters cost too much, the cache
+	// order is kept as it is.
+	size_t transformLimit = static_cast<size_t>(CountTransforms(indices, vertices.size(), AnalysisCacheSize) * acmrThreshold);
+	std::vector<TriangleCluster> merged;
+	std::vector<unsigned int> sorted;
+	sorted.reserve(triangleCount * 3);
+	for (size_t clustersPerMerge = 1; clustersPerMerge < clusters.size(); clustersPerMerge *= 2)
+	{
+		merged.clear();
+		for (size_t c = 0; c < clusters.size(); c++)
+		{
+			if (c % clustersPerMerge == 0)
+			{
+				merged.push_back(clusters[c]);
+			}
+			else
+			{
+				AddCluster(merged.back(), clusters[c]);
+			}
+		}
+
+		// Clusters that are further out along the way they face are more likely to be in front
+		// of the rest of the mesh, so they are drawn first
+		for (TriangleCluster& cluster : merged)
+		{
+			float scale = cluster.Area > 0.0f ? 1.0f / (cluster.Area * 3.0f) : 0.0f;
+			XMFLOAT3 centroid(cluster.CentroidSum.x * scale, cluster.CentroidSum.y * scale, cluster.CentroidSum.z * scale);
+			const XMFLOAT3& normal = cluster.NormalSum;
+			float normalLength = sqrtf(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+			float normalScale = normalLength > 0.0f ? 1.0f / normalLength : 0.0f;
+			cluster.SortKey = ((centroid.x - meshCentroid.x) * normal.x +
+							   (centroid.y - meshCentroid.y) * normal.y +
+							   (centroid.z - meshCentroid.z) * normal.z) * normalScale;
+		}
+		std::stable_sort(merged.begin(), merged.end(),
+						 [](const TriangleCluster& first, const TriangleCluster& second) { return first.SortKey > second.SortKey; });
+
+		sorted.clear();
+		for (const TriangleCluster& cluster : merged)
+		{
+			sorted.insert(sorted.end(), indices.begin() + cluster.FirstTriangle * 3, indices.begin() + (cluster.FirstTriangle + cluster.TriangleCount) * 3);
+		}
+		if (CountTransforms(sorted, vertices.size(), AnalysisCacheSize) <= transformLimit)
+		{
+			std::copy(sorted.begin(), sorted.end(), indices.begin());
+			return;
+		}
+	}
+}
+
+void MeshOptimiser::OptimiseVertexFetch(std::vector<VERTEX>& vertices, std::vector<unsigned int>& indices)
+{
+	// Vertices that no triangle uses are dropped
+	std::vector<unsigned int> remap(vertices.size(), NoVertex);
+	std::vector<VERTEX> ordered;
+	ordered.reserve(vertices.size());
+	for (unsigned int& index : indices)
+	{
+		if (remap[index] == NoVertex)
+		{
+			remap[index] = static_cast<unsigned int>(ordered.size());
+			ordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+	vertices.swap(ordered);
+}
+
+size_t MeshOptimiser::CountTransforms(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize)
+{
+	// A vertex is in the FIFO cache if fewer than cacheSize vertices have been added since it was
+	std::vector<size_t> cacheTime(vertexCount, 0);
+	size_t time = cacheSize + 1;
+	size_t transforms = 0;
+	for (unsigned int index : indices)
+	{
+		if (time - cacheTime[index] > cacheSize)
+		{
+			cacheTime[index] = time++;
+			transforms++;
+		}
+	}
+	return transforms;
+}
+
+float MeshOptimiser::GetAcmr(size_t transformCount, size_t triangleCount)
+{
+	return triangleCount > 0 ? static_cast<float>(transformCount) / triangleCount : 0.0f;
+}
+
+float MeshOptimiser::GetAtvr(size_t transformCount, size_t vertexCount)
+{
+	return vertexCount > 0 ? static_cast<float>(transformCount) / vertexCount : 0.0f;
+}
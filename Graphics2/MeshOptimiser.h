@@ -0,0 +1,58 @@
+#pragma once
+#include "Vertex.h"
+#include <vector>
+
+// Reorders a sub-mesh's triangles and vertices so that the GPU does less work drawing it.
+// Nothing here depends on Direct3D, so it is run on the worker threads that read models.
+//
+// Optimise runs these steps in order:
+//   1. WeldVertices removes vertices that are exact copies of another vertex, so that the
+//      triangles that share them can share the transformed result.
+//   2. OptimiseVertexCache reorders the triangles so that vertices are reused while they are
+//      still in the post-transform cache (Tom Forsyth's linear-speed algorithm).
+//   3. OptimiseOverdraw splits the new order into clusters, both where the cache had to start
+//      again anyway and where a cluster started from an empty cache costs little more than
+//      the order does, and draws the clusters facing out from the centre of the mesh first,
+//      so that they hide more of what is behind them.  A cluster can still lose reuse of
+//      vertices left in the cache by the one that was before it, so the ACMR is measured, and
+//      clusters are merged until it is no more than OverdrawAcmrThreshold times the ACMR of
+//      step 2 (the lambda of Sander et al.).
+//   4. OptimiseVertexFetch puts the vertices in the order the triangles first use them, so
+//      the vertex fetches walk through memory.
+//
+// ACMR (average cache miss ratio) is the number of vertices transformed per triangle: 3 with
+// no reuse and around 0.5 to 0.7 for a well ordered mesh.  ATVR (average transform to vertex
+// ratio) is the number transformed per vertex, where 1 is the best possible.
+
+struct MeshOptimisationStatistics
+{
+	size_t						VertexCountBefore;
+	size_t						VertexCountAfter;
+	size_t						TriangleCount;
+	// Transforms counted with a FIFO cache of AnalysisCacheSize vertices
+	size_t						TransformCountBefore;
+	size_t						TransformCountAfter;
+};
+
+class MeshOptimiser
+{
+public:
+	// The size of the FIFO cache used to count transforms.  Most GPUs have at least this many.
+	static const unsigned int	AnalysisCacheSize = 16;
+	// How much OptimiseOverdraw may raise the ACMR, as a ratio.  1 only reorders clusters where
+	// that costs nothing.
+	static const float			OverdrawAcmrThreshold;
+
+	static void					Optimise(std::vector<VERTEX>& vertices, std::vector<unsigned int>& indices, MeshOptimisationStatistics& statistics);
+	static void					AddStatistics(const MeshOptimisationStatistics& subMeshStatistics, MeshOptimisationStatistics& statistics);
+
+	static void					WeldVertices(std::vector<VERTEX>& vertices, std::vector<unsigned int>& indices);
+	static void					OptimiseVertexCache(std::vector<unsigned int>& indices, size_t vertexCount);
+	static void					OptimiseOverdraw(const std::vector<VERTEX>& vertices, std::vector<unsigned int>& indices, float acmrThreshold = OverdrawAcmrThreshold);
+	static void					OptimiseVertexFetch(std::vector<VERTEX>& vertices, std::vector<unsigned int>& indices);
+
+	// The number of vertices that would be transformed drawing the triangles with a FIFO cache
+	static size_t				CountTransforms(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize);
+	static float				GetAcmr(size_t transformCount, size_t triangleCount);
+	static float				GetAtvr(size_t transformCount, size_t vertexCount);
+};
@@ -1,23 +1,6 @@
 #include "MeshRenderer.h"
 #include "DirectXFramework.h"
 
-struct CBUFFER
-{
-	XMMATRIX    CompleteTransformation;
-	XMMATRIX	WorldTransformation;
-	XMFLOAT4	CameraPosition;
-	XMVECTOR    LightVector;
-	XMFLOAT4    LightColor;
-	XMFLOAT4    AmbientColor;
-	XMFLOAT4    DiffuseCoefficient;
-	XMFLOAT4	SpecularCoefficient;
-	float		Shininess;
-	float		Opacity;
-	float       Padding[2];
-};
-
-CBUFFER cBuffer;
-
 void MeshRenderer::SetMesh(shared_ptr<Mesh> mesh)
 {
 	_mesh = mesh;
@@ -28,118 +11,176 @@ void MeshRenderer::SetWorldTransformation(FXMMATRIX worldTransformation)
 	XMStoreFloat4x4(&_worldTransformation, worldTransformation);
 }
 
-void MeshRenderer::SetAmbientLight(XMFLOAT4 ambientLight)
-{
-	_ambientLight = ambientLight;
-}
-
-void MeshRenderer::SetDirectionalLight(FXMVECTOR lightVector, XMFLOAT4 lightColour)
-{
-	_directionalLightColour = lightColour;
-	XMStoreFloat4(&_directionalLightVector, lightVector);
-}
-
-void MeshRenderer::SetCameraPosition(XMFLOAT4 cameraPosition)
-{
-	_cameraPosition = cameraPosition;
-}
-
 bool MeshRenderer::Initialise()
 {
 	_device = DirectXFramework::GetDXFramework()->GetDevice();
 	_deviceContext = DirectXFramework::GetDXFramework()->GetDeviceContext();
+	_resourceManager = DirectXFramework::GetDXFramework()->GetResourceManager().get();
 	BuildShaders();
 	BuildVertexLayout();
-	BuildConstantBuffer();
 	BuildBlendState();
 	BuildRendererState();
+
+	// Turn off back face culling while we render a mesh. 
+	// We do this since ASSIMP does not appear to be setting the
+	// TWOSIDED property on materials correctly. Without turning off
+	// back face culling, some materials do not render correctly.
+	_pipeline.VertexShader = _vertexShader;
+	_pipeline.PixelShader = _pixelShader;
+	_pipeline.InputLayout = _layout;
+	_pipeline.BlendState = _transparentBlendState;
+	_pipeline.RasterizerState = _noCullRasteriserState;
+	_pipeline.Topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+	// The camera and lights are shared by every renderer
+	_pipeline.FrameConstantBuffer = DirectXFramework::GetDXFramework()->GetClusteredLighting()->GetFrameConstantBuffer();
+	_instancedPipeline = _pipeline;
+	_instancedPipeline.VertexShader = _instancedVertexShader;
+	_instancedPipeline.InputLayout = _instancedLayout;
+	_quantizedPipeline = _pipeline;
+	_quantizedPipeline.VertexShader = _quantizedVertexShader;
+	_quantizedPipeline.InputLayout = _quantizedLayout;
+	_quantizedInstancedPipeline = _pipeline;
+	_quantizedInstancedPipeline.VertexShader = _quantizedInstancedVertexShader;
+	_quantizedInstancedPipeline.InputLayout = _quantizedInstancedLayout;
 	return true;
 }
 
-void MeshRenderer::RenderNode(shared_ptr<Node> node, bool renderTransparent)
+void MeshRenderer::RenderNode(shared_ptr<Node> node, bool testBounds, SubMeshSelection selection, RenderQueue& renderQueue, const DrawPacket& instancing,
+							  FXMMATRIX viewProjection, const XMFLOAT4X4 * instances, unsigned int instanceCount)
 {
-	unsigned int subMeshCount = (unsigned int)node->GetMeshCount();
-	// Loop through all submeshes in the mesh, rendering them
-	for (unsigned int i = 0; i < subMeshCount; i++)
+	const SubMeshSelector& selector = _mesh->GetSubMeshSelector();
+	auto isSelected = [&selector, selection](unsigned int meshIndex)
 	{
-		unsigned int meshIndex = node->GetMesh(i);
-		shared_ptr<SubMesh> subMesh = _mesh->GetSubMesh(meshIndex);
-		shared_ptr<Material> material = subMesh->GetMaterial();
-		float opacity = material->GetOpacity();
-		if ((renderTransparent && opacity < 1.0f) ||
-			(!renderTransparent && opacity == 1.0f))
+		return selector.IsSelected(meshIndex, selection);
+	};
+	// The culler skips the nodes that are out of view, with everything below them
+	_nodeCuller.Cull(*node, XMMatrixIdentity(), testBounds, _frustum, _mesh->GetSubMeshBounds(), isSelected,
+		[&](Node&, FXMMATRIX nodeTransformation, const vector<unsigned int>& meshIndices)
+	{
+		// The selector works out the draws each of the node's sub-meshes needs, and the depth
+		// each is sorted by.  The queue draws transparent submeshes after the opaque ones,
+		// furthest first.  We have to do this since blending always blends the submesh with
+		// whatever is in the render target.  If we render a transparent node first, it will be opaque.
+		_draws.clear();
+		selector.AddDraws(meshIndices, nodeTransformation, viewProjection, instances, instanceCount, selection, _draws);
+
+		// Submit each of the draws to the render queue
+		for (const SubMeshDraw& draw : _draws)
 		{
-			UINT stride = sizeof(VERTEX);
-			UINT offset = 0;
-			_vertexBuffer = subMesh->GetVertexBuffer();
-			_deviceContext->IASetVertexBuffers(0, 1, _vertexBuffer.GetAddressOf(), &stride, &offset);
-			_indexBuffer = subMesh->GetIndexBuffer();
-			_deviceContext->IASetIndexBuffer(_indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
-			cBuffer.DiffuseCoefficient = material->GetDiffuseColour();
-			cBuffer.SpecularCoefficient = material->GetSpecularColour();
-			cBuffer.Shininess = material->GetShininess();
-			cBuffer.Opacity = opacity;
-			// Update the constant buffer 
-			_deviceContext->VSSetConstantBuffers(0, 1, _constantBuffer.GetAddressOf());
-			_deviceContext->UpdateSubresource(_constantBuffer.Get(), 0, 0, &cBuffer, 0, 0);
-			_texture = material->GetTexture();
-			_deviceContext->PSSetShaderResources(0, 1, _texture.GetAddressOf());
-			_deviceContext->PSSetConstantBuffers(0, 1, _constantBuffer.GetAddressOf());
-			_deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-			_deviceContext->DrawIndexed(static_cast<UINT>(subMesh->GetIndexCount()), 0, 0);
+			shared_ptr<SubMesh> subMesh = _mesh->GetSubMesh(draw.MeshIndex);
+			shared_ptr<Material> material = subMesh->GetMaterial();
+
+			ObjectConstants subMeshConstants;
+			subMeshConstants.CompleteTransformation = draw.CompleteTransformation;
+			subMeshConstants.WorldTransformation = draw.WorldTransformation;
+			subMeshConstants.PositionScale = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+			subMeshConstants.PositionOffset = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+
+			// Quantized submeshes need a vertex shader that unpacks them, and their
+			// bounding box to scale the positions back
+			const RenderPipeline * pipeline;
+			if (subMesh->IsQuantized())
+			{
+				pipeline = draw.Instanced ? &_quantizedInstancedPipeline : &_quantizedPipeline;
+				XMFLOAT3 positionScale = subMesh->GetPositionScale();
+				XMFLOAT3 positionOffset = subMesh->GetPositionOffset();
+				subMeshConstants.PositionScale = XMFLOAT4(positionScale.x, positionScale.y, positionScale.z, 1.0f);
+				subMeshConstants.PositionOffset = XMFLOAT4(positionOffset.x, positionOffset.y, positionOffset.z, 0.0f);
+			}
+			else
+			{
+				pipeline = draw.Instanced ? &_instancedPipeline : &_pipeline;
+			}
+
+			DrawPacket packet = {};
+			if (draw.Instanced)
+			{
+				packet.InstanceBuffer = instancing.InstanceBuffer;
+				packet.InstanceCount = instancing.InstanceCount;
+				packet.StartInstance = instancing.StartInstance;
+			}
+			packet.Pipeline = pipeline;
+			packet.SortKey = RenderQueue::MakeSortKey(draw.Transparent, pipeline->SortId.Get(), material->GetSortId(), draw.Depth);
+			if (material->GetStreamedTextureId() != Material::NoStreamedTexture)
+			{
+				_resourceManager->MarkTextureUsed(material->GetStreamedTextureId());
+			}
+			packet.MaterialConstantBuffer = material->GetConstantBuffer().Get();
+			packet.Texture = material->GetTexture().Get();
+			packet.VertexBuffer = subMesh->GetVertexBuffer().Get();
+			packet.IndexBuffer = subMesh->GetIndexBuffer().Get();
+			packet.VertexStride = subMesh->GetVertexStride();
+			packet.IndexSize = subMesh->GetIndexSize();
+			packet.IndexCount = static_cast<unsigned int>(subMesh->GetIndexCount());
+			packet.StartIndex = subMesh->GetStartIndex();
+			packet.BaseVertex = subMesh->GetBaseVertex();
+			renderQueue.Submit(packet, &subMeshConstants, sizeof(ObjectConstants));
 		}
-	}
-	// Render the children
-	unsigned int childrenCount = (unsigned int)node->GetChildrenCount();
-	// Loop through all submeshes in the mesh, rendering them
-	for (unsigned int i = 0; i < childrenCount; i++)
-	{
-		RenderNode(node->GetChild(i), renderTransparent);
-	}
+	});
 }
 
 void MeshRenderer::Render()
 {
-	// Turn off back face culling while we render a mesh. 
-	// We do this since ASSIMP does not appear to be setting the
-	// TWOSIDED property on materials correctly. Without turning off
-	// back face culling, some materials do not render correctly.
-	_deviceContext->RSSetState(_noCullRasteriserState.Get());
+	XMMATRIX projectionTransformation = DirectXFramework::GetDXFramework()->GetProjectionTransformation();
+	XMMATRIX viewTransformation = DirectXFramework::GetDXFramework()->GetCamera()->GetViewMatrix();
+	XMMATRIX viewProjection = viewTransformation * projectionTransformation;
 
+	// The draws are made when the framework flushes the render queue.  RenderNode
+	// picks the pipeline for each submesh and culls the nodes that are out of view.
+	_frustum.SetFromMatrix(XMLoadFloat4x4(&_worldTransformation) * viewProjection);
+	RenderNode(_mesh->GetRootNode(), true, SubMeshSelection::All, *DirectXFramework::GetDXFramework()->GetRenderQueue(), DrawPacket(),
+			   viewProjection, &_worldTransformation, 1);
+}
+
+void MeshRenderer::RenderInstanced(ComPtr<ID3D11Buffer> instanceBuffer, const XMFLOAT4X4 * instanceTransforms, unsigned int startInstance, unsigned int instanceCount)
+{
 	XMMATRIX projectionTransformation = DirectXFramework::GetDXFramework()->GetProjectionTransformation();
 	XMMATRIX viewTransformation = DirectXFramework::GetDXFramework()->GetCamera()->GetViewMatrix();
 
-	XMMATRIX completeTransformation = XMLoadFloat4x4(&_worldTransformation) * viewTransformation * projectionTransformation;
-
-	// Draw the first cube
-
-	cBuffer.CompleteTransformation = completeTransformation;
-	cBuffer.WorldTransformation = XMLoadFloat4x4(&_worldTransformation);
-	cBuffer.AmbientColor = _ambientLight;
-	cBuffer.LightVector = XMVector4Normalize(XMLoadFloat4(&_directionalLightVector)); 
-	cBuffer.LightColor = _directionalLightColour;
-	cBuffer.CameraPosition = _cameraPosition;
-
-	_deviceContext->VSSetShader(_vertexShader.Get(), 0, 0);
-	_deviceContext->PSSetShader(_pixelShader.Get(), 0, 0);
-	_deviceContext->IASetInputLayout(_layout.Get());
-
-	// Set the blend state correctly to handle opacity
-	float blendFactors[] = { 0.0f, 0.0f, 0.0f, 0.0f }; 
-	_deviceContext->OMSetBlendState(_transparentBlendState.Get(), blendFactors, 0xffffffff);
-
-	// We do two passes through the nodes.  The first time we render nodes
-	// that are not transparent (i.e. their opacity == 1.0f).
-	RenderNode(_mesh->GetRootNode(), false);
-	// Now we render any transparent nodes
-	// We have to do this since blending always blends the submesh with
-	// whatever is in the render target.  If we render a transparent node
-	// first, it will be opaque.
-	RenderNode(_mesh->GetRootNode(), true);
-
-	// Turn back face culling back on in case another renderer 
-	// relies on it
-	_deviceContext->RSSetState(_defaultRasteriserState.Get());
+	// Each instance's world transformation comes from the instance buffer
+	DrawPacket instancing = {};
+	instancing.InstanceBuffer = instanceBuffer.Get();
+	instancing.InstanceCount = instanceCount;
+	instancing.StartInstance = startInstance;
+	// Every instance was tested before it was batched, and the nodes cannot be culled for
+	// some instances but not others.  The transparent submeshes are drawn for each instance
+	// in the same walk of the nodes, so they can be sorted.
+	RenderNode(_mesh->GetRootNode(), false, SubMeshSelection::All, *DirectXFramework::GetDXFramework()->GetRenderQueue(), instancing,
+			   viewTransformation * projectionTransformation, instanceTransforms + startInstance, instanceCount);
+}
+
+bool MeshRenderer::IsMeshVisible(const shared_ptr<Mesh>& mesh, FXMMATRIX worldTransformation)
+{
+	XMMATRIX projectionTransformation = DirectXFramework::GetDXFramework()->GetProjectionTransformation();
+	XMMATRIX viewTransformation = DirectXFramework::GetDXFramework()->GetCamera()->GetViewMatrix();
+
+	// The mesh's bounds are in object space, so the frustum is too
+	Frustum frustum(worldTransformation * viewTransformation * projectionTransformation);
+	const MeshBounds& bounds = mesh->GetBounds();
+	_cullingStatistics.MeshesTested++;
+	if (bounds.IsEmpty() || !frustum.IntersectsBox(bounds.Minimum, bounds.Maximum))
+	{
+		_cullingStatistics.MeshesCulled++;
+		return false;
+	}
+	MeshBounds worldBounds = bounds.Transform(worldTransformation);
+	if (!DirectXFramework::GetDXFramework()->GetOcclusionCuller()->IsBoxVisible(worldBounds.Minimum, worldBounds.Maximum))
+	{
+		_cullingStatistics.MeshesOccluded++;
+		return false;
+	}
+	return true;
+}
+
+MeshCullingStatistics MeshRenderer::TakeCullingStatistics()
+{
+	MeshCullingStatistics statistics = _cullingStatistics;
+	MeshCullingStatistics nodeStatistics = _nodeCuller.TakeStatistics();
+	statistics.NodesCulled = nodeStatistics.NodesCulled;
+	statistics.SubMeshesCulled = nodeStatistics.SubMeshesCulled;
+	statistics.SubMeshesDrawn = nodeStatistics.SubMeshesDrawn;
+	_cullingStatistics = {};
+	return statistics;
 }
 
 void MeshRenderer::Shutdown(void)
@@ -148,18 +189,11 @@ void MeshRenderer::Shutdown(void)
 
 void MeshRenderer::BuildShaders()
 {
-	DWORD shaderCompileFlags = 0;
-#if defined( _DEBUG )
-	shaderCompileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
-#endif
-
+	// The framework's shader cache picks the compile flags and makes sure each shader is only compiled once
 	ComPtr<ID3DBlob> compilationMessages = nullptr;
 
 	//Compile vertex shader
-	HRESULT hr = D3DCompileFromFile(L"TexturedShaders.hlsl",
-									nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE,
-									"VShader", "vs_5_0",
-									shaderCompileFlags, 0,
+	HRESULT hr = DirectXFramework::GetDXFramework()->CompileShader(L"TexturedShaders.hlsl", "VShader", "vs_5_0",
 									_vertexShaderByteCode.GetAddressOf(),
 									compilationMessages.GetAddressOf());
 
@@ -172,11 +206,46 @@ void MeshRenderer::BuildShaders()
 	ThrowIfFailed(hr);
 	ThrowIfFailed(_device->CreateVertexShader(_vertexShaderByteCode->GetBufferPointer(), _vertexShaderByteCode->GetBufferSize(), NULL, _vertexShader.GetAddressOf()));
 
+	// Compile the vertex shader used for instanced drawing
+	hr = DirectXFramework::GetDXFramework()->CompileShader(L"TexturedShaders.hlsl", "VShaderInstanced", "vs_5_0",
+							_instancedVertexShaderByteCode.GetAddressOf(),
+							compilationMessages.GetAddressOf());
+
+	if (compilationMessages.Get() != nullptr)
+	{
+		// If there were any compilation messages, display them
+		MessageBoxA(0, (char*)compilationMessages->GetBufferPointer(), 0, 0);
+	}
+	ThrowIfFailed(hr);
+	ThrowIfFailed(_device->CreateVertexShader(_instancedVertexShaderByteCode->GetBufferPointer(), _instancedVertexShaderByteCode->GetBufferSize(), NULL, _instancedVertexShader.GetAddressOf()));
+
+	// Compile the vertex shaders used for quantized submeshes
+	hr = DirectXFramework::GetDXFramework()->CompileShader(L"TexturedShaders.hlsl", "VShaderQuantized", "vs_5_0",
+							_quantizedVertexShaderByteCode.GetAddressOf(),
+							compilationMessages.GetAddressOf());
+
+	if (compilationMessages.Get() != nullptr)
+	{
+		// If there were any compilation messages, display them
+		MessageBoxA(0, (char*)compilationMessages->GetBufferPointer(), 0, 0);
+	}
+	ThrowIfFailed(hr);
+	ThrowIfFailed(_device->CreateVertexShader(_quantizedVertexShaderByteCode->GetBufferPointer(), _quantizedVertexShaderByteCode->GetBufferSize(), NULL, _quantizedVertexShader.GetAddressOf()));
+
+	hr = DirectXFramework::GetDXFramework()->CompileShader(L"TexturedShaders.hlsl", "VShaderQuantizedInstanced", "vs_5_0",
+							_quantizedInstancedVertexShaderByteCode.GetAddressOf(),
+							compilationMessages.GetAddressOf());
+
+	if (compilationMessages.Get() != nullptr)
+	{
+		// If there were any compilation messages, display them
+		MessageBoxA(0, (char*)compilationMessages->GetBufferPointer(), 0, 0);
+	}
+	ThrowIfFailed(hr);
+	ThrowIfFailed(_device->CreateVertexShader(_quantizedInstancedVertexShaderByteCode->GetBufferPointer(), _quantizedInstancedVertexShaderByteCode->GetBufferSize(), NULL, _quantizedInstancedVertexShader.GetAddressOf()));
+
 	// Compile pixel shader
-	hr = D3DCompileFromFile(L"TexturedShaders.hlsl",
-							nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE,
-							"PShader", "ps_5_0",
-							shaderCompileFlags, 0,
+	hr = DirectXFramework::GetDXFramework()->CompileShader(L"TexturedShaders.hlsl", "PShader", "ps_5_0",
 							_pixelShaderByteCode.GetAddressOf(),
 							compilationMessages.GetAddressOf());
 
@@ -202,16 +271,40 @@ void MeshRenderer::BuildVertexLayout()
 		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT , D3D11_INPUT_PER_VERTEX_DATA, 0 },
 	};
 	ThrowIfFailed(_device->CreateInputLayout(vertexDesc, ARRAYSIZE(vertexDesc), _vertexShaderByteCode->GetBufferPointer(), _vertexShaderByteCode->GetBufferSize(), _layout.GetAddressOf()));
-}
 
-void MeshRenderer::BuildConstantBuffer()
-{
-	D3D11_BUFFER_DESC bufferDesc;
-	ZeroMemory(&bufferDesc, sizeof(bufferDesc));
-	bufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	bufferDesc.ByteWidth = sizeof(CBUFFER);
-	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	ThrowIfFailed(_device->CreateBuffer(&bufferDesc, NULL, _constantBuffer.GetAddressOf()));
+	// The instanced layout adds a world transform per instance from a second buffer
+	D3D11_INPUT_ELEMENT_DESC instancedVertexDesc[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT , D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT , D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	};
+	ThrowIfFailed(_device->CreateInputLayout(instancedVertexDesc, ARRAYSIZE(instancedVertexDesc), _instancedVertexShaderByteCode->GetBufferPointer(), _instancedVertexShaderByteCode->GetBufferSize(), _instancedLayout.GetAddressOf()));
+
+	// The quantized layouts match PackedVertex in VertexPacker.h
+	D3D11_INPUT_ELEMENT_DESC quantizedVertexDesc[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT , D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT , D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	};
+	ThrowIfFailed(_device->CreateInputLayout(quantizedVertexDesc, ARRAYSIZE(quantizedVertexDesc), _quantizedVertexShaderByteCode->GetBufferPointer(), _quantizedVertexShaderByteCode->GetBufferSize(), _quantizedLayout.GetAddressOf()));
+
+	D3D11_INPUT_ELEMENT_DESC quantizedInstancedVertexDesc[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT , D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT , D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	};
+	ThrowIfFailed(_device->CreateInputLayout(quantizedInstancedVertexDesc, ARRAYSIZE(quantizedInstancedVertexDesc), _quantizedInstancedVertexShaderByteCode->GetBufferPointer(), _quantizedInstancedVertexShaderByteCode->GetBufferSize(), _quantizedInstancedLayout.GetAddressOf()));
 }
 
 void MeshRenderer::BuildBlendState()
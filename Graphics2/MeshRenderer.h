@@ -1,6 +1,14 @@
 #pragma once
 #include "Renderer.h"
 #include "Mesh.h"
+#include "RenderQueue.h"
+#include "DirectXRenderCommandSink.h"
+#include "ConstantBuffers.h"
+#include "Frustum.h"
+#include "NodeCuller.h"
+#include "SubMeshSelector.h"
+
+class ResourceManager;
 
 class MeshRenderer : public Renderer
 {
@@ -8,48 +16,69 @@ public:
 
 	void SetMesh(shared_ptr<Mesh> mesh);
 	void SetWorldTransformation(FXMMATRIX worldTransformation);
-	void SetAmbientLight(XMFLOAT4 ambientLight);
-	void SetDirectionalLight(FXMVECTOR lightVector, XMFLOAT4 lightColour);
-	void SetCameraPosition(XMFLOAT4 cameraPosition);
 	bool Initialise();
 	void Render();
+	// Draws the opaque sub-meshes once for each world transform in instanceBuffer, starting at
+	// startInstance.  instanceTransforms are the same transforms, from the start of the buffer.
+	// The transparent sub-meshes are drawn with each of them in turn, so the queue can sort them.
+	void RenderInstanced(ComPtr<ID3D11Buffer> instanceBuffer, const XMFLOAT4X4 * instanceTransforms, unsigned int startInstance, unsigned int instanceCount);
 	void Shutdown(void);
 
+	// False if none of the mesh would be in view with this world transformation
+	bool IsMeshVisible(const shared_ptr<Mesh>& mesh, FXMMATRIX worldTransformation);
+	// Returns the counts since the last call and starts counting again
+	MeshCullingStatistics TakeCullingStatistics();
+
 private:
 	shared_ptr<Mesh>	_mesh;
 	XMFLOAT4X4			_worldTransformation;
-	XMFLOAT4			_ambientLight;
-	XMFLOAT4			_directionalLightVector;
-	XMFLOAT4			_directionalLightColour;
-	XMFLOAT4			_cameraPosition;
+	// The view frustum in the mesh's object space, used while a mesh is being rendered
+	Frustum				_frustum;
+	NodeCuller			_nodeCuller;
+	// Reused for the draws of each node
+	vector<SubMeshDraw>	_draws;
+	MeshCullingStatistics	_cullingStatistics = {};
 
 	ComPtr<ID3D11Device>			_device;
 	ComPtr<ID3D11DeviceContext>		_deviceContext;
-
-	ComPtr<ID3D11Buffer>			_vertexBuffer;
-	ComPtr<ID3D11Buffer>			_indexBuffer;
+	// Not a shared pointer, since the resource manager owns the renderer
+	ResourceManager *				_resourceManager = nullptr;
 
 	ComPtr<ID3DBlob>				_vertexShaderByteCode = nullptr;
 	ComPtr<ID3DBlob>				_pixelShaderByteCode = nullptr;
+	ComPtr<ID3DBlob>				_instancedVertexShaderByteCode = nullptr;
+	ComPtr<ID3DBlob>				_quantizedVertexShaderByteCode = nullptr;
+	ComPtr<ID3DBlob>				_quantizedInstancedVertexShaderByteCode = nullptr;
 	ComPtr<ID3D11VertexShader>		_vertexShader;
+	ComPtr<ID3D11VertexShader>		_instancedVertexShader;
+	ComPtr<ID3D11VertexShader>		_quantizedVertexShader;
+	ComPtr<ID3D11VertexShader>		_quantizedInstancedVertexShader;
 	ComPtr<ID3D11PixelShader>		_pixelShader;
 	ComPtr<ID3D11InputLayout>		_layout;
-	ComPtr<ID3D11Buffer>			_constantBuffer;
-
-	ComPtr<ID3D11ShaderResourceView> _texture;;
-
+	ComPtr<ID3D11InputLayout>		_instancedLayout;
+	ComPtr<ID3D11InputLayout>		_quantizedLayout;
+	ComPtr<ID3D11InputLayout>		_quantizedInstancedLayout;
 	ComPtr<ID3D11BlendState>		 _transparentBlendState;
 
 	ComPtr<ID3D11RasterizerState>    _defaultRasteriserState;
 	ComPtr<ID3D11RasterizerState>    _noCullRasteriserState;
 
+	// The states shared by all of our draws, used as the pipeline handle in the render queue
+	RenderPipeline					_pipeline;
+	RenderPipeline					_instancedPipeline;
+	RenderPipeline					_quantizedPipeline;
+	RenderPipeline					_quantizedInstancedPipeline;
 
 	void BuildShaders();
 	void BuildVertexLayout();
-	void BuildConstantBuffer();
 	void BuildBlendState();
 	void BuildRendererState();
 
-	void RenderNode(shared_ptr<Node> node, bool renderTransparent);
+	// Submits the sub-meshes of node and the nodes below it, drawn with each of the instances'
+	// world transformations (see SubMeshSelector::AddDraws).  instancing holds the instance
+	// buffer for the instanced draws.  If testBounds is false, the node is known to be
+	// completely in view.
+	void RenderNode(shared_ptr<Node> node, bool testBounds, SubMeshSelection selection, RenderQueue& renderQueue, const DrawPacket& instancing,
+					FXMMATRIX viewProjection, const XMFLOAT4X4 * instances, unsigned int instanceCount);
 };
 
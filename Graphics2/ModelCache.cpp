@@ -0,0 +1,384 @@
+#include "ModelCache.h"
+#include "CacheFiles.h"
+#include "MappedFile.h"
+#include <cstring>
+
+using namespace DirectX;
+
+// Changing the file layout, or the way models are converted when they are imported, must
+// change this so that old files are not used
+static const uint32_t ModelFormatVersion = 4;
+static const char ModelFileMagic[4] = { 'M', 'D', 'L', 'B' };
+
+// Every section starts on a 16 byte boundary
+static const size_t SectionAlignment = 16;
+
+// All offsets are from the start of the file.  The names of the materials and nodes are all
+// kept in one table of 32-bit characters, so that the file reads back the same whatever the
+// size of wchar_t.  Nodes are stored breadth first, so the children of a node are next to
+// each other and always come after it.
+struct ModelFileHeader
+{
+	char					Magic[4];
+	uint32_t				Version;
+	uint64_t				NameHash;
+	uint64_t				SourceHash;
+	uint32_t				VertexSize;
+	uint32_t				MaterialCount;
+	uint32_t				SubMeshCount;
+	uint32_t				NodeCount;
+	uint32_t				NodeMeshCount;
+	uint32_t				NameTableLength;
+	uint64_t				MaterialsOffset;
+	uint64_t				SubMeshesOffset;
+	uint64_t				NodesOffset;
+	uint64_t				NodeMeshesOffset;
+	uint64_t				NameTableOffset;
+	// MeshOptimisationStatistics for the whole model, from when it was imported
+	uint64_t				OptimisedVertexCountBefore;
+	uint64_t				OptimisedVertexCountAfter;
+	uint64_t				OptimisedTriangleCount;
+	uint64_t				TransformCountBefore;
+	uint64_t				TransformCountAfter;
+	// The model file's size and last write time when it was baked (see GetFileStamp)
+	uint64_t				SourceSize;
+	uint64_t				SourceWriteTime;
+};
+
+struct ModelFileMaterial
+{
+	uint32_t				NameStart;
+	uint32_t				NameLength;
+	uint32_t				TextureNameStart;
+	uint32_t				TextureNameLength;
+	XMFLOAT4				DiffuseColour;
+	XMFLOAT4				SpecularColour;
+	float					Shininess;
+	float					Opacity;
+};
+
+struct ModelFileSubMesh
+{
+	uint64_t				VerticesOffset;
+	uint64_t				IndicesOffset;
+	uint32_t				VertexCount;
+	uint32_t				IndexCount;
+	uint32_t				MaterialIndex;
+	uint32_t				Padding;
+};
+
+struct ModelFileNode
+{
+	uint32_t				NameStart;
+	uint32_t				NameLength;
+	uint32_t				FirstMesh;
+	uint32_t				MeshCount;
+	uint32_t				FirstChild;
+	uint32_t				ChildCount;
+	XMFLOAT4X4				Transformation;
+};
+
+static uint64_t HashModelName(const std::wstring& modelName)
+{
+	uint64_t hash = FnvOffsetBasis;
+	HashString(hash, modelName);
+	return hash;
+}
+
+static void AddName(std::vector<uint32_t>& nameTable, const std::wstring& name, uint32_t& start, uint32_t& length)
+{
+	start = static_cast<uint32_t>(nameTable.size());
+	length = static_cast<uint32_t>(name.size());
+	for (wchar_t character : name)
+	{
+		nameTable.push_back(static_cast<uint32_t>(character));
+	}
+}
+
+static bool GetName(const uint32_t * nameTable, uint32_t nameTableLength, uint32_t start, uint32_t length, std::wstring& name)
+{
+	if (static_cast<uint64_t>(start) + length > nameTableLength)
+	{
+		return false;
+	}
+	name.resize(length);
+	for (uint32_t i = 0; i < length; i++)
+	{
+		name[i] = static_cast<wchar_t>(nameTable[start + i]);
+	}
+	return true;
+}
+
+// Pads the contents out to the next section boundary, then adds the data.  Returns the offset
+// of the data.
+static uint64_t AddSection(std::vector<unsigned char>& contents, const void * data, size_t size)
+{
+	contents.resize((contents.size() + SectionAlignment - 1) & ~(SectionAlignment - 1));
+	uint64_t offset = contents.size();
+	if (size > 0)
+	{
+		contents.resize(contents.size() + size);
+		memcpy(&contents[static_cast<size_t>(offset)], data, size);
+	}
+	return offset;
+}
+
+// True if a section of count elements of the given size is aligned and inside the file
+static bool IsSectionInFile(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t fileSize)
+{
+	return offset % SectionAlignment == 0 && offset <= fileSize && count <= (fileSize - offset) / elementSize;
+}
+
+ModelCache::ModelCache(const std::wstring& directory)
+{
+	_directory = directory;
+	_verifySource = false;
+	if (!_directory.empty())
+	{
+		CreateCacheDirectory(_directory);
+	}
+}
+
+std::wstring ModelCache::GetCacheFileName(const std::wstring& modelName) const
+{
+	return ::GetCacheFileName(_directory, HashModelName(modelName), L".mdl");
+}
+
+bool ModelCache::HashModelFile(const std::wstring& modelName, uint64_t& hash)
+{
+	MappedFile file;
+	if (!file.Open(modelName))
+	{
+		return false;
+	}
+	hash = FnvOffsetBasis;
+	HashValue(hash, file.GetSize());
+	HashBytes(hash, file.GetData(), file.GetSize());
+	return true;
+}
+
+std::shared_ptr<ModelData> ModelCache::ReadModel(const std::wstring& modelName)
+{
+	if (_directory.empty())
+	{
+		return nullptr;
+	}
+	uint64_t sourceSize;
+	uint64_t sourceWriteTime;
+	if (!GetFileStamp(modelName, sourceSize, sourceWriteTime))
+	{
+		return nullptr;
+	}
+	// The file stays mapped for as long as the model is kept, since its sub-meshes point into it
+	std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+	if (!file->Open(GetCacheFileName(modelName)) || file->GetSize() < sizeof(ModelFileHeader))
+	{
+		return nullptr;
+	}
+	// Anything that does not look right (such as a file cut short) is treated as missing, and
+	// is replaced once the model has been imported again
+	const unsigned char * data = static_cast<const unsigned char *>(file->GetData());
+	uint64_t fileSize = file->GetSize();
+	ModelFileHeader header;
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.Magic, ModelFileMagic, sizeof(ModelFileMagic)) != 0 ||
+		header.Version != ModelFormatVersion ||
+		header.NameHash != HashModelName(modelName) ||
+		header.VertexSize != sizeof(VERTEX) ||
+		header.NodeCount == 0 ||
+		!IsSectionInFile(header.MaterialsOffset, header.MaterialCount, sizeof(ModelFileMaterial), fileSize) ||
+		!IsSectionInFile(header.SubMeshesOffset, header.SubMeshCount, sizeof(ModelFileSubMesh), fileSize) ||
+		!IsSectionInFile(header.NodesOffset, header.NodeCount, sizeof(ModelFileNode), fileSize) ||
+		!IsSectionInFile(header.NodeMeshesOffset, header.NodeMeshCount, sizeof(uint32_t), fileSize) ||
+		!IsSectionInFile(header.NameTableOffset, header.NameTableLength, sizeof(uint32_t), fileSize))
+	{
+		return nullptr;
+	}
+	// The model file is only read if it does not look the same as when it was baked.  It may
+	// just have been copied or touched, so it is the contents that decide.
+	if (_verifySource || header.SourceSize != sourceSize || header.SourceWriteTime != sourceWriteTime)
+	{
+		uint64_t sourceHash;
+		if (!HashModelFile(modelName, sourceHash) || sourceHash != header.SourceHash)
+		{
+			return nullptr;
+		}
+	}
+	// The sections are aligned, so the tables can be used where they are in the mapped file
+	const ModelFileMaterial * materials = reinterpret_cast<const ModelFileMaterial *>(data + header.MaterialsOffset);
+	const ModelFileSubMesh * subMeshes = reinterpret_cast<const ModelFileSubMesh *>(data + header.SubMeshesOffset);
+	const ModelFileNode * nodes = reinterpret_cast<const ModelFileNode *>(data + header.NodesOffset);
+	const uint32_t * nodeMeshes = reinterpret_cast<const uint32_t *>(data + header.NodeMeshesOffset);
+	const uint32_t * nameTable = reinterpret_cast<const uint32_t *>(data + header.NameTableOffset);
+
+	std::shared_ptr<ModelData> model = std::make_shared<ModelData>();
+	model->MappedStorage = file;
+	model->OptimisationStatistics.VertexCountBefore = static_cast<size_t>(header.OptimisedVertexCountBefore);
+	model->OptimisationStatistics.VertexCountAfter = static_cast<size_t>(header.OptimisedVertexCountAfter);
+	model->OptimisationStatistics.TriangleCount = static_cast<size_t>(header.OptimisedTriangleCount);
+	model->OptimisationStatistics.TransformCountBefore = static_cast<size_t>(header.TransformCountBefore);
+	model->OptimisationStatistics.TransformCountAfter = static_cast<size_t>(header.TransformCountAfter);
+	model->Materials.resize(header.MaterialCount);
+	for (uint32_t i = 0; i < header.MaterialCount; i++)
+	{
+		ModelMaterialData& material = model->Materials[i];
+		if (!GetName(nameTable, header.NameTableLength, materials[i].NameStart, materials[i].NameLength, material.Name) ||
+			!GetName(nameTable, header.NameTableLength, materials[i].TextureNameStart, materials[i].TextureNameLength, material.TextureName))
+		{
+			return nullptr;
+		}
+		material.DiffuseColour = materials[i].DiffuseColour;
+		material.SpecularColour = materials[i].SpecularColour;
+		material.Shininess = materials[i].Shininess;
+		material.Opacity = materials[i].Opacity;
+	}
+
+	model->SubMeshes.resize(header.SubMeshCount);
+	for (uint32_t i = 0; i < header.SubMeshCount; i++)
+	{
+		const ModelFileSubMesh& fileSubMesh = subMeshes[i];
+		if (fileSubMesh.VertexCount == 0 ||
+			fileSubMesh.IndexCount == 0 ||
+			(header.MaterialCount > 0 && fileSubMesh.MaterialIndex >= header.MaterialCount) ||
+			!IsSectionInFile(fileSubMesh.VerticesOffset, fileSubMesh.VertexCount, sizeof(VERTEX), fileSize) ||
+			!IsSectionInFile(fileSubMesh.IndicesOffset, fileSubMesh.IndexCount, sizeof(unsigned int), fileSize))
+		{
+			return nullptr;
+		}
+		ModelSubMeshData& subMesh = model->SubMeshes[i];
+		subMesh.MaterialIndex = fileSubMesh.MaterialIndex;
+		// The streams are aligned, so they are used where they are rather than copied
+		subMesh.MappedVertices = reinterpret_cast<const VERTEX *>(data + fileSubMesh.VerticesOffset);
+		subMesh.MappedVertexCount = fileSubMesh.VertexCount;
+		subMesh.MappedIndices = reinterpret_cast<const unsigned int *>(data + fileSubMesh.IndicesOffset);
+		subMesh.MappedIndexCount = fileSubMesh.IndexCount;
+	}
+
+	// Create all of the nodes first, then link them up.  Children always come after their
+	// parent, so the links cannot form a loop.
+	std::vector<std::shared_ptr<Node>> modelNodes(header.NodeCount);
+	for (uint32_t i = 0; i < header.NodeCount; i++)
+	{
+		modelNodes[i] = std::make_shared<Node>();
+	}
+	for (uint32_t i = 0; i < header.NodeCount; i++)
+	{
+		const ModelFileNode& fileNode = nodes[i];
+		if ((fileNode.ChildCount > 0 && fileNode.FirstChild <= i) ||
+			static_cast<uint64_t>(fileNode.FirstChild) + fileNode.ChildCount > header.NodeCount ||
+			static_cast<uint64_t>(fileNode.FirstMesh) + fileNode.MeshCount > header.NodeMeshCount)
+		{
+			return nullptr;
+		}
+		std::wstring name;
+		if (!GetName(nameTable, header.NameTableLength, fileNode.NameStart, fileNode.NameLength, name))
+		{
+			return nullptr;
+		}
+		modelNodes[i]->SetName(name);
+		modelNodes[i]->SetTransformation(fileNode.Transformation);
+		for (uint32_t mesh = 0; mesh < fileNode.MeshCount; mesh++)
+		{
+			uint32_t meshIndex = nodeMeshes[fileNode.FirstMesh + mesh];
+			if (meshIndex >= header.SubMeshCount)
+			{
+				return nullptr;
+			}
+			modelNodes[i]->AddMesh(meshIndex);
+		}
+		for (uint32_t child = 0; child < fileNode.ChildCount; child++)
+		{
+			modelNodes[i]->AddChild(modelNodes[fileNode.FirstChild + child]);
+		}
+	}
+	model->RootNode = modelNodes[0];
+	return model;
+}
+
+bool ModelCache::WriteModel(const std::wstring& modelName, const ModelData& model)
+{
+	if (_directory.empty() || model.RootNode == nullptr)
+	{
+		return false;
+	}
+	ModelFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.Magic, ModelFileMagic, sizeof(ModelFileMagic));
+	header.Version = ModelFormatVersion;
+	header.NameHash = HashModelName(modelName);
+	if (!GetFileStamp(modelName, header.SourceSize, header.SourceWriteTime) || !HashModelFile(modelName, header.SourceHash))
+	{
+		return false;
+	}
+	header.VertexSize = sizeof(VERTEX);
+	header.OptimisedVertexCountBefore = model.OptimisationStatistics.VertexCountBefore;
+	header.OptimisedVertexCountAfter = model.OptimisationStatistics.VertexCountAfter;
+	header.OptimisedTriangleCount = model.OptimisationStatistics.TriangleCount;
+	header.TransformCountBefore = model.OptimisationStatistics.TransformCountBefore;
+	header.TransformCountAfter = model.OptimisationStatistics.TransformCountAfter;
+
+	std::vector<uint32_t> nameTable;
+	std::vector<ModelFileMaterial> materials(model.Materials.size());
+	for (size_t i = 0; i < model.Materials.size(); i++)
+	{
+		const ModelMaterialData& material = model.Materials[i];
+		AddName(nameTable, material.Name, materials[i].NameStart, materials[i].NameLength);
+		AddName(nameTable, material.TextureName, materials[i].TextureNameStart, materials[i].TextureNameLength);
+		materials[i].DiffuseColour = material.DiffuseColour;
+		materials[i].SpecularColour = material.SpecularColour;
+		materials[i].Shininess = material.Shininess;
+		materials[i].Opacity = material.Opacity;
+	}
+
+	// Flatten the hierarchy breadth first
+	std::vector<std::shared_ptr<Node>> modelNodes;
+	std::vector<ModelFileNode> nodes;
+	std::vector<uint32_t> nodeMeshes;
+	modelNodes.push_back(model.RootNode);
+	for (size_t i = 0; i < modelNodes.size(); i++)
+	{
+		std::shared_ptr<Node> node = modelNodes[i];
+		ModelFileNode fileNode;
+		AddName(nameTable, node->GetName(), fileNode.NameStart, fileNode.NameLength);
+		fileNode.Transformation = node->GetTransformation();
+		fileNode.FirstMesh = static_cast<uint32_t>(nodeMeshes.size());
+		fileNode.MeshCount = static_cast<uint32_t>(node->GetMeshCount());
+		for (unsigned int mesh = 0; mesh < fileNode.MeshCount; mesh++)
+		{
+			nodeMeshes.push_back(node->GetMesh(mesh));
+		}
+		fileNode.FirstChild = static_cast<uint32_t>(modelNodes.size());
+		fileNode.ChildCount = static_cast<uint32_t>(node->GetChildrenCount());
+		for (unsigned int child = 0; child < fileNode.ChildCount; child++)
+		{
+			modelNodes.push_back(node->GetChild(child));
+		}
+		nodes.push_back(fileNode);
+	}
+
+	// The header is filled in last, once the offsets are known
+	std::vector<unsigned char> contents(sizeof(header));
+	std::vector<ModelFileSubMesh> subMeshes(model.SubMeshes.size());
+	for (size_t i = 0; i < model.SubMeshes.size(); i++)
+	{
+		const ModelSubMeshData& subMesh = model.SubMeshes[i];
+		subMeshes[i].VerticesOffset = AddSection(contents, subMesh.GetVertices(), subMesh.GetVertexCount() * sizeof(VERTEX));
+		subMeshes[i].IndicesOffset = AddSection(contents, subMesh.GetIndices(), subMesh.GetIndexCount() * sizeof(unsigned int));
+		subMeshes[i].VertexCount = static_cast<uint32_t>(subMesh.GetVertexCount());
+		subMeshes[i].IndexCount = static_cast<uint32_t>(subMesh.GetIndexCount());
+		subMeshes[i].MaterialIndex = subMesh.MaterialIndex;
+		subMeshes[i].Padding = 0;
+	}
+	header.MaterialCount = static_cast<uint32_t>(materials.size());
+	header.MaterialsOffset = AddSection(contents, materials.data(), materials.size() * sizeof(ModelFileMaterial));
+	header.SubMeshCount = static_cast<uint32_t>(subMeshes.size());
+	header.SubMeshesOffset = AddSection(contents, subMeshes.data(), subMeshes.size() * sizeof(ModelFileSubMesh));
+	header.NodeCount = static_cast<uint32_t>(nodes.size());
+	header.NodesOffset = AddSection(contents, nodes.data(), nodes.size() * sizeof(ModelFileNode));
+	header.NodeMeshCount = static_cast<uint32_t>(nodeMeshes.size());
+	header.NodeMeshesOffset = AddSection(contents, nodeMeshes.data(), nodeMeshes.size() * sizeof(uint32_t));
+	header.NameTableLength = static_cast<uint32_t>(nameTable.size());
+	header.NameTableOffset = AddSection(contents, nameTable.data(), nameTable.size() * sizeof(uint32_t));
+	memcpy(&contents[0], &header, sizeof(header));
+	return WriteWholeFile(GetCacheFileName(modelName), &contents[0], contents.size());
+}
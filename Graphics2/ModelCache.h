@@ -0,0 +1,43 @@
+#pragma once
+#include "ModelData.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Keeps models in a baked form, so that a model only has to be imported through Assimp the
+// first time it is used.
+//
+// A baked model holds exactly what ResourceManager makes from the imported scene: the
+// interleaved VERTEX and index streams for each sub-mesh, the material table and the Node
+// hierarchy.  Later runs map the file and use the streams where they are in it (see
+// ModelSubMeshData), so the file stays mapped until the model is released.  Each model has
+// one file in the cache directory, named after a hash of the model's name.  The file also
+// records the model file's size, last write time and a hash of its contents, so a baked model
+// is not used once the model file changes (it is replaced the next time the model is
+// imported).  Reading a model only checks the size and time, and hashes the model file if
+// they differ, or if SetVerifySource asks for it every time.
+
+class ModelCache
+{
+public:
+	// The directory is created if it does not exist
+	ModelCache(const std::wstring& directory);
+
+	// Returns null if there is no up to date baked file for the model.  Safe to call from any thread.
+	std::shared_ptr<ModelData>	ReadModel(const std::wstring& modelName);
+	// Returns false if the file could not be written.  Safe to call from any thread.
+	bool						WriteModel(const std::wstring& modelName, const ModelData& model);
+
+	std::wstring				GetCacheFileName(const std::wstring& modelName) const;
+
+	// Hashes the model file on every read, for when a model file may have been changed
+	// without changing its size or last write time
+	inline void					SetVerifySource(bool verifySource) { _verifySource = verifySource; }
+
+private:
+	std::wstring				_directory;
+	bool						_verifySource;
+
+	// Returns false if the model file cannot be read
+	static bool					HashModelFile(const std::wstring& modelName, uint64_t& hash);
+};
@@ -0,0 +1,56 @@
+#pragma once
+#include "Node.h"
+#include "Vertex.h"
+#include "MeshOptimiser.h"
+#include "MappedFile.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+// A model as read from a file, before any Direct3D resources have been created for it.
+// Reading and converting a model does not need the device, so it can be done on a worker
+// thread.  The ResourceManager then turns this into a Mesh (creating the materials, textures
+// and buffers) on the thread that owns the device.
+
+struct ModelMaterialData
+{
+	std::wstring						Name;
+	DirectX::XMFLOAT4					DiffuseColour;
+	DirectX::XMFLOAT4					SpecularColour;
+	float								Shininess;
+	float								Opacity;
+	std::wstring						TextureName;		// Empty if the material has no texture
+};
+
+// A sub-mesh that is imported or built in memory fills in Vertices and Indices.  One read
+// from a baked model instead points into the model's mapped file (which ModelData keeps
+// open), so that its streams are not copied before they are packed into the GPU buffers.
+// Anything that only reads a sub-mesh uses GetVertices and GetIndices, which work either way.
+
+struct ModelSubMeshData
+{
+	std::vector<VERTEX>					Vertices;
+	std::vector<unsigned int>			Indices;
+	unsigned int						MaterialIndex;
+
+	const VERTEX *						MappedVertices = nullptr;
+	const unsigned int *				MappedIndices = nullptr;
+	size_t								MappedVertexCount = 0;
+	size_t								MappedIndexCount = 0;
+
+	inline const VERTEX *				GetVertices() const { return MappedVertices != nullptr ? MappedVertices : Vertices.data(); }
+	inline size_t						GetVertexCount() const { return MappedVertices != nullptr ? MappedVertexCount : Vertices.size(); }
+	inline const unsigned int *			GetIndices() const { return MappedIndices != nullptr ? MappedIndices : Indices.data(); }
+	inline size_t						GetIndexCount() const { return MappedIndices != nullptr ? MappedIndexCount : Indices.size(); }
+};
+
+struct ModelData
+{
+	std::vector<ModelMaterialData>		Materials;
+	std::vector<ModelSubMeshData>		SubMeshes;
+	std::shared_ptr<Node>				RootNode;
+	// The sub-meshes are optimised with MeshOptimiser when the model is imported
+	MeshOptimisationStatistics			OptimisationStatistics;
+	// The baked model file the sub-meshes point into, if they were read from one
+	std::shared_ptr<MappedFile>			MappedStorage;
+};
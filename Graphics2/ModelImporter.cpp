@@ -0,0 +1,243 @@
+#include "ModelImporter.h"
+#include <sstream>
+#include <locale>
+#include <codecvt>
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#if defined(_MSC_VER)
+#pragma comment(lib, "../Assimp/lib/release/assimp-vc140-mt.lib")
+#endif
+
+using namespace std;
+using namespace DirectX;
+using namespace Assimp;
+
+//-------------------------------------------------------------------------------------------
+// Utility functions to convert from wstring to string and back
+// Copied from https://stackoverflow.com/questions/4804298/how-to-convert-wstring-into-string
+
+static wstring s2ws(const std::string& str)
+{
+	using convert_typeX = std::codecvt_utf8<wchar_t>;
+	std::wstring_convert<convert_typeX, wchar_t> converterX;
+
+	return converterX.from_bytes(str);
+}
+
+static string ws2s(const std::wstring& wstr)
+{
+	using convert_typeX = std::codecvt_utf8<wchar_t>;
+	std::wstring_convert<convert_typeX, wchar_t> converterX;
+
+	return converterX.to_bytes(wstr);
+}
+
+//-------------------------------------------------------------------------------------------
+
+static shared_ptr<Node> CreateNodes(aiNode * sceneNode)
+{
+	shared_ptr<Node> node = make_shared<Node>();
+	node->SetName(s2ws(string(sceneNode->mName.C_Str())));
+	// Assimp's matrices are for column vectors, so they are transposed for DirectXMath
+	const aiMatrix4x4& sceneTransformation = sceneNode->mTransformation;
+	node->SetTransformation(XMFLOAT4X4(sceneTransformation.a1, sceneTransformation.b1, sceneTransformation.c1, sceneTransformation.d1,
+									   sceneTransformation.a2, sceneTransformation.b2, sceneTransformation.c2, sceneTransformation.d2,
+									   sceneTransformation.a3, sceneTransformation.b3, sceneTransformation.c3, sceneTransformation.d3,
+									   sceneTransformation.a4, sceneTransformation.b4, sceneTransformation.c4, sceneTransformation.d4));
+	// Get the meshes associated with this node
+	unsigned int meshCount = sceneNode->mNumMeshes;
+	for (unsigned int i = 0; i < meshCount; i++)
+	{
+		node->AddMesh(sceneNode->mMeshes[i]);
+	}
+	// Now process the children of this node
+	unsigned int childrenCount = sceneNode->mNumChildren;
+	for (unsigned int i = 0; i < childrenCount; i++)
+	{
+		node->AddChild(CreateNodes(sceneNode->mChildren[i]));
+	}
+	return node;
+}
+
+shared_ptr<ModelData> ModelImporter::Import(const wstring& modelName)
+{
+	// This is run on worker threads, so it must not use the device
+	Importer importer;
+
+	unsigned int postProcessSteps = aiProcess_Triangulate |
+		                            aiProcess_ConvertToLeftHanded;
+	string modelNameUTF8 = ws2s(modelName);
+	const aiScene * scene = importer.ReadFile(modelNameUTF8.c_str(), postProcessSteps);
+	if (!scene)
+	{
+        // If failed to load, there is nothing to do
+		return nullptr;
+	}
+    if (!scene->HasMeshes())
+    {
+        //If there are no meshes, then there is nothing to do.
+        return nullptr;
+    }
+	shared_ptr<ModelData> modelData = make_shared<ModelData>();
+    if (scene->HasMaterials())
+    {
+        // We need to find the directory part of the model name since we will need to add it to any texture names. 
+        // There is definately a more elegant and accurate way to do this using Windows API calls, but this is a quick
+        // and dirty approach
+        string::size_type slashIndex = modelNameUTF8.find_last_of("\\");
+        string directory;
+        if (slashIndex == string::npos) 
+        {
+            directory = ".";
+        }
+        else if (slashIndex == 0) 
+        {
+            directory = "/";
+        }
+        else 
+        {
+            directory = modelNameUTF8.substr(0, slashIndex);
+        }
+        // Let's deal with the materials/textures first
+        modelData->Materials.resize(scene->mNumMaterials);
+        for (unsigned int i = 0; i < scene->mNumMaterials; i++)
+        {
+            // Get the core material properties.  Ideally, we would be looking for more information
+            // e.g. emissive colour, etc.  This is a task for later.
+            aiMaterial * material = scene->mMaterials[i];
+
+			aiColor3D defaultColour = aiColor3D(0.0f, 0.0f, 0.0f);
+			aiColor3D diffuseColour = aiColor3D(0.0f, 0.0f, 0.0f);
+			if (material->Get(AI_MATKEY_COLOR_DIFFUSE, diffuseColour) != aiReturn_SUCCESS)
+			{
+				diffuseColour = defaultColour;
+			}
+            aiColor3D specularColour = aiColor3D(0.0f, 0.0f, 0.0f);
+			if (material->Get(AI_MATKEY_COLOR_SPECULAR, specularColour) != aiReturn_SUCCESS)
+			{
+				specularColour = defaultColour;
+			}
+            float defaultShininess = 0.0f;
+            float& shininess = defaultShininess;
+            material->Get(AI_MATKEY_SHININESS, shininess);
+			float defaultOpacity = 1.0f;
+			float& opacity = defaultOpacity;
+			material->Get(AI_MATKEY_OPACITY, opacity);
+			bool defaultTwoSided = false;
+			bool& twoSided = defaultTwoSided;
+			material->Get(AI_MATKEY_TWOSIDED, twoSided);
+			string fullTextureNamePath = "";
+            if (material->GetTextureCount(aiTextureType_DIFFUSE) > 0)
+            {
+                aiString textureName;
+				float blendFactor;
+				aiTextureOp blendOp;
+                if (material->GetTexture(aiTextureType_DIFFUSE, 0, &textureName, NULL, NULL, &blendFactor, &blendOp, NULL) == AI_SUCCESS)
+                {
+                    // Get full path to texture by prepending the same folder as included in the model name. This
+                    // does assume that textures are in the same folder as the model files
+                    fullTextureNamePath = directory + "\\" + textureName.data;
+                }
+            }
+            // Now create a unique name for the material based on the model name and loop count
+            stringstream materialNameStream;
+            materialNameStream << modelNameUTF8 << i;
+            string materialName = materialNameStream.str();
+			ModelMaterialData& materialData = modelData->Materials[i];
+			materialData.Name = s2ws(materialName);
+			materialData.DiffuseColour = XMFLOAT4(diffuseColour.r, diffuseColour.g, diffuseColour.b, 1.0f);
+			materialData.SpecularColour = XMFLOAT4(specularColour.r, specularColour.g, specularColour.b, 1.0f);
+			materialData.Shininess = shininess;
+			materialData.Opacity = opacity;
+			materialData.TextureName = s2ws(fullTextureNamePath);
+        }
+    }
+    // Now convert the sub-meshes to our vertex and index format
+	modelData->SubMeshes.resize(scene->mNumMeshes);
+    for (unsigned int sm = 0; sm < scene->mNumMeshes; sm++)
+    {
+	    aiMesh * subMesh = scene->mMeshes[sm];
+	    unsigned int numVertices = subMesh->mNumVertices;
+	    bool hasNormals = subMesh->HasNormals();
+	    bool hasTexCoords = subMesh->HasTextureCoords(0);
+	    if (numVertices == 0 || !hasNormals)
+	    {
+		    return nullptr;
+	    }
+		ModelSubMeshData& subMeshData = modelData->SubMeshes[sm];
+		subMeshData.MaterialIndex = subMesh->mMaterialIndex;
+	    // Build up our vertex structure
+	    aiVector3D * subMeshVertices = subMesh->mVertices;
+	    aiVector3D * subMeshNormals = subMesh->mNormals;
+        // We only handle one set of UV coordinates at the moment.  Again, handling multiple sets of UV
+        // coordinates is a future enhancement.
+	    aiVector3D * subMeshTexCoords = subMesh->mTextureCoords[0];
+		subMeshData.Vertices.resize(numVertices);
+	    VERTEX * currentVertex = &subMeshData.Vertices[0];
+	    for (unsigned int i = 0; i < numVertices; i++)
+	    {
+			currentVertex->Position = XMFLOAT3(subMeshVertices->x, subMeshVertices->y, subMeshVertices->z);
+			currentVertex->Normal = XMFLOAT3(subMeshNormals->x, subMeshNormals->y, subMeshNormals->z);
+		    subMeshVertices++;
+		    subMeshNormals++;
+            if (!hasTexCoords)
+            {
+                // If the model does not have texture coordinates, set them to 0
+				currentVertex->TexCoord = XMFLOAT2(0.0f, 0.0f);
+            }
+            else
+            {
+                // Handle negative texture coordinates by wrapping them to positive.  This should
+                // ideally be handled in the shader.  Note we are assuming that negative coordinates
+                // here are no smaller than -1.0 - this may not be a valid assumption.
+		        if (subMeshTexCoords->x < 0)
+		        {
+			        currentVertex->TexCoord.x = subMeshTexCoords->x + 1.0f;
+		        }
+		        else
+		        {
+			        currentVertex->TexCoord.x = subMeshTexCoords->x;
+		        }
+		        if (subMeshTexCoords->y < 0)
+		        {
+			        currentVertex->TexCoord.y = subMeshTexCoords->y + 1.0f;
+		        }
+		        else
+		        {
+			        currentVertex->TexCoord.y = subMeshTexCoords->y;
+		        }
+		        subMeshTexCoords++;
+            }
+		    currentVertex++;
+	    }
+
+	    // Now extract the indices from the file
+	    unsigned int numberOfFaces = subMesh->mNumFaces;
+	    unsigned int numberOfIndices = numberOfFaces * 3;
+	    aiFace * subMeshFaces = subMesh->mFaces;
+	    if (subMeshFaces->mNumIndices != 3)
+	    {
+		    // We are not dealing with triangles, so we cannot handle it
+		    return nullptr;
+	    }
+		subMeshData.Indices.resize(numberOfIndices);
+	    unsigned int * currentIndex = &subMeshData.Indices[0];
+	    for (unsigned int i = 0; i < numberOfFaces; i++)
+	    {
+		    *currentIndex++ = subMeshFaces->mIndices[0];
+		    *currentIndex++ = subMeshFaces->mIndices[1];
+		    *currentIndex++ = subMeshFaces->mIndices[2];
+		    subMeshFaces++;
+	    }
+
+		// Weld and reorder the vertices and triangles so that they are quicker to draw
+		MeshOptimisationStatistics subMeshStatistics = {};
+		MeshOptimiser::Optimise(subMeshData.Vertices, subMeshData.Indices, subMeshStatistics);
+		MeshOptimiser::AddStatistics(subMeshStatistics, modelData->OptimisationStatistics);
+    }
+	// Now build the hierarchy of nodes
+	modelData->RootNode = CreateNodes(scene->mRootNode);
+	return modelData;
+}
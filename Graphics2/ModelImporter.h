@@ -0,0 +1,17 @@
+#pragma once
+#include "ModelData.h"
+#include <memory>
+#include <string>
+
+// Imports a model file through Assimp and converts it into a ModelData: the materials, the
+// sub-meshes as VERTEX and index streams (optimised with MeshOptimiser) and the node
+// hierarchy.  This does not use the device, so it is run on worker threads, and the result is
+// baked by ModelCache so that later runs do not need Assimp to read the model.
+
+class ModelImporter
+{
+public:
+	// Returns null if the file cannot be read, or has a sub-mesh that cannot be drawn (one
+	// without normals, or with faces that are not triangles)
+	static std::shared_ptr<ModelData>	Import(const std::wstring& modelName);
+};
@@ -0,0 +1,40 @@
+#pragma once
+#include "MeshBounds.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+// One node of a model's hierarchy.  A node places its sub-meshes (given as indices into the
+// model's sub-meshes) and its children in its parent's space.  Nothing here depends on
+// Direct3D, so models can be read and baked on worker threads.
+
+class Node
+{
+public:
+	inline void										SetName(std::wstring name) { _name = name; }
+	inline std::wstring								GetName() { return _name; }
+	inline size_t									GetMeshCount() { return _meshIndices.size(); }
+	inline unsigned int								GetMesh(unsigned int index) { return _meshIndices[index]; }
+	inline void										AddMesh(unsigned int meshIndex) { _meshIndices.push_back(meshIndex); }
+	inline size_t									GetChildrenCount() { return _children.size(); }
+	inline std::shared_ptr<Node>					GetChild(unsigned int index) { return _children[index]; }
+	inline void										AddChild(std::shared_ptr<Node> node) { _children.push_back(node); }
+	// Places the node in its parent's space.  The identity unless the model file says otherwise.
+	inline const DirectX::XMFLOAT4X4&				GetTransformation() { return _transformation; }
+	inline void										SetTransformation(const DirectX::XMFLOAT4X4& transformation) { _transformation = transformation; }
+	// The bounds of the node's sub-meshes and all of its children, in the node's own space
+	// (before its transformation is applied).  Set by NodeCuller::CalculateBounds.
+	inline const MeshBounds&						GetBounds() { return _bounds; }
+
+private:
+	std::wstring									_name;
+	std::vector<unsigned int>						_meshIndices;
+	std::vector<std::shared_ptr<Node>>				_children;
+	DirectX::XMFLOAT4X4								_transformation = DirectX::XMFLOAT4X4(1.0f, 0.0f, 0.0f, 0.0f,
+																						  0.0f, 1.0f, 0.0f, 0.0f,
+																						  0.0f, 0.0f, 1.0f, 0.0f,
+																						  0.0f, 0.0f, 0.0f, 1.0f);
+	MeshBounds										_bounds;
+
+	friend class NodeCuller;
+};
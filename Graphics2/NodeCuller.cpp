@@ -0,0 +1,80 @@
+#include "NodeCuller.h"
+
+using namespace DirectX;
+
+void NodeCuller::CalculateBounds(Node& node, const std::vector<MeshBounds>& subMeshBounds)
+{
+	node._bounds = MeshBounds();
+	for (unsigned int meshIndex : node._meshIndices)
+	{
+		if (meshIndex < subMeshBounds.size())
+		{
+			node._bounds.Merge(subMeshBounds[meshIndex]);
+		}
+	}
+	for (std::shared_ptr<Node>& child : node._children)
+	{
+		CalculateBounds(*child, subMeshBounds);
+		node._bounds.Merge(child->_bounds.Transform(XMLoadFloat4x4(&child->_transformation)));
+	}
+}
+
+void NodeCuller::Cull(Node& node, FXMMATRIX parentTransformation, bool testBounds, const Frustum& frustum,
+					  const std::vector<MeshBounds>& subMeshBounds, const SubMeshFilter& filter, const NodeVisitor& visit)
+{
+	XMMATRIX nodeTransformation = XMLoadFloat4x4(&node.GetTransformation()) * parentTransformation;
+	if (testBounds)
+	{
+		MeshBounds bounds = node.GetBounds().Transform(nodeTransformation);
+		if (bounds.IsEmpty())
+		{
+			return;
+		}
+		if (!frustum.IntersectsBox(bounds.Minimum, bounds.Maximum))
+		{
+			_statistics.NodesCulled++;
+			return;
+		}
+		testBounds = !frustum.ContainsBox(bounds.Minimum, bounds.Maximum);
+	}
+
+	// The list is reused by every node, so it is finished with before the children are culled
+	_visibleMeshIndices.clear();
+	size_t meshCount = node.GetMeshCount();
+	for (unsigned int i = 0; i < meshCount; i++)
+	{
+		unsigned int meshIndex = node.GetMesh(i);
+		if (!filter(meshIndex))
+		{
+			continue;
+		}
+		if (testBounds)
+		{
+			MeshBounds bounds = subMeshBounds[meshIndex].Transform(nodeTransformation);
+			if (!frustum.IntersectsBox(bounds.Minimum, bounds.Maximum))
+			{
+				_statistics.SubMeshesCulled++;
+				continue;
+			}
+		}
+		_visibleMeshIndices.push_back(meshIndex);
+	}
+	if (!_visibleMeshIndices.empty())
+	{
+		_statistics.SubMeshesDrawn += static_cast<unsigned int>(_visibleMeshIndices.size());
+		visit(node, nodeTransformation, _visibleMeshIndices);
+	}
+
+	size_t childrenCount = node.GetChildrenCount();
+	for (unsigned int i = 0; i < childrenCount; i++)
+	{
+		Cull(*node.GetChild(i), nodeTransformation, testBounds, frustum, subMeshBounds, filter, visit);
+	}
+}
+
+MeshCullingStatistics NodeCuller::TakeStatistics()
+{
+	MeshCullingStatistics statistics = _statistics;
+	_statistics = {};
+	return statistics;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "Frustum.h"
+#include "Node.h"
+#include <functional>
+#include <vector>
+
+// Frustum culling of a model's node tree.  MeshRenderer uses this to reject whole branches of a
+// mesh before anything is submitted, and it does not need a device, so the counts can be
+// checked on a test scene.
+//
+// A node whose bounds are outside the frustum is rejected with everything below it.  Below a
+// node that is completely inside, nothing is tested.  Otherwise each of the node's sub-meshes
+// is tested with its own bounds.
+
+class NodeCuller
+{
+public:
+	// Decides which sub-meshes are wanted at all.  Those it rejects are neither tested nor counted.
+	using SubMeshFilter = std::function<bool(unsigned int meshIndex)>;
+	// Called for each node with sub-meshes that may be in view.  nodeTransformation takes the
+	// node's space to the space the frustum was made in.
+	using NodeVisitor = std::function<void(Node& node, DirectX::FXMMATRIX nodeTransformation, const std::vector<unsigned int>& meshIndices)>;
+
+	// Sets the bounds of node and every node below it from the bounds of the model's
+	// sub-meshes, indexed as the nodes index them
+	static void						CalculateBounds(Node& node, const std::vector<MeshBounds>& subMeshBounds);
+
+	// parentTransformation takes the node's parent to the frustum's space.  If testBounds is
+	// false, nothing is tested and every wanted sub-mesh is visited.
+	void							Cull(Node& node, DirectX::FXMMATRIX parentTransformation, bool testBounds, const Frustum& frustum,
+										 const std::vector<MeshBounds>& subMeshBounds, const SubMeshFilter& filter, const NodeVisitor& visit);
+
+	// Returns the counts since the last call and starts counting again.  Only the node and
+	// sub-mesh counts are set.
+	MeshCullingStatistics			TakeStatistics();
+
+private:
+	std::vector<unsigned int>		_visibleMeshIndices;
+	MeshCullingStatistics			_statistics = {};
+};
@@ -0,0 +1,541 @@
+#include "OcclusionCuller.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OCCLUSION_CULLER_SSE
+#endif
+
+using namespace DirectX;
+
+const unsigned int OccluderMesh::NoNeighbour;
+
+OcclusionCuller::OcclusionCuller(int width, int height)
+{
+	_width = width;
+	_height = height;
+	_enabled = true;
+	_simd = true;
+	_depth.assign(static_cast<size_t>(width) * height, 1.0f);
+	XMStoreFloat4x4(&_viewProjection, XMMatrixIdentity());
+	_statistics = {};
+}
+
+void OcclusionCuller::AddOccluder(std::shared_ptr<OccluderMesh> occluder)
+{
+	_occluders.push_back(occluder);
+}
+
+void OcclusionCuller::BeginFrame(FXMMATRIX viewProjection)
+{
+	XMStoreFloat4x4(&_viewProjection, viewProjection);
+	_statistics = {};
+	std::fill(_depth.begin(), _depth.end(), 1.0f);
+	if (!_enabled)
+	{
+		return;
+	}
+	std::vector<std::weak_ptr<OccluderMesh>>::iterator it = _occluders.begin();
+	while (it != _occluders.end())
+	{
+		std::shared_ptr<OccluderMesh> occluder = it->lock();
+		if (occluder == nullptr)
+		{
+			it = _occluders.erase(it);
+			continue;
+		}
+		DrawOccluder(*occluder);
+		++it;
+	}
+}
+
+void OcclusionCuller::DrawOccluder(const OccluderMesh& occluder)
+{
+	XMMATRIX completeTransformation = XMLoadFloat4x4(&occluder.WorldTransformation) * XMLoadFloat4x4(&_viewProjection);
+	_clipPositions.resize(occluder.Positions.size());
+	for (size_t i = 0; i < occluder.Positions.size(); i++)
+	{
+		XMStoreFloat4(&_clipPositions[i], XMVector3Transform(XMLoadFloat3(&occluder.Positions[i]), completeTransformation));
+	}
+	bool hasNeighbours = occluder.Neighbours.size() == occluder.Indices.size();
+	for (size_t i = 0; i + 2 < occluder.Indices.size(); i += 3)
+	{
+		const XMFLOAT4& c0 = _clipPositions[occluder.Indices[i]];
+		const XMFLOAT4& c1 = _clipPositions[occluder.Indices[i + 1]];
+		const XMFLOAT4& c2 = _clipPositions[occluder.Indices[i + 2]];
+		// Skip triangles that are wholly off one side of the screen
+		if ((c0.x > c0.w && c1.x > c1.w && c2.x > c2.w) ||
+			(c0.x < -c0.w && c1.x < -c1.w && c2.x < -c2.w) ||
+			(c0.y > c0.w && c1.y > c1.w && c2.y > c2.w) ||
+			(c0.y < -c0.w && c1.y < -c1.w && c2.y < -c2.w))
+		{
+			continue;
+		}
+		const XMFLOAT4 * neighbours[3] = { nullptr, nullptr, nullptr };
+		if (hasNeighbours)
+		{
+			for (int edge = 0; edge < 3; edge++)
+			{
+				unsigned int opposite = occluder.Neighbours[i + edge];
+				if (opposite != OccluderMesh::NoNeighbour)
+				{
+					neighbours[edge] = &_clipPositions[opposite];
+				}
+			}
+		}
+		DrawClippedTriangle(c0, c1, c2, neighbours);
+	}
+	_statistics.OccludersDrawn++;
+}
+
+void OcclusionCuller::DrawClippedTriangle(const XMFLOAT4& c0, const XMFLOAT4& c1, const XMFLOAT4& c2, const XMFLOAT4 * const clipNeighbours[3])
+{
+	// Clip against the near plane (z = 0 in Direct3D clip space), which leaves a triangle or a
+	// quad.  Nothing is clipped against the far plane since those depths are never written.
+	const XMFLOAT4 * input[3] = { &c0, &c1, &c2 };
+	XMFLOAT4 clipped[4];
+	int clippedCount = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		const XMFLOAT4& current = *input[i];
+		const XMFLOAT4& next = *input[(i + 1) % 3];
+		if (current.z >= 0.0f)
+		{
+			clipped[clippedCount++] = current;
+		}
+		if ((current.z >= 0.0f) != (next.z >= 0.0f))
+		{
+			float t = current.z / (current.z - next.z);
+			clipped[clippedCount++] = XMFLOAT4(current.x + (next.x - current.x) * t,
+											   current.y + (next.y - current.y) * t,
+											   0.0f,
+											   current.w + (next.w - current.w) * t);
+		}
+	}
+	if (clippedCount < 3)
+	{
+		return;
+	}
+	XMFLOAT4 screen[4];
+	for (int i = 0; i < clippedCount; i++)
+	{
+		// Anything left at w = 0 is at the eye, where the projection does not work
+		if (clipped[i].w <= 0.0f)
+		{
+			return;
+		}
+		screen[i] = ToScreen(clipped[i]);
+	}
+	if (clippedCount == 4 || c0.z < 0.0f || c1.z < 0.0f || c2.z < 0.0f)
+	{
+		// The clipped edges are not shared with the neighbours, but the two halves of a quad
+		// share its diagonal
+		const XMFLOAT4 * firstNeighbours[3] = { nullptr, nullptr, clippedCount == 4 ? &screen[3] : nullptr };
+		const XMFLOAT4 * secondNeighbours[3] = { &screen[1], nullptr, nullptr };
+		DrawTriangle(screen[0], screen[1], screen[2], firstNeighbours);
+		if (clippedCount == 4)
+		{
+			DrawTriangle(screen[0], screen[2], screen[3], secondNeighbours);
+		}
+		return;
+	}
+	// A neighbour is only any use if its far corner is in front of the near plane too
+	XMFLOAT4 screenNeighbours[3];
+	const XMFLOAT4 * neighbours[3] = { nullptr, nullptr, nullptr };
+	for (int edge = 0; edge < 3; edge++)
+	{
+		const XMFLOAT4 * neighbour = clipNeighbours[edge];
+		if (neighbour != nullptr && neighbour->z >= 0.0f && neighbour->w > 0.0f)
+		{
+			screenNeighbours[edge] = ToScreen(*neighbour);
+			neighbours[edge] = &screenNeighbours[edge];
+		}
+	}
+	DrawTriangle(screen[0], screen[1], screen[2], neighbours);
+}
+
+XMFLOAT4 OcclusionCuller::ToScreen(const XMFLOAT4& clip) const
+{
+	float inverseW = 1.0f / clip.w;
+	return XMFLOAT4((clip.x * inverseW * 0.5f + 0.5f) * _width,
+					(0.5f - clip.y * inverseW * 0.5f) * _height,
+					clip.z * inverseW,
+					1.0f);
+}
+
+OcclusionCuller::LinearFunction OcclusionCuller::EdgeFunction(const XMFLOAT4& from, const XMFLOAT4& to, const XMFLOAT4& inside, float startX, float startY)
+{
+	// Positive on the same side of the edge as inside
+	LinearFunction edge;
+	edge.StepX = -(to.y - from.y);
+	edge.StepY = to.x - from.x;
+	edge.Start = (to.x - from.x) * (startY - from.y) - (to.y - from.y) * (startX - from.x);
+	float insideValue = (to.x - from.x) * (inside.y - from.y) - (to.y - from.y) * (inside.x - from.x);
+	if (insideValue < 0.0f)
+	{
+		edge.StepX = -edge.StepX;
+		edge.StepY = -edge.StepY;
+		edge.Start = -edge.Start;
+	}
+	return edge;
+}
+
+OcclusionCuller::LinearFunction OcclusionCuller::DepthFunction(const XMFLOAT4& v0, const XMFLOAT4& v1, const XMFLOAT4& v2, float startX, float startY)
+{
+	// The farthest depth of the plane anywhere on each pixel, rather than at its centre
+	float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+	LinearFunction depth;
+	depth.StepX = ((v1.z - v0.z) * (v2.y - v0.y) - (v2.z - v0.z) * (v1.y - v0.y)) / area;
+	depth.StepY = ((v2.z - v0.z) * (v1.x - v0.x) - (v1.z - v0.z) * (v2.x - v0.x)) / area;
+	depth.Start = v0.z + depth.StepX * (startX - v0.x) + depth.StepY * (startY - v0.y);
+	depth.Start += HalfPixelSpan(depth);
+	return depth;
+}
+
+float OcclusionCuller::HalfPixelSpan(const LinearFunction& function)
+{
+	// A linear function is lowest and highest over a pixel at two of its corners, which are half
+	// a pixel from the centre in x and y
+	return 0.5f * (fabsf(function.StepX) + fabsf(function.StepY));
+}
+
+void OcclusionCuller::TriangleSetup::NextRow()
+{
+	for (int edge = 0; edge < 3; edge++)
+	{
+		Edges[edge].Start += Edges[edge].StepY;
+		NeighbourEdges[edge][0].Start += NeighbourEdges[edge][0].StepY;
+		NeighbourEdges[edge][1].Start += NeighbourEdges[edge][1].StepY;
+		NeighbourDepths[edge].Start += NeighbourDepths[edge].StepY;
+	}
+	Depth.Start += Depth.StepY;
+}
+
+void OcclusionCuller::DrawEdgePixel(const TriangleSetup& setup, float offset, float& pixel)
+{
+	// The pixel touches the triangle but is not inside it, so at least one edge crosses it.  If
+	// only one does, and the triangle on the other side of that edge covers the rest of the
+	// pixel, the two of them cover it, and the farther of their two depths is safe to write.
+	int crossingEdge = -1;
+	for (int edge = 0; edge < 3; edge++)
+	{
+		if (setup.Edges[edge].At(offset) < setup.Shrink[edge])
+		{
+			if (crossingEdge >= 0)
+			{
+				return;
+			}
+			crossingEdge = edge;
+		}
+	}
+	if (crossingEdge < 0 || !setup.HasNeighbour[crossingEdge] ||
+		setup.NeighbourEdges[crossingEdge][0].At(offset) < 0.0f || setup.NeighbourEdges[crossingEdge][1].At(offset) < 0.0f)
+	{
+		return;
+	}
+	float depth = fmaxf(setup.Depth.At(offset), setup.NeighbourDepths[crossingEdge].At(offset));
+	pixel = fminf(pixel, fmaxf(depth, 0.0f));
+}
+
+void OcclusionCuller::DrawTriangle(const XMFLOAT4& v0, const XMFLOAT4& v1In, const XMFLOAT4& v2In, const XMFLOAT4 * const neighboursIn[3])
+{
+	// Make the winding the same whichever way the triangle faces, since occluders are drawn
+	// from both sides.  Swapping two corners also reorders the edges.
+	float area = (v1In.x - v0.x) * (v2In.y - v0.y) - (v1In.y - v0.y) * (v2In.x - v0.x);
+	if (fabsf(area) < 1e-6f)
+	{
+		return;
+	}
+	const XMFLOAT4& v1 = area > 0.0f ? v1In : v2In;
+	const XMFLOAT4& v2 = area > 0.0f ? v2In : v1In;
+	const XMFLOAT4 * neighbours[3] = { area > 0.0f ? neighboursIn[0] : neighboursIn[2], neighboursIn[1], area > 0.0f ? neighboursIn[2] : neighboursIn[0] };
+	area = fabsf(area);
+
+	// The pixels whose centres are inside the triangle's bounding box
+	float minX = fminf(v0.x, fminf(v1.x, v2.x));
+	float maxX = fmaxf(v0.x, fmaxf(v1.x, v2.x));
+	float minY = fminf(v0.y, fminf(v1.y, v2.y));
+	float maxY = fmaxf(v0.y, fmaxf(v1.y, v2.y));
+	int x0 = static_cast<int>(ceilf(minX - 0.5f));
+	int x1 = static_cast<int>(floorf(maxX - 0.5f));
+	int y0 = static_cast<int>(ceilf(minY - 0.5f));
+	int y1 = static_cast<int>(floorf(maxY - 0.5f));
+	x0 = x0 > 0 ? x0 : 0;
+	y0 = y0 > 0 ? y0 : 0;
+	x1 = x1 < _width - 1 ? x1 : _width - 1;
+	y1 = y1 < _height - 1 ? y1 : _height - 1;
+	if (x0 > x1 || y0 > y1)
+	{
+		return;
+	}
+
+	float startX = x0 + 0.5f;
+	float startY = y0 + 0.5f;
+	const XMFLOAT4 * corners[3] = { &v0, &v1, &v2 };
+	TriangleSetup setup;
+	for (int edge = 0; edge < 3; edge++)
+	{
+		const XMFLOAT4& from = *corners[edge];
+		const XMFLOAT4& to = *corners[(edge + 1) % 3];
+		const XMFLOAT4& opposite = *corners[(edge + 2) % 3];
+		setup.Edges[edge] = EdgeFunction(from, to, opposite, startX, startY);
+		setup.Shrink[edge] = HalfPixelSpan(setup.Edges[edge]);
+		setup.HasNeighbour[edge] = false;
+
+		// Where the neighbour on the other side of this edge covers the rest of a pixel, the pixel
+		// is covered by the two of them as long as it is inside the other two edges of each
+		const XMFLOAT4 * neighbour = neighbours[edge];
+		if (neighbour == nullptr)
+		{
+			continue;
+		}
+		float neighbourArea = (to.x - from.x) * (neighbour->y - from.y) - (to.y - from.y) * (neighbour->x - from.x);
+		if (fabsf(neighbourArea) < 1e-6f)
+		{
+			continue;
+		}
+		setup.HasNeighbour[edge] = true;
+		for (int side = 0; side < 2; side++)
+		{
+			const XMFLOAT4& sideFrom = side == 0 ? to : *neighbour;
+			const XMFLOAT4& sideTo = side == 0 ? *neighbour : from;
+			const XMFLOAT4& sideOpposite = side == 0 ? from : to;
+			setup.NeighbourEdges[edge][side] = EdgeFunction(sideFrom, sideTo, sideOpposite, startX, startY);
+			setup.NeighbourEdges[edge][side].Start -= HalfPixelSpan(setup.NeighbourEdges[edge][side]);
+		}
+		setup.NeighbourDepths[edge] = DepthFunction(to, from, *neighbour, startX, startY);
+	}
+	setup.Depth = DepthFunction(v0, v1, v2, startX, startY);
+
+	for (int y = y0; y <= y1; y++)
+	{
+		float * row = &_depth[static_cast<size_t>(y) * _width];
+		int x = x0;
+		// Each pixel's values are worked out from the start of the row rather than by adding
+		// the step again and again, so both loops give exactly the same result
+#if defined(OCCLUSION_CULLER_SSE)
+		if (_simd)
+		{
+			__m128 zero = _mm_setzero_ps();
+			__m128 four = _mm_set1_ps(4.0f);
+			__m128 offsets = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+			__m128 edgeStarts[3];
+			__m128 edgeSteps[3];
+			__m128 shrinks[3];
+			__m128 touchShrinks[3];
+			for (int edge = 0; edge < 3; edge++)
+			{
+				edgeStarts[edge] = _mm_set1_ps(setup.Edges[edge].Start);
+				edgeSteps[edge] = _mm_set1_ps(setup.Edges[edge].StepX);
+				shrinks[edge] = _mm_set1_ps(setup.Shrink[edge]);
+				touchShrinks[edge] = _mm_set1_ps(-setup.Shrink[edge]);
+			}
+			__m128 depthStart = _mm_set1_ps(setup.Depth.Start);
+			__m128 depthStep = _mm_set1_ps(setup.Depth.StepX);
+			for (; x + 3 <= x1; x += 4)
+			{
+				__m128 edge0 = _mm_add_ps(edgeStarts[0], _mm_mul_ps(offsets, edgeSteps[0]));
+				__m128 edge1 = _mm_add_ps(edgeStarts[1], _mm_mul_ps(offsets, edgeSteps[1]));
+				__m128 edge2 = _mm_add_ps(edgeStarts[2], _mm_mul_ps(offsets, edgeSteps[2]));
+				__m128 touching = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge0, touchShrinks[0]), _mm_cmpge_ps(edge1, touchShrinks[1])), _mm_cmpge_ps(edge2, touchShrinks[2]));
+				int touchingMask = _mm_movemask_ps(touching);
+				if (touchingMask != 0)
+				{
+					__m128 covered = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge0, shrinks[0]), _mm_cmpge_ps(edge1, shrinks[1])), _mm_cmpge_ps(edge2, shrinks[2]));
+					__m128 depth = _mm_max_ps(_mm_add_ps(depthStart, _mm_mul_ps(offsets, depthStep)), zero);
+					__m128 current = _mm_loadu_ps(row + x);
+					__m128 nearest = _mm_min_ps(current, depth);
+					_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(covered, nearest), _mm_andnot_ps(covered, current)));
+					// The pixels along the edges are only covered with the help of a neighbour
+					int edgeMask = touchingMask & ~_mm_movemask_ps(covered);
+					for (int lane = 0; lane < 4; lane++)
+					{
+						if (edgeMask & (1 << lane))
+						{
+							DrawEdgePixel(setup, static_cast<float>(x + lane - x0), row[x + lane]);
+						}
+					}
+				}
+				offsets = _mm_add_ps(offsets, four);
+			}
+		}
+#endif
+		for (; x <= x1; x++)
+		{
+			float offset = static_cast<float>(x - x0);
+			float edge0 = setup.Edges[0].At(offset);
+			float edge1 = setup.Edges[1].At(offset);
+			float edge2 = setup.Edges[2].At(offset);
+			if (edge0 < -setup.Shrink[0] || edge1 < -setup.Shrink[1] || edge2 < -setup.Shrink[2])
+			{
+				continue;
+			}
+			if (edge0 >= setup.Shrink[0] && edge1 >= setup.Shrink[1] && edge2 >= setup.Shrink[2])
+			{
+				row[x] = fminf(row[x], fmaxf(setup.Depth.At(offset), 0.0f));
+			}
+			else
+			{
+				DrawEdgePixel(setup, offset, row[x]);
+			}
+		}
+		setup.NextRow();
+	}
+	_statistics.TrianglesDrawn++;
+}
+
+bool OcclusionCuller::IsBoxVisible(const XMFLOAT3& boxMin, const XMFLOAT3& boxMax)
+{
+	if (!_enabled)
+	{
+		return true;
+	}
+	_statistics.BoxesTested++;
+
+	// Find the screen rectangle and the nearest depth of the box's corners
+	XMMATRIX viewProjection = XMLoadFloat4x4(&_viewProjection);
+	float minX = FLT_MAX;
+	float maxX = -FLT_MAX;
+	float minY = FLT_MAX;
+	float maxY = -FLT_MAX;
+	float minDepth = FLT_MAX;
+	for (int corner = 0; corner < 8; corner++)
+	{
+		XMVECTOR position = XMVectorSet(corner & 1 ? boxMax.x : boxMin.x,
+										corner & 2 ? boxMax.y : boxMin.y,
+										corner & 4 ? boxMax.z : boxMin.z,
+										1.0f);
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector4Transform(position, viewProjection));
+		// A box that reaches the near plane covers too much of the screen to be worth testing
+		if (clip.z < 0.0f || clip.w <= 0.0f)
+		{
+			return true;
+		}
+		XMFLOAT4 screen = ToScreen(clip);
+		minX = fminf(minX, screen.x);
+		maxX = fmaxf(maxX, screen.x);
+		minY = fminf(minY, screen.y);
+		maxY = fmaxf(maxY, screen.y);
+		minDepth = fminf(minDepth, screen.z);
+	}
+
+	// Every pixel the rectangle touches has to be covered by something nearer than the box
+	int x0 = static_cast<int>(floorf(minX));
+	int x1 = static_cast<int>(floorf(maxX));
+	int y0 = static_cast<int>(floorf(minY));
+	int y1 = static_cast<int>(floorf(maxY));
+	x0 = x0 > 0 ? x0 : 0;
+	y0 = y0 > 0 ? y0 : 0;
+	x1 = x1 < _width - 1 ? x1 : _width - 1;
+	y1 = y1 < _height - 1 ? y1 : _height - 1;
+	if (x0 > x1 || y0 > y1)
+	{
+		// Off the screen, which the frustum test deals with
+		return true;
+	}
+	for (int y = y0; y <= y1; y++)
+	{
+		const float * row = &_depth[static_cast<size_t>(y) * _width];
+		for (int x = x0; x <= x1; x++)
+		{
+			if (row[x] >= minDepth)
+			{
+				return true;
+			}
+		}
+	}
+	_statistics.BoxesOccluded++;
+	return false;
+}
+
+std::shared_ptr<OccluderMesh> OcclusionCuller::CreateHeightfieldOccluder(const std::vector<VERTEX>& vertices, int verticesPerRow, int cells)
+{
+	std::shared_ptr<OccluderMesh> occluder = std::make_shared<OccluderMesh>();
+	XMStoreFloat4x4(&occluder->WorldTransformation, XMMatrixIdentity());
+	int gridCells = verticesPerRow - 1;
+	if (gridCells <= 0 || vertices.size() < static_cast<size_t>(verticesPerRow) * verticesPerRow)
+	{
+		return occluder;
+	}
+	cells = cells < gridCells ? cells : gridCells;
+
+	// Each occluder vertex sits on a grid vertex, lowered to the lowest grid vertex in the
+	// occluder cells either side of it.  Every occluder cell is then below all of the terrain
+	// it covers.
+	std::vector<int> gridLines(cells + 1);
+	for (int i = 0; i <= cells; i++)
+	{
+		gridLines[i] = i * gridCells / cells;
+	}
+	for (int row = 0; row <= cells; row++)
+	{
+		int firstRow = gridLines[row > 0 ? row - 1 : 0];
+		int lastRow = gridLines[row < cells ? row + 1 : cells];
+		for (int column = 0; column <= cells; column++)
+		{
+			int firstColumn = gridLines[column > 0 ? column - 1 : 0];
+			int lastColumn = gridLines[column < cells ? column + 1 : cells];
+			float lowest = FLT_MAX;
+			for (int z = firstRow; z <= lastRow; z++)
+			{
+				for (int x = firstColumn; x <= lastColumn; x++)
+				{
+					lowest = fminf(lowest, vertices[static_cast<size_t>(z) * verticesPerRow + x].Position.y);
+				}
+			}
+			XMFLOAT3 position = vertices[static_cast<size_t>(gridLines[row]) * verticesPerRow + gridLines[column]].Position;
+			position.y = lowest;
+			occluder->Positions.push_back(position);
+		}
+	}
+	unsigned int occluderVerticesPerRow = static_cast<unsigned int>(cells + 1);
+	for (unsigned int row = 0; row < static_cast<unsigned int>(cells); row++)
+	{
+		for (unsigned int column = 0; column < static_cast<unsigned int>(cells); column++)
+		{
+			unsigned int topLeft = row * occluderVerticesPerRow + column;
+			unsigned int bottomLeft = topLeft + occluderVerticesPerRow;
+			occluder->Indices.insert(occluder->Indices.end(), { topLeft, topLeft + 1, bottomLeft, bottomLeft, topLeft + 1, bottomLeft + 1 });
+		}
+	}
+	FindNeighbours(*occluder);
+	return occluder;
+}
+
+void OcclusionCuller::FindNeighbours(OccluderMesh& occluder)
+{
+	// Each edge is looked up the other way round, as it is wound in the triangle that shares it.
+	// An edge shared by more than two triangles, or by two wound the same way, gets no neighbour.
+	std::unordered_map<uint64_t, size_t> edges;
+	edges.reserve(occluder.Indices.size());
+	size_t indexCount = occluder.Indices.size() - occluder.Indices.size() % 3;
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		uint64_t from = occluder.Indices[i];
+		uint64_t to = occluder.Indices[i - i % 3 + (i + 1) % 3];
+		if (!edges.emplace((from << 32) | to, i).second)
+		{
+			edges[(from << 32) | to] = SIZE_MAX;
+		}
+	}
+	occluder.Neighbours.assign(occluder.Indices.size(), OccluderMesh::NoNeighbour);
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		uint64_t from = occluder.Indices[i];
+		uint64_t to = occluder.Indices[i - i % 3 + (i + 1) % 3];
+		std::unordered_map<uint64_t, size_t>::const_iterator shared = edges.find((to << 32) | from);
+		std::unordered_map<uint64_t, size_t>::const_iterator same = edges.find((from << 32) | to);
+		if (shared == edges.end() || shared->second == SIZE_MAX || same->second == SIZE_MAX)
+		{
+			continue;
+		}
+		// The corner of the other triangle that is not on the edge
+		size_t other = shared->second;
+		occluder.Neighbours[i] = occluder.Indices[other - other % 3 + (other + 2) % 3];
+	}
+}
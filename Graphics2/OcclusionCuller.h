@@ -0,0 +1,129 @@
+#pragma once
+#include "Vertex.h"
+#include <memory>
+#include <vector>
+
+// Software occlusion culling.  Large objects that hide others (the terrain, mainly) are drawn
+// on the CPU into a small depth buffer at the start of each frame, and the world space bounding
+// boxes of meshes are then tested against it before they are submitted.  A box is only
+// rejected if every pixel it covers has an occluder in front of the whole box.
+//
+// The test is conservative: occluders only write the pixels they cover completely, with the
+// farthest depth they have anywhere on the pixel, and are clipped at the near plane.  A pixel
+// on an edge between two triangles is covered by the pair of them, so an occluder that knows
+// its neighbours (see FindNeighbours) also writes the pixels along its inside edges.  A box is
+// tested over every pixel it touches, against the nearest depth of its corners, and is always
+// visible if it crosses the near plane.  Occluders themselves must lie inside the objects they
+// stand in for, which CreateHeightfieldOccluder makes sure of for the terrain.
+//
+// Where SSE2 is available, the edge functions of four pixels are evaluated at once.
+//
+// Nothing here uses Direct3D, so the culler can be run and timed on its own.
+
+struct OccluderMesh
+{
+	std::vector<DirectX::XMFLOAT3>	Positions;
+	std::vector<unsigned int>		Indices;
+	// For each edge of each triangle (from Indices[i] to the next corner), the far corner of the
+	// triangle on the other side, or NoNeighbour.  Optional: without it, pixels that are only
+	// covered by two triangles together are left empty.
+	std::vector<unsigned int>		Neighbours;
+	DirectX::XMFLOAT4X4				WorldTransformation;
+
+	static const unsigned int		NoNeighbour = 0xFFFFFFFF;
+};
+
+struct OcclusionStatistics
+{
+	unsigned int					OccludersDrawn;
+	unsigned int					TrianglesDrawn;
+	unsigned int					BoxesTested;
+	unsigned int					BoxesOccluded;
+};
+
+class OcclusionCuller
+{
+public:
+	static const int				DefaultWidth = 256;
+	static const int				DefaultHeight = 128;
+
+	OcclusionCuller(int width = DefaultWidth, int height = DefaultHeight);
+
+	// Occluders are held weakly, so one is dropped once its owner releases it
+	void							AddOccluder(std::shared_ptr<OccluderMesh> occluder);
+
+	// Clears the depth buffer and draws every occluder.  Called once a frame, after the scene's
+	// transforms have been updated and before anything is tested.
+	void							BeginFrame(DirectX::FXMMATRIX viewProjection);
+	void							DrawOccluder(const OccluderMesh& occluder);
+	// The box is in world space
+	bool							IsBoxVisible(const DirectX::XMFLOAT3& boxMin, const DirectX::XMFLOAT3& boxMax);
+
+	inline void						SetEnabled(bool enabled) { _enabled = enabled; }
+	inline bool						IsEnabled() const { return _enabled; }
+	// Draws occluders without SSE, for comparing the two.  Both give the same depth buffer.
+	inline void						SetSimdEnabled(bool simd) { _simd = simd; }
+	inline int						GetWidth() const { return _width; }
+	inline int						GetHeight() const { return _height; }
+	// Depth from 0 (near) to 1 (far), a row at a time from the top of the screen
+	inline const std::vector<float>&	GetDepthBuffer() const { return _depth; }
+	// Counts since the last BeginFrame
+	inline const OcclusionStatistics&	GetStatistics() const { return _statistics; }
+
+	// An occluder for a grid of terrain vertices, cells x cells in size.  Each of its vertices
+	// is as low as the lowest terrain vertex in the cells around it, so it always lies under
+	// the terrain however coarse it is.
+	static std::shared_ptr<OccluderMesh>	CreateHeightfieldOccluder(const std::vector<VERTEX>& vertices, int verticesPerRow, int cells);
+	// Fills in the occluder's Neighbours from its indices.  Triangles only share an edge if they
+	// are wound the same way round.
+	static void						FindNeighbours(OccluderMesh& occluder);
+
+private:
+	int								_width;
+	int								_height;
+	bool							_enabled;
+	bool							_simd;
+	std::vector<float>				_depth;
+	DirectX::XMFLOAT4X4				_viewProjection;
+	std::vector<std::weak_ptr<OccluderMesh>>	_occluders;
+	std::vector<DirectX::XMFLOAT4>	_clipPositions;		// Kept between occluders so it is not reallocated
+	OcclusionStatistics				_statistics;
+
+	// A function of the screen position that changes by StepX from one pixel to the next along a
+	// row and by StepY from one row to the next.  Start is its value at the first pixel of the row.
+	struct LinearFunction
+	{
+		float						Start;
+		float						StepX;
+		float						StepY;
+
+		inline float				At(float offset) const { return Start + offset * StepX; }
+	};
+
+	// A triangle's edges and depth, and those of the triangles on the other side of its edges
+	struct TriangleSetup
+	{
+		LinearFunction				Edges[3];
+		float						Shrink[3];			// An edge has to be at least this for the whole pixel to be inside it
+		bool						HasNeighbour[3];
+		LinearFunction				NeighbourEdges[3][2];
+		LinearFunction				NeighbourDepths[3];
+		LinearFunction				Depth;
+
+		void						NextRow();
+	};
+
+	// Vertices are in screen space: x and y in pixels, z the depth and w unused.  Each of
+	// neighbours is the far corner of the triangle across the edge starting at the same
+	// corner, or null.
+	void							DrawTriangle(const DirectX::XMFLOAT4& v0, const DirectX::XMFLOAT4& v1, const DirectX::XMFLOAT4& v2, const DirectX::XMFLOAT4 * const neighbours[3]);
+	// Vertices are in clip space.  Clips the triangle against the near plane before drawing it.
+	void							DrawClippedTriangle(const DirectX::XMFLOAT4& c0, const DirectX::XMFLOAT4& c1, const DirectX::XMFLOAT4& c2, const DirectX::XMFLOAT4 * const neighbours[3]);
+	// Writes a pixel that touches the triangle but is crossed by one of its edges
+	static void						DrawEdgePixel(const TriangleSetup& setup, float offset, float& pixel);
+	static LinearFunction			EdgeFunction(const DirectX::XMFLOAT4& from, const DirectX::XMFLOAT4& to, const DirectX::XMFLOAT4& inside, float startX, float startY);
+	// The farthest depth of the triangle's plane over each pixel
+	static LinearFunction			DepthFunction(const DirectX::XMFLOAT4& v0, const DirectX::XMFLOAT4& v1, const DirectX::XMFLOAT4& v2, float startX, float startY);
+	static float					HalfPixelSpan(const LinearFunction& function);
+	DirectX::XMFLOAT4				ToScreen(const DirectX::XMFLOAT4& clip) const;
+};
@@ -0,0 +1,178 @@
+#include "RenderQueue.h"
+#include <atomic>
+#include <cstring>
+
+// Sort key layout, from the most significant bit:
+//   Opaque:       0 | pipeline (15 bits) | material (24 bits) | depth (24 bits)
+//   Transparent:  1 | inverted depth (24 bits) | pipeline (15 bits) | material (24 bits)
+static const int PipelineBits = 15;
+static const int MaterialBits = 24;
+static const int DepthBits = 24;
+
+// Direct3D 11.1 can only bind a constant buffer from an offset that is a multiple of 256 bytes
+static const size_t ConstantsAlignment = 256;
+
+static std::atomic<unsigned int> nextStateId(0);
+
+RenderStateId::RenderStateId()
+{
+	_id = nextStateId++ & ((1u << MaterialBits) - 1);
+}
+
+RenderStateId::RenderStateId(const RenderStateId&)
+{
+	_id = nextStateId++ & ((1u << MaterialBits) - 1);
+}
+
+RenderQueue::RenderQueue()
+{
+	memset(&_statistics, 0, sizeof(_statistics));
+}
+
+uint64_t RenderQueue::MakeSortKey(bool transparent, unsigned int pipelineId, unsigned int materialId, float depth)
+{
+	depth = depth < 0.0f ? 0.0f : (depth > 1.0f ? 1.0f : depth);
+	uint64_t depthBits = static_cast<uint64_t>(depth * ((1 << DepthBits) - 1));
+	uint64_t pipeline = pipelineId & ((1ull << PipelineBits) - 1);
+	uint64_t material = materialId & ((1ull << MaterialBits) - 1);
+	if (transparent)
+	{
+		uint64_t invertedDepth = ((1ull << DepthBits) - 1) - depthBits;
+		return (1ull << 63) | (invertedDepth << (PipelineBits + MaterialBits)) | (pipeline << MaterialBits) | material;
+	}
+	return (pipeline << (MaterialBits + DepthBits)) | (material << DepthBits) | depthBits;
+}
+
+
+void RenderQueue::Submit(const DrawPacket& packet, const void * constants, size_t constantsSize)
+{
+	size_t offset = (_constants.size() + ConstantsAlignment - 1) & ~(ConstantsAlignment - 1);
+	_constants.resize(offset + constantsSize);
+	if (constantsSize > 0)
+	{
+		memcpy(&_constants[offset], constants, constantsSize);
+	}
+	_packets.push_back(packet);
+	_packets.back().ConstantsOffset = offset;
+	_packets.back().ConstantsSize = constantsSize;
+}
+
+void RenderQueue::Sort()
+{
+	// Least significant digit radix sort, a byte at a time.  Each pass is stable, so the
+	// order from the earlier (less significant) passes is kept.  Passes where every key has
+	// the same byte do not change the order, so they are skipped.
+	size_t count = _packets.size();
+	_sortItems.resize(count);
+	_sortScratch.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		_sortItems[i].Key = _packets[i].SortKey;
+		_sortItems[i].Index = static_cast<unsigned int>(i);
+	}
+
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		size_t offsets[256] = { 0 };
+		for (const SortItem& item : _sortItems)
+		{
+			offsets[(item.Key >> shift) & 0xff]++;
+		}
+		if (offsets[(_sortItems[0].Key >> shift) & 0xff] == count)
+		{
+			continue;
+		}
+		size_t total = 0;
+		for (size_t& offset : offsets)
+		{
+			size_t digitCount = offset;
+			offset = total;
+			total += digitCount;
+		}
+		for (const SortItem& item : _sortItems)
+		{
+			_sortScratch[offsets[(item.Key >> shift) & 0xff]++] = item;
+		}
+		_sortItems.swap(_sortScratch);
+	}
+}
+
+void RenderQueue::Flush(RenderCommandSink& sink)
+{
+	memset(&_statistics, 0, sizeof(_statistics));
+	if (_packets.empty())
+	{
+		return;
+	}
+	Sort();
+
+	sink.BeginFlush(_constants.empty() ? nullptr : &_constants[0], _constants.size());
+	const void * pipeline = nullptr;
+	const void * materialConstantBuffer = nullptr;
+	const void * texture = nullptr;
+	const void * vertexBuffer = nullptr;
+	const void * indexBuffer = nullptr;
+	const void * instanceBuffer = nullptr;
+	unsigned int vertexStride = 0;
+	unsigned int indexSize = 0;
+	bool first = true;
+	for (const SortItem& item : _sortItems)
+	{
+		const DrawPacket& packet = _packets[item.Index];
+		if (first || packet.Pipeline != pipeline)
+		{
+			sink.SetPipeline(packet.Pipeline);
+			pipeline = packet.Pipeline;
+			_statistics.PipelineChanges++;
+		}
+		else
+		{
+			_statistics.RedundantChangesSkipped++;
+		}
+		if (first || packet.MaterialConstantBuffer != materialConstantBuffer)
+		{
+			sink.SetMaterialConstantBuffer(packet.MaterialConstantBuffer);
+			materialConstantBuffer = packet.MaterialConstantBuffer;
+			_statistics.MaterialConstantBufferChanges++;
+		}
+		else
+		{
+			_statistics.RedundantChangesSkipped++;
+		}
+		if (first || packet.Texture != texture)
+		{
+			sink.SetTexture(packet.Texture);
+			texture = packet.Texture;
+			_statistics.TextureChanges++;
+		}
+		else
+		{
+			_statistics.RedundantChangesSkipped++;
+		}
+		if (first || packet.VertexBuffer != vertexBuffer || packet.IndexBuffer != indexBuffer || packet.InstanceBuffer != instanceBuffer ||
+			packet.VertexStride != vertexStride || packet.IndexSize != indexSize)
+		{
+			// Buffers in the geometry arena hold sub-meshes of both vertex formats and index
+			// sizes, so a change of format is a change of geometry too
+			sink.SetGeometry(packet.VertexBuffer, packet.VertexStride, packet.IndexBuffer, packet.IndexSize, packet.InstanceBuffer);
+			vertexBuffer = packet.VertexBuffer;
+			indexBuffer = packet.IndexBuffer;
+			instanceBuffer = packet.InstanceBuffer;
+			vertexStride = packet.VertexStride;
+			indexSize = packet.IndexSize;
+			_statistics.GeometryChanges++;
+		}
+		else
+		{
+			_statistics.RedundantChangesSkipped++;
+		}
+		first = false;
+
+		sink.Draw(packet, packet.ConstantsSize > 0 ? &_constants[packet.ConstantsOffset] : nullptr);
+		_statistics.DrawCount++;
+	}
+	sink.EndFlush();
+
+	_packets.clear();
+	_constants.clear();
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Collects the draws for a frame so that they can be sorted to keep state changes to a minimum.
+//
+// Renderers submit a DrawPacket for each draw rather than drawing straight away.  Each packet
+// holds the states it needs (as opaque handles) and a 64-bit sort key.  Flush radix sorts the
+// packets by key and passes them to a RenderCommandSink, only setting a state when it differs
+// from the one already set.
+//
+// Nothing here depends on Direct3D - the handles are only compared, and the sink decides what
+// they mean - so the sorting and the number of state changes can be checked with a sink that
+// just counts calls.
+
+struct DrawPacket
+{
+	uint64_t								SortKey;
+	const void *							Pipeline;				// Shaders, input layout and fixed function state
+	const void *							MaterialConstantBuffer;
+	const void *							Texture;
+	const void *							VertexBuffer;
+	const void *							IndexBuffer;
+	unsigned int							VertexStride;			// Size of each vertex in bytes
+	unsigned int							IndexSize;				// 2 or 4 bytes
+	const void *							InstanceBuffer;			// Null unless the draw is instanced
+	unsigned int							IndexCount;
+	unsigned int							StartIndex;
+	unsigned int							BaseVertex;				// Added to each index, for geometry that shares a buffer
+	unsigned int							InstanceCount;			// 0 for a draw that is not instanced
+	unsigned int							StartInstance;
+	size_t									ConstantsOffset;		// Per-object constants, filled in by Submit
+	size_t									ConstantsSize;
+};
+
+class RenderCommandSink
+{
+public:
+	virtual ~RenderCommandSink() {}
+
+	// Called at the start and end of Flush.  Nothing can be assumed about the state that is
+	// already set at the start of a flush.  constants holds the per-object constants of every
+	// packet in the flush, each at the packet's ConstantsOffset, so that they can all be
+	// uploaded at once.
+	virtual void							BeginFlush(const void * /*constants*/, size_t /*constantsSize*/) {}
+	virtual void							EndFlush() {}
+
+	virtual void							SetPipeline(const void * pipeline) = 0;
+	virtual void							SetMaterialConstantBuffer(const void * constantBuffer) = 0;
+	virtual void							SetTexture(const void * texture) = 0;
+	virtual void							SetGeometry(const void * vertexBuffer, unsigned int vertexStride, const void * indexBuffer, unsigned int indexSize, const void * instanceBuffer) = 0;
+	// constants points at the data given to Submit for this packet
+	virtual void							Draw(const DrawPacket& packet, const void * constants) = 0;
+};
+
+// A small number for a state, for use in a sort key.  The object that owns the state (a material
+// or a pipeline, for example) holds one, so the id lives exactly as long as the state does and is
+// never given to another state that happens to be allocated at the same address.  A copy is
+// treated as a different state and gets an id of its own.
+//
+// Ids are handed out in order and wrap around after 2^24 of them.  Two states with the same id
+// are only grouped together in the sort - the queue still compares the handles themselves - so
+// a wrapped id costs at most a few state changes.
+class RenderStateId
+{
+public:
+	RenderStateId();
+	RenderStateId(const RenderStateId&);
+	RenderStateId& operator=(const RenderStateId&) { return *this; }
+
+	inline unsigned int						Get() const { return _id; }
+
+private:
+	unsigned int							_id;
+};
+
+struct RenderQueueStatistics
+{
+	unsigned int							DrawCount;
+	unsigned int							PipelineChanges;
+	unsigned int							MaterialConstantBufferChanges;
+	unsigned int							TextureChanges;
+	unsigned int							GeometryChanges;
+	// State sets that were skipped because the state was already set
+	unsigned int							RedundantChangesSkipped;
+};
+
+class RenderQueue
+{
+public:
+	RenderQueue();
+
+	// Transparent draws are sorted after all opaque draws, furthest first.  Opaque draws are
+	// grouped by pipeline and then material, and drawn nearest first within a group.  depth is
+	// in the range 0 (near) to 1 (far) and is clamped to it.
+	// The ids are usually RenderStateIds.
+	static uint64_t							MakeSortKey(bool transparent, unsigned int pipelineId, unsigned int materialId, float depth);
+
+	// The per-object constants are copied, so they do not need to outlive the call.  Each
+	// packet's copy starts on a 256 byte boundary, so it can be bound as a constant buffer range.
+	void									Submit(const DrawPacket& packet, const void * constants, size_t constantsSize);
+
+	// Sorts the packets, sends them to the sink and empties the queue
+	void									Flush(RenderCommandSink& sink);
+
+	inline size_t							GetPacketCount() const { return _packets.size(); }
+	// Statistics from the last call to Flush
+	inline const RenderQueueStatistics&		GetStatistics() const { return _statistics; }
+
+private:
+	struct SortItem
+	{
+		uint64_t							Key;
+		unsigned int						Index;
+	};
+
+	std::vector<DrawPacket>					_packets;
+	std::vector<unsigned char>				_constants;
+	std::vector<SortItem>					_sortItems;
+	std::vector<SortItem>					_sortScratch;
+	RenderQueueStatistics					_statistics;
+
+	void									Sort();
+};
@@ -1,41 +1,19 @@
 #include "ResourceManager.h"
 #include "DirectXFramework.h"
-#include <sstream>
 #include "WICTextureLoader.h"
-#include <locale>
-#include <codecvt>
+#include "ConstantBuffers.h"
 #include "MeshRenderer.h"
+#include "ModelImporter.h"
 
-#pragma comment(lib, "../Assimp/lib/release/assimp-vc140-mt.lib")
-
-using namespace Assimp;
-
-//-------------------------------------------------------------------------------------------
-// Utility functions to convert from wstring to string and back
-// Copied from https://stackoverflow.com/questions/4804298/how-to-convert-wstring-into-string
-
-wstring s2ws(const std::string& str)
-{
-	using convert_typeX = std::codecvt_utf8<wchar_t>;
-	std::wstring_convert<convert_typeX, wchar_t> converterX;
-
-	return converterX.from_bytes(str);
-}
-
-string ws2s(const std::wstring& wstr)
-{
-	using convert_typeX = std::codecvt_utf8<wchar_t>;
-	std::wstring_convert<convert_typeX, wchar_t> converterX;
-
-	return converterX.to_bytes(wstr);
-}
-
-//-------------------------------------------------------------------------------------------
+// The memory the streamed textures can use before the least recently drawn are evicted
+static const size_t DefaultTextureBudget = 256 * 1024 * 1024;
 
 ResourceManager::ResourceManager()
 {
 	_device = DirectXFramework::GetDXFramework()->GetDevice();
 	_deviceContext = DirectXFramework::GetDXFramework()->GetDeviceContext();
+	_modelCache = make_shared<ModelCache>(L"ModelCache");
+	_geometryArena = make_shared<GeometryArena>(_device, _deviceContext);
 
     // Create a default texture for use where none is specified.  If white.png is not available, then
     // the default texture will be null, i.e. black.  This causes problems for materials that do not
@@ -50,6 +28,8 @@ ResourceManager::ResourceManager()
 	{
 		_defaultTexture = nullptr;
 	}
+	_textureStreamer = make_shared<TextureStreamer>(_device, _deviceContext, _defaultTexture);
+	_textureResidency = make_shared<TextureResidencyManager>(*_textureStreamer, DefaultTextureBudget);
 
 }
 
@@ -84,6 +64,13 @@ shared_ptr<Renderer> ResourceManager::GetRenderer(wstring rendererName)
 
 shared_ptr<Mesh> ResourceManager::GetMesh(wstring modelName)
 {
+	// If the model is already being read on a worker thread, wait for that rather than
+	// reading it again
+	PendingMeshMap::iterator pending = _pendingMeshes.find(modelName);
+	if (pending != _pendingMeshes.end())
+	{
+		FinishMeshLoad(pending);
+	}
 	// CHeck to see if the mesh has already been loaded
 	MeshResourceMap::iterator it = _meshResources.find(modelName);
 	if (it != _meshResources.end())
@@ -112,8 +99,239 @@ shared_ptr<Mesh> ResourceManager::GetMesh(wstring modelName)
 	}
 }
 
+shared_ptr<MeshLoadRequest> ResourceManager::GetMeshAsync(wstring modelName)
+{
+	shared_ptr<MeshLoadRequest> request;
+	MeshResourceMap::iterator it = _meshResources.find(modelName);
+	if (it != _meshResources.end())
+	{
+		// Already loaded, so there is nothing to wait for
+		it->second.ReferenceCount++;
+		request = make_shared<MeshLoadRequest>();
+		request->_mesh = it->second.MeshPointer;
+		return request;
+	}
+	PendingMeshMap::iterator pending = _pendingMeshes.find(modelName);
+	if (pending != _pendingMeshes.end())
+	{
+		// Already being read, so share the same request
+		pending->second.ReferenceCount++;
+		return pending->second.Request;
+	}
+	request = make_shared<MeshLoadRequest>();
+	if (GetFileAttributesW(modelName.c_str()) == INVALID_FILE_ATTRIBUTES)
+	{
+		// A missing file fails straight away, so that the node's Initialise can report it
+		OutputDebugStringW((L"Unable to find model " + modelName + L"\n").c_str());
+		request->_failed = true;
+		return request;
+	}
+	request->_placeholder = GetPlaceholderMesh();
+
+	// Reading the file and converting the vertices does not need the device, so is done on a
+	// worker thread.  Several models can be read at the same time.
+	shared_ptr<promise<shared_ptr<ModelData>>> modelPromise = make_shared<promise<shared_ptr<ModelData>>>();
+	PendingMeshStruct pendingStruct;
+	pendingStruct.ReferenceCount = 1;
+	pendingStruct.Request = request;
+	pendingStruct.Model = modelPromise->get_future();
+	_pendingMeshes[modelName] = move(pendingStruct);
+	shared_ptr<ModelCache> modelCache = _modelCache;
+	DirectXFramework::GetDXFramework()->GetThreadPool()->SubmitBackground([modelPromise, modelName, modelCache]()
+	{
+		modelPromise->set_value(ReadModelData(modelName, modelCache));
+	});
+	return request;
+}
+
+void ResourceManager::CreatePendingMeshes()
+{
+	// Only the models that have finished being read are dealt with, so this never waits
+	PendingMeshMap::iterator it = _pendingMeshes.begin();
+	while (it != _pendingMeshes.end())
+	{
+		PendingMeshMap::iterator next = std::next(it);
+		if (it->second.Model.wait_for(chrono::seconds(0)) == future_status::ready)
+		{
+			FinishMeshLoad(it);
+		}
+		it = next;
+	}
+}
+
+shared_ptr<Mesh> ResourceManager::CreateStaticBatch(const vector<StaticBatchPlacement>& placements, StaticBatchStatistics& statistics, vector<bool>& batched)
+{
+	StaticBatcher batcher;
+	map<wstring, shared_ptr<ModelData>> models;
+	batched.assign(placements.size(), false);
+	for (size_t i = 0; i < placements.size(); i++)
+	{
+		// Each model is only read once, however many times it is placed
+		const StaticBatchPlacement& placement = placements[i];
+		map<wstring, shared_ptr<ModelData>>::iterator it = models.find(placement.ModelName);
+		if (it == models.end())
+		{
+			it = models.insert({ placement.ModelName, ReadModelData(placement.ModelName, _modelCache) }).first;
+		}
+		batched[i] = batcher.AddPlacement(it->second, XMLoadFloat4x4(&placement.WorldTransformation));
+	}
+	statistics = batcher.GetStatistics();
+	shared_ptr<ModelData> batch = batcher.Build();
+	shared_ptr<Mesh> mesh = batch->SubMeshes.empty() ? nullptr : CreateMesh(*batch);
+	if (mesh == nullptr)
+	{
+		batched.assign(placements.size(), false);
+		return nullptr;
+	}
+	AddMeshStatistics(L"static batch", *mesh);
+	wchar_t line[512];
+	swprintf(line, sizeof(line) / sizeof(line[0]),
+			 L"Static batch: %u of %zu placements merged, %u draws (was %u), %zu KB of geometry (models %zu KB)\n",
+			 statistics.PlacementCount, placements.size(), statistics.DrawsAfter, statistics.DrawsBefore,
+			 (statistics.BatchedVertexBytes + statistics.BatchedIndexBytes) / 1024,
+			 (statistics.SourceVertexBytes + statistics.SourceIndexBytes) / 1024);
+	OutputDebugStringW(line);
+	return mesh;
+}
+
+void ResourceManager::ReleaseStaticBatch(shared_ptr<Mesh> batch)
+{
+	if (batch != nullptr)
+	{
+		ReleaseMeshMaterials(*batch);
+	}
+}
+
+void ResourceManager::UpdateTextureStreaming()
+{
+	_textureStreamer->CreateLoadedTextures(*_textureResidency);
+	_textureResidency->Update();
+}
+
+void ResourceManager::FinishMeshLoad(PendingMeshMap::iterator it)
+{
+	// Waits if the model has not been read yet
+	shared_ptr<ModelData> modelData = it->second.Model.get();
+	shared_ptr<MeshLoadRequest> request = it->second.Request;
+	unsigned int referenceCount = it->second.ReferenceCount;
+	wstring modelName = it->first;
+	_pendingMeshes.erase(it);
+	shared_ptr<Mesh> mesh = nullptr;
+	if (modelData != nullptr)
+	{
+		mesh = CreateMesh(*modelData);
+	}
+	if (mesh == nullptr)
+	{
+		OutputDebugStringW((L"Unable to load model " + modelName + L"\n").c_str());
+		request->_failed = true;
+		return;
+	}
+	AddMeshStatistics(modelName, *mesh);
+	// If every node that asked for the model has released it already, the mesh is still kept
+	// (with no references), so that the work is not wasted if the model is asked for again
+	MeshResourceStruct resourceStruct;
+	resourceStruct.ReferenceCount = referenceCount;
+	resourceStruct.MeshPointer = mesh;
+	_meshResources[modelName] = resourceStruct;
+	request->_mesh = mesh;
+}
+
+void ResourceManager::ReleaseMeshMaterials(Mesh& mesh)
+{
+	unsigned int subMeshCount = static_cast<unsigned int>(mesh.GetSubMeshCount());
+	// Loop through all submeshes in the mesh
+	for (unsigned int i = 0; i < subMeshCount; i++)
+	{
+		shared_ptr<SubMesh> subMesh = mesh.GetSubMesh(i);
+		if (subMesh->GetMaterial() != nullptr)
+		{
+			ReleaseMaterial(subMesh->GetMaterial()->GetMaterialName());
+		}
+	}
+}
+
+void ResourceManager::AddMeshStatistics(const wstring& name, const Mesh& mesh)
+{
+	const GeometryMemoryStatistics& memory = mesh.GetMemoryStatistics();
+	const MeshOptimisationStatistics& optimisation = mesh.GetOptimisationStatistics();
+	_geometryMemoryStatistics.VertexCount += memory.VertexCount;
+	_geometryMemoryStatistics.IndexCount += memory.IndexCount;
+	_geometryMemoryStatistics.UnpackedVertexBytes += memory.UnpackedVertexBytes;
+	_geometryMemoryStatistics.UnpackedIndexBytes += memory.UnpackedIndexBytes;
+	_geometryMemoryStatistics.PackedVertexBytes += memory.PackedVertexBytes;
+	_geometryMemoryStatistics.PackedIndexBytes += memory.PackedIndexBytes;
+	MeshOptimiser::AddStatistics(optimisation, _meshOptimisationStatistics);
+
+	wchar_t line[512];
+	swprintf(line, sizeof(line) / sizeof(line[0]),
+			 L"Loaded %ls: %zu vertices (%zu KB, was %zu KB), %zu indices (%zu KB, was %zu KB), ACMR %.2f (was %.2f)\n",
+			 name.c_str(), memory.VertexCount, memory.PackedVertexBytes / 1024, memory.UnpackedVertexBytes / 1024,
+			 memory.IndexCount, memory.PackedIndexBytes / 1024, memory.UnpackedIndexBytes / 1024,
+			 MeshOptimiser::GetAcmr(optimisation.TransformCountAfter, optimisation.TriangleCount),
+			 MeshOptimiser::GetAcmr(optimisation.TransformCountBefore, optimisation.TriangleCount));
+	OutputDebugStringW(line);
+}
+
+shared_ptr<Mesh> ResourceManager::GetPlaceholderMesh()
+{
+	if (_placeholderMesh == nullptr)
+	{
+		// A plain grey cube, drawn in place of models that are still loading
+		ModelData modelData;
+		modelData.Materials.resize(1);
+		ModelMaterialData& material = modelData.Materials[0];
+		material.Name = L"Placeholder";
+		material.DiffuseColour = XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f);
+		material.SpecularColour = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+		material.Shininess = 0.0f;
+		material.Opacity = 1.0f;
+		modelData.SubMeshes.resize(1);
+		ModelSubMeshData& subMesh = modelData.SubMeshes[0];
+		subMesh.MaterialIndex = 0;
+		// Each face has its own four vertices so that it can have its own normal
+		static const XMFLOAT3 faceNormals[6] = { XMFLOAT3(0.0f, 0.0f, -1.0f), XMFLOAT3(0.0f, 0.0f, 1.0f),
+												 XMFLOAT3(-1.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 0.0f, 0.0f),
+												 XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT3(0.0f, -1.0f, 0.0f) };
+		static const float corners[4][2] = { { -1.0f, -1.0f }, { -1.0f, 1.0f }, { 1.0f, 1.0f }, { 1.0f, -1.0f } };
+		for (unsigned int face = 0; face < 6; face++)
+		{
+			XMVECTOR normal = XMLoadFloat3(&faceNormals[face]);
+			XMVECTOR u = XMVectorSwizzle<1, 2, 0, 3>(normal);
+			XMVECTOR v = XMVector3Cross(normal, u);
+			UINT firstVertex = static_cast<UINT>(subMesh.Vertices.size());
+			for (unsigned int corner = 0; corner < 4; corner++)
+			{
+				VERTEX vertex;
+				XMStoreFloat3(&vertex.Position, normal + u * corners[corner][0] + v * corners[corner][1]);
+				vertex.Normal = faceNormals[face];
+				vertex.TexCoord = XMFLOAT2((corners[corner][0] + 1.0f) * 0.5f, (corners[corner][1] + 1.0f) * 0.5f);
+				subMesh.Vertices.push_back(vertex);
+			}
+			UINT faceIndices[6] = { 0, 1, 2, 0, 2, 3 };
+			for (UINT index : faceIndices)
+			{
+				subMesh.Indices.push_back(firstVertex + index);
+			}
+		}
+		modelData.RootNode = make_shared<Node>();
+		modelData.RootNode->SetName(L"Placeholder");
+		modelData.RootNode->AddMesh(0);
+		_placeholderMesh = CreateMesh(modelData);
+	}
+	return _placeholderMesh;
+}
+
 void ResourceManager::ReleaseMesh(wstring modelName)
 {
+	PendingMeshMap::iterator pending = _pendingMeshes.find(modelName);
+	if (pending != _pendingMeshes.end())
+	{
+		// Still being read.  If nothing else wants it by the time it has been read, it is kept
+		// until it is asked for again.
+		pending->second.ReferenceCount--;
+		return;
+	}
 	MeshResourceMap::iterator it = _meshResources.find(modelName);
 	if (it != _meshResources.end())
 	{
@@ -121,15 +339,7 @@ void ResourceManager::ReleaseMesh(wstring modelName)
 		if (it->second.ReferenceCount == 0)
 		{
 			// Release any materials used by this mesh
-			shared_ptr<Mesh> mesh = it->second.MeshPointer;
-			unsigned int subMeshCount = static_cast<unsigned int>(mesh->GetSubMeshCount());
-			// Loop through all submeshes in the mesh
-			for (unsigned int i = 0; i < subMeshCount; i++)
-			{
-				shared_ptr<SubMesh> subMesh = mesh->GetSubMesh(i);
-				wstring materialName = subMesh->GetMaterial()->GetMaterialName();
-				ReleaseMaterial(materialName);
-			}
+			ReleaseMeshMaterials(*it->second.MeshPointer);
 			// If no other nodes are using this mesh, remove it frmo the map
 			// (which will also release the resources).
 			it->second.MeshPointer = nullptr;
@@ -138,6 +348,71 @@ void ResourceManager::ReleaseMesh(wstring modelName)
 	}
 }
 
+void ResourceManager::AddMeshInstance(shared_ptr<Mesh> mesh, FXMMATRIX worldTransformation)
+{
+	// Instances that are out of view are dropped before they are batched
+	shared_ptr<MeshRenderer> renderer = dynamic_pointer_cast<MeshRenderer>(GetRenderer(L"PNT"));
+	if (!renderer->IsMeshVisible(mesh, worldTransformation))
+	{
+		return;
+	}
+	XMFLOAT4X4 instanceTransformation;
+	XMStoreFloat4x4(&instanceTransformation, worldTransformation);
+	_instanceBatcher.Add(mesh.get(), instanceTransformation);
+	_instancedMeshes[mesh.get()] = mesh;
+}
+
+void ResourceManager::RenderMeshInstances()
+{
+	shared_ptr<MeshRenderer> renderer = dynamic_pointer_cast<MeshRenderer>(GetRenderer(L"PNT"));
+	_instanceBatcher.Build();
+	unsigned int instanceCount = _instanceBatcher.GetInstanceCount();
+	if (instanceCount == 0)
+	{
+		_cullingStatistics = renderer->TakeCullingStatistics();
+		return;
+	}
+
+	// Grow the instance buffer if needed, doubling it so that it is not recreated every time
+	// another instance is added
+	if (instanceCount > _instanceBufferCapacity)
+	{
+		_instanceBufferCapacity = instanceCount > _instanceBufferCapacity * 2 ? instanceCount : _instanceBufferCapacity * 2;
+		D3D11_BUFFER_DESC instanceBufferDescriptor;
+		instanceBufferDescriptor.Usage = D3D11_USAGE_DYNAMIC;
+		instanceBufferDescriptor.ByteWidth = sizeof(XMFLOAT4X4) * _instanceBufferCapacity;
+		instanceBufferDescriptor.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		instanceBufferDescriptor.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		instanceBufferDescriptor.MiscFlags = 0;
+		instanceBufferDescriptor.StructureByteStride = 0;
+		_instanceBuffer = nullptr;
+		ThrowIfFailed(_device->CreateBuffer(&instanceBufferDescriptor, nullptr, _instanceBuffer.GetAddressOf()));
+	}
+	D3D11_MAPPED_SUBRESOURCE mappedInstances;
+	ThrowIfFailed(_deviceContext->Map(_instanceBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedInstances));
+	memcpy(mappedInstances.pData, &_instanceBatcher.GetInstanceTransforms()[0], sizeof(XMFLOAT4X4) * instanceCount);
+	_deviceContext->Unmap(_instanceBuffer.Get(), 0);
+
+	for (const InstanceGroup& group : _instanceBatcher.GetGroups())
+	{
+		renderer->SetMesh(_instancedMeshes[group.Mesh]);
+		renderer->SetWorldTransformation(XMLoadFloat4x4(&_instanceBatcher.GetInstanceTransforms()[group.FirstInstance]));
+		if (group.InstanceCount == 1)
+		{
+			renderer->Render();
+		}
+		else
+		{
+			// Blended submeshes are submitted for each instance, in the same walk of the
+			// nodes, so the queue can sort them
+			renderer->RenderInstanced(_instanceBuffer, &_instanceBatcher.GetInstanceTransforms()[0], group.FirstInstance, group.InstanceCount);
+		}
+	}
+	_instanceBatcher.Clear();
+	_instancedMeshes.clear();
+	_cullingStatistics = renderer->TakeCullingStatistics();
+}
+
 void ResourceManager::CreateMaterialFromTexture(wstring textureName)
 {
     // We have no diffuse or specular colours here since we are just building a default material structure
@@ -197,27 +472,38 @@ void ResourceManager::InitialiseMaterial(wstring materialName, XMFLOAT4 diffuseC
 	MaterialResourceMap::iterator it = _materialResources.find(materialName);
 	if (it == _materialResources.end())
 	{
-		// We are creating the material for the first time
-		ComPtr<ID3D11ShaderResourceView> texture;
+		// We are creating the material for the first time.  It uses the default texture
+		// until its own texture has been streamed in.
+		shared_ptr<Material> material = make_shared<Material>(materialName, diffuseColour, specularColour, shininess, opacity, _defaultTexture);
+
+		// The material's constants never change, so they are put in their own buffer once
+		MaterialConstants materialConstants;
+		ZeroMemory(&materialConstants, sizeof(materialConstants));
+		materialConstants.DiffuseCoefficient = diffuseColour;
+		materialConstants.SpecularCoefficient = specularColour;
+		materialConstants.Shininess = shininess;
+		materialConstants.Opacity = opacity;
+		D3D11_BUFFER_DESC bufferDesc;
+		ZeroMemory(&bufferDesc, sizeof(bufferDesc));
+		bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		bufferDesc.ByteWidth = sizeof(MaterialConstants);
+		bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		D3D11_SUBRESOURCE_DATA initialisationData;
+		ZeroMemory(&initialisationData, sizeof(initialisationData));
+		initialisationData.pSysMem = &materialConstants;
+		ComPtr<ID3D11Buffer> constantBuffer;
+		ThrowIfFailed(_device->CreateBuffer(&bufferDesc, &initialisationData, constantBuffer.GetAddressOf()));
+		material->SetConstantBuffer(constantBuffer);
+
 		if (textureName.size() > 0)
 		{
-			// A texture was specified.  Try to load it.
-			if (FAILED(CreateWICTextureFromFile(_device.Get(),
-											    _deviceContext.Get(),
-												textureName.c_str(),
-												nullptr,
-												texture.GetAddressOf()
-												)))
-			{
-				// If we cannot load the texture, then just use the default.
-				texture = _defaultTexture;
-			}
-		}
-		else
-		{
-			texture = _defaultTexture;
+			// A texture was specified.  It is read in the background once the material has been
+			// drawn with.  If it cannot be loaded, the default texture is kept.
+			unsigned int textureId = _textureResidency->AddTexture(textureName);
+			material->SetStreamedTextureId(textureId);
+			_textureStreamer->AddMaterial(textureId, material);
 		}
-		shared_ptr<Material> material = make_shared<Material>(materialName, diffuseColour, specularColour, shininess, opacity, texture);
+
 		MaterialResourceStruct resourceStruct;
 		resourceStruct.ReferenceCount = 0;
 		resourceStruct.MaterialPointer = material;
@@ -225,248 +511,84 @@ void ResourceManager::InitialiseMaterial(wstring materialName, XMFLOAT4 diffuseC
 	}
 }
 
-shared_ptr<Node> ResourceManager::CreateNodes(aiNode * sceneNode)
+shared_ptr<Mesh> ResourceManager::LoadModelFromFile(wstring modelName)
 {
-	shared_ptr<Node> node = make_shared<Node>();
-	node->SetName(s2ws(string(sceneNode->mName.C_Str())));
-	// Get the meshes associated with this node
-	unsigned int meshCount = sceneNode->mNumMeshes;
-	for (unsigned int i = 0; i < meshCount; i++)
+	shared_ptr<ModelData> modelData = ReadModelData(modelName, _modelCache);
+	if (modelData == nullptr)
 	{
-		node->AddMesh(sceneNode->mMeshes[i]);
+		return nullptr;
 	}
-	// Now process the children of this node
-	unsigned int childrenCount = sceneNode->mNumChildren;
-	for (unsigned int i = 0; i < childrenCount; i++)
+	shared_ptr<Mesh> mesh = CreateMesh(*modelData);
+	if (mesh != nullptr)
 	{
-		node->AddChild(CreateNodes(sceneNode->mChildren[i]));
+		AddMeshStatistics(modelName, *mesh);
 	}
-	return node;
+	return mesh;
 }
 
-shared_ptr<Mesh> ResourceManager::LoadModelFromFile(wstring modelName)
+shared_ptr<ModelData> ResourceManager::ReadModelData(wstring modelName, shared_ptr<ModelCache> modelCache)
 {
-	ComPtr<ID3D11Buffer> vertexBuffer;
-	ComPtr<ID3D11Buffer> indexBuffer;
-    wstring * materials = nullptr;
-	
-	Importer importer;
-
-	unsigned int postProcessSteps = aiProcess_Triangulate |
-		                            aiProcess_ConvertToLeftHanded;
-	string modelNameUTF8 = ws2s(modelName);
-	const aiScene * scene = importer.ReadFile(modelNameUTF8.c_str(), postProcessSteps);
-	if (!scene)
-	{
-        // If failed to load, there is nothing to do
-		return nullptr;
+	// Use the baked model if there is an up to date one.  Otherwise import the model
+	// and bake it for next time.
+	shared_ptr<ModelData> modelData = modelCache->ReadModel(modelName);
+	if (modelData == nullptr)
+	{
+		modelData = ModelImporter::Import(modelName);
+		if (modelData != nullptr)
+		{
+			modelCache->WriteModel(modelName, *modelData);
+		}
 	}
-    if (!scene->HasMeshes())
-    {
-        //If there are no meshes, then there is nothing to do.
-        return nullptr;
-    }
-    if (scene->HasMaterials())
-    {
-        // We need to find the directory part of the model name since we will need to add it to any texture names. 
-        // There is definately a more elegant and accurate way to do this using Windows API calls, but this is a quick
-        // and dirty approach
-        string::size_type slashIndex = modelNameUTF8.find_last_of("\\");
-        string directory;
-        if (slashIndex == string::npos) 
-        {
-            directory = ".";
-        }
-        else if (slashIndex == 0) 
-        {
-            directory = "/";
-        }
-        else 
-        {
-            directory = modelNameUTF8.substr(0, slashIndex);
-        }
-        // Let's deal with the materials/textures first
-        materials = new wstring[scene->mNumMaterials];
-        for (unsigned int i = 0; i < scene->mNumMaterials; i++)
-        {
-            // Get the core material properties.  Ideally, we would be looking for more information
-            // e.g. emissive colour, etc.  This is a task for later.
-            aiMaterial * material = scene->mMaterials[i];
+	return modelData;
+}
 
-			aiColor3D &defaultColour = aiColor3D(0.0f, 0.0f, 0.0f);
-			aiColor3D& diffuseColour = aiColor3D(0.0f, 0.0f, 0.0f);
-			if (material->Get(AI_MATKEY_COLOR_DIFFUSE, diffuseColour) != aiReturn_SUCCESS)
-			{
-				diffuseColour = defaultColour;
-			}
-            aiColor3D& specularColour = aiColor3D(0.0f, 0.0f, 0.0f);
-			if (material->Get(AI_MATKEY_COLOR_SPECULAR, specularColour) != aiReturn_SUCCESS)
-			{
-				specularColour = defaultColour;
-			}
-            float defaultShininess = 0.0f;
-            float& shininess = defaultShininess;
-            material->Get(AI_MATKEY_SHININESS, shininess);
-			float defaultOpacity = 1.0f;
-			float& opacity = defaultOpacity;
-			material->Get(AI_MATKEY_OPACITY, opacity);
-			bool defaultTwoSided = false;
-			bool& twoSided = defaultTwoSided;
-			material->Get(AI_MATKEY_TWOSIDED, twoSided);
-			string fullTextureNamePath = "";
-            if (material->GetTextureCount(aiTextureType_DIFFUSE) > 0)
-            {
-                aiString textureName;
-				float blendFactor;
-				aiTextureOp blendOp;
-                if (material->GetTexture(aiTextureType_DIFFUSE, 0, &textureName, NULL, NULL, &blendFactor, &blendOp, NULL) == AI_SUCCESS)
-                {
-                    // Get full path to texture by prepending the same folder as included in the model name. This
-                    // does assume that textures are in the same folder as the model files
-                    fullTextureNamePath = directory + "\\" + textureName.data;
-                }
-            }
-            // Now create a unique name for the material based on the model name and loop count
-            stringstream materialNameStream;
-            materialNameStream << modelNameUTF8 << i;
-            string materialName = materialNameStream.str();
-			wstring materialNameWS = s2ws(materialName);
-			CreateMaterial(materialNameWS,
-						   XMFLOAT4(diffuseColour.r, diffuseColour.g, diffuseColour.b, 1.0f),
-                           XMFLOAT4(specularColour.r, specularColour.g, specularColour.b, 1.0f),
-                           shininess,
-						   opacity, 
-                           s2ws(fullTextureNamePath));
-            materials[i] = materialNameWS;
-        }
-    }
+shared_ptr<Mesh> ResourceManager::CreateMesh(const ModelData& modelData)
+{
+	// Create all of the materials first
+	for (const ModelMaterialData& materialData : modelData.Materials)
+	{
+		CreateMaterial(materialData.Name,
+					   materialData.DiffuseColour,
+					   materialData.SpecularColour,
+					   materialData.Shininess,
+					   materialData.Opacity,
+					   materialData.TextureName);
+	}
     // Now we have created all of the materials, build up the mesh
 	shared_ptr<Mesh> resourceMesh = make_shared<Mesh>();
-    for (unsigned int sm = 0; sm < scene->mNumMeshes; sm++)
-    {
-	    aiMesh * subMesh = scene->mMeshes[sm];
-	    unsigned int numVertices = subMesh->mNumVertices;
-	    bool hasNormals = subMesh->HasNormals();
-	    bool hasTexCoords = subMesh->HasTextureCoords(0);
-	    if (numVertices == 0 || !hasNormals)
-	    {
-		    return nullptr;
-	    }
-	    // Build up our vertex structure
-	    aiVector3D * subMeshVertices = subMesh->mVertices;
-	    aiVector3D * subMeshNormals = subMesh->mNormals;
-        // We only handle one set of UV coordinates at the moment.  Again, handling multiple sets of UV
-        // coordinates is a future enhancement.
-	    aiVector3D * subMeshTexCoords = subMesh->mTextureCoords[0];
-	    VERTEX * modelVertices = new VERTEX[numVertices];
-	    VERTEX * currentVertex = modelVertices;
-	    for (unsigned int i = 0; i < numVertices; i++)
-	    {
-			currentVertex->Position = XMFLOAT3(subMeshVertices->x, subMeshVertices->y, subMeshVertices->z);
-			currentVertex->Normal = XMFLOAT3(subMeshNormals->x, subMeshNormals->y, subMeshNormals->z);
-		    subMeshVertices++;
-		    subMeshNormals++;
-            if (!hasTexCoords)
-            {
-                // If the model does not have texture coordinates, set them to 0
-				currentVertex->TexCoord = XMFLOAT2(0.0f, 0.0f);
-            }
-            else
-            {
-                // Handle negative texture coordinates by wrapping them to positive.  This should
-                // ideally be handled in the shader.  Note we are assuming that negative coordinates
-                // here are no smaller than -1.0 - this may not be a valid assumption.
-		        if (subMeshTexCoords->x < 0)
-		        {
-			        currentVertex->TexCoord.x = subMeshTexCoords->x + 1.0f;
-		        }
-		        else
-		        {
-			        currentVertex->TexCoord.x = subMeshTexCoords->x;
-		        }
-		        if (subMeshTexCoords->y < 0)
-		        {
-			        currentVertex->TexCoord.y = subMeshTexCoords->y + 1.0f;
-		        }
-		        else
-		        {
-			        currentVertex->TexCoord.y = subMeshTexCoords->y;
-		        }
-		        subMeshTexCoords++;
-            }
-		    currentVertex++;
-	    }
-
-		D3D11_BUFFER_DESC vertexBufferDescriptor;
-		vertexBufferDescriptor.Usage = D3D11_USAGE_IMMUTABLE;
-		vertexBufferDescriptor.ByteWidth = sizeof(VERTEX) * numVertices;
-		vertexBufferDescriptor.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-		vertexBufferDescriptor.CPUAccessFlags = 0;
-		vertexBufferDescriptor.MiscFlags = 0;
-		vertexBufferDescriptor.StructureByteStride = 0;
-
-		// Now set up a structure that tells DirectX where to get the
-		// data for the vertices from
-		D3D11_SUBRESOURCE_DATA vertexInitialisationData;
-		vertexInitialisationData.pSysMem = modelVertices;
-
-		// and create the vertex buffer
-		if (FAILED(_device->CreateBuffer(&vertexBufferDescriptor, &vertexInitialisationData, vertexBuffer.GetAddressOf())))
-		{
-			return nullptr;
-		}
+	GeometryMemoryStatistics memoryStatistics = {};
+	PackedGeometry packed;
+	for (const ModelSubMeshData& subMeshData : modelData.SubMeshes)
+	{
+		UINT numVertices = static_cast<UINT>(subMeshData.GetVertexCount());
+		UINT numberOfIndices = static_cast<UINT>(subMeshData.GetIndexCount());
 
-	    // Now extract the indices from the file
-	    unsigned int numberOfFaces = subMesh->mNumFaces;
-	    unsigned int numberOfIndices = numberOfFaces * 3;
-	    aiFace * subMeshFaces = subMesh->mFaces;
-	    if (subMeshFaces->mNumIndices != 3)
-	    {
-		    // We are not dealing with triangles, so we cannot handle it
-		    return nullptr;
-	    }
-	    unsigned int * modelIndices = new unsigned int[numberOfIndices * 3];
-	    unsigned int * currentIndex  = modelIndices;
-	    for (unsigned int i = 0; i < numberOfFaces; i++)
-	    {
-		    *currentIndex++ = subMeshFaces->mIndices[0];
-		    *currentIndex++ = subMeshFaces->mIndices[1];
-		    *currentIndex++ = subMeshFaces->mIndices[2];
-		    subMeshFaces++;
-	    }
-		// Setup the structure that specifies how big the index 
-		// buffer should be
-		D3D11_BUFFER_DESC indexBufferDescriptor;
-		indexBufferDescriptor.Usage = D3D11_USAGE_IMMUTABLE;
-		indexBufferDescriptor.ByteWidth = sizeof(UINT) * numberOfIndices * 3;
-		indexBufferDescriptor.BindFlags = D3D11_BIND_INDEX_BUFFER;
-		indexBufferDescriptor.CPUAccessFlags = 0;
-		indexBufferDescriptor.MiscFlags = 0;
-		indexBufferDescriptor.StructureByteStride = 0;
-
-		// Now set up a structure that tells DirectX where to get the
-		// data for the indices from
-		D3D11_SUBRESOURCE_DATA indexInitialisationData;
-		indexInitialisationData.pSysMem = modelIndices;
-
-		// and create the index buffer
-		if (FAILED(_device->CreateBuffer(&indexBufferDescriptor, &indexInitialisationData, indexBuffer.GetAddressOf())))
+		// Use 16-bit indices where we can, and the smaller vertex format if asked for
+		VertexPacker::Pack(subMeshData.GetVertices(), numVertices, subMeshData.GetIndices(), numberOfIndices, _quantizeVertices, packed);
+		VertexPacker::AddStatistics(packed, numVertices, numberOfIndices, memoryStatistics);
+
+		// Copy the geometry into a range of the shared buffers rather than making buffers for each sub-mesh
+		GeometryAllocation allocation;
+		if (!_geometryArena->Allocate(packed, allocation))
 		{
 			return nullptr;
 		}
 
 		// Do we have a material associated with this mesh?
 		shared_ptr<Material> material = nullptr;
-        if (scene->HasMaterials())
+        if (!modelData.Materials.empty())
         {
-            material = GetMaterial(materials[subMesh->mMaterialIndex]);
+            material = GetMaterial(modelData.Materials[subMeshData.MaterialIndex].Name);
         }
-	    shared_ptr<SubMesh> resourceSubMesh = make_shared<SubMesh>(vertexBuffer, indexBuffer, numVertices, numberOfIndices, material);
+	    shared_ptr<SubMesh> resourceSubMesh = make_shared<SubMesh>(nullptr, nullptr, numVertices, numberOfIndices, material);
+		resourceSubMesh->SetPacking(packed);
+		resourceSubMesh->SetArenaRange(_geometryArena, allocation);
+		resourceSubMesh->SetBounds(MeshBounds::FromVertices(subMeshData.GetVertices(), numVertices));
 	    resourceMesh->AddSubMesh(resourceSubMesh);
-		delete[] modelVertices;
-		delete[] modelIndices;
-    }
-	// Now build the hierarchy of nodes
-	resourceMesh->SetRootNode(CreateNodes(scene->mRootNode));
+	}
+	resourceMesh->SetMemoryStatistics(memoryStatistics);
+	resourceMesh->SetOptimisationStatistics(modelData.OptimisationStatistics);
+	resourceMesh->SetRootNode(modelData.RootNode);
+	resourceMesh->CalculateBounds();
 	return resourceMesh;
 }
@@ -1,17 +1,14 @@
 #pragma once
 #include "Mesh.h"
 #include "Renderer.h"
+#include "Vertex.h"
+#include "InstanceBatcher.h"
+#include "ModelData.h"
+#include "ModelCache.h"
+#include "TextureStreamer.h"
+#include "StaticBatcher.h"
 #include <map>
-#include <Assimp\importer.hpp>
-#include <assimp\scene.h>
-#include <assimp\postprocess.h>
-
-struct VERTEX
-{
-	XMFLOAT3 Position;
-	XMFLOAT3 Normal;
-	XMFLOAT2 TexCoord;
-};
+#include <future>
 
 struct MeshResourceStruct
 {
@@ -21,6 +18,39 @@ struct MeshResourceStruct
 
 typedef map<wstring, MeshResourceStruct>		MeshResourceMap;
 
+// Returned by GetMeshAsync.  Until the model has been loaded, GetMesh returns a placeholder
+// mesh so that the node still has something to draw.  If the model could not be loaded,
+// GetMesh returns null.  A file that does not exist is failed straight away.
+
+class MeshLoadRequest
+{
+public:
+	inline bool									IsResident() { return _mesh != nullptr; }
+	inline bool									HasFailed() { return _failed; }
+	inline shared_ptr<Mesh>						GetMesh() { return _mesh != nullptr ? _mesh : (_failed ? nullptr : _placeholder); }
+
+private:
+	shared_ptr<Mesh>							_mesh;
+	shared_ptr<Mesh>							_placeholder;
+	bool										_failed = false;
+
+	friend class ResourceManager;
+};
+
+// A model that is being read on a worker thread.  The reference count includes every
+// GetMeshAsync for the model, less any ReleaseMesh made before it finished loading.
+// A model whose count has dropped to zero by the time it has been read is still created, and
+// kept with no references.
+
+struct PendingMeshStruct
+{
+	unsigned int								ReferenceCount;
+	shared_ptr<MeshLoadRequest>					Request;
+	future<shared_ptr<ModelData>>				Model;
+};
+
+typedef map<wstring, PendingMeshStruct>		PendingMeshMap;
+
 struct MaterialResourceStruct
 {
 	unsigned int			ReferenceCount;
@@ -41,6 +71,30 @@ public:
 
 	shared_ptr<Mesh>							GetMesh(wstring modelName);
 	void										ReleaseMesh(wstring modelName);
+	// Reads the model on a worker thread rather than waiting for it.  The Direct3D resources
+	// are created by CreatePendingMeshes once the model has been read.
+	shared_ptr<MeshLoadRequest>					GetMeshAsync(wstring modelName);
+	// Called on the device thread once a frame to finish off any models that have been read
+	void										CreatePendingMeshes();
+	// Merges models that never move into one mesh with a sub-mesh for each material (see
+	// StaticBatcher.h).  The models are read straight away rather than on a worker thread.
+	// batched is set to whether each placement was merged.  Returns null (with nothing
+	// batched) if none of the models could be batched.
+	shared_ptr<Mesh>							CreateStaticBatch(const vector<StaticBatchPlacement>& placements, StaticBatchStatistics& statistics, vector<bool>& batched);
+	// Releases the materials that a static batch holds on to
+	void										ReleaseStaticBatch(shared_ptr<Mesh> batch);
+	// Meshes created after this is set use the 16 byte vertex format from VertexPacker.h
+	// where they can.  Off by default.
+	inline void									SetQuantizeVertices(bool quantizeVertices) { _quantizeVertices = quantizeVertices; }
+	// How full and how fragmented the shared vertex and index buffers are
+	inline GeometryArenaStatistics				GetGeometryArenaStatistics() { return _geometryArena->GetStatistics(); }
+	// Called on the device thread once a frame.  Gives materials the textures that have finished
+	// loading, starts loading the textures drawn with last frame and evicts textures to stay in budget.
+	void										UpdateTextureStreaming();
+	// Called each time a material with a streamed texture is drawn
+	inline void									MarkTextureUsed(unsigned int textureId) { _textureResidency->MarkUsed(textureId); }
+	inline void									SetTextureBudget(size_t budgetBytes) { _textureResidency->SetBudget(budgetBytes); }
+	inline const TextureStreamingStatistics&	GetTextureStreamingStatistics() { return _textureResidency->GetStatistics(); }
 
 	void										CreateMaterialFromTexture(wstring textureName);
     void										CreateMaterialWithNoTexture(wstring materialName, XMFLOAT4 diffuseColour, XMFLOAT4 specularColour, float shininess, float opacity);
@@ -48,8 +102,25 @@ public:
 	shared_ptr<Material>						GetMaterial(wstring materialName);
 	void										ReleaseMaterial(wstring materialName);
 
+	// Nodes add their mesh and world transform each frame rather than drawing straight away.
+	// RenderMeshInstances then draws each mesh once for all of the nodes that use it.
+	void										AddMeshInstance(shared_ptr<Mesh> mesh, FXMMATRIX worldTransformation);
+	void										RenderMeshInstances();
+	// What was culled in the last call to RenderMeshInstances (and the calls to AddMeshInstance before it)
+	inline const MeshCullingStatistics&			GetCullingStatistics() { return _cullingStatistics; }
+	// Totals for every model and static batch loaded so far: the memory their vertex and index
+	// buffers use, and what optimising them when they were imported saved.  Each one is also
+	// written to the debugger output as it is loaded.
+	inline const GeometryMemoryStatistics&		GetGeometryMemoryStatistics() { return _geometryMemoryStatistics; }
+	inline const MeshOptimisationStatistics&	GetMeshOptimisationStatistics() { return _meshOptimisationStatistics; }
+
 private:
 	MeshResourceMap								_meshResources;
+	PendingMeshMap								_pendingMeshes;
+	shared_ptr<Mesh>							_placeholderMesh;
+	shared_ptr<ModelCache>						_modelCache;
+	bool										_quantizeVertices = false;
+	shared_ptr<GeometryArena>					_geometryArena;
 	MaterialResourceMap							_materialResources;
 	RendererResourceMap							_rendererResources;
 
@@ -57,9 +128,25 @@ private:
 	ComPtr<ID3D11DeviceContext>					_deviceContext;
 
 	ComPtr<ID3D11ShaderResourceView>			_defaultTexture;
+	shared_ptr<TextureStreamer>					_textureStreamer;
+	shared_ptr<TextureResidencyManager>			_textureResidency;
+
+	InstanceBatcher								_instanceBatcher;
+	map<const void *, shared_ptr<Mesh>>			_instancedMeshes;
+	ComPtr<ID3D11Buffer>						_instanceBuffer;
+	unsigned int								_instanceBufferCapacity = 0;
+	MeshCullingStatistics						_cullingStatistics = {};
+	GeometryMemoryStatistics					_geometryMemoryStatistics = {};
+	MeshOptimisationStatistics					_meshOptimisationStatistics = {};
     
-	shared_ptr<Node>							CreateNodes(aiNode * sceneNode);
 	shared_ptr<Mesh>							LoadModelFromFile(wstring modelName);
+	// These do not use the device, so can be run on any thread
+	static shared_ptr<ModelData>				ReadModelData(wstring modelName, shared_ptr<ModelCache> modelCache);
+	shared_ptr<Mesh>							CreateMesh(const ModelData& modelData);
+	void										FinishMeshLoad(PendingMeshMap::iterator it);
+	void										AddMeshStatistics(const wstring& name, const Mesh& mesh);
+	void										ReleaseMeshMaterials(Mesh& mesh);
+	shared_ptr<Mesh>							GetPlaceholderMesh();
     void										InitialiseMaterial(wstring materialName, XMFLOAT4 diffuseColour, XMFLOAT4 specularColour, float shininess, float opacity, wstring textureName);
 };
 
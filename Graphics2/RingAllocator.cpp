@@ -0,0 +1,113 @@
+#include "RingAllocator.h"
+
+RingAllocator::RingAllocator(size_t capacity)
+{
+	_capacity = capacity & ~(Alignment - 1);
+	_head = 0;
+	_tail = 0;
+	_used = 0;
+	_inFrame = false;
+	_currentFrame = { 0, 0, 0 };
+}
+
+void RingAllocator::BeginFrame(unsigned long long frameIndex)
+{
+	if (_inFrame)
+	{
+		EndFrame();
+	}
+	_currentFrame.FrameIndex = frameIndex;
+	_currentFrame.Size = 0;
+	_inFrame = true;
+}
+
+void RingAllocator::EndFrame()
+{
+	if (!_inFrame)
+	{
+		return;
+	}
+	_currentFrame.End = _head;
+	_frames.push_back(_currentFrame);
+	_inFrame = false;
+}
+
+size_t RingAllocator::Allocate(size_t size)
+{
+	size_t alignedSize = size > 0 ? AlignSize(size) : Alignment;
+	if (!_inFrame || alignedSize > _capacity || _used == _capacity)
+	{
+		return InvalidOffset;
+	}
+	if (_used == 0)
+	{
+		// Nothing is in use, so start again from the beginning to leave the most room.  Any
+		// frames still in flight used no space, so they end there too.
+		_head = 0;
+		_tail = 0;
+		for (FrameRecord& frame : _frames)
+		{
+			frame.End = 0;
+		}
+	}
+
+	size_t offset;
+	if (_head >= _tail)
+	{
+		// The free space is from the head to the end of the buffer, and from the start of the
+		// buffer to the tail
+		if (_head + alignedSize <= _capacity)
+		{
+			offset = _head;
+		}
+		else if (alignedSize <= _tail)
+		{
+			size_t skipped = _capacity - _head;
+			_used += skipped;
+			_currentFrame.Size += skipped;
+			offset = 0;
+		}
+		else
+		{
+			return InvalidOffset;
+		}
+	}
+	else
+	{
+		// The free space is between the head and the tail
+		if (_head + alignedSize > _tail)
+		{
+			return InvalidOffset;
+		}
+		offset = _head;
+	}
+
+	_head = offset + alignedSize;
+	if (_head == _capacity)
+	{
+		_head = 0;
+	}
+	_used += alignedSize;
+	_currentFrame.Size += alignedSize;
+	return offset;
+}
+
+void RingAllocator::RetireFrames(unsigned long long frameIndex)
+{
+	while (!_frames.empty() && _frames.front().FrameIndex <= frameIndex)
+	{
+		_tail = _frames.front().End;
+		_used -= _frames.front().Size;
+		_frames.pop_front();
+	}
+}
+
+void RingAllocator::Reset()
+{
+	_head = 0;
+	_tail = 0;
+	_used = 0;
+	_currentFrame.Size = 0;
+	_currentFrame.End = 0;
+	_frames.clear();
+}
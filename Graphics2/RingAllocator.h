@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <deque>
+
+// Hands out space from a fixed size buffer in a ring, for data that is written by the CPU once
+// and read by the GPU in the same frame (such as per-object constants).
+//
+// Allocations are made inside a frame (between BeginFrame and EndFrame) and all of a frame's
+// allocations are given back together.  The GPU can be a few frames behind the CPU, so the
+// space used by a frame is only reused once RetireFrames has been told that frame is done.
+// Until then an allocation that does not fit fails, rather than overwriting data the GPU may
+// still be reading.
+//
+// Offsets are aligned to Alignment bytes (256, the granularity of Direct3D 11.1 constant buffer
+// offsets).  An allocation never wraps around the end of the buffer - the space left at the end
+// is skipped and given back with the frame.  Only offsets are tracked, so no device is needed.
+
+class RingAllocator
+{
+public:
+	static const size_t						Alignment = 256;
+	static const size_t						InvalidOffset = static_cast<size_t>(-1);
+
+	RingAllocator(size_t capacity);
+
+	void									BeginFrame(unsigned long long frameIndex);
+	void									EndFrame();
+
+	// Returns the offset of size bytes of space, or InvalidOffset if there is not enough
+	// free space.  Must be called between BeginFrame and EndFrame.
+	size_t									Allocate(size_t size);
+
+	// Gives back the space used by every frame up to and including frameIndex
+	void									RetireFrames(unsigned long long frameIndex);
+
+	// Gives back all space, including that of frames that have not been retired
+	void									Reset();
+
+	inline size_t							GetCapacity() const { return _capacity; }
+	inline size_t							GetUsed() const { return _used; }
+	inline size_t							GetFramesInFlight() const { return _frames.size(); }
+
+	static inline size_t					AlignSize(size_t size) { return (size + Alignment - 1) & ~(Alignment - 1); }
+
+private:
+	struct FrameRecord
+	{
+		unsigned long long					FrameIndex;
+		size_t								End;			// The head at the end of the frame
+		size_t								Size;			// Bytes used, including any skipped at the end of the buffer
+	};
+
+	size_t									_capacity;
+	size_t									_head;
+	size_t									_tail;
+	size_t									_used;
+	bool									_inFrame;
+	FrameRecord								_currentFrame;
+	std::deque<FrameRecord>					_frames;
+};
@@ -31,6 +31,53 @@ void SceneGraph::Update(FXMMATRIX& currentWorldTransformation)
 	}
 }
 
+void SceneGraph::UpdateIfChanged(FXMMATRIX& currentWorldTransformation, bool parentChanged, unsigned int& updatedCount)
+{
+	//If this node has moved, everything below it has to be updated as well
+	bool changed = parentChanged || _transformDirty;
+	if (changed)
+	{
+		SceneNode::Update(currentWorldTransformation);
+		_transformDirty = false;
+		updatedCount++;
+	}
+	FXMMATRIX combineWorldTransform = XMLoadFloat4x4(&_combinedWorldTransformation);
+	std::list<SceneNodePointer>::iterator it;
+
+	for (it = _children.begin(); it != _children.end(); it++)
+	{
+		it->get()->UpdateIfChanged(combineWorldTransform, changed, updatedCount);
+	}
+}
+
+void SceneGraph::UpdateIfChangedParallel(FXMMATRIX& currentWorldTransformation, bool parentChanged, unsigned int& updatedCount, ThreadPool& threadPool)
+{
+	bool changed = parentChanged || _transformDirty;
+	if (changed)
+	{
+		SceneNode::Update(currentWorldTransformation);
+		_transformDirty = false;
+		updatedCount++;
+	}
+	XMFLOAT4X4 combineWorldTransform = _combinedWorldTransformation;
+
+	//Each child gets its own count so that no locking is needed while updating
+	std::vector<SceneNode*> children;
+	for (const SceneNodePointer& child : _children)
+	{
+		children.push_back(child.get());
+	}
+	std::vector<unsigned int> childUpdatedCounts(children.size(), 0);
+	threadPool.ParallelForEach(static_cast<unsigned int>(children.size()), [&](unsigned int index)
+	{
+		children[index]->UpdateIfChanged(XMLoadFloat4x4(&combineWorldTransform), changed, childUpdatedCounts[index]);
+	});
+	for (unsigned int childUpdatedCount : childUpdatedCounts)
+	{
+		updatedCount += childUpdatedCount;
+	}
+}
+
 void SceneGraph::Render(void)
 {
 	std::list<SceneNodePointer>::iterator it;
@@ -42,35 +89,54 @@ void SceneGraph::Render(void)
 
 void SceneGraph::Add(SceneNodePointer node)
 {
+	//The node's combined transform was worked out for its old parent, if it had one
+	node->MarkTransformDirty();
 	_children.push_back(node);
+	_nameIndex->Add(node->GetInternedName(), node);
+	node->SetNameIndex(_nameIndex);
 }
 
 void SceneGraph::Remove(SceneNodePointer node)
 {
-	std::list<SceneNodePointer>::iterator it;
-	for (it = _children.begin(); it != _children.end(); it++)
+	std::list<SceneNodePointer>::iterator it = _children.begin();
+	while (it != _children.end())
 	{
-		it->get()->Remove(node);
-		SceneNodePointer thisNode = (SceneNodePointer)it->get();
-		if (node == thisNode)
+		if (*it == node)
+		{
+			//The removed subtree gets an index of its own
+			_nameIndex->Remove(node->GetInternedName(), node);
+			node->SetNameIndex(make_shared<SceneNameIndex>());
+			it = _children.erase(it);
+		}
+		else
 		{
-			_children.erase(it);
+			it->get()->Remove(node);
+			it++;
 		}
 	}
-	
 }
 
 SceneNodePointer SceneGraph::Find(wstring name)
 {
-	if (name == _name)
+	if (name == *_name)
 	{
 		return shared_from_this();
 	}
+	return _nameIndex->Find(name);
+}
+
+void SceneGraph::SetNameIndex(shared_ptr<SceneNameIndex> nameIndex)
+{
+	//Move this subtree's names into the new index
 	std::list<SceneNodePointer>::iterator it;
 	for (it = _children.begin(); it != _children.end(); it++)
 	{
-		it->get()->Find(name);
+		_nameIndex->Remove(it->get()->GetInternedName(), *it);
+		nameIndex->Add(it->get()->GetInternedName(), *it);
+		it->get()->SetNameIndex(nameIndex);
 	}
+	_nameIndex = nameIndex;
+	SceneNode::SetNameIndex(nameIndex);
 }
 
 void SceneGraph::Shutdown(void)
@@ -1,25 +1,38 @@
 #pragma once
 #include "SceneNode.h"
+#include "ThreadPool.h"
 #include <list>
 
 class SceneGraph : public SceneNode
 {
 public:
-	SceneGraph() : SceneNode(L"Root") {};
-	SceneGraph(wstring name) : SceneNode(name) {};
+	SceneGraph() : SceneNode(L"Root") { _nameIndex = make_shared<SceneNameIndex>(); };
+	SceneGraph(wstring name) : SceneNode(name) { _nameIndex = make_shared<SceneNameIndex>(); };
 	~SceneGraph(void) {};
 
 	virtual bool Initialise(void);
 	virtual void Update(FXMMATRIX& currentWorldTransformation);
+	virtual void UpdateIfChanged(FXMMATRIX& currentWorldTransformation, bool parentChanged, unsigned int& updatedCount);
+	// The same as UpdateIfChanged, but the subtrees of each child are updated on the thread pool.
+	// Each node's transform only depends on its parent, so the results are identical to the
+	// serial update.  Node Update methods must not change anything outside their own node.
+	void UpdateIfChangedParallel(FXMMATRIX& currentWorldTransformation, bool parentChanged, unsigned int& updatedCount, ThreadPool& threadPool);
 	virtual void Render(void);
 	virtual void Shutdown(void);
 
 	void Add(SceneNodePointer node);
 	void Remove(SceneNodePointer node);
+	// Looks the name up in the index shared by every node of the graph this node is part of
 	SceneNodePointer Find(wstring name);
+	void SetNameIndex(shared_ptr<SceneNameIndex> nameIndex);
 
-private:
+	inline const std::list<SceneNodePointer>& GetChildren() const { return _children; }
+
+protected:
 	std::list<SceneNodePointer> _children;
+
+private:
+	shared_ptr<SceneNameIndex> _nameIndex;
 };
 
 typedef shared_ptr<SceneGraph>			 SceneGraphPointer;
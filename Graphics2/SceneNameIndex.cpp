@@ -0,0 +1,75 @@
+#include "SceneNameIndex.h"
+
+std::mutex SceneNameIndex::_internMutex;
+std::unordered_set<std::wstring> SceneNameIndex::_internedNames;
+
+const std::wstring * SceneNameIndex::Intern(const std::wstring& name)
+{
+	// Elements of an unordered_set are never moved, so their addresses are stable
+	std::lock_guard<std::mutex> lock(_internMutex);
+	return &*_internedNames.insert(name).first;
+}
+
+const std::wstring * SceneNameIndex::Lookup(const std::wstring& name)
+{
+	std::lock_guard<std::mutex> lock(_internMutex);
+	auto it = _internedNames.find(name);
+	return it == _internedNames.end() ? nullptr : &*it;
+}
+
+void SceneNameIndex::Add(const std::wstring * name, const std::shared_ptr<SceneNode>& node)
+{
+	_nodes.emplace(name, node);
+}
+
+void SceneNameIndex::Remove(const std::wstring * name, const std::shared_ptr<SceneNode>& node)
+{
+	auto range = _nodes.equal_range(name);
+	auto it = range.first;
+	while (it != range.second)
+	{
+		std::shared_ptr<SceneNode> indexedNode = it->second.lock();
+		if (indexedNode == nullptr || indexedNode == node)
+		{
+			it = _nodes.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+bool SceneNameIndex::Rename(const std::wstring * oldName, const std::wstring * newName, const std::shared_ptr<SceneNode>& node)
+{
+	auto range = _nodes.equal_range(oldName);
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		if (it->second.lock() == node)
+		{
+			_nodes.erase(it);
+			_nodes.emplace(newName, node);
+			return true;
+		}
+	}
+	return false;
+}
+
+std::shared_ptr<SceneNode> SceneNameIndex::Find(const std::wstring& name) const
+{
+	const std::wstring * internedName = Lookup(name);
+	if (internedName == nullptr)
+	{
+		return nullptr;
+	}
+	auto range = _nodes.equal_range(internedName);
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		std::shared_ptr<SceneNode> node = it->second.lock();
+		if (node != nullptr)
+		{
+			return node;
+		}
+	}
+	return nullptr;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+// Finds scene graph nodes by name without walking the graph.
+//
+// Node names are interned - every node with the same name points at one shared copy of the
+// string - so the index can hash and compare the pointers rather than the strings.  The index
+// only holds weak references, so it does not keep removed nodes alive.
+//
+// The index does not depend on Windows or DirectX, so it can be used on its own.
+
+class SceneNode;
+
+class SceneNameIndex
+{
+public:
+	// Returns the shared copy of name, adding it if this is the first time it has been seen.
+	// The strings are never freed, so the pointer stays valid for the life of the program.
+	static const std::wstring *				Intern(const std::wstring& name);
+	// Returns the shared copy of name, or nullptr if no node has ever had that name
+	static const std::wstring *				Lookup(const std::wstring& name);
+
+	void									Add(const std::wstring * name, const std::shared_ptr<SceneNode>& node);
+	// Also drops any entries under the name whose nodes no longer exist
+	void									Remove(const std::wstring * name, const std::shared_ptr<SceneNode>& node);
+	// Moves the node from oldName to newName.  Returns false, and changes nothing, if the node
+	// is not in the index under oldName.
+	bool									Rename(const std::wstring * oldName, const std::wstring * newName, const std::shared_ptr<SceneNode>& node);
+
+	// Returns a node with the given name, or nullptr if there is none.  If several nodes share
+	// the name, any one of them may be returned.
+	std::shared_ptr<SceneNode>				Find(const std::wstring& name) const;
+
+	inline size_t							GetCount() const { return _nodes.size(); }
+
+private:
+	std::unordered_multimap<const std::wstring *, std::weak_ptr<SceneNode>>	_nodes;
+
+	static std::mutex						_internMutex;
+	static std::unordered_set<std::wstring>	_internedNames;
+};
@@ -1,6 +1,9 @@
 #pragma once
 #include "core.h"
 #include "DirectXCore.h"
+#include "TransformHierarchy.h"
+#include "SceneNameIndex.h"
+#include <cstring>
 
 using namespace std;
 
@@ -14,26 +17,92 @@ typedef shared_ptr<SceneNode>	SceneNodePointer;
 class SceneNode : public enable_shared_from_this<SceneNode>
 {
 public:
-	SceneNode(wstring name) {_name = name; XMStoreFloat4x4(&_worldTransformation, XMMatrixIdentity()); };
+	SceneNode(wstring name) {_name = SceneNameIndex::Intern(name); XMStoreFloat4x4(&_worldTransformation, XMMatrixIdentity()); _transforms = nullptr; _transformHandle = TransformHierarchy::InvalidHandle; _transformDirty = true; };
 	~SceneNode(void) {};
 
 	// Core methods
 	virtual bool Initialise() = 0;
 	virtual void Update(FXMMATRIX& currentWorldTransformation) { XMStoreFloat4x4(&_combinedWorldTransformation, XMLoadFloat4x4(&_worldTransformation) * currentWorldTransformation); }
+	// Only calls Update if this node's transform or its parent's combined transform has changed
+	// since it was last updated.  updatedCount is increased by the number of nodes updated.
+	virtual void UpdateIfChanged(FXMMATRIX& currentWorldTransformation, bool parentChanged, unsigned int& updatedCount)
+	{
+		if (parentChanged || _transformDirty)
+		{
+			Update(currentWorldTransformation);
+			_transformDirty = false;
+			updatedCount++;
+		}
+	}
 	virtual void Render() = 0;
 	virtual void Shutdown() = 0;
 
-	void SetWorldTransform(FXMMATRIX& worldTransformation) { XMStoreFloat4x4(&_worldTransformation, worldTransformation); }
-		
+	void SetWorldTransform(FXMMATRIX& worldTransformation)
+	{
+		// Setting the same transform every frame does not mark the node as changed
+		XMFLOAT4X4 newWorldTransformation;
+		XMStoreFloat4x4(&newWorldTransformation, worldTransformation);
+		if (memcmp(&newWorldTransformation, &_worldTransformation, sizeof(XMFLOAT4X4)) == 0)
+		{
+			return;
+		}
+		_worldTransformation = newWorldTransformation;
+		_transformDirty = true;
+		if (_transforms != nullptr)
+		{
+			_transforms->SetLocalTransform(_transformHandle, worldTransformation);
+		}
+	}
+
+	// Used by FlatSceneGraph, which keeps the transforms of its nodes in a TransformHierarchy
+	// and hands each node its combined transform after updating them all together
+	void AttachTransforms(TransformHierarchy * transforms, TransformHierarchy::Handle handle)
+	{
+		_transforms = transforms;
+		_transformHandle = handle;
+		if (_transforms != nullptr)
+		{
+			_transforms->SetLocalTransform(_transformHandle, XMLoadFloat4x4(&_worldTransformation));
+		}
+	}
+	inline TransformHierarchy::Handle GetTransformHandle() const { return _transformHandle; }
+	inline void SetCombinedWorldTransform(const XMFLOAT4X4& combinedWorldTransformation) { _combinedWorldTransformation = combinedWorldTransformation; }
+
+	// Forces the node to be updated next frame, for example when it is given a new parent
+	inline void MarkTransformDirty() { _transformDirty = true; }
+
 	// Although only required in the composite class, these are provided
 	// in order to simplify the code base.
 	virtual void Add(SceneNodePointer node) {};
 	virtual void Remove(SceneNodePointer node) {};
-	virtual	SceneNodePointer Find(wstring name) { return (_name == name) ? shared_from_this() : nullptr; }
+	virtual	SceneNodePointer Find(wstring name) { return (*_name == name) ? shared_from_this() : nullptr; }
+	// Called when the node is added to (or removed from) a graph, so that composites can
+	// share the graph's name index with their own children.  Overrides must call this too.
+	virtual void SetNameIndex(shared_ptr<SceneNameIndex> nameIndex) { _indexedIn = nameIndex; };
+
+	inline const XMFLOAT4X4& GetWorldTransform() const { return _worldTransformation; }
+	inline const wstring& GetName() const { return *_name; }
+	// Also moves the node to its new name in the index of the graph it is part of
+	void SetName(wstring name)
+	{
+		const wstring * newName = SceneNameIndex::Intern(name);
+		shared_ptr<SceneNameIndex> nameIndex = _indexedIn.lock();
+		if (nameIndex != nullptr)
+		{
+			nameIndex->Rename(_name, newName, shared_from_this());
+		}
+		_name = newName;
+	}
+	inline const wstring * GetInternedName() const { return _name; }
 
 protected:
 	XMFLOAT4X4			_worldTransformation;
 	XMFLOAT4X4			_combinedWorldTransformation;
-	wstring				_name;
+	const wstring *		_name;				// Interned, so nodes with the same name share one copy
+	weak_ptr<SceneNameIndex>	_indexedIn;	// The index of the graph this node was last added to
+
+	TransformHierarchy *			_transforms;
+	TransformHierarchy::Handle		_transformHandle;
+	bool							_transformDirty;
 };
 
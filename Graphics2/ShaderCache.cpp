@@ -0,0 +1,239 @@
+#include "ShaderCache.h"
+#include "CacheFiles.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cstring>
+
+// Changing the way keys are made or the file layout must change this, so old files are not used
+static const uint32_t CacheFormatVersion = 1;
+static const char CacheFileMagic[4] = { 'S', 'H', 'D', 'C' };
+
+struct CacheFileHeader
+{
+	char					Magic[4];
+	uint32_t				Version;
+	uint64_t				Key;
+	uint64_t				Size;
+};
+
+// Finds the file names in the #include lines of some shader source
+static void FindIncludes(const char * text, size_t size, std::vector<std::string>& includes)
+{
+	size_t position = 0;
+	while (position < size)
+	{
+		size_t lineEnd = position;
+		while (lineEnd < size && text[lineEnd] != '\n')
+		{
+			lineEnd++;
+		}
+		size_t i = position;
+		while (i < lineEnd && (text[i] == ' ' || text[i] == '\t'))
+		{
+			i++;
+		}
+		if (i < lineEnd && text[i] == '#')
+		{
+			i++;
+			while (i < lineEnd && (text[i] == ' ' || text[i] == '\t'))
+			{
+				i++;
+			}
+			if (lineEnd - i > 7 && strncmp(text + i, "include", 7) == 0)
+			{
+				i += 7;
+				while (i < lineEnd && text[i] != '"' && text[i] != '<')
+				{
+					i++;
+				}
+				if (i < lineEnd)
+				{
+					char close = text[i] == '"' ? '"' : '>';
+					size_t nameStart = ++i;
+					while (i < lineEnd && text[i] != close)
+					{
+						i++;
+					}
+					if (i < lineEnd)
+					{
+						includes.push_back(std::string(text + nameStart, i - nameStart));
+					}
+				}
+			}
+		}
+		position = lineEnd + 1;
+	}
+}
+
+ShaderCache::ShaderCache(std::shared_ptr<ShaderCompiler> compiler, const std::wstring& directory)
+{
+	_compiler = compiler;
+	_directory = directory;
+	memset(&_statistics, 0, sizeof(_statistics));
+	if (!_directory.empty())
+	{
+		CreateCacheDirectory(_directory);
+	}
+}
+
+bool ShaderCache::HashFile(const std::wstring& fileName, uint64_t& hash, std::vector<std::wstring>& visited)
+{
+	MappedFile file;
+	if (!file.Open(fileName))
+	{
+		return false;
+	}
+	visited.push_back(fileName);
+	const char * text = static_cast<const char *>(file.GetData());
+	HashValue(hash, file.GetSize());
+	HashBytes(hash, text, file.GetSize());
+
+	// Included files are found relative to the file that includes them
+	size_t separator = fileName.find_last_of(L"/\\");
+	std::wstring directory = separator == std::wstring::npos ? std::wstring() : fileName.substr(0, separator + 1);
+	std::vector<std::string> includes;
+	FindIncludes(text, file.GetSize(), includes);
+	for (const std::string& include : includes)
+	{
+		std::wstring includeName = directory + std::wstring(include.begin(), include.end());
+		if (std::find(visited.begin(), visited.end(), includeName) != visited.end())
+		{
+			// Already hashed (an include guard or #pragma once stops it being included again)
+			HashString(hash, includeName);
+			continue;
+		}
+		if (!HashFile(includeName, hash, visited))
+		{
+			// The compiler will report a missing file.  Hashing the name means the key will
+			// change when the file turns up.
+			HashString(hash, includeName);
+		}
+	}
+	return true;
+}
+
+bool ShaderCache::GetKey(const ShaderCompileOptions& options, uint64_t& key)
+{
+	uint64_t hash = FnvOffsetBasis;
+	HashValue(hash, CacheFormatVersion);
+	std::vector<std::wstring> visited;
+	if (!HashFile(options.FileName, hash, visited))
+	{
+		return false;
+	}
+	HashString(hash, options.EntryPoint);
+	HashString(hash, options.Target);
+	HashValue(hash, options.Defines.size());
+	for (const ShaderDefine& define : options.Defines)
+	{
+		HashString(hash, define.Name);
+		HashString(hash, define.Value);
+	}
+	HashValue(hash, options.Flags);
+	HashString(hash, _compiler->GetVersion());
+	key = hash;
+	return true;
+}
+
+std::wstring ShaderCache::GetCacheFileName(uint64_t key) const
+{
+	return ::GetCacheFileName(_directory, key, L".cso");
+}
+
+bool ShaderCache::ReadCacheFile(uint64_t key, ShaderByteCode& byteCode)
+{
+	if (_directory.empty())
+	{
+		return false;
+	}
+	MappedFile file;
+	if (!file.Open(GetCacheFileName(key)) || file.GetSize() < sizeof(CacheFileHeader))
+	{
+		return false;
+	}
+	// Anything that does not look right (such as a file cut short) is treated as missing,
+	// and is replaced once the shader has been compiled again
+	CacheFileHeader header;
+	memcpy(&header, file.GetData(), sizeof(header));
+	if (memcmp(header.Magic, CacheFileMagic, sizeof(CacheFileMagic)) != 0 ||
+		header.Version != CacheFormatVersion ||
+		header.Key != key ||
+		header.Size != file.GetSize() - sizeof(CacheFileHeader))
+	{
+		return false;
+	}
+	const unsigned char * data = static_cast<const unsigned char *>(file.GetData()) + sizeof(CacheFileHeader);
+	byteCode.assign(data, data + header.Size);
+	return true;
+}
+
+void ShaderCache::WriteCacheFile(uint64_t key, const ShaderByteCode& byteCode)
+{
+	if (_directory.empty())
+	{
+		return;
+	}
+	CacheFileHeader header;
+	memcpy(header.Magic, CacheFileMagic, sizeof(CacheFileMagic));
+	header.Version = CacheFormatVersion;
+	header.Key = key;
+	header.Size = byteCode.size();
+	std::vector<unsigned char> contents(sizeof(header) + byteCode.size());
+	memcpy(&contents[0], &header, sizeof(header));
+	if (!byteCode.empty())
+	{
+		memcpy(&contents[sizeof(header)], &byteCode[0], byteCode.size());
+	}
+	// If the file cannot be written, the shader is just compiled again next time
+	WriteWholeFile(GetCacheFileName(key), &contents[0], contents.size());
+}
+
+std::shared_ptr<const ShaderByteCode> ShaderCache::GetByteCode(const ShaderCompileOptions& options, std::string& messages)
+{
+	// Held while compiling, so that two threads asking for the same shader do not both compile it
+	std::lock_guard<std::mutex> lock(_mutex);
+	messages.clear();
+
+	uint64_t key = 0;
+	bool keyed = GetKey(options, key);
+	if (keyed)
+	{
+		auto it = _shaders.find(key);
+		if (it != _shaders.end())
+		{
+			_statistics.MemoryHits++;
+			return it->second;
+		}
+		ShaderByteCode byteCode;
+		if (ReadCacheFile(key, byteCode))
+		{
+			_statistics.DiskHits++;
+			std::shared_ptr<const ShaderByteCode> shader = std::make_shared<const ShaderByteCode>(std::move(byteCode));
+			_shaders[key] = shader;
+			return shader;
+		}
+	}
+
+	// If the source cannot be read there is no key, but the compiler is still asked so that
+	// it can report the error
+	ShaderByteCode byteCode;
+	if (!_compiler->Compile(options, byteCode, messages))
+	{
+		_statistics.Failures++;
+		return nullptr;
+	}
+	_statistics.Compiles++;
+	std::shared_ptr<const ShaderByteCode> shader = std::make_shared<const ShaderByteCode>(std::move(byteCode));
+	if (keyed)
+	{
+		_shaders[key] = shader;
+		WriteCacheFile(key, *shader);
+	}
+	return shader;
+}
+
+ShaderCacheStatistics ShaderCache::GetStatistics()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _statistics;
+}
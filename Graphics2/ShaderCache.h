@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Keeps compiled shader byte code, so that a shader is only compiled once per process and,
+// as long as nothing it depends on changes, only once ever.
+//
+// Each shader is keyed by a hash of everything that affects its byte code: the source file,
+// every file it includes (found by following its #include lines), the defines, the entry
+// point, the target, the compile flags and the compiler's version.  Byte code is kept in memory
+// for the life of the cache and stored in the cache directory as <key>.cso.  A change to any
+// of the inputs gives a new key, so stale files are never used - they are just left behind.
+//
+// The compiling itself is done by a ShaderCompiler, so the keying and storage have no
+// dependency on Direct3D.
+
+struct ShaderDefine
+{
+	std::string								Name;
+	std::string								Value;
+};
+
+struct ShaderCompileOptions
+{
+	std::wstring							FileName;
+	std::string								EntryPoint;
+	std::string								Target;
+	std::vector<ShaderDefine>				Defines;
+	unsigned int							Flags = 0;
+};
+
+typedef std::vector<unsigned char> ShaderByteCode;
+
+class ShaderCompiler
+{
+public:
+	virtual ~ShaderCompiler() {}
+
+	// Part of every key, so that a different compiler does not use the old byte code
+	virtual std::string						GetVersion() = 0;
+	// Returns false if the shader could not be compiled.  Any messages (including warnings)
+	// are put in messages.
+	virtual bool							Compile(const ShaderCompileOptions& options, ShaderByteCode& byteCode, std::string& messages) = 0;
+};
+
+struct ShaderCacheStatistics
+{
+	unsigned int							MemoryHits;
+	unsigned int							DiskHits;
+	unsigned int							Compiles;
+	unsigned int							Failures;
+};
+
+class ShaderCache
+{
+public:
+	// The directory is created if it does not exist.  If it cannot be written to, shaders are
+	// still shared within the process.
+	ShaderCache(std::shared_ptr<ShaderCompiler> compiler, const std::wstring& directory);
+
+	// Returns null if the shader could not be compiled.  Safe to call from any thread.
+	std::shared_ptr<const ShaderByteCode>	GetByteCode(const ShaderCompileOptions& options, std::string& messages);
+
+	// The key for a shader.  Returns false if the source file cannot be read.
+	bool									GetKey(const ShaderCompileOptions& options, uint64_t& key);
+	std::wstring							GetCacheFileName(uint64_t key) const;
+
+	ShaderCacheStatistics					GetStatistics();
+
+private:
+	std::shared_ptr<ShaderCompiler>			_compiler;
+	std::wstring							_directory;
+	std::mutex								_mutex;
+	std::unordered_map<uint64_t, std::shared_ptr<const ShaderByteCode>>	_shaders;
+	ShaderCacheStatistics					_statistics;
+
+	bool									HashFile(const std::wstring& fileName, uint64_t& hash, std::vector<std::wstring>& visited);
+	bool									ReadCacheFile(uint64_t key, ShaderByteCode& byteCode);
+	void									WriteCacheFile(uint64_t key, const ShaderByteCode& byteCode);
+};
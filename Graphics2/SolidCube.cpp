@@ -5,25 +5,18 @@ SolidCube::SolidCube(wstring ObjectName) : SceneNode(ObjectName)
 	//Compile Shaders and Set Vertex Layout
 	_parentDXDevice = DirectXFramework::GetDXFramework();
 
-	DWORD shaderCompileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
 	ComPtr<ID3D10Blob> vertexCompileMessages;
 	ComPtr<ID3D10Blob> pixelCompileMessages;
 	HRESULT hr;
-	hr = D3DCompileFromFile(
-		L"shader.hlsl",
-		nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE,
-		"VS", "vs_5_0",
-		shaderCompileFlags, 0,
+	hr = _parentDXDevice->CompileShader(
+		L"shader.hlsl", "VS", "vs_5_0",
 		vertexShaderByteCode.GetAddressOf(),
 		vertexCompileMessages.GetAddressOf()
 	);
 	ThrowIfFailed(hr);
 
-	hr = D3DCompileFromFile(
-		L"shader.hlsl",
-		nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE,
-		"PS", "ps_5_0",
-		shaderCompileFlags, 0,
+	hr = _parentDXDevice->CompileShader(
+		L"shader.hlsl", "PS", "ps_5_0",
 		pixelShaderByteCode.GetAddressOf(),
 		pixelCompileMessages.GetAddressOf()
 	);
@@ -0,0 +1,100 @@
+#include "StaticBatcher.h"
+
+using namespace DirectX;
+
+StaticBatcher::StaticBatcher()
+{
+	_batch = std::make_shared<ModelData>();
+	_batch->RootNode = std::make_shared<Node>();
+	_batch->RootNode->SetName(L"StaticBatch");
+	_batch->OptimisationStatistics = {};
+	_statistics = {};
+}
+
+bool StaticBatcher::AddPlacement(std::shared_ptr<const ModelData> model, FXMMATRIX worldTransformation)
+{
+	if (model == nullptr || model->Materials.empty() || model->RootNode == nullptr)
+	{
+		return false;
+	}
+	_statistics.PlacementCount++;
+	if (_sourceModels.find(model.get()) == _sourceModels.end())
+	{
+		// Kept so that the same model read twice is not counted twice
+		_sourceModels[model.get()] = model;
+		for (const ModelSubMeshData& subMesh : model->SubMeshes)
+		{
+			_statistics.SourceVertexBytes += subMesh.GetVertexCount() * sizeof(VERTEX);
+			_statistics.SourceIndexBytes += subMesh.GetIndexCount() * sizeof(unsigned int);
+		}
+	}
+	AddNode(*model, *model->RootNode, worldTransformation);
+	return true;
+}
+
+void StaticBatcher::AddNode(const ModelData& model, Node& node, FXMMATRIX parentTransformation)
+{
+	XMMATRIX nodeTransformation = XMLoadFloat4x4(&node.GetTransformation()) * parentTransformation;
+	for (unsigned int i = 0; i < node.GetMeshCount(); i++)
+	{
+		unsigned int meshIndex = node.GetMesh(i);
+		if (meshIndex < model.SubMeshes.size())
+		{
+			AddSubMesh(model, model.SubMeshes[meshIndex], nodeTransformation);
+		}
+	}
+	for (unsigned int i = 0; i < node.GetChildrenCount(); i++)
+	{
+		AddNode(model, *node.GetChild(i), nodeTransformation);
+	}
+}
+
+void StaticBatcher::AddSubMesh(const ModelData& model, const ModelSubMeshData& subMesh, FXMMATRIX transformation)
+{
+	_statistics.DrawsBefore++;
+	const ModelMaterialData& material = model.Materials[subMesh.MaterialIndex < model.Materials.size() ? subMesh.MaterialIndex : 0];
+	std::map<std::wstring, unsigned int>::iterator it = _materialSubMeshes.find(material.Name);
+	if (it == _materialSubMeshes.end())
+	{
+		ModelSubMeshData batchSubMesh;
+		batchSubMesh.MaterialIndex = static_cast<unsigned int>(_batch->Materials.size());
+		_batch->Materials.push_back(material);
+		it = _materialSubMeshes.insert({ material.Name, static_cast<unsigned int>(_batch->SubMeshes.size()) }).first;
+		_batch->RootNode->AddMesh(it->second);
+		_batch->SubMeshes.push_back(batchSubMesh);
+		_statistics.DrawsAfter++;
+	}
+	ModelSubMeshData& batchSubMesh = _batch->SubMeshes[it->second];
+
+	// Normals are transformed by the inverse transpose so that they stay at right angles to
+	// surfaces that have been scaled unevenly
+	XMVECTOR determinant;
+	XMMATRIX normalTransformation = XMMatrixTranspose(XMMatrixInverse(&determinant, transformation));
+	bool mirrored = XMVectorGetX(determinant) < 0.0f;
+
+	unsigned int firstVertex = static_cast<unsigned int>(batchSubMesh.Vertices.size());
+	const VERTEX * vertices = subMesh.GetVertices();
+	const unsigned int * indices = subMesh.GetIndices();
+	size_t indexCount = subMesh.GetIndexCount();
+	for (size_t i = 0; i < subMesh.GetVertexCount(); i++)
+	{
+		const VERTEX& vertex = vertices[i];
+		VERTEX transformed = vertex;
+		XMStoreFloat3(&transformed.Position, XMVector3TransformCoord(XMLoadFloat3(&vertex.Position), transformation));
+		XMStoreFloat3(&transformed.Normal, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&vertex.Normal), normalTransformation)));
+		batchSubMesh.Vertices.push_back(transformed);
+	}
+	for (size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		batchSubMesh.Indices.push_back(firstVertex + indices[i]);
+		batchSubMesh.Indices.push_back(firstVertex + indices[mirrored ? i + 2 : i + 1]);
+		batchSubMesh.Indices.push_back(firstVertex + indices[mirrored ? i + 1 : i + 2]);
+	}
+	_statistics.BatchedVertexBytes += subMesh.GetVertexCount() * sizeof(VERTEX);
+	_statistics.BatchedIndexBytes += (indexCount / 3 * 3) * sizeof(unsigned int);
+}
+
+std::shared_ptr<ModelData> StaticBatcher::Build()
+{
+	return _batch;
+}
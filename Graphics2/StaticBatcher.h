@@ -0,0 +1,57 @@
+#pragma once
+#include "ModelData.h"
+#include <map>
+
+// Merges models that are placed once and never moved into a single model, so that they can be
+// drawn with one draw per material rather than one for every sub-mesh of every placement.
+//
+// Each placement's vertices are transformed by its node transformations and its world
+// transformation, then appended to the sub-mesh for its material.  Materials are matched by
+// name, as ResourceManager does.  Placements that are mirrored have their triangles turned
+// round so they still face the right way.  The merged model has a single root node with no
+// transformation, so it is drawn with the world transformation of whatever holds the batch.
+//
+// The geometry is copied for every placement, so placing the same model many times uses more
+// memory than drawing it many times.  The statistics give both sides of that trade.
+
+struct StaticBatchPlacement
+{
+	std::wstring						ModelName;
+	DirectX::XMFLOAT4X4					WorldTransformation;
+};
+
+struct StaticBatchStatistics
+{
+	unsigned int						PlacementCount;
+	// The draws the placements would make if drawn on their own, and those the batch makes
+	unsigned int						DrawsBefore;
+	unsigned int						DrawsAfter;
+	// Sizes as VERTEX structures and 32-bit indices, before VertexPacker packs them.  The
+	// source sizes count each model once, however often it is placed.
+	size_t								SourceVertexBytes;
+	size_t								SourceIndexBytes;
+	size_t								BatchedVertexBytes;
+	size_t								BatchedIndexBytes;
+};
+
+class StaticBatcher
+{
+public:
+	StaticBatcher();
+
+	// Models without materials are left out, since MeshRenderer cannot draw them.  Returns
+	// whether the placement was merged.
+	bool								AddPlacement(std::shared_ptr<const ModelData> model, DirectX::FXMMATRIX worldTransformation);
+	// The merged model, with one sub-mesh for each material used
+	std::shared_ptr<ModelData>			Build();
+	inline const StaticBatchStatistics&	GetStatistics() const { return _statistics; }
+
+private:
+	std::shared_ptr<ModelData>			_batch;
+	std::map<std::wstring, unsigned int>	_materialSubMeshes;		// Material name to sub-mesh in _batch
+	std::map<const ModelData *, std::shared_ptr<const ModelData>>	_sourceModels;
+	StaticBatchStatistics				_statistics;
+
+	void								AddNode(const ModelData& model, Node& node, DirectX::FXMMATRIX parentTransformation);
+	void								AddSubMesh(const ModelData& model, const ModelSubMeshData& subMesh, DirectX::FXMMATRIX transformation);
+};
@@ -0,0 +1,62 @@
+#include "StaticMeshGroup.h"
+#include "MeshNode.h"
+
+bool StaticMeshGroup::Initialise(void)
+{
+	_resourceManager = DirectXFramework::GetDXFramework()->GetResourceManager();
+	_renderer = dynamic_pointer_cast<MeshRenderer>(_resourceManager->GetRenderer(L"PNT"));
+	if (!_renderer->Initialise())
+	{
+		return false;
+	}
+
+	// The placements are in the group's space, so only the MeshNodes' own transforms are used
+	vector<StaticBatchPlacement> placements;
+	vector<SceneNodePointer> placedNodes;
+	for (const SceneNodePointer& child : _children)
+	{
+		shared_ptr<MeshNode> meshNode = dynamic_pointer_cast<MeshNode>(child);
+		if (meshNode != nullptr)
+		{
+			placements.push_back({ meshNode->GetModelName(), meshNode->GetWorldTransform() });
+			placedNodes.push_back(child);
+		}
+	}
+	vector<bool> batched;
+	if (!placements.empty())
+	{
+		_batch = _resourceManager->CreateStaticBatch(placements, _batchStatistics, batched);
+	}
+
+	// The merged nodes are taken out of the list of children so they are not drawn twice.  Any
+	// that could not be merged stay, and are drawn on their own.
+	for (size_t i = 0; i < placedNodes.size() && _batch != nullptr; i++)
+	{
+		if (batched[i])
+		{
+			_batchedNodes.push_back(placedNodes[i]);
+			_children.remove(placedNodes[i]);
+		}
+	}
+	return SceneGraph::Initialise();
+}
+
+void StaticMeshGroup::Render(void)
+{
+	SceneGraph::Render();
+	if (_batch != nullptr)
+	{
+		_resourceManager->AddMeshInstance(_batch, XMLoadFloat4x4(&_combinedWorldTransformation));
+	}
+}
+
+void StaticMeshGroup::Shutdown(void)
+{
+	SceneGraph::Shutdown();
+	// Gives the batch's materials back, and its ranges back to the geometry arena
+	if (_batch != nullptr)
+	{
+		_resourceManager->ReleaseStaticBatch(_batch);
+		_batch = nullptr;
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "SceneGraph.h"
+#include "DirectXFramework.h"
+#include "MeshRenderer.h"
+#include "StaticBatcher.h"
+#include <vector>
+
+// A SceneGraph for meshes that are placed once and never moved, such as buildings and props.
+// When the group is initialised, the MeshNodes added directly to it are merged into one mesh
+// in the group's space (see StaticBatcher.h), which is drawn with one draw per material.  The
+// group itself can still be placed with SetWorldTransform.
+//
+// The merged MeshNodes are not initialised or rendered, so moving or removing them afterwards
+// has no effect.  Any other nodes in the group are initialised and rendered as in a SceneGraph,
+// as are MeshNodes whose models cannot be merged (see StaticBatcher::AddPlacement).
+
+class StaticMeshGroup : public SceneGraph
+{
+public:
+	StaticMeshGroup(wstring name) : SceneGraph(name) {};
+
+	virtual bool Initialise(void);
+	virtual void Render(void);
+	virtual void Shutdown(void);
+
+	// The draws saved and the memory used by merging
+	inline const StaticBatchStatistics& GetBatchStatistics() const { return _batchStatistics; }
+
+private:
+	shared_ptr<ResourceManager>		_resourceManager;
+	shared_ptr<MeshRenderer>		_renderer;
+	shared_ptr<Mesh>				_batch;
+	// Kept so that they can still be found by name
+	std::vector<SceneNodePointer>	_batchedNodes;
+	StaticBatchStatistics			_batchStatistics = {};
+};
@@ -0,0 +1,94 @@
+#include "SubMeshSelector.h"
+
+using namespace DirectX;
+
+void SubMeshSelector::Classify(const std::vector<float>& opacities, const std::vector<MeshBounds>& subMeshBounds)
+{
+	_transparent.assign(opacities.size(), false);
+	_opaqueSubMeshes.clear();
+	_transparentSubMeshes.clear();
+	_centres.assign(opacities.size(), XMFLOAT3(0.0f, 0.0f, 0.0f));
+	for (unsigned int meshIndex = 0; meshIndex < opacities.size(); meshIndex++)
+	{
+		if (opacities[meshIndex] < 1.0f)
+		{
+			_transparent[meshIndex] = true;
+			_transparentSubMeshes.push_back(meshIndex);
+		}
+		else
+		{
+			_opaqueSubMeshes.push_back(meshIndex);
+		}
+		if (meshIndex < subMeshBounds.size() && !subMeshBounds[meshIndex].IsEmpty())
+		{
+			_centres[meshIndex] = subMeshBounds[meshIndex].Centre;
+		}
+	}
+}
+
+bool SubMeshSelector::IsSelected(unsigned int meshIndex, SubMeshSelection selection) const
+{
+	if (meshIndex >= _transparent.size())
+	{
+		return false;
+	}
+	bool transparent = _transparent[meshIndex];
+	return !((selection == SubMeshSelection::Opaque && transparent) || (selection == SubMeshSelection::Transparent && !transparent));
+}
+
+float SubMeshSelector::GetDepth(FXMMATRIX completeTransformation, const XMFLOAT3& position)
+{
+	return XMVectorGetZ(XMVector3TransformCoord(XMLoadFloat3(&position), completeTransformation));
+}
+
+void SubMeshSelector::AddDraws(const std::vector<unsigned int>& meshIndices, FXMMATRIX nodeTransformation, CXMMATRIX viewProjection,
+							   const XMFLOAT4X4 * instances, unsigned int instanceCount, SubMeshSelection selection, std::vector<SubMeshDraw>& draws) const
+{
+	if (instanceCount == 0)
+	{
+		return;
+	}
+	bool instanced = instanceCount > 1;
+	XMMATRIX firstWorld = XMLoadFloat4x4(&instances[0]);
+	// The opaque sub-meshes are ordered by the object's origin, as the first instance places it
+	float objectDepth = GetDepth(firstWorld * viewProjection);
+	for (unsigned int meshIndex : meshIndices)
+	{
+		if (!IsSelected(meshIndex, selection))
+		{
+			continue;
+		}
+		SubMeshDraw draw;
+		draw.MeshIndex = meshIndex;
+		draw.Transparent = _transparent[meshIndex];
+		if (!draw.Transparent)
+		{
+			draw.Instanced = instanced;
+			draw.Depth = objectDepth;
+			if (instanced)
+			{
+				XMStoreFloat4x4(&draw.WorldTransformation, nodeTransformation);
+				XMStoreFloat4x4(&draw.CompleteTransformation, viewProjection);
+			}
+			else
+			{
+				XMMATRIX world = nodeTransformation * firstWorld;
+				XMStoreFloat4x4(&draw.WorldTransformation, world);
+				XMStoreFloat4x4(&draw.CompleteTransformation, world * viewProjection);
+			}
+			draws.push_back(draw);
+			continue;
+		}
+		// A blended sub-mesh is drawn on its own for each instance, ordered by the centre of its bounds
+		draw.Instanced = false;
+		for (unsigned int instance = 0; instance < instanceCount; instance++)
+		{
+			XMMATRIX world = nodeTransformation * XMLoadFloat4x4(&instances[instance]);
+			XMMATRIX complete = world * viewProjection;
+			draw.Depth = GetDepth(complete, _centres[meshIndex]);
+			XMStoreFloat4x4(&draw.WorldTransformation, world);
+			XMStoreFloat4x4(&draw.CompleteTransformation, complete);
+			draws.push_back(draw);
+		}
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "MeshBounds.h"
+#include <vector>
+
+// Which of a mesh's sub-meshes MeshRenderer submits, and the depth each draw is sorted by.  It
+// does not need a device, so the order the render queue ends up with can be checked in the tests.
+//
+// Each sub-mesh is classified as opaque or transparent once, when the mesh is loaded.  Opaque
+// sub-meshes are sorted by the depth of the object's origin and can be drawn instanced.  Blended
+// sub-meshes have to be drawn back to front one at a time, so each one is sorted by the depth of
+// the centre of its own bounds, and is drawn once for each instance of an instanced mesh.
+
+// Which of a mesh's sub-meshes are drawn
+enum class SubMeshSelection
+{
+	All,
+	Opaque,
+	Transparent
+};
+
+// One draw of a sub-mesh
+struct SubMeshDraw
+{
+	unsigned int			MeshIndex;
+	bool					Transparent;
+	// Set for the opaque sub-meshes of an instanced mesh, which are drawn once for every instance
+	bool					Instanced;
+	// 0 at the near plane, 1 at the far plane
+	float					Depth;
+	// Node space to world space.  For an instanced draw, node space to object space, since the
+	// shader applies each instance's transformation after it.
+	DirectX::XMFLOAT4X4		WorldTransformation;
+	// Node space to clip space.  For an instanced draw, world space to clip space.
+	DirectX::XMFLOAT4X4		CompleteTransformation;
+};
+
+class SubMeshSelector
+{
+public:
+	// Classifies each sub-mesh from its material's opacity.  Called once when the mesh is loaded;
+	// drawing the mesh never looks at the materials' opacity again.
+	void							Classify(const std::vector<float>& opacities, const std::vector<MeshBounds>& subMeshBounds);
+
+	inline bool						IsTransparent(unsigned int meshIndex) const { return _transparent[meshIndex]; }
+	inline bool						HasTransparentSubMeshes() const { return !_transparentSubMeshes.empty(); }
+	inline const std::vector<unsigned int>&	GetOpaqueSubMeshes() const { return _opaqueSubMeshes; }
+	inline const std::vector<unsigned int>&	GetTransparentSubMeshes() const { return _transparentSubMeshes; }
+	bool							IsSelected(unsigned int meshIndex, SubMeshSelection selection) const;
+
+	// The depth of a point in object space
+	static float					GetDepth(DirectX::FXMMATRIX completeTransformation, const DirectX::XMFLOAT3& position = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f));
+
+	// Adds the draws of the sub-meshes of one node (as visited by NodeCuller) to draws.
+	// nodeTransformation takes the node to object space and viewProjection takes world space to
+	// clip space.  instances are the world transformations the mesh is drawn with.  With more
+	// than one, the opaque sub-meshes are drawn once, instanced, ordered by the first instance,
+	// and each transparent sub-mesh once for each instance, all in the same walk of the nodes.
+	void							AddDraws(const std::vector<unsigned int>& meshIndices, DirectX::FXMMATRIX nodeTransformation, DirectX::CXMMATRIX viewProjection,
+											 const DirectX::XMFLOAT4X4 * instances, unsigned int instanceCount, SubMeshSelection selection, std::vector<SubMeshDraw>& draws) const;
+
+private:
+	std::vector<bool>				_transparent;
+	std::vector<unsigned int>		_opaqueSubMeshes;
+	std::vector<unsigned int>		_transparentSubMeshes;
+	std::vector<DirectX::XMFLOAT3>	_centres;
+};
@@ -0,0 +1,147 @@
+#include "TerrainGrid.h"
+#include "HeightfieldNormals.h"
+#include <algorithm>
+
+using namespace DirectX;
+
+TerrainGrid::TerrainGrid(int size, float cellSize, float maxHeight)
+{
+	_size = size;
+	_cellSize = cellSize;
+	_maxHeight = maxHeight;
+	_buildIndices = true;
+}
+
+void TerrainGrid::Build(const HeightMap& heightMap, ThreadPool * threadPool)
+{
+	// Allocate everything up front so that each row band can write straight into place
+	int verticesPerRow = GetVerticesPerRow();
+	size_t vertexCount = static_cast<size_t>(verticesPerRow) * verticesPerRow;
+	_heights.resize(vertexCount);
+	_vertices.resize(vertexCount);
+
+	// Normals need the heights of the rows either side, so all of the heights
+	// must be sampled before any vertices are built
+	ForEachRowBand(verticesPerRow, threadPool, [this, &heightMap](int firstRow, int lastRow)
+	{
+		SampleHeights(heightMap, firstRow, lastRow);
+	});
+	ForEachRowBand(verticesPerRow, threadPool, [this](int firstRow, int lastRow)
+	{
+		BuildVertices(firstRow, lastRow);
+	});
+
+	// The index pattern only depends on the size of the grid, so it only
+	// needs to be created the first time we build
+	if (_buildIndices && _indices.empty())
+	{
+		_indices.resize(static_cast<size_t>(_size) * _size * 6);
+		ForEachRowBand(_size, threadPool, [this](int firstRow, int lastRow)
+		{
+			BuildIndices(firstRow, lastRow);
+		});
+	}
+}
+
+void TerrainGrid::ReleaseHeights()
+{
+	std::vector<float>().swap(_heights);
+}
+
+void TerrainGrid::ForEachRowBand(int rowCount, ThreadPool * threadPool, const std::function<void(int, int)>& task)
+{
+	if (threadPool == nullptr)
+	{
+		task(0, rowCount);
+		return;
+	}
+	threadPool->ParallelFor(static_cast<unsigned int>(rowCount), [&task](unsigned int begin, unsigned int end)
+	{
+		task(static_cast<int>(begin), static_cast<int>(end));
+	});
+}
+
+void TerrainGrid::SampleHeights(const HeightMap& heightMap, int firstRow, int lastRow)
+{
+	int verticesPerRow = GetVerticesPerRow();
+
+	int heightMapWidth = heightMap.GetWidth();
+	if (!heightMap.IsLoaded())
+	{
+		// No height map loaded, so the terrain is flat
+		std::fill(_heights.begin() + static_cast<size_t>(firstRow) * verticesPerRow,
+				  _heights.begin() + static_cast<size_t>(lastRow) * verticesPerRow,
+				  0.0f);
+		return;
+	}
+	for (int z = firstRow; z < lastRow; z++)
+	{
+		int heightMapZ = std::min(static_cast<int>((static_cast<long long>(z) * heightMapWidth) / _size), heightMapWidth - 1);
+		float * heightRow = &_heights[static_cast<size_t>(z) * verticesPerRow];
+		for (int x = 0; x < verticesPerRow; x++)
+		{
+			int heightMapX = std::min(static_cast<int>((static_cast<long long>(x) * heightMapWidth) / _size), heightMapWidth - 1);
+			heightRow[x] = heightMap.GetHeight(heightMapX, heightMapZ) * _maxHeight;
+		}
+	}
+}
+
+void TerrainGrid::BuildVertices(int firstRow, int lastRow)
+{
+	int verticesPerRow = GetVerticesPerRow();
+
+	// The grid is centred on the origin, with rows running from +z to -z
+	float totalWidth = _cellSize * _size;
+	float xOffset = -totalWidth / 2;
+	float zOffset = totalWidth / 2;
+	float uvStep = 1.0f / _size;
+
+	// Normals for one row at a time, worked out together so that they can use SIMD
+	std::vector<XMFLOAT3> normals(verticesPerRow);
+
+	for (int z = firstRow; z < lastRow; z++)
+	{
+		// Rows either side of this vertex, clamped at the edges of the grid
+		int above = z > 0 ? z - 1 : z;
+		int below = z < _size ? z + 1 : z;
+		const float * row = &_heights[static_cast<size_t>(z) * verticesPerRow];
+		ComputeNormalRow(&_heights[static_cast<size_t>(above) * verticesPerRow], row,
+						 &_heights[static_cast<size_t>(below) * verticesPerRow],
+						 verticesPerRow, _cellSize, below - above, &normals[0]);
+
+		VERTEX * vertex = &_vertices[static_cast<size_t>(z) * verticesPerRow];
+		for (int x = 0; x < verticesPerRow; x++)
+		{
+			vertex->Position = XMFLOAT3(x * _cellSize + xOffset, row[x], zOffset - z * _cellSize);
+			vertex->Normal = normals[x];
+			vertex->TexCoord = XMFLOAT2(x * uvStep, z * uvStep);
+			vertex++;
+		}
+	}
+}
+
+void TerrainGrid::BuildIndices(int firstRow, int lastRow)
+{
+	unsigned int verticesPerRow = static_cast<unsigned int>(GetVerticesPerRow());
+
+	unsigned int * index = &_indices[static_cast<size_t>(firstRow) * _size * 6];
+	for (unsigned int z = static_cast<unsigned int>(firstRow); z < static_cast<unsigned int>(lastRow); z++)
+	{
+		for (unsigned int x = 0; x < static_cast<unsigned int>(_size); x++)
+		{
+			// Corners of the cell, with 0 top left and 3 bottom right
+			unsigned int corner0 = z * verticesPerRow + x;
+			unsigned int corner1 = corner0 + 1;
+			unsigned int corner2 = corner0 + verticesPerRow;
+			unsigned int corner3 = corner2 + 1;
+
+			*index++ = corner0;
+			*index++ = corner1;
+			*index++ = corner2;
+
+			*index++ = corner2;
+			*index++ = corner1;
+			*index++ = corner3;
+		}
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "Vertex.h"
+#include "ThreadPool.h"
+#include "HeightMap.h"
+#include <vector>
+
+// Builds the vertex and index data for a regular terrain grid.  A grid of size x size cells
+// has (size + 1) x (size + 1) vertices, each one shared by up to four cells, and six indices
+// per cell.  Normals are calculated per vertex from the neighbouring heights.
+//
+// This class does not need a DirectX device, so the grid can be built and timed on its own.
+// Every row of the grid is independent, so if a thread pool is given the rows are split into
+// bands that are built in parallel.  The output is identical whichever way it is built.
+
+class TerrainGrid
+{
+public:
+	TerrainGrid(int size, float cellSize, float maxHeight);
+
+	// Build the vertices from a height map.  The height map does not have to match the grid
+	// size - it is sampled at the nearest point.  If it is not loaded, the terrain is flat.
+	void									Build(const HeightMap& heightMap, ThreadPool * threadPool = nullptr);
+
+	// The full resolution index list can be skipped when the caller builds its own (for example
+	// the per chunk lists of TerrainQuadTree)
+	inline void								SetBuildIndices(bool buildIndices) { _buildIndices = buildIndices; }
+	// The heights are only needed while building.  A grid that is built once (such as a streamed
+	// terrain tile) can free them afterwards; they are allocated again by the next Build.
+	void									ReleaseHeights();
+
+	inline int								GetSize() const { return _size; }
+	inline int								GetVerticesPerRow() const { return _size + 1; }
+	inline const std::vector<VERTEX>&		GetVertices() const { return _vertices; }
+	inline const std::vector<unsigned int>&	GetIndices() const { return _indices; }
+	inline unsigned int						GetVertexCount() const { return static_cast<unsigned int>(_vertices.size()); }
+	inline unsigned int						GetIndexCount() const { return static_cast<unsigned int>(_indices.size()); }
+	inline size_t							GetMemoryUsed() const { return _heights.capacity() * sizeof(float) + _vertices.capacity() * sizeof(VERTEX) + _indices.capacity() * sizeof(unsigned int); }
+
+private:
+	int										_size;
+	float									_cellSize;
+	float									_maxHeight;
+	bool									_buildIndices;
+
+	std::vector<float>						_heights;
+	std::vector<VERTEX>						_vertices;
+	std::vector<unsigned int>				_indices;
+
+	void									SampleHeights(const HeightMap& heightMap, int firstRow, int lastRow);
+	void									BuildVertices(int firstRow, int lastRow);
+	void									BuildIndices(int firstRow, int lastRow);
+	void									ForEachRowBand(int rowCount, ThreadPool * threadPool, const std::function<void(int, int)>& task);
+};
@@ -1,26 +1,7 @@
 #include "TerrainNode.h"
 #include <DirectXMath.h>
-#include <ios>
-#include <fstream>
 
 
-struct CBUFFER
-{
-	XMMATRIX    CompleteTransformation;
-	XMMATRIX	WorldTransformation;
-	XMFLOAT4	CameraPosition;
-	XMVECTOR    LightVector;
-	XMFLOAT4    LightColor;
-	XMFLOAT4    AmbientColor;
-	XMFLOAT4    DiffuseCoefficient;
-	XMFLOAT4	SpecularCoefficient;
-	float		Shininess;
-	float		Opacity;
-	float       Padding[2];
-};
-
-CBUFFER currentCBuffer;
-
 TerrainNode::TerrainNode(wstring ObjectName) : SceneNode(ObjectName)
 {
 	_parentDXDevice = DirectXFramework::GetDXFramework();
@@ -34,46 +15,145 @@ TerrainNode::TerrainNode(wstring ObjectName) : SceneNode(ObjectName)
 	CreateMesh();
 }
 
+TerrainNode::TerrainNode(wstring ObjectName, const TerrainTileSettings& tileSettings) : SceneNode(ObjectName)
+{
+	_parentDXDevice = DirectXFramework::GetDXFramework();
+	SetWorldTransform(XMMatrixIdentity());
+	BuildRenderState();
+
+	BuildShaders();
+	BuildVertexLayout();
+	BuildConstantBuffer();
+
+	//Tiles are loaded and built on the cache's own thread as the camera moves
+	Size = tileSettings.TileSize;
+	cellSize = tileSettings.CellSize;
+	maxHeight = tileSettings.MaxHeight;
+	_tileCache = make_shared<TerrainTileCache>(tileSettings);
+	CreateTileIndexBuffer();
+}
+
 void TerrainNode::Render()
 {
 	ComPtr<ID3D11Device> Device = _parentDXDevice->GetDevice();
-	ComPtr<ID3D11DeviceContext> DeviceContext = _parentDXDevice->GetDeviceContext();
 
 	XMMATRIX projectionTransformation = DirectXFramework::GetDXFramework()->GetProjectionTransformation();
 	XMMATRIX viewTransformation = DirectXFramework::GetDXFramework()->GetCamera()->GetViewMatrix();
 
 	XMMATRIX completeTransformation = XMLoadFloat4x4(&_worldTransformation) * viewTransformation * projectionTransformation;
-	currentCBuffer.CompleteTransformation = completeTransformation;
-	currentCBuffer.WorldTransformation = XMLoadFloat4x4(&_worldTransformation);
-
-	XMFLOAT4 CamPos;
-	XMStoreFloat4(&CamPos, DirectXFramework::GetDXFramework()->GetCamera()->GetCameraPosition());
-
-	currentCBuffer.CameraPosition = CamPos;
-	currentCBuffer.LightVector = XMVector4Normalize(XMVectorSet(-1.0f, -1.0f, 0.0f, 0.0f));
-	currentCBuffer.LightColor = XMFLOAT4(0.75f, 0.75f, 0.75f, 1.0f);
-	currentCBuffer.AmbientColor = XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f);
-	currentCBuffer.DiffuseCoefficient = XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f);
-	currentCBuffer.SpecularCoefficient = XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f);
-	currentCBuffer.Shininess = 1.0f;
-	currentCBuffer.Opacity = 1;
-
-	
-	DeviceContext->VSSetShader(vertexShader.Get(),0,0);
-	DeviceContext->PSSetShader(pixelShader.Get(),0,0);
-	DeviceContext->IASetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
-	UINT stride = sizeof(VERTEX);
-	UINT offset = 0;
-	DeviceContext->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
-	DeviceContext->IASetInputLayout(vertexInputLayout.Get());
-	DeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
-
-	DeviceContext->VSSetConstantBuffers(0, 1, constantBuffer.GetAddressOf());
-	DeviceContext->PSSetConstantBuffers(0, 1, constantBuffer.GetAddressOf());
-	DeviceContext->UpdateSubresource(constantBuffer.Get(), 0, 0, &currentCBuffer, 0, 0);
-
-	DeviceContext->DrawIndexed(IndeciesCount, 0, 0);
+
+	//The draws are made when the framework flushes the render queue
+	RenderQueue& renderQueue = *_parentDXDevice->GetRenderQueue();
+	DrawPacket packet = {};
+	packet.SortKey = RenderQueue::MakeSortKey(false, _pipeline.SortId.Get(), _materialSortId.Get(), 0.0f);
+	packet.Pipeline = &_pipeline;
+	packet.MaterialConstantBuffer = materialConstantBuffer.Get();
+	packet.IndexBuffer = indexBuffer.Get();
+	packet.VertexStride = sizeof(VERTEX);
+	packet.IndexSize = sizeof(UINT);
+
+	if (_tileCache)
+	{
+		RenderTiles(viewTransformation * projectionTransformation, packet);
+		return;
+	}
+
+	ObjectConstants objectConstants;
+	XMStoreFloat4x4(&objectConstants.CompleteTransformation, completeTransformation);
+	objectConstants.WorldTransformation = _worldTransformation;
+
+	//Only draw the chunks that can be seen, each at a level of detail that suits its distance.
+	//The frustum and camera are moved into the terrain's own space to match the chunk bounds.
+	XMMATRIX worldTransformation = XMLoadFloat4x4(&_worldTransformation);
+	Frustum frustum(completeTransformation);
+	XMFLOAT3 localCameraPosition;
+	XMStoreFloat3(&localCameraPosition, XMVector3TransformCoord(
+		DirectXFramework::GetDXFramework()->GetCamera()->GetCameraPosition(),
+		XMMatrixInverse(nullptr, worldTransformation)));
+
+	XMFLOAT4X4 projection;
+	XMStoreFloat4x4(&projection, projectionTransformation);
+	float errorScale = _parentDXDevice->GetWindowHeight() * 0.5f * projection._22;
+
+	_quadTree->Select(frustum, localCameraPosition, errorScale, _chunkDraws);
+	packet.VertexBuffer = vertexBuffer.Get();
+	for (const TerrainChunkDraw& draw : _chunkDraws)
+	{
+		packet.IndexCount = draw.IndexCount;
+		packet.StartIndex = draw.StartIndex;
+		renderQueue.Submit(packet, &objectConstants, sizeof(ObjectConstants));
+	}
+}
+
+void TerrainNode::RenderTiles(const XMMATRIX& viewProjection, DrawPacket& packet)
+{
+	RenderQueue& renderQueue = *_parentDXDevice->GetRenderQueue();
+
+	//Tile positions and bounds are in the terrain's own space, so the camera is moved into it
+	XMMATRIX worldTransformation = XMLoadFloat4x4(&_worldTransformation);
+	Frustum frustum(worldTransformation * viewProjection);
+	XMFLOAT3 localCameraPosition;
+	XMStoreFloat3(&localCameraPosition, XMVector3TransformCoord(
+		DirectXFramework::GetDXFramework()->GetCamera()->GetCameraPosition(),
+		XMMatrixInverse(nullptr, worldTransformation)));
+
+	_tileCache->Update(localCameraPosition);
+
+	//Create vertex buffers for tiles that have just arrived and release the ones for
+	//tiles that are no longer near the camera
+	std::unordered_map<TerrainTile*, TileBuffer> tileBuffers;
+	for (const shared_ptr<TerrainTile>& tile : _tileCache->GetVisibleTiles())
+	{
+		auto it = _tileBuffers.find(tile.get());
+		if (it != _tileBuffers.end())
+		{
+			tileBuffers[tile.get()] = it->second;
+			continue;
+		}
+
+		const std::vector<VERTEX>& vVector = tile->Grid->GetVertices();
+
+		D3D11_BUFFER_DESC vertexBufferDescriptor;
+		vertexBufferDescriptor.Usage = D3D11_USAGE_IMMUTABLE;
+		vertexBufferDescriptor.ByteWidth = sizeof(VERTEX) * static_cast<UINT>(vVector.size());
+		vertexBufferDescriptor.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		vertexBufferDescriptor.CPUAccessFlags = 0;
+		vertexBufferDescriptor.MiscFlags = 0;
+		vertexBufferDescriptor.StructureByteStride = 0;
+
+		D3D11_SUBRESOURCE_DATA vertexInitialisationData;
+		vertexInitialisationData.pSysMem = &vVector[0];
+
+		TileBuffer tileBuffer;
+		tileBuffer.Tile = tile;
+		ThrowIfFailed(
+			_parentDXDevice->GetDevice()->CreateBuffer(
+				&vertexBufferDescriptor, &vertexInitialisationData,
+				tileBuffer.VertexBuffer.GetAddressOf()
+			)
+		);
+		tileBuffers[tile.get()] = tileBuffer;
+	}
+	_tileBuffers.swap(tileBuffers);
+
+	//The tiles' buffers are kept until the next frame, so they outlive the queued draws
+	packet.IndexCount = IndeciesCount;
+	for (auto& entry : _tileBuffers)
+	{
+		const TerrainTile& tile = *entry.second.Tile;
+		if (!frustum.IntersectsBox(tile.BoundsMin, tile.BoundsMax))
+		{
+			continue;
+		}
+
+		XMMATRIX tileWorldTransformation = XMMatrixTranslation(tile.Origin.x, tile.Origin.y, tile.Origin.z) * worldTransformation;
+		ObjectConstants objectConstants;
+		XMStoreFloat4x4(&objectConstants.CompleteTransformation, tileWorldTransformation * viewProjection);
+		XMStoreFloat4x4(&objectConstants.WorldTransformation, tileWorldTransformation);
+
+		packet.VertexBuffer = entry.second.VertexBuffer.Get();
+		renderQueue.Submit(packet, &objectConstants, sizeof(ObjectConstants));
+	}
 }
 
 void TerrainNode::BuildRenderState()
@@ -98,122 +178,26 @@ void TerrainNode::BuildRenderState()
 
 void TerrainNode::CreateMesh()
 {
-	std::vector<VERTEX> vVector;
-	std::vector<UINT> iVector;
-
-	//Find How many square in the mesh
-	int SquareCount = Size * Size ; //Total amount of sqaures. 
-	
-	float TotalWidth = cellSize * Size;
-
-	for (int square = 0; square < SquareCount; square++)
-	{
-		//Find relative x and y points
-		int z = square / Size; //Rows
-		int x = square - (z * Size); //Column on row
-
-		//The offset the square has
-		float xOffset = -TotalWidth / 2;
-		float zOffset = TotalWidth / 2;
-
-
-		//Read Height map values
-		float readPercent = (float)square / SquareCount;
-		int hMapSize = heightMapValue.size();
-		if (hMapSize > SquareCount)
-		{
-			hMapSize = SquareCount;
-		}
-		int hMapIndex = hMapSize * readPercent;
-
-		float thisHMapValue = heightMapValue[hMapIndex];
-
-		//Create the points
-		VERTEX V1;
-		V1.Position = DirectX::XMFLOAT3(
-			(x * cellSize) + xOffset,
-			0 + (thisHMapValue * maxHeight),
-			-(z * cellSize) + zOffset
-		);
-		V1.Normal = DirectX::XMFLOAT3(0, 1, 0);
+	//Build the shared vertex grid from the height map, splitting the rows across the thread pool
+	TerrainGrid grid(Size, cellSize, maxHeight);
+	grid.SetBuildIndices(false);
+	grid.Build(_heightMap, _parentDXDevice->GetThreadPool().get());
 
-		VERTEX V2;
-		V2.Position = DirectX::XMFLOAT3(
-			((x + 1) * cellSize) + xOffset,
-			0 + (thisHMapValue * maxHeight),
-			-(z * cellSize) + zOffset
-		);
-		V2.Normal = DirectX::XMFLOAT3(0, 1, 0);
-
-		VERTEX V3;
-		V3.Position = DirectX::XMFLOAT3(
-			(x * cellSize) + xOffset,
-			0 +(thisHMapValue * maxHeight),
-			-(z + 1) * cellSize + zOffset
-		);
-		V3.Normal = DirectX::XMFLOAT3(0, 1, 0);
-
-		VERTEX V4;
-		V4.Position = DirectX::XMFLOAT3(
-			(x + 1) * cellSize + xOffset,
-			0 + (thisHMapValue * maxHeight),
-			-(z + 1) * cellSize + zOffset);
-
-		V4.Normal = DirectX::XMFLOAT3(0, 1, 0);
-
-
-		int prevSquare = square - 1;
-		if (prevSquare >= 0 && x > 0)
-		{
-			V1.Position.y = vVector[(prevSquare * 4) + 1].Position.y;
-			V3.Position.y = vVector[(prevSquare * 4) + 3].Position.y;
-		}
-		int topSquare = square - Size;
-		if (topSquare >= 0)
-		{
-			V1.Position.y = vVector[(topSquare * 4) + 2].Position.y;
-			V2.Position.y = vVector[(topSquare * 4) + 3].Position.y;
-		}
-
-		XMVECTOR u = XMVectorSet(
-			V2.Position.x - V1.Position.x,
-			V2.Position.y - V1.Position.y,
-			V2.Position.z - V1.Position.z,
-			0
-		);
+	//Split the grid into chunks with several levels of detail. The chunk index
+	//lists all go into one index buffer that indexes the full grid of vertices
+	_quadTree = make_shared<TerrainQuadTree>(grid, chunkSize, lodCount);
 
-		XMVECTOR v = XMVectorSet(
-			V3.Position.x - V1.Position.x,
-			V3.Position.y - V1.Position.y,
-			V3.Position.z - V1.Position.z,
-			0
-		);
+	//The occlusion culler holds the occluder weakly, so it goes when this node does
+	_occluder = OcclusionCuller::CreateHeightfieldOccluder(grid.GetVertices(), grid.GetVerticesPerRow(), occluderCells);
+	_occluder->WorldTransformation = _worldTransformation;
+	_parentDXDevice->GetOcclusionCuller()->AddOccluder(_occluder);
 
-		XMVECTOR squareCrossProduct = XMVector3Cross(u, v);
-		squareCrossProduct = XMVector3Normalize(squareCrossProduct);
-		XMFLOAT3 squareNormal;
-
-		XMStoreFloat3(&squareNormal, squareCrossProduct);
-		V1.Normal = squareNormal;
-		V2.Normal = squareNormal;
-		V3.Normal = squareNormal;
-		V4.Normal = squareNormal;
-
-		//push back the points
-		vVector.push_back(V1);
-		vVector.push_back(V2);
-		vVector.push_back(V3);
-		vVector.push_back(V4);
-
-		//Add indecies to the vector
-		iVector.push_back((square * 4));
-		iVector.push_back((square * 4) + 1);
-		iVector.push_back((square * 4) + 2);
-
-		iVector.push_back((square * 4) + 2);
-		iVector.push_back((square * 4) + 1);
-		iVector.push_back((square * 4) + 3);
-	}
+	//The chunks' skirts hang from copies of the edge vertices, which go after the grid's own
+	std::vector<VERTEX> vVector;
+	vVector.reserve(grid.GetVertices().size() + _quadTree->GetSkirtVertices().size());
+	vVector.insert(vVector.end(), grid.GetVertices().begin(), grid.GetVertices().end());
+	vVector.insert(vVector.end(), _quadTree->GetSkirtVertices().begin(), _quadTree->GetSkirtVertices().end());
+	const std::vector<UINT>& iVector = _quadTree->GetIndices();
 
 	VertexCount = vVector.size();
 	IndeciesCount = iVector.size();
@@ -258,21 +242,45 @@ void TerrainNode::CreateMesh()
 
 }
 
+void TerrainNode::CreateTileIndexBuffer()
+{
+	//Every tile is the same size, so a flat grid gives the index pattern they all share
+	TerrainGrid grid(Size, cellSize, maxHeight);
+	grid.Build(HeightMap());
+
+	const std::vector<UINT>& iVector = grid.GetIndices();
+	IndeciesCount = iVector.size();
+
+	D3D11_BUFFER_DESC indexBufferDescriptor;
+	indexBufferDescriptor.Usage = D3D11_USAGE_IMMUTABLE;
+	indexBufferDescriptor.ByteWidth = sizeof(UINT) * IndeciesCount;
+	indexBufferDescriptor.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	indexBufferDescriptor.CPUAccessFlags = 0;
+	indexBufferDescriptor.MiscFlags = 0;
+	indexBufferDescriptor.StructureByteStride = 0;
+
+	D3D11_SUBRESOURCE_DATA indexInitialisationData;
+	indexInitialisationData.pSysMem = &iVector[0];
+
+	ThrowIfFailed(
+		_parentDXDevice->GetDevice()->CreateBuffer(
+			&indexBufferDescriptor, &indexInitialisationData,
+			indexBuffer.GetAddressOf()
+		)
+	);
+}
+
 void TerrainNode::BuildShaders()
 {
 	//Compile Shaders and Set Vertex Layout
 	_parentDXDevice = DirectXFramework::GetDXFramework();
 
 	//Vertex Shader compile
-	DWORD shaderCompileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
 	ComPtr<ID3D10Blob> vertexCompileMessages;
 	ComPtr<ID3D10Blob> pixelCompileMessages;
 	HRESULT hr;
-	hr = D3DCompileFromFile(
-		L"TexturedShaders.hlsl",
-		nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE,
-		"VShader", "vs_5_0",
-		shaderCompileFlags, 0,
+	hr = _parentDXDevice->CompileShader(
+		L"TexturedShaders.hlsl", "VShader", "vs_5_0",
 		vertexShaderByteCode.GetAddressOf(),
 		vertexCompileMessages.GetAddressOf()
 	);
@@ -280,11 +288,8 @@ void TerrainNode::BuildShaders()
 
 
 	//Pixel Shader compile
-	hr = D3DCompileFromFile(
-		L"TexturedShaders.hlsl",
-		nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE,
-		"PShader", "ps_5_0",
-		shaderCompileFlags, 0,
+	hr = _parentDXDevice->CompileShader(
+		L"TexturedShaders.hlsl", "PShader", "ps_5_0",
 		pixelShaderByteCode.GetAddressOf(),
 		pixelCompileMessages.GetAddressOf()
 	);
@@ -342,48 +347,41 @@ void TerrainNode::BuildVertexLayout()
 
 void TerrainNode::BuildConstantBuffer()
 {
-	//Create Constant Buffer
+	//Create the material buffer, which never changes.  The camera and lights are in the
+	//frame constants that every renderer shares, so the terrain has no light of its own and
+	//is lit by the scene's directional light like the meshes.  Before the constants were
+	//shared it used a light along (-1, -1, 0) at 0.75; ClusteredLighting::SetDirectionalLight
+	//gives that back if the terrain should be lit as it was.
 	D3D11_BUFFER_DESC bufferDesc;
 	ZeroMemory(&bufferDesc, sizeof(bufferDesc));
-	bufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	bufferDesc.ByteWidth = sizeof(CBUFFER);
 	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	MaterialConstants materialConstants;
+	ZeroMemory(&materialConstants, sizeof(materialConstants));
+	materialConstants.DiffuseCoefficient = XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f);
+	materialConstants.SpecularCoefficient = XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f);
+	materialConstants.Shininess = 1.0f;
+	materialConstants.Opacity = 1;
+
+	bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	bufferDesc.ByteWidth = sizeof(MaterialConstants);
+	D3D11_SUBRESOURCE_DATA materialInitialisationData;
+	ZeroMemory(&materialInitialisationData, sizeof(materialInitialisationData));
+	materialInitialisationData.pSysMem = &materialConstants;
 
 	ThrowIfFailed(
 		_parentDXDevice->GetDevice()->CreateBuffer(
-			&bufferDesc, NULL, constantBuffer.GetAddressOf()));
+			&bufferDesc, &materialInitialisationData, materialConstantBuffer.GetAddressOf()));
+
+	//The per-object constants go in the render queue with each draw
+	_pipeline.VertexShader = vertexShader;
+	_pipeline.PixelShader = pixelShader;
+	_pipeline.InputLayout = vertexInputLayout;
+	_pipeline.Topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+	_pipeline.FrameConstantBuffer = _parentDXDevice->GetClusteredLighting()->GetFrameConstantBuffer();
 }
 
 bool TerrainNode::LoadHeightMap(wstring fileName)
 {
-	//Get Size of file
-	int streamSize = 0;
-	std::streampos fSize = 0;
-	std::ifstream fileStream(fileName, std::ios::binary);
-	//Couldn't find or open file
-	if (!fileStream)
-	{
-		return false;
-	}
-
-	fSize = fileStream.tellg();
-	fileStream.seekg(0, std::ios::end);
-	fSize = fileStream.tellg() - fSize;
-	streamSize = fSize;
-
-	fileStream.clear();
-	fileStream.seekg(0, std::ios::beg);
-	
-	USHORT* rawValues = new USHORT[streamSize];
-	fileStream.read((char*)rawValues, streamSize);
-	fileStream.close();
-
-
-	//normalize all values between 
-	for (int i = 0; i < streamSize; i++)
-	{
-		heightMapValue.push_back((float)rawValues[i] / 65536);
-	}
-	delete[] rawValues;
-	return true;
+	//Map the file into memory. The samples are read in place when the mesh is built
+	return _heightMap.Load(fileName);
 }
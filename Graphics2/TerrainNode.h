@@ -2,6 +2,13 @@
 #include "SceneNode.h"
 #include "ResourceManager.h"
 #include "DirectXFramework.h"
+#include "TerrainGrid.h"
+#include "TerrainQuadTree.h"
+#include "TerrainTileCache.h"
+#include "ConstantBuffers.h"
+#include "RenderQueue.h"
+#include "DirectXRenderCommandSink.h"
+#include <unordered_map>
 #include <vector>
 
 class TerrainNode :
@@ -9,31 +16,39 @@ class TerrainNode :
 {
 public:
     TerrainNode(wstring ObjectName);
+    //Tiled mode - tiles are streamed in from disk around the camera instead of loading one height map
+    TerrainNode(wstring ObjectName, const TerrainTileSettings& tileSettings);
     bool Initialise() { return true; }
     void Update(FXMMATRIX& currentWorldTransformation) 
     {
         XMStoreFloat4x4(&_combinedWorldTransformation, XMMatrixIdentity() * currentWorldTransformation);
+        //The occluder has to be where the terrain is drawn
+        if (_occluder != nullptr)
+        {
+            _occluder->WorldTransformation = _worldTransformation;
+        }
     };
     void Render();
     void Shutdown() {}
 
+    //Culling and level of detail results from the last frame
+    inline shared_ptr<TerrainQuadTree> GetQuadTree() { return _quadTree; }
+    //Residency counters for the tiled mode. Null when a single height map is used
+    inline shared_ptr<TerrainTileCache> GetTileCache() { return _tileCache; }
+
 private:
     bool LoadHeightMap(wstring fileName);
-    std::vector<float> heightMapValue;
+    HeightMap _heightMap;
 
 
     void CreateMesh();
+    void CreateTileIndexBuffer();
+    void RenderTiles(const XMMATRIX& viewProjection, DrawPacket& packet);
     void BuildShaders();
     void BuildVertexLayout();
     void BuildConstantBuffer();
     void BuildRenderState();
 
-    XMFLOAT4			_ambientLight;
-    XMFLOAT4			_directionalLightVector;
-    XMFLOAT4			_directionalLightColour;
-    XMFLOAT4			_cameraPosition;
-
-
     DirectXFramework* _parentDXDevice;
     //Raster States
     ComPtr<ID3D11RasterizerState> RasterState;
@@ -47,11 +62,13 @@ private:
     //Buffers
     ComPtr <ID3D11Buffer> vertexBuffer;
     ComPtr <ID3D11Buffer> indexBuffer;
-    ComPtr <ID3D11Buffer> constantBuffer;
+    ComPtr <ID3D11Buffer> materialConstantBuffer;
+    RenderStateId _materialSortId;
 
     //Shaders
     ComPtr<ID3D11VertexShader> vertexShader;
     ComPtr<ID3D11PixelShader> pixelShader;
+    RenderPipeline _pipeline;
 
     //Terrain Info
     int Size = 1024;
@@ -59,5 +76,25 @@ private:
     float maxHeight = 1000;
     UINT VertexCount = 0;
     UINT IndeciesCount = 0;
+
+    //Level of detail and culling
+    int chunkSize = 64;
+    int lodCount = 4;
+    shared_ptr<TerrainQuadTree> _quadTree;
+    std::vector<TerrainChunkDraw> _chunkDraws;
+
+    //A coarse copy of the terrain, lying under it, that hides meshes behind hills
+    int occluderCells = 64;
+    shared_ptr<OccluderMesh> _occluder;
+
+    //Tiled mode. All tiles share one index buffer, and each resident tile near the
+    //camera gets its own vertex buffer, which is released when the tile is dropped
+    struct TileBuffer
+    {
+        shared_ptr<TerrainTile> Tile;
+        ComPtr<ID3D11Buffer> VertexBuffer;
+    };
+    shared_ptr<TerrainTileCache> _tileCache;
+    std::unordered_map<TerrainTile*, TileBuffer> _tileBuffers;
 };
 
@@ -0,0 +1,347 @@
+#include "TerrainQuadTree.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+// Grid coordinates used by a level of detail with the given step between vertices.  The last
+// coordinate is always the edge of the chunk, even if the chunk size is not a multiple of the step.
+static void GetLodCoordinates(int first, int last, int step, std::vector<int>& coordinates)
+{
+	coordinates.clear();
+	for (int c = first; c < last; c += step)
+	{
+		coordinates.push_back(c);
+	}
+	coordinates.push_back(last);
+}
+
+TerrainQuadTree::TerrainQuadTree(const TerrainGrid& grid, int chunkSize, int lodCount)
+{
+	_chunkSize = std::max(chunkSize, 1);
+	_lodCount = std::max(lodCount, 1);
+	_chunksPerSide = (grid.GetSize() + _chunkSize - 1) / _chunkSize;
+	_maxPixelError = 2.0f;
+	_chunksDrawn = 0;
+	_chunksCulled = 0;
+	_trianglesSubmitted = 0;
+	_gridVertexCount = grid.GetVertexCount();
+
+	_chunks.resize(static_cast<size_t>(_chunksPerSide) * _chunksPerSide);
+	for (int chunkZ = 0; chunkZ < _chunksPerSide; chunkZ++)
+	{
+		for (int chunkX = 0; chunkX < _chunksPerSide; chunkX++)
+		{
+			BuildChunk(grid, chunkX, chunkZ);
+		}
+	}
+
+	// Along a shared edge, each chunk's surface is within its own error of the true heights, so
+	// the gap between two chunks is never more than twice the largest error
+	float maxError = 0.0f;
+	for (const Chunk& chunk : _chunks)
+	{
+		maxError = std::max(maxError, chunk.LodErrors.back());
+	}
+	_skirtDepth = 2.0f * maxError;
+	for (Chunk& chunk : _chunks)
+	{
+		chunk.BoundsMin.y -= _skirtDepth;
+	}
+	_skirtVertices.resize(_skirtSources.size());
+	for (size_t i = 0; i < _skirtSources.size(); i++)
+	{
+		_skirtVertices[i] = grid.GetVertices()[_skirtSources[i]];
+		_skirtVertices[i].Position.y -= _skirtDepth;
+	}
+	_skirtVertexIndices.clear();
+
+	if (_chunksPerSide > 0)
+	{
+		// Round the span up to a power of two so that every node splits evenly.  Nodes
+		// that fall completely outside the grid are never created.
+		int span = 1;
+		while (span < _chunksPerSide)
+		{
+			span *= 2;
+		}
+		BuildNode(0, 0, span);
+	}
+}
+
+void TerrainQuadTree::BuildChunk(const TerrainGrid& grid, int chunkX, int chunkZ)
+{
+	const std::vector<VERTEX>& vertices = grid.GetVertices();
+	unsigned int verticesPerRow = static_cast<unsigned int>(grid.GetVerticesPerRow());
+	int firstX = chunkX * _chunkSize;
+	int firstZ = chunkZ * _chunkSize;
+	int lastX = std::min(firstX + _chunkSize, grid.GetSize());
+	int lastZ = std::min(firstZ + _chunkSize, grid.GetSize());
+
+	Chunk& chunk = _chunks[static_cast<size_t>(chunkZ) * _chunksPerSide + chunkX];
+
+	// Bounds of the chunk.  Rows run from +z to -z.
+	const VERTEX& topLeft = vertices[firstZ * verticesPerRow + firstX];
+	const VERTEX& bottomRight = vertices[lastZ * verticesPerRow + lastX];
+	float minHeight = topLeft.Position.y;
+	float maxHeight = topLeft.Position.y;
+	for (int z = firstZ; z <= lastZ; z++)
+	{
+		for (int x = firstX; x <= lastX; x++)
+		{
+			float height = vertices[z * verticesPerRow + x].Position.y;
+			minHeight = std::min(minHeight, height);
+			maxHeight = std::max(maxHeight, height);
+		}
+	}
+	chunk.BoundsMin = XMFLOAT3(topLeft.Position.x, minHeight, bottomRight.Position.z);
+	chunk.BoundsMax = XMFLOAT3(bottomRight.Position.x, maxHeight, topLeft.Position.z);
+
+	std::vector<int> xCoordinates;
+	std::vector<int> zCoordinates;
+	for (int lod = 0; lod < _lodCount; lod++)
+	{
+		int step = 1 << lod;
+		GetLodCoordinates(firstX, lastX, step, xCoordinates);
+		GetLodCoordinates(firstZ, lastZ, step, zCoordinates);
+
+		TerrainChunkDraw draw;
+		draw.StartIndex = static_cast<unsigned int>(_indices.size());
+		float error = 0.0f;
+		for (size_t row = 0; row + 1 < zCoordinates.size(); row++)
+		{
+			int z0 = zCoordinates[row];
+			int z1 = zCoordinates[row + 1];
+			for (size_t column = 0; column + 1 < xCoordinates.size(); column++)
+			{
+				int x0 = xCoordinates[column];
+				int x1 = xCoordinates[column + 1];
+
+				// Same winding as the full resolution grid
+				unsigned int corner0 = z0 * verticesPerRow + x0;
+				unsigned int corner1 = z0 * verticesPerRow + x1;
+				unsigned int corner2 = z1 * verticesPerRow + x0;
+				unsigned int corner3 = z1 * verticesPerRow + x1;
+				_indices.push_back(corner0);
+				_indices.push_back(corner1);
+				_indices.push_back(corner2);
+				_indices.push_back(corner2);
+				_indices.push_back(corner1);
+				_indices.push_back(corner3);
+
+				// The geometric error of this cell is the furthest any skipped vertex is from
+				// the surface interpolated between the corners of the coarse cell
+				if (step > 1)
+				{
+					float h0 = vertices[corner0].Position.y;
+					float h1 = vertices[corner1].Position.y;
+					float h2 = vertices[corner2].Position.y;
+					float h3 = vertices[corner3].Position.y;
+					for (int z = z0; z <= z1; z++)
+					{
+						float v = static_cast<float>(z - z0) / (z1 - z0);
+						for (int x = x0; x <= x1; x++)
+						{
+							float u = static_cast<float>(x - x0) / (x1 - x0);
+							float interpolated = (h0 * (1.0f - u) + h1 * u) * (1.0f - v) + (h2 * (1.0f - u) + h3 * u) * v;
+							error = std::max(error, std::fabs(vertices[z * verticesPerRow + x].Position.y - interpolated));
+						}
+					}
+				}
+			}
+		}
+
+		// Skirts along the edges that have a neighbour, going clockwise round the chunk
+		std::vector<unsigned int> edgeVertices;
+		if (chunkZ > 0)
+		{
+			edgeVertices.clear();
+			for (int x : xCoordinates)
+			{
+				edgeVertices.push_back(firstZ * verticesPerRow + x);
+			}
+			AddSkirt(edgeVertices);
+		}
+		if (chunkX < _chunksPerSide - 1)
+		{
+			edgeVertices.clear();
+			for (int z : zCoordinates)
+			{
+				edgeVertices.push_back(z * verticesPerRow + lastX);
+			}
+			AddSkirt(edgeVertices);
+		}
+		if (chunkZ < _chunksPerSide - 1)
+		{
+			edgeVertices.clear();
+			for (auto x = xCoordinates.rbegin(); x != xCoordinates.rend(); ++x)
+			{
+				edgeVertices.push_back(lastZ * verticesPerRow + *x);
+			}
+			AddSkirt(edgeVertices);
+		}
+		if (chunkX > 0)
+		{
+			edgeVertices.clear();
+			for (auto z = zCoordinates.rbegin(); z != zCoordinates.rend(); ++z)
+			{
+				edgeVertices.push_back(*z * verticesPerRow + firstX);
+			}
+			AddSkirt(edgeVertices);
+		}
+		draw.IndexCount = static_cast<unsigned int>(_indices.size()) - draw.StartIndex;
+		// Make sure the error never gets smaller as the level of detail gets coarser
+		if (lod > 0)
+		{
+			error = std::max(error, chunk.LodErrors[lod - 1]);
+		}
+		chunk.Lods.push_back(draw);
+		chunk.LodErrors.push_back(error);
+	}
+}
+
+void TerrainQuadTree::AddSkirt(const std::vector<unsigned int>& edgeVertices)
+{
+	// Neighbouring chunks hang their skirts from the same grid vertices, so they share them
+	std::vector<unsigned int> skirtVertices(edgeVertices.size());
+	for (size_t i = 0; i < edgeVertices.size(); i++)
+	{
+		std::unordered_map<unsigned int, unsigned int>::iterator it = _skirtVertexIndices.find(edgeVertices[i]);
+		if (it == _skirtVertexIndices.end())
+		{
+			it = _skirtVertexIndices.insert({ edgeVertices[i], _gridVertexCount + static_cast<unsigned int>(_skirtSources.size()) }).first;
+			_skirtSources.push_back(edgeVertices[i]);
+		}
+		skirtVertices[i] = it->second;
+	}
+	// Going clockwise round the chunk, this winding faces out of it
+	for (size_t i = 0; i + 1 < edgeVertices.size(); i++)
+	{
+		_indices.push_back(edgeVertices[i]);
+		_indices.push_back(skirtVertices[i]);
+		_indices.push_back(edgeVertices[i + 1]);
+		_indices.push_back(edgeVertices[i + 1]);
+		_indices.push_back(skirtVertices[i]);
+		_indices.push_back(skirtVertices[i + 1]);
+	}
+}
+
+int TerrainQuadTree::BuildNode(int firstChunkX, int firstChunkZ, int chunkSpan)
+{
+	if (firstChunkX >= _chunksPerSide || firstChunkZ >= _chunksPerSide)
+	{
+		return -1;
+	}
+	int nodeIndex = static_cast<int>(_nodes.size());
+	_nodes.emplace_back();
+	_nodes[nodeIndex].ChunkIndex = -1;
+	_nodes[nodeIndex].ChunkCount = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		_nodes[nodeIndex].Children[i] = -1;
+	}
+
+	if (chunkSpan == 1)
+	{
+		int chunkIndex = firstChunkZ * _chunksPerSide + firstChunkX;
+		_nodes[nodeIndex].ChunkIndex = chunkIndex;
+		_nodes[nodeIndex].ChunkCount = 1;
+		_nodes[nodeIndex].BoundsMin = _chunks[chunkIndex].BoundsMin;
+		_nodes[nodeIndex].BoundsMax = _chunks[chunkIndex].BoundsMax;
+		return nodeIndex;
+	}
+
+	int halfSpan = chunkSpan / 2;
+	int children[4] =
+	{
+		BuildNode(firstChunkX, firstChunkZ, halfSpan),
+		BuildNode(firstChunkX + halfSpan, firstChunkZ, halfSpan),
+		BuildNode(firstChunkX, firstChunkZ + halfSpan, halfSpan),
+		BuildNode(firstChunkX + halfSpan, firstChunkZ + halfSpan, halfSpan)
+	};
+
+	// _nodes may have been reallocated while building the children
+	QuadTreeNode& node = _nodes[nodeIndex];
+	bool first = true;
+	for (int i = 0; i < 4; i++)
+	{
+		node.Children[i] = children[i];
+		if (children[i] < 0)
+		{
+			continue;
+		}
+		const QuadTreeNode& child = _nodes[children[i]];
+		node.ChunkCount += child.ChunkCount;
+		if (first)
+		{
+			node.BoundsMin = child.BoundsMin;
+			node.BoundsMax = child.BoundsMax;
+			first = false;
+		}
+		else
+		{
+			node.BoundsMin = XMFLOAT3(std::min(node.BoundsMin.x, child.BoundsMin.x), std::min(node.BoundsMin.y, child.BoundsMin.y), std::min(node.BoundsMin.z, child.BoundsMin.z));
+			node.BoundsMax = XMFLOAT3(std::max(node.BoundsMax.x, child.BoundsMax.x), std::max(node.BoundsMax.y, child.BoundsMax.y), std::max(node.BoundsMax.z, child.BoundsMax.z));
+		}
+	}
+	return nodeIndex;
+}
+
+void TerrainQuadTree::Select(const Frustum& frustum, const XMFLOAT3& cameraPosition, float errorScale, std::vector<TerrainChunkDraw>& draws)
+{
+	draws.clear();
+	_chunksDrawn = 0;
+	_chunksCulled = 0;
+	_trianglesSubmitted = 0;
+	if (!_nodes.empty())
+	{
+		SelectNode(0, frustum, cameraPosition, errorScale, draws);
+	}
+}
+
+void TerrainQuadTree::SelectNode(int nodeIndex, const Frustum& frustum, const XMFLOAT3& cameraPosition, float errorScale, std::vector<TerrainChunkDraw>& draws)
+{
+	const QuadTreeNode& node = _nodes[nodeIndex];
+	if (!frustum.IntersectsBox(node.BoundsMin, node.BoundsMax))
+	{
+		// Nothing below this node can be seen
+		_chunksCulled += node.ChunkCount;
+		return;
+	}
+	if (node.ChunkIndex >= 0)
+	{
+		SelectChunk(_chunks[node.ChunkIndex], cameraPosition, errorScale, draws);
+		return;
+	}
+	for (int i = 0; i < 4; i++)
+	{
+		if (node.Children[i] >= 0)
+		{
+			SelectNode(node.Children[i], frustum, cameraPosition, errorScale, draws);
+		}
+	}
+}
+
+void TerrainQuadTree::SelectChunk(const Chunk& chunk, const XMFLOAT3& cameraPosition, float errorScale, std::vector<TerrainChunkDraw>& draws)
+{
+	// Distance from the camera to the nearest point of the chunk
+	float dx = std::max(std::max(chunk.BoundsMin.x - cameraPosition.x, cameraPosition.x - chunk.BoundsMax.x), 0.0f);
+	float dy = std::max(std::max(chunk.BoundsMin.y - cameraPosition.y, cameraPosition.y - chunk.BoundsMax.y), 0.0f);
+	float dz = std::max(std::max(chunk.BoundsMin.z - cameraPosition.z, cameraPosition.z - chunk.BoundsMax.z), 0.0f);
+	float distance = std::max(std::sqrt(dx * dx + dy * dy + dz * dz), 1.0f);
+
+	// Use the coarsest level of detail whose error is small enough on screen
+	int lod = 0;
+	for (int i = _lodCount - 1; i > 0; i--)
+	{
+		if (chunk.LodErrors[i] * errorScale / distance <= _maxPixelError)
+		{
+			lod = i;
+			break;
+		}
+	}
+	const TerrainChunkDraw& draw = chunk.Lods[lod];
+	draws.push_back(draw);
+	_chunksDrawn++;
+	_trianglesSubmitted += draw.IndexCount / 3;
+}
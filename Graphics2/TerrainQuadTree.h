@@ -0,0 +1,96 @@
+#pragma once
+#include "TerrainGrid.h"
+#include "Frustum.h"
+#include <unordered_map>
+#include <vector>
+
+// Splits a terrain grid into square chunks organised as a quadtree.  Each chunk has a number of
+// levels of detail, each one using every 2nd, 4th, 8th, ... vertex of the grid.  All of the
+// index lists for all chunks are held in one array so they can live in a single index buffer,
+// and they all index into the full grid vertex buffer.
+//
+// Select walks the quadtree, skipping any subtree whose bounds are outside the view frustum,
+// and picks the coarsest level of detail for each visible chunk whose geometric error stays
+// under a screen-space threshold.  Where a fine chunk meets a coarse one, their edges do not
+// quite line up, so every level of detail also has a skirt: a strip of triangles hanging down
+// from each edge the chunk shares with a neighbour, facing out of the chunk.  The skirts are
+// deep enough to cover the largest gap two levels of detail can leave, so no cracks show.  The
+// skirt vertices are copies of the grid's edge vertices, moved down, and go after the grid's
+// vertices in the vertex buffer.
+//
+// No DirectX device is needed, so selection can be measured on its own.
+
+struct TerrainChunkDraw
+{
+	unsigned int							StartIndex;
+	unsigned int							IndexCount;
+};
+
+class TerrainQuadTree
+{
+public:
+	TerrainQuadTree(const TerrainGrid& grid, int chunkSize = 64, int lodCount = 4);
+
+	inline const std::vector<unsigned int>&	GetIndices() const { return _indices; }
+	// Indexed from the grid's vertex count onwards
+	inline const std::vector<VERTEX>&		GetSkirtVertices() const { return _skirtVertices; }
+	inline float							GetSkirtDepth() const { return _skirtDepth; }
+	inline int								GetChunkCount() const { return static_cast<int>(_chunks.size()); }
+	inline int								GetLodCount() const { return _lodCount; }
+
+	// The maximum error (in pixels) allowed before a finer level of detail is used
+	inline void								SetMaxPixelError(float maxPixelError) { _maxPixelError = maxPixelError; }
+
+	// errorScale converts an error at unit distance to pixels.  For a perspective projection
+	// this is (viewport height / 2) * projection._22.  The frustum and camera position must be
+	// in the same space as the grid vertices.
+	void									Select(const Frustum& frustum, const DirectX::XMFLOAT3& cameraPosition, float errorScale, std::vector<TerrainChunkDraw>& draws);
+
+	// Statistics from the last call to Select
+	inline unsigned int						GetChunksDrawn() const { return _chunksDrawn; }
+	inline unsigned int						GetChunksCulled() const { return _chunksCulled; }
+	inline unsigned int						GetTrianglesSubmitted() const { return _trianglesSubmitted; }
+
+private:
+	struct Chunk
+	{
+		DirectX::XMFLOAT3					BoundsMin;
+		DirectX::XMFLOAT3					BoundsMax;
+		std::vector<TerrainChunkDraw>		Lods;
+		std::vector<float>					LodErrors;
+	};
+
+	struct QuadTreeNode
+	{
+		DirectX::XMFLOAT3					BoundsMin;
+		DirectX::XMFLOAT3					BoundsMax;
+		int									Children[4];
+		int									ChunkIndex;
+		unsigned int						ChunkCount;
+	};
+
+	int										_chunkSize;
+	int										_lodCount;
+	int										_chunksPerSide;
+	float									_maxPixelError;
+
+	std::vector<Chunk>						_chunks;
+	std::vector<QuadTreeNode>				_nodes;
+	std::vector<unsigned int>				_indices;
+	unsigned int							_gridVertexCount;
+	float									_skirtDepth;
+	std::vector<VERTEX>						_skirtVertices;
+	std::vector<unsigned int>				_skirtSources;			// The grid vertex each skirt vertex hangs from
+	std::unordered_map<unsigned int, unsigned int>	_skirtVertexIndices;	// Grid vertex to skirt vertex, while building
+
+	unsigned int							_chunksDrawn;
+	unsigned int							_chunksCulled;
+	unsigned int							_trianglesSubmitted;
+
+	void									BuildChunk(const TerrainGrid& grid, int chunkX, int chunkZ);
+	// The edge's grid vertices must go clockwise round the chunk, seen from above
+	void									AddSkirt(const std::vector<unsigned int>& edgeVertices);
+	int										BuildNode(int firstChunkX, int firstChunkZ, int chunkSpan);
+	void									SelectNode(int nodeIndex, const Frustum& frustum, const DirectX::XMFLOAT3& cameraPosition, float errorScale, std::vector<TerrainChunkDraw>& draws);
+	void									SelectChunk(const Chunk& chunk, const DirectX::XMFLOAT3& cameraPosition, float errorScale, std::vector<TerrainChunkDraw>& draws);
+};
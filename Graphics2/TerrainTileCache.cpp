@@ -0,0 +1,247 @@
+#include "TerrainTileCache.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+using namespace DirectX;
+
+TerrainTileCache::TerrainTileCache(const TerrainTileSettings& settings)
+{
+	_settings = settings;
+	_memoryUsed = 0;
+	_hitCount = 0;
+	_missCount = 0;
+	_evictionCount = 0;
+	_loadCount = 0;
+	_failedLoadCount = 0;
+	_stopping = false;
+	_loader = std::thread(&TerrainTileCache::LoaderLoop, this);
+}
+
+TerrainTileCache::~TerrainTileCache()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_requestAvailable.notify_all();
+	_loader.join();
+}
+
+TerrainTileCache::TileKey TerrainTileCache::MakeKey(int x, int z)
+{
+	return static_cast<TileKey>((static_cast<unsigned long long>(static_cast<unsigned int>(x)) << 32) | static_cast<unsigned int>(z));
+}
+
+void TerrainTileCache::Update(const XMFLOAT3& cameraPosition)
+{
+	CollectCompletedTiles();
+
+	// Find the tiles around the camera, nearest first
+	float tileWidth = GetTileWidth();
+	int cameraX = static_cast<int>(std::floor(cameraPosition.x / tileWidth + 0.5f));
+	int cameraZ = static_cast<int>(std::floor(cameraPosition.z / tileWidth + 0.5f));
+	int radius = _settings.PrefetchRadius;
+
+	struct WantedTile
+	{
+		int							X;
+		int							Z;
+		float						DistanceSquared;
+	};
+	std::vector<WantedTile> wantedTiles;
+	for (int z = cameraZ - radius; z <= cameraZ + radius; z++)
+	{
+		for (int x = cameraX - radius; x <= cameraX + radius; x++)
+		{
+			float dx = x * tileWidth - cameraPosition.x;
+			float dz = z * tileWidth - cameraPosition.z;
+			wantedTiles.push_back({ x, z, dx * dx + dz * dz });
+		}
+	}
+	std::sort(wantedTiles.begin(), wantedTiles.end(), [](const WantedTile& a, const WantedTile& b)
+	{
+		return a.DistanceSquared < b.DistanceSquared;
+	});
+
+	// Touch the resident tiles and build the list of tiles still to load
+	std::unordered_set<TileKey> wanted;
+	std::deque<TileKey> requests;
+	Clock::time_point now = Clock::now();
+	_visibleTiles.clear();
+	for (const WantedTile& wantedTile : wantedTiles)
+	{
+		TileKey key = MakeKey(wantedTile.X, wantedTile.Z);
+		auto missing = _missingTiles.find(key);
+		if (missing != _missingTiles.end() && now < missing->second.RetryTime)
+		{
+			continue;
+		}
+		wanted.insert(key);
+		auto it = _residentLookup.find(key);
+		if (it != _residentLookup.end())
+		{
+			_hitCount++;
+			_residentTiles.splice(_residentTiles.begin(), _residentTiles, it->second);
+			_visibleTiles.push_back(*it->second);
+		}
+		else
+		{
+			_missCount++;
+			requests.push_back(key);
+		}
+	}
+
+	// Replace the request queue, so that tiles the camera has moved away from are
+	// not loaded and the nearest tiles are loaded first.  Tiles that are loading, or
+	// have loaded but not been collected yet, are still in flight.
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_requests.clear();
+		for (TileKey key : requests)
+		{
+			if (_inFlight.count(key) == 0)
+			{
+				_requests.push_back(key);
+			}
+		}
+	}
+	_requestAvailable.notify_one();
+
+	EvictTiles(wanted);
+}
+
+void TerrainTileCache::CollectCompletedTiles()
+{
+	std::vector<std::shared_ptr<TerrainTile>> completed;
+	std::vector<TileKey> failed;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		completed.swap(_completed);
+		failed.swap(_failed);
+		// Only now that they are resident (or known to be missing) can they be asked for again
+		for (const std::shared_ptr<TerrainTile>& tile : completed)
+		{
+			_inFlight.erase(MakeKey(tile->X, tile->Z));
+		}
+		for (TileKey key : failed)
+		{
+			_inFlight.erase(key);
+		}
+	}
+	for (const std::shared_ptr<TerrainTile>& tile : completed)
+	{
+		TileKey key = MakeKey(tile->X, tile->Z);
+		_missingTiles.erase(key);
+		if (_residentLookup.count(key) > 0)
+		{
+			continue;
+		}
+		// New tiles go to the back of the list so that they are the first to be evicted if
+		// they are no longer wanted by the time they arrive
+		_residentTiles.push_back(tile);
+		_residentLookup[key] = std::prev(_residentTiles.end());
+		_memoryUsed += tile->Grid->GetMemoryUsed();
+		_loadCount++;
+	}
+	Clock::time_point now = Clock::now();
+	for (TileKey key : failed)
+	{
+		// Back off, doubling the delay each time up to 64 times the first delay
+		MissingTile& missing = _missingTiles[key];
+		missing.FailureCount++;
+		float delay = _settings.MissingTileRetryDelay * static_cast<float>(1u << std::min(missing.FailureCount - 1, 6u));
+		missing.RetryTime = now + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(delay));
+		_failedLoadCount++;
+	}
+}
+
+void TerrainTileCache::EvictTiles(const std::unordered_set<TileKey>& wanted)
+{
+	// Work back from the least recently used tile.  Tiles the camera currently wants are
+	// never evicted, even if that means going over the budget.
+	auto it = _residentTiles.end();
+	while (_memoryUsed > _settings.MemoryBudget && it != _residentTiles.begin())
+	{
+		--it;
+		TileKey key = MakeKey((*it)->X, (*it)->Z);
+		if (wanted.count(key) > 0)
+		{
+			continue;
+		}
+		_memoryUsed -= (*it)->Grid->GetMemoryUsed();
+		_residentLookup.erase(key);
+		it = _residentTiles.erase(it);
+		_evictionCount++;
+	}
+}
+
+void TerrainTileCache::LoaderLoop()
+{
+	while (true)
+	{
+		TileKey key;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_requestAvailable.wait(lock, [this]() { return _stopping || !_requests.empty(); });
+			if (_stopping)
+			{
+				return;
+			}
+			key = _requests.front();
+			_requests.pop_front();
+			_inFlight.insert(key);
+		}
+
+		std::shared_ptr<TerrainTile> tile = LoadTile(key);
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (tile != nullptr)
+		{
+			_completed.push_back(tile);
+		}
+		else
+		{
+			_failed.push_back(key);
+		}
+	}
+}
+
+std::shared_ptr<TerrainTile> TerrainTileCache::LoadTile(TileKey key)
+{
+	int x = static_cast<int>(key >> 32);
+	int z = static_cast<int>(static_cast<unsigned int>(key & 0xffffffff));
+
+	std::wstringstream fileName;
+	fileName << _settings.Directory << L"/Tile_" << x << L"_" << z << L".raw";
+	HeightMap heightMap;
+	if (!heightMap.Load(fileName.str()))
+	{
+		return nullptr;
+	}
+
+	std::shared_ptr<TerrainTile> tile = std::make_shared<TerrainTile>();
+	tile->X = x;
+	tile->Z = z;
+	tile->Origin = XMFLOAT3(x * GetTileWidth(), 0.0f, z * GetTileWidth());
+
+	// All tiles share the same index pattern, so only the vertices are built here
+	tile->Grid = std::make_shared<TerrainGrid>(_settings.TileSize, _settings.CellSize, _settings.MaxHeight);
+	tile->Grid->SetBuildIndices(false);
+	tile->Grid->Build(heightMap);
+	tile->Grid->ReleaseHeights();
+
+	// World space bounds, used to cull the tile
+	const std::vector<VERTEX>& vertices = tile->Grid->GetVertices();
+	float minHeight = vertices[0].Position.y;
+	float maxHeight = vertices[0].Position.y;
+	for (const VERTEX& vertex : vertices)
+	{
+		minHeight = std::min(minHeight, vertex.Position.y);
+		maxHeight = std::max(maxHeight, vertex.Position.y);
+	}
+	float halfWidth = GetTileWidth() / 2;
+	tile->BoundsMin = XMFLOAT3(tile->Origin.x - halfWidth, minHeight, tile->Origin.z - halfWidth);
+	tile->BoundsMax = XMFLOAT3(tile->Origin.x + halfWidth, maxHeight, tile->Origin.z + halfWidth);
+	return tile;
+}
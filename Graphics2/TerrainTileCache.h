@@ -0,0 +1,120 @@
+#pragma once
+#include "TerrainGrid.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Streams terrain tiles in around the camera.  The world is split into square tiles, each with
+// its own raw height map file named <directory>/Tile_<x>_<z>.raw.  Tile (x, z) is centred on
+// (x * tile width, 0, z * tile width) in world space.
+//
+// Update is called on the render thread each frame.  It works out which tiles are within the
+// prefetch radius of the camera and queues the missing ones, nearest first, for a background
+// thread that maps the height map and builds the tile mesh and normals.  Finished tiles are
+// kept in a least recently used cache.  When the memory used goes over the budget, the least
+// recently used tiles that are not currently wanted are evicted.
+//
+// A tile whose file cannot be loaded is not asked for again until a retry delay has passed.
+// The delay doubles with each failure, so a tile that is still being written (or copied in
+// from elsewhere) turns up once it is there, without the loader trying every frame.
+//
+// The cache does not need a DirectX device - creating GPU buffers for resident tiles is left
+// to the caller.
+
+struct TerrainTileSettings
+{
+	std::wstring							Directory;
+	int										TileSize = 256;				// Cells along each side of a tile
+	float									CellSize = 5.0f;
+	float									MaxHeight = 1000.0f;
+	int										PrefetchRadius = 2;			// Tiles either side of the camera's tile
+	size_t									MemoryBudget = 256 * 1024 * 1024;
+	float									MissingTileRetryDelay = 2.0f;	// Seconds, before the first retry
+};
+
+struct TerrainTile
+{
+	int										X;
+	int										Z;
+	DirectX::XMFLOAT3						Origin;
+	DirectX::XMFLOAT3						BoundsMin;					// World space bounds
+	DirectX::XMFLOAT3						BoundsMax;
+	std::shared_ptr<TerrainGrid>			Grid;
+};
+
+class TerrainTileCache
+{
+public:
+	TerrainTileCache(const TerrainTileSettings& settings);
+	~TerrainTileCache();
+
+	TerrainTileCache(const TerrainTileCache&) = delete;
+	TerrainTileCache& operator=(const TerrainTileCache&) = delete;
+
+	void									Update(const DirectX::XMFLOAT3& cameraPosition);
+
+	// Tiles around the camera that are resident, as of the last Update
+	inline const std::vector<std::shared_ptr<TerrainTile>>& GetVisibleTiles() const { return _visibleTiles; }
+
+	inline const TerrainTileSettings&		GetSettings() const { return _settings; }
+	inline float							GetTileWidth() const { return _settings.TileSize * _settings.CellSize; }
+
+	// Counters for tuning the prefetch radius and memory budget.  Hits and misses count
+	// wanted tiles that were or were not resident, summed over every Update.
+	inline unsigned long long				GetHitCount() const { return _hitCount; }
+	inline unsigned long long				GetMissCount() const { return _missCount; }
+	inline unsigned long long				GetEvictionCount() const { return _evictionCount; }
+	inline unsigned long long				GetLoadCount() const { return _loadCount; }
+	inline unsigned long long				GetFailedLoadCount() const { return _failedLoadCount; }
+	inline size_t							GetMemoryUsed() const { return _memoryUsed; }
+	inline size_t							GetResidentTileCount() const { return _residentTiles.size(); }
+
+private:
+	typedef long long						TileKey;
+	typedef std::list<std::shared_ptr<TerrainTile>>	TileList;
+	typedef std::chrono::steady_clock		Clock;
+
+	struct MissingTile
+	{
+		unsigned int						FailureCount;
+		Clock::time_point					RetryTime;
+	};
+
+	TerrainTileSettings						_settings;
+
+	// Owned by the render thread
+	TileList								_residentTiles;				// Most recently used at the front
+	std::unordered_map<TileKey, TileList::iterator>	_residentLookup;
+	std::unordered_map<TileKey, MissingTile> _missingTiles;				// Tiles that failed to load
+	std::vector<std::shared_ptr<TerrainTile>> _visibleTiles;
+	size_t									_memoryUsed;
+	unsigned long long						_hitCount;
+	unsigned long long						_missCount;
+	unsigned long long						_evictionCount;
+	unsigned long long						_loadCount;
+	unsigned long long						_failedLoadCount;
+
+	// Shared with the loader thread
+	std::mutex								_mutex;
+	std::condition_variable					_requestAvailable;
+	std::deque<TileKey>						_requests;
+	std::unordered_set<TileKey>				_inFlight;					// Until collected by the render thread
+	std::vector<std::shared_ptr<TerrainTile>> _completed;
+	std::vector<TileKey>					_failed;
+	bool									_stopping;
+	std::thread								_loader;
+
+	static TileKey							MakeKey(int x, int z);
+	void									LoaderLoop();
+	std::shared_ptr<TerrainTile>			LoadTile(TileKey key);
+	void									CollectCompletedTiles();
+	void									EvictTiles(const std::unordered_set<TileKey>& wanted);
+};
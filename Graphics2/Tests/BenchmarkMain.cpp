@@ -0,0 +1,6 @@
+#include "TestFramework.h"
+
+int main(int argc, char ** argv)
+{
+	return RunTestCases(GetBenchmarks(), argc, argv);
+}
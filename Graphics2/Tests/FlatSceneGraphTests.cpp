@@ -0,0 +1,105 @@
+#include "TestFramework.h"
+#include "FlatSceneGraph.h"
+
+// Counts the calls made to it, and keeps the combined transform it was given
+class CountingNode : public SceneNode
+{
+public:
+	CountingNode(wstring name) : SceneNode(name) {}
+
+	virtual bool Initialise() { InitialiseCount++; return true; }
+	virtual void Render() { RenderCount++; }
+	virtual void Shutdown() { ShutdownCount++; }
+
+	inline const XMFLOAT4X4& GetCombinedWorldTransform() const { return _combinedWorldTransformation; }
+
+	int									InitialiseCount = 0;
+	int									RenderCount = 0;
+	int									ShutdownCount = 0;
+};
+
+typedef shared_ptr<CountingNode>		CountingNodePointer;
+
+TEST(FlatSceneGraph, FlattensNestedSceneGraphs)
+{
+	// graph -> group -> (first, inner -> second)
+	CountingNodePointer first = make_shared<CountingNode>(L"First");
+	CountingNodePointer second = make_shared<CountingNode>(L"Second");
+	SceneGraphPointer inner = make_shared<SceneGraph>(L"Inner");
+	inner->Add(second);
+	SceneGraphPointer group = make_shared<SceneGraph>(L"Group");
+	group->Add(first);
+	group->Add(inner);
+	first->SetWorldTransform(XMMatrixTranslation(1.0f, 0.0f, 0.0f));
+	second->SetWorldTransform(XMMatrixTranslation(0.0f, 0.0f, 3.0f));
+	inner->SetWorldTransform(XMMatrixTranslation(0.0f, 2.0f, 0.0f));
+	group->SetWorldTransform(XMMatrixTranslation(10.0f, 0.0f, 0.0f));
+
+	FlatSceneGraph graph;
+	graph.Add(group);
+	CHECK_EQUAL(static_cast<size_t>(4), graph.GetTransforms().GetCount());
+
+	// The leaves are each called once; the SceneGraphs do not call them again
+	CHECK(graph.Initialise());
+	graph.Update(XMMatrixIdentity());
+	graph.Render();
+	graph.Shutdown();
+	CHECK_EQUAL(1, first->InitialiseCount);
+	CHECK_EQUAL(1, second->InitialiseCount);
+	CHECK_EQUAL(1, first->RenderCount);
+	CHECK_EQUAL(1, second->RenderCount);
+	CHECK_EQUAL(1, second->ShutdownCount);
+
+	// Every level of nesting contributes to the combined transform
+	CHECK_NEAR(11.0f, first->GetCombinedWorldTransform()._41, 0.0001f);
+	CHECK_NEAR(10.0f, second->GetCombinedWorldTransform()._41, 0.0001f);
+	CHECK_NEAR(2.0f, second->GetCombinedWorldTransform()._42, 0.0001f);
+	CHECK_NEAR(3.0f, second->GetCombinedWorldTransform()._43, 0.0001f);
+
+	// Names from every level can be found, through the graph or through a nested SceneGraph
+	CHECK(graph.Find(L"Second") == second);
+	CHECK(graph.Find(L"Inner") == inner);
+	CHECK(inner->Find(L"First") == first);
+}
+
+TEST(FlatSceneGraph, RemovesAFlattenedSubtree)
+{
+	CountingNodePointer leaf = make_shared<CountingNode>(L"Leaf");
+	CountingNodePointer other = make_shared<CountingNode>(L"Other");
+	SceneGraphPointer group = make_shared<SceneGraph>(L"Group");
+	group->Add(leaf);
+	FlatSceneGraph graph;
+	graph.Add(group);
+	graph.Add(other);
+
+	graph.Remove(group);
+	CHECK_EQUAL(static_cast<size_t>(1), graph.GetTransforms().GetCount());
+	CHECK(graph.Find(L"Leaf") == nullptr);
+	CHECK(graph.Find(L"Other") == other);
+	// The removed SceneGraph keeps its own children, with a name index of their own
+	CHECK(group->Find(L"Leaf") == leaf);
+	graph.Render();
+	CHECK_EQUAL(0, leaf->RenderCount);
+	CHECK_EQUAL(1, other->RenderCount);
+}
+
+TEST(FlatSceneGraph, IgnoresNodesFromAnotherGraph)
+{
+	// A node from a bigger graph has a handle past the end of this one's nodes
+	FlatSceneGraph bigGraph;
+	CountingNodePointer stranger;
+	for (int i = 0; i < 10; i++)
+	{
+		stranger = make_shared<CountingNode>(L"Stranger");
+		bigGraph.Add(stranger);
+	}
+	FlatSceneGraph smallGraph;
+	CountingNodePointer node = make_shared<CountingNode>(L"Node");
+	smallGraph.Add(node);
+
+	smallGraph.Remove(stranger);
+	smallGraph.Remove(make_shared<CountingNode>(L"Loose"));
+	CHECK_EQUAL(static_cast<size_t>(1), smallGraph.GetTransforms().GetCount());
+	CHECK_EQUAL(static_cast<size_t>(10), bigGraph.GetTransforms().GetCount());
+	CHECK(smallGraph.Find(L"Node") == node);
+}
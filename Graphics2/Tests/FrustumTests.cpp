@@ -0,0 +1,83 @@
+#include "TestFramework.h"
+#include "Frustum.h"
+
+using namespace DirectX;
+
+// At the origin looking along +z, with a 90 degree field of view, so that the side planes are
+// x = +-z and y = +-z, and the near and far planes are at z = 1 and z = 100
+static XMMATRIX CreateViewProjection()
+{
+	XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 1.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.0f, 1.0f, 100.0f);
+	return view * projection;
+}
+
+TEST(Frustum, EmptyFrustumAcceptsEverything)
+{
+	Frustum frustum;
+	CHECK(frustum.IntersectsSphere(XMFLOAT3(0.0f, 0.0f, -1000.0f), 1.0f));
+	CHECK(frustum.IntersectsBox(XMFLOAT3(-5.0f, -5.0f, -5.0f), XMFLOAT3(-4.0f, -4.0f, -4.0f)));
+	CHECK(frustum.ContainsBox(XMFLOAT3(-5.0f, -5.0f, -5.0f), XMFLOAT3(-4.0f, -4.0f, -4.0f)));
+}
+
+TEST(Frustum, SpheresInsideOutsideAndAcrossEachPlane)
+{
+	Frustum frustum(CreateViewProjection());
+	CHECK(frustum.IntersectsSphere(XMFLOAT3(0.0f, 0.0f, 50.0f), 1.0f));
+	// Behind the camera, in front of the near plane and beyond the far plane
+	CHECK(!frustum.IntersectsSphere(XMFLOAT3(0.0f, 0.0f, -50.0f), 1.0f));
+	CHECK(!frustum.IntersectsSphere(XMFLOAT3(0.0f, 0.0f, 0.5f), 0.25f));
+	CHECK(!frustum.IntersectsSphere(XMFLOAT3(0.0f, 0.0f, 102.0f), 1.0f));
+	CHECK(frustum.IntersectsSphere(XMFLOAT3(0.0f, 0.0f, 100.5f), 1.0f));
+	// The centre is 2 / sqrt(2) = 1.41 outside the left plane
+	CHECK(!frustum.IntersectsSphere(XMFLOAT3(-12.0f, 0.0f, 10.0f), 1.0f));
+	CHECK(frustum.IntersectsSphere(XMFLOAT3(-12.0f, 0.0f, 10.0f), 2.0f));
+	// And the same above the top plane and off the right plane
+	CHECK(!frustum.IntersectsSphere(XMFLOAT3(0.0f, 12.0f, 10.0f), 1.0f));
+	CHECK(frustum.IntersectsSphere(XMFLOAT3(0.0f, 12.0f, 10.0f), 2.0f));
+	CHECK(!frustum.IntersectsSphere(XMFLOAT3(12.0f, 0.0f, 10.0f), 1.0f));
+}
+
+TEST(Frustum, BoxesInsideOutsideAndAcrossEachPlane)
+{
+	Frustum frustum(CreateViewProjection());
+	XMFLOAT3 half(1.0f, 1.0f, 1.0f);
+	struct BoxCase
+	{
+		XMFLOAT3	Centre;
+		bool		Intersects;
+		bool		Contained;
+	};
+	BoxCase cases[] =
+	{
+		{ XMFLOAT3(0.0f, 0.0f, 50.0f), true, true },
+		{ XMFLOAT3(0.0f, 0.0f, -50.0f), false, false },
+		{ XMFLOAT3(0.0f, 0.0f, 1.0f), true, false },		// Across the near plane
+		{ XMFLOAT3(0.0f, 0.0f, 100.0f), true, false },		// Across the far plane
+		{ XMFLOAT3(0.0f, 0.0f, 102.0f), false, false },
+		{ XMFLOAT3(-20.0f, 0.0f, 10.0f), false, false },
+		{ XMFLOAT3(-10.0f, 0.0f, 10.0f), true, false },		// Across the left plane
+		{ XMFLOAT3(20.0f, 0.0f, 10.0f), false, false },
+		{ XMFLOAT3(0.0f, -20.0f, 10.0f), false, false },
+		{ XMFLOAT3(0.0f, 10.0f, 10.0f), true, false },		// Across the top plane
+		{ XMFLOAT3(8.0f, 8.0f, 10.0f), true, true }
+	};
+	for (const BoxCase& box : cases)
+	{
+		XMFLOAT3 boxMin(box.Centre.x - half.x, box.Centre.y - half.y, box.Centre.z - half.z);
+		XMFLOAT3 boxMax(box.Centre.x + half.x, box.Centre.y + half.y, box.Centre.z + half.z);
+		CHECK_EQUAL(box.Intersects, frustum.IntersectsBox(boxMin, boxMax));
+		CHECK_EQUAL(box.Contained, frustum.ContainsBox(boxMin, boxMax));
+	}
+}
+
+TEST(Frustum, PlanesAreInTheSpaceTheMatrixTransformsFrom)
+{
+	// With the world transformation included, object space bounds are tested where they are
+	// placed in the world
+	Frustum frustum(XMMatrixTranslation(0.0f, 0.0f, 50.0f) * CreateViewProjection());
+	CHECK(frustum.ContainsBox(XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT3(1.0f, 1.0f, 1.0f)));
+	CHECK(!frustum.IntersectsBox(XMFLOAT3(-1.0f, -1.0f, -100.0f), XMFLOAT3(1.0f, 1.0f, -60.0f)));
+	CHECK(frustum.IntersectsSphere(XMFLOAT3(0.0f, 0.0f, -45.0f), 1.0f));
+	CHECK(!frustum.IntersectsSphere(XMFLOAT3(0.0f, 0.0f, -55.0f), 1.0f));
+}
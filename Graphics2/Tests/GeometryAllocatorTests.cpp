@@ -0,0 +1,191 @@
+#include "TestFramework.h"
+#include "GeometryAllocator.h"
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+TEST(GeometryAllocator, RangesTakeTheSmallestFreeRangeTheyFitIn)
+{
+	RangeAllocator allocator(1000);
+	size_t a = allocator.Allocate(100, 1);
+	size_t b = allocator.Allocate(300, 1);
+	size_t c = allocator.Allocate(50, 1);
+	size_t d = allocator.Allocate(200, 1);
+	CHECK_EQUAL(static_cast<size_t>(0), a);
+	CHECK_EQUAL(static_cast<size_t>(100), b);
+	CHECK_EQUAL(static_cast<size_t>(650), allocator.GetUsed());
+	// Free ranges of 100, 50 and the 350 at the end
+	allocator.Free(a, 100);
+	allocator.Free(c, 50);
+	CHECK_EQUAL(static_cast<size_t>(3), allocator.GetFreeRangeCount());
+	CHECK_EQUAL(c, allocator.Allocate(40, 1));
+	CHECK_EQUAL(a, allocator.Allocate(60, 1));
+	CHECK_EQUAL(d + 200, allocator.Allocate(150, 1));
+	// Nothing is big enough
+	CHECK_EQUAL(RangeAllocator::InvalidOffset, allocator.Allocate(300, 1));
+	CHECK_EQUAL(RangeAllocator::InvalidOffset, allocator.Allocate(0, 1));
+}
+
+TEST(GeometryAllocator, FreedRangesAreMergedWithTheirNeighbours)
+{
+	RangeAllocator allocator(400);
+	size_t offsets[4];
+	for (size_t& offset : offsets)
+	{
+		offset = allocator.Allocate(100, 1);
+	}
+	CHECK_EQUAL(static_cast<size_t>(0), allocator.GetFreeRangeCount());
+	CHECK_EQUAL(0.0f, allocator.GetFragmentation());
+
+	allocator.Free(offsets[0], 100);
+	allocator.Free(offsets[2], 100);
+	CHECK_EQUAL(static_cast<size_t>(2), allocator.GetFreeRangeCount());
+	CHECK_EQUAL(static_cast<size_t>(100), allocator.GetLargestFreeRange());
+	CHECK_NEAR(0.5f, allocator.GetFragmentation(), 0.0001f);
+
+	// Freeing the range between them joins all three
+	allocator.Free(offsets[1], 100);
+	CHECK_EQUAL(static_cast<size_t>(1), allocator.GetFreeRangeCount());
+	CHECK_EQUAL(static_cast<size_t>(300), allocator.GetLargestFreeRange());
+	CHECK_EQUAL(0.0f, allocator.GetFragmentation());
+	allocator.Free(offsets[3], 100);
+	CHECK_EQUAL(static_cast<size_t>(400), allocator.GetLargestFreeRange());
+	CHECK_EQUAL(static_cast<size_t>(0), allocator.GetUsed());
+}
+
+TEST(GeometryAllocator, RangesAreAligned)
+{
+	RangeAllocator allocator(1024);
+	CHECK_EQUAL(static_cast<size_t>(0), allocator.Allocate(10, 32));
+	size_t offset = allocator.Allocate(10, 32);
+	CHECK_EQUAL(static_cast<size_t>(32), offset);
+	// The gap left by the alignment stays free
+	CHECK_EQUAL(static_cast<size_t>(2), allocator.GetFreeRangeCount());
+	CHECK_EQUAL(static_cast<size_t>(10), allocator.Allocate(22, 1));
+}
+
+TEST(GeometryAllocator, AddsPagesWhenFull)
+{
+	GeometryAllocator allocator(1000, 500);
+	// Page sizes are rounded up to the alignment
+	GeometryAllocation first = allocator.Allocate(600, 200);
+	CHECK_EQUAL(1u, allocator.GetPageCount());
+	CHECK_EQUAL(static_cast<size_t>(1024), allocator.GetVertexPageSize(0));
+	CHECK_EQUAL(static_cast<size_t>(0), first.VertexOffset % GeometryAllocator::VertexAlignment);
+	CHECK_EQUAL(static_cast<size_t>(608), first.VertexSize);
+
+	// Room for the vertices but not the indices, so both go in a new page
+	GeometryAllocation second = allocator.Allocate(100, 400);
+	CHECK_EQUAL(1u, second.Page);
+	CHECK_EQUAL(2u, allocator.GetPageCount());
+	CHECK_EQUAL(static_cast<size_t>(608), allocator.GetStatistics().VertexBytesUsed - second.VertexSize);
+
+	// Geometry bigger than a page gets a page of its own, of its own size
+	GeometryAllocation large = allocator.Allocate(5000, 100);
+	CHECK_EQUAL(2u, large.Page);
+	CHECK_EQUAL(static_cast<size_t>(5024), allocator.GetVertexPageSize(2));
+
+	// Small geometry fills the gaps in the first page
+	GeometryAllocation small = allocator.Allocate(100, 100);
+	CHECK_EQUAL(0u, small.Page);
+	CHECK(small.VertexOffset >= first.VertexOffset + first.VertexSize);
+	CHECK(small.IndexOffset >= first.IndexOffset + first.IndexSize);
+}
+
+TEST(GeometryAllocator, StatisticsFollowAllocationsAndFrees)
+{
+	GeometryAllocator allocator(4096, 2048);
+	std::vector<GeometryAllocation> allocations;
+	for (int i = 0; i < 8; i++)
+	{
+		allocations.push_back(allocator.Allocate(512, 256));
+	}
+	GeometryArenaStatistics statistics = allocator.GetStatistics();
+	CHECK_EQUAL(1u, statistics.PageCount);
+	CHECK_EQUAL(8u, statistics.AllocationCount);
+	CHECK_EQUAL(statistics.VertexCapacity, statistics.VertexBytesUsed);
+	CHECK_EQUAL(0.0f, statistics.VertexFragmentation);
+
+	// Every other one freed leaves the free space in four pieces
+	for (size_t i = 0; i < allocations.size(); i += 2)
+	{
+		allocator.Free(allocations[i]);
+	}
+	statistics = allocator.GetStatistics();
+	CHECK_EQUAL(4u, statistics.AllocationCount);
+	CHECK_EQUAL(static_cast<size_t>(2048), statistics.VertexBytesUsed);
+	CHECK_EQUAL(static_cast<size_t>(512), statistics.LargestFreeVertexRange);
+	CHECK_EQUAL(static_cast<size_t>(8), statistics.FreeRangeCount);
+	CHECK_NEAR(0.75f, statistics.VertexFragmentation, 0.0001f);
+	CHECK_NEAR(0.75f, statistics.IndexFragmentation, 0.0001f);
+
+	// A mesh that needs more than one piece cannot use them, even though there is room
+	GeometryAllocation large = allocator.Allocate(1024, 256);
+	CHECK_EQUAL(1u, large.Page);
+
+	for (size_t i = 1; i < allocations.size(); i += 2)
+	{
+		allocator.Free(allocations[i]);
+	}
+	allocator.Free(large);
+	statistics = allocator.GetStatistics();
+	CHECK_EQUAL(0u, statistics.AllocationCount);
+	CHECK_EQUAL(static_cast<size_t>(0), statistics.VertexBytesUsed + statistics.IndexBytesUsed);
+	// Pages are kept, and each is one free range again
+	CHECK_EQUAL(2u, statistics.PageCount);
+	CHECK_EQUAL(static_cast<size_t>(4), statistics.FreeRangeCount);
+}
+
+TEST(GeometryAllocator, AllocationsNeverOverlap)
+{
+	GeometryAllocator allocator(64 * 1024, 32 * 1024);
+	std::mt19937 random(17);
+	std::uniform_int_distribution<size_t> vertexSize(1, 8000);
+	std::uniform_int_distribution<size_t> indexSize(1, 4000);
+	std::vector<GeometryAllocation> live;
+	for (int step = 0; step < 2000; step++)
+	{
+		// Streaming in and out, with somewhat more allocations than frees
+		if (!live.empty() && random() % 5 < 2)
+		{
+			size_t victim = random() % live.size();
+			allocator.Free(live[victim]);
+			live[victim] = live.back();
+			live.pop_back();
+		}
+		else
+		{
+			live.push_back(allocator.Allocate(vertexSize(random), indexSize(random)));
+		}
+	}
+
+	// Sort each page's ranges by offset, and check that each ends before the next begins
+	for (bool vertices : { true, false })
+	{
+		std::vector<std::pair<unsigned int, std::pair<size_t, size_t>>> ranges;
+		for (const GeometryAllocation& allocation : live)
+		{
+			ranges.push_back({ allocation.Page, vertices ? std::make_pair(allocation.VertexOffset, allocation.VertexSize) : std::make_pair(allocation.IndexOffset, allocation.IndexSize) });
+		}
+		std::sort(ranges.begin(), ranges.end());
+		for (size_t i = 0; i < ranges.size(); i++)
+		{
+			size_t pageSize = vertices ? allocator.GetVertexPageSize(ranges[i].first) : allocator.GetIndexPageSize(ranges[i].first);
+			CHECK(ranges[i].second.first + ranges[i].second.second <= pageSize);
+			if (i + 1 < ranges.size() && ranges[i + 1].first == ranges[i].first)
+			{
+				CHECK(ranges[i].second.first + ranges[i].second.second <= ranges[i + 1].second.first);
+			}
+		}
+	}
+
+	GeometryArenaStatistics statistics = allocator.GetStatistics();
+	CHECK_EQUAL(static_cast<unsigned int>(live.size()), statistics.AllocationCount);
+	size_t vertexBytes = 0;
+	for (const GeometryAllocation& allocation : live)
+	{
+		vertexBytes += allocation.VertexSize;
+	}
+	CHECK_EQUAL(vertexBytes, statistics.VertexBytesUsed);
+}
@@ -0,0 +1,66 @@
+#include "TestFramework.h"
+#include "HeightfieldNormals.h"
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace DirectX;
+
+// The normals for a size x size height field, computed three ways: the way the terrain used to,
+// with one face normal per cell from XMVector3Cross and XMVector3Normalize on gathered
+// positions; the scalar row kernel; and the row kernel with whatever SIMD the build targets
+BENCHMARK(HeightfieldNormals, AgainstPerCellNormals)
+{
+	const float cellSize = 1.0f;
+	printf("    %8s %14s %14s %14s %10s\n", "size", "per-cell ms", "scalar ms", "SIMD ms", "speed-up");
+	for (int size = 256; size <= 2048; size *= 2)
+	{
+		const int width = size + 1;
+		std::vector<float> heights(static_cast<size_t>(width) * width);
+		for (size_t i = 0; i < heights.size(); i++)
+		{
+			heights[i] = std::sin(i * 0.001f) * 50.0f;
+		}
+		std::vector<XMFLOAT3> normals(heights.size());
+
+		double perCellMilliseconds = TimeMilliseconds(3, [&]()
+		{
+			for (int z = 0; z < size; z++)
+			{
+				for (int x = 0; x < size; x++)
+				{
+					const float * cell = &heights[static_cast<size_t>(z) * width + x];
+					XMFLOAT3 v1(x * cellSize, cell[0], -z * cellSize);
+					XMFLOAT3 v2((x + 1) * cellSize, cell[1], -z * cellSize);
+					XMFLOAT3 v3(x * cellSize, cell[width], -(z + 1) * cellSize);
+					XMVECTOR u = XMVectorSet(v2.x - v1.x, v2.y - v1.y, v2.z - v1.z, 0.0f);
+					XMVECTOR v = XMVectorSet(v3.x - v1.x, v3.y - v1.y, v3.z - v1.z, 0.0f);
+					XMStoreFloat3(&normals[static_cast<size_t>(z) * size + x], XMVector3Normalize(XMVector3Cross(u, v)));
+				}
+			}
+		});
+		auto computeRows = [&](bool scalar)
+		{
+			for (int z = 0; z < width; z++)
+			{
+				int above = z > 0 ? z - 1 : z;
+				int below = z < width - 1 ? z + 1 : z;
+				const float * row = &heights[static_cast<size_t>(z) * width];
+				if (scalar)
+				{
+					ComputeNormalRowScalar(&heights[static_cast<size_t>(above) * width], row, &heights[static_cast<size_t>(below) * width],
+										   width, cellSize, below - above, &normals[static_cast<size_t>(z) * width]);
+				}
+				else
+				{
+					ComputeNormalRow(&heights[static_cast<size_t>(above) * width], row, &heights[static_cast<size_t>(below) * width],
+									 width, cellSize, below - above, &normals[static_cast<size_t>(z) * width]);
+				}
+			}
+		};
+		double scalarMilliseconds = TimeMilliseconds(3, [&]() { computeRows(true); });
+		double simdMilliseconds = TimeMilliseconds(3, [&]() { computeRows(false); });
+		printf("    %8d %14.2f %14.2f %14.2f %9.2fx\n", size, perCellMilliseconds, scalarMilliseconds, simdMilliseconds,
+			   perCellMilliseconds / simdMilliseconds);
+	}
+}
@@ -0,0 +1,76 @@
+#include "TestFramework.h"
+#include "HeightfieldNormals.h"
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace DirectX;
+
+// Three rows of awkward heights, so that any change in the order of operations would show
+static void FillRows(int count, std::vector<float>& rowAbove, std::vector<float>& row, std::vector<float>& rowBelow)
+{
+	rowAbove.resize(count);
+	row.resize(count);
+	rowBelow.resize(count);
+	for (int x = 0; x < count; x++)
+	{
+		rowAbove[x] = std::sin(x * 1.7f) * 13.1f + 0.1f;
+		row[x] = std::cos(x * 0.37f) * 7.3f - x * 0.013f;
+		rowBelow[x] = std::sin(x * 0.91f + 2.0f) * 19.7f;
+	}
+}
+
+TEST(HeightfieldNormals, MatchesTheScalarPathExactly)
+{
+	// Every length up to a few blocks of 8, so that the ends and the leftovers are covered
+	for (int count = 1; count <= 40; count++)
+	{
+		std::vector<float> rowAbove, row, rowBelow;
+		FillRows(count, rowAbove, row, rowBelow);
+		for (int rowSpacing = 1; rowSpacing <= 2; rowSpacing++)
+		{
+			std::vector<XMFLOAT3> normals(count);
+			std::vector<XMFLOAT3> scalarNormals(count);
+			ComputeNormalRow(rowAbove.data(), row.data(), rowBelow.data(), count, 2.5f, rowSpacing, normals.data());
+			ComputeNormalRowScalar(rowAbove.data(), row.data(), rowBelow.data(), count, 2.5f, rowSpacing, scalarNormals.data());
+			CHECK(memcmp(normals.data(), scalarNormals.data(), count * sizeof(XMFLOAT3)) == 0);
+		}
+	}
+}
+
+TEST(HeightfieldNormals, NormalsAreUnitLengthAndPointUp)
+{
+	const int count = 37;
+	std::vector<float> rowAbove, row, rowBelow;
+	FillRows(count, rowAbove, row, rowBelow);
+	std::vector<XMFLOAT3> normals(count);
+	ComputeNormalRow(rowAbove.data(), row.data(), rowBelow.data(), count, 1.0f, 2, normals.data());
+	for (const XMFLOAT3& normal : normals)
+	{
+		CHECK_NEAR(1.0f, normal.x * normal.x + normal.y * normal.y + normal.z * normal.z, 0.00001f);
+		CHECK(normal.y > 0.0f);
+	}
+}
+
+TEST(HeightfieldNormals, PlaneGivesItsOwnNormalEverywhere)
+{
+	// Height = 0.5 x - 0.25 z, with rows moving towards -z
+	const int count = 21;
+	const float cellSize = 2.0f;
+	std::vector<float> rowAbove(count), row(count), rowBelow(count);
+	for (int x = 0; x < count; x++)
+	{
+		rowAbove[x] = 0.5f * x * cellSize - 0.25f * cellSize;
+		row[x] = 0.5f * x * cellSize;
+		rowBelow[x] = 0.5f * x * cellSize + 0.25f * cellSize;
+	}
+	std::vector<XMFLOAT3> normals(count);
+	ComputeNormalRow(rowAbove.data(), row.data(), rowBelow.data(), count, cellSize, 2, normals.data());
+	float length = std::sqrt(0.5f * 0.5f + 1.0f + 0.25f * 0.25f);
+	for (const XMFLOAT3& normal : normals)
+	{
+		CHECK_NEAR(-0.5f / length, normal.x, 0.00001f);
+		CHECK_NEAR(1.0f / length, normal.y, 0.00001f);
+		CHECK_NEAR(0.25f / length, normal.z, 0.00001f);
+	}
+}
@@ -0,0 +1,40 @@
+#include "TestFramework.h"
+#include "InstanceBatcher.h"
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+// Time to group and pack a frame's props, for thousands of instances of a few dozen models,
+// and the draw calls made for each submesh with and without instancing
+BENCHMARK(InstanceBatcher, GroupAndPack)
+{
+	const int meshCount = 40;
+	static int meshes[meshCount];
+	std::mt19937 random(5);
+	InstanceBatcher batcher;
+
+	printf("    %10s %10s %10s %12s %12s\n", "instances", "build ms", "ns/inst", "instanced", "one each");
+	for (int instanceCount = 1000; instanceCount <= 100000; instanceCount *= 10)
+	{
+		std::vector<int> meshIndices(instanceCount);
+		std::vector<XMFLOAT4X4> transforms(instanceCount);
+		for (int i = 0; i < instanceCount; i++)
+		{
+			meshIndices[i] = random() % meshCount;
+			XMStoreFloat4x4(&transforms[i], XMMatrixTranslation(static_cast<float>(i), 0.0f, 0.0f));
+		}
+		double milliseconds = TimeMilliseconds(20, [&]()
+		{
+			batcher.Clear();
+			for (int i = 0; i < instanceCount; i++)
+			{
+				batcher.Add(&meshes[meshIndices[i]], transforms[i]);
+			}
+			batcher.Build();
+		});
+		printf("    %10d %10.3f %10.2f %12zu %12d\n", instanceCount, milliseconds, milliseconds * 1e6 / instanceCount,
+			   batcher.GetGroups().size(), instanceCount);
+	}
+}
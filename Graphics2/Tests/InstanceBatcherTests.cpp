@@ -0,0 +1,105 @@
+#include "TestFramework.h"
+#include "InstanceBatcher.h"
+#include <vector>
+
+using namespace DirectX;
+
+static int Meshes[3];
+
+// A transform that records which instance it came from in its translation
+static XMFLOAT4X4 CreateTransform(int instance)
+{
+	XMFLOAT4X4 transformation;
+	XMStoreFloat4x4(&transformation, XMMatrixTranslation(static_cast<float>(instance), 0.0f, 0.0f));
+	return transformation;
+}
+
+TEST(InstanceBatcher, GroupsInstancesByMeshInTheOrderTheyWereAdded)
+{
+	// Meshes 0 1 0 2 1 0
+	InstanceBatcher batcher;
+	const int meshOrder[] = { 0, 1, 0, 2, 1, 0 };
+	for (int instance = 0; instance < 6; instance++)
+	{
+		batcher.Add(&Meshes[meshOrder[instance]], CreateTransform(instance));
+	}
+	batcher.Build();
+
+	const std::vector<InstanceGroup>& groups = batcher.GetGroups();
+	CHECK_EQUAL(static_cast<size_t>(3), groups.size());
+	CHECK_EQUAL(6u, batcher.GetInstanceCount());
+	CHECK(groups[0].Mesh == &Meshes[0]);
+	CHECK(groups[1].Mesh == &Meshes[1]);
+	CHECK(groups[2].Mesh == &Meshes[2]);
+	CHECK_EQUAL(0u, groups[0].FirstInstance);
+	CHECK_EQUAL(3u, groups[0].InstanceCount);
+	CHECK_EQUAL(3u, groups[1].FirstInstance);
+	CHECK_EQUAL(2u, groups[1].InstanceCount);
+	CHECK_EQUAL(5u, groups[2].FirstInstance);
+	CHECK_EQUAL(1u, groups[2].InstanceCount);
+
+	// Each group's transforms are next to each other, in the order they were added
+	const float expected[] = { 0, 2, 5, 1, 4, 3 };
+	for (int i = 0; i < 6; i++)
+	{
+		CHECK_EQUAL(expected[i], batcher.GetInstanceTransforms()[i]._41);
+	}
+}
+
+TEST(InstanceBatcher, ClearStartsAFreshFrame)
+{
+	InstanceBatcher batcher;
+	batcher.Add(&Meshes[0], CreateTransform(0));
+	batcher.Add(&Meshes[1], CreateTransform(1));
+	batcher.Build();
+	batcher.Clear();
+	CHECK(batcher.GetGroups().empty());
+	CHECK_EQUAL(0u, batcher.GetInstanceCount());
+
+	// The group order comes from the new frame only
+	batcher.Add(&Meshes[1], CreateTransform(7));
+	batcher.Add(&Meshes[0], CreateTransform(8));
+	batcher.Build();
+	CHECK_EQUAL(static_cast<size_t>(2), batcher.GetGroups().size());
+	CHECK(batcher.GetGroups()[0].Mesh == &Meshes[1]);
+	CHECK_EQUAL(7.0f, batcher.GetInstanceTransforms()[0]._41);
+	CHECK_EQUAL(8.0f, batcher.GetInstanceTransforms()[1]._41);
+
+	// An empty frame builds nothing
+	batcher.Clear();
+	batcher.Build();
+	CHECK(batcher.GetGroups().empty());
+	CHECK_EQUAL(0u, batcher.GetInstanceCount());
+}
+
+TEST(InstanceBatcher, RangesCoverEveryInstanceOnce)
+{
+	InstanceBatcher batcher;
+	const int instanceCount = 1000;
+	for (int instance = 0; instance < instanceCount; instance++)
+	{
+		batcher.Add(&Meshes[(instance * 7) % 3], CreateTransform(instance));
+	}
+	batcher.Build();
+	std::vector<int> seen(instanceCount, 0);
+	unsigned int nextFirst = 0;
+	for (const InstanceGroup& group : batcher.GetGroups())
+	{
+		CHECK_EQUAL(nextFirst, group.FirstInstance);
+		int previous = -1;
+		for (unsigned int i = group.FirstInstance; i < group.FirstInstance + group.InstanceCount; i++)
+		{
+			int instance = static_cast<int>(batcher.GetInstanceTransforms()[i]._41);
+			CHECK(&Meshes[(instance * 7) % 3] == group.Mesh);
+			CHECK(instance > previous);
+			previous = instance;
+			seen[instance]++;
+		}
+		nextFirst += group.InstanceCount;
+	}
+	CHECK_EQUAL(static_cast<unsigned int>(instanceCount), nextFirst);
+	for (int count : seen)
+	{
+		CHECK_EQUAL(1, count);
+	}
+}
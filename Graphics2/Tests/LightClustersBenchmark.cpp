@@ -0,0 +1,50 @@
+#include "TestFramework.h"
+#include "LightClusters.h"
+#include "ThreadPool.h"
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+
+// Build time for the default 16 x 8 x 24 clusters against the number of lights and threads.
+// The lights are scattered through a 400 x 40 x 400 area in front of the camera, a third of
+// them spots.
+BENCHMARK(LightClusters, Build)
+{
+	XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0.0f, 10.0f, -20.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 100.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 1.0f, 1000.0f);
+	unsigned int hardwareThreads = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> horizontal(-200.0f, 200.0f);
+	std::uniform_real_distribution<float> depth(0.0f, 400.0f);
+	std::uniform_real_distribution<float> height(0.0f, 40.0f);
+	std::uniform_real_distribution<float> range(5.0f, 30.0f);
+
+	printf("    %8s %8s %10s %10s %12s %14s\n", "lights", "threads", "build ms", "in view", "indices", "most in one");
+	for (unsigned int lightCount : { 100u, 1000u, 4000u })
+	{
+		std::vector<ClusterLight> lights(lightCount);
+		for (unsigned int i = 0; i < lightCount; i++)
+		{
+			lights[i] = {};
+			lights[i].Position = XMFLOAT3(horizontal(random), height(random), depth(random));
+			lights[i].Range = range(random);
+			lights[i].Colour = XMFLOAT3(1.0f, 1.0f, 1.0f);
+			lights[i].SpotCosine = i % 3 == 0 ? 0.8f : -1.0f;
+			lights[i].Direction = XMFLOAT3(0.0f, -1.0f, 0.0f);
+		}
+		LightClusters clusters;
+		double serialMilliseconds = TimeMilliseconds(20, [&]() { clusters.Build(lights, view, projection); });
+		const LightClusterStatistics& statistics = clusters.GetStatistics();
+		printf("    %8u %8s %10.3f %10u %12u %14u\n", lightCount, "serial", serialMilliseconds,
+			   statistics.LightsInView, statistics.LightIndexCount, statistics.MaximumLightsInCluster);
+		for (unsigned int threadCount = 2; threadCount <= hardwareThreads; threadCount *= 2)
+		{
+			ThreadPool threadPool(threadCount);
+			double milliseconds = TimeMilliseconds(20, [&]() { clusters.Build(lights, view, projection, &threadPool); });
+			printf("    %8u %8u %10.3f\n", lightCount, threadCount, milliseconds);
+		}
+	}
+}
@@ -0,0 +1,213 @@
+#include "TestFramework.h"
+#include "LightClusters.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+static const unsigned int TilesX = 8;
+static const unsigned int TilesY = 4;
+static const unsigned int Slices = 16;
+static const float Near = 0.5f;
+static const float Far = 200.0f;
+
+static XMMATRIX CreateView()
+{
+	return XMMatrixLookAtLH(XMVectorSet(5.0f, 3.0f, -20.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 10.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+}
+
+static XMMATRIX CreateProjection()
+{
+	return XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, Near, Far);
+}
+
+// Point and spot lights scattered through and around the view
+static std::vector<ClusterLight> CreateRandomLights(std::mt19937& random, unsigned int count)
+{
+	std::uniform_real_distribution<float> x(-60.0f, 60.0f);
+	std::uniform_real_distribution<float> y(-20.0f, 20.0f);
+	std::uniform_real_distribution<float> z(-30.0f, 150.0f);
+	std::uniform_real_distribution<float> range(2.0f, 25.0f);
+	std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> spotCosine(0.2f, 0.98f);
+	std::vector<ClusterLight> lights(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		ClusterLight& light = lights[i];
+		light = {};
+		light.Position = XMFLOAT3(x(random), y(random), z(random));
+		light.Range = range(random);
+		light.Colour = XMFLOAT3(1.0f, 1.0f, 1.0f);
+		light.SpotCosine = -1.0f;
+		if (i % 2 == 1)
+		{
+			XMStoreFloat3(&light.Direction, XMVector3Normalize(XMVectorSet(direction(random), direction(random), direction(random), 0.0f)));
+			light.SpotCosine = spotCosine(random);
+		}
+	}
+	return lights;
+}
+
+// Whether a view space point is lit by a light that has been moved into view space
+static bool IsLit(const ClusterLight& light, const XMFLOAT3& point)
+{
+	XMFLOAT3 offset(point.x - light.Position.x, point.y - light.Position.y, point.z - light.Position.z);
+	float distance = std::sqrt(offset.x * offset.x + offset.y * offset.y + offset.z * offset.z);
+	if (distance > light.Range)
+	{
+		return false;
+	}
+	if (light.SpotCosine <= -1.0f || distance == 0.0f)
+	{
+		return true;
+	}
+	return (offset.x * light.Direction.x + offset.y * light.Direction.y + offset.z * light.Direction.z) / distance >= light.SpotCosine;
+}
+
+TEST(LightClusters, MatchesABruteForceTestOfEveryCluster)
+{
+	std::mt19937 random(11);
+	std::vector<ClusterLight> lights = CreateRandomLights(random, 300);
+	XMMATRIX view = CreateView();
+	XMMATRIX projection = CreateProjection();
+	LightClusters clusters(TilesX, TilesY, Slices);
+	clusters.Build(lights, view, projection);
+	CHECK_NEAR(Near, clusters.GetNear(), 0.001f);
+	CHECK_NEAR(Far, clusters.GetFar(), 0.1f);
+
+	// The lights and their bounding spheres in view space
+	std::vector<ClusterLight> viewLights = lights;
+	std::vector<XMFLOAT3> sphereCentres(lights.size());
+	std::vector<float> sphereRadii(lights.size());
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		ClusterLight& light = viewLights[i];
+		XMStoreFloat3(&light.Position, XMVector3Transform(XMLoadFloat3(&light.Position), view));
+		XMStoreFloat3(&light.Direction, XMVector3TransformNormal(XMLoadFloat3(&light.Direction), view));
+		LightClusters::GetBoundingSphere(lights[i], sphereCentres[i], sphereRadii[i]);
+		XMStoreFloat3(&sphereCentres[i], XMVector3Transform(XMLoadFloat3(&sphereCentres[i]), view));
+	}
+	XMFLOAT4X4 projectionValues;
+	XMStoreFloat4x4(&projectionValues, projection);
+
+	const std::vector<ClusterRange>& ranges = clusters.GetClusterRanges();
+	const std::vector<unsigned int>& indices = clusters.GetLightIndices();
+	CHECK_EQUAL(static_cast<size_t>(clusters.GetClusterCount()), ranges.size());
+	CHECK_EQUAL(static_cast<size_t>(ranges.back().Offset + ranges.back().Count), indices.size());
+	unsigned int mustBeListed = 0;
+	unsigned int listedOutsideSamples = 0;
+	for (unsigned int slice = 0; slice < Slices; slice++)
+	{
+		float sliceNear = Near * std::pow(Far / Near, static_cast<float>(slice) / Slices);
+		float sliceFar = Near * std::pow(Far / Near, static_cast<float>(slice + 1) / Slices);
+		for (unsigned int tileY = 0; tileY < TilesY; tileY++)
+		{
+			for (unsigned int tileX = 0; tileX < TilesX; tileX++)
+			{
+				// The cluster's corners in normalised device coordinates
+				float left = 2.0f * tileX / TilesX - 1.0f;
+				float right = 2.0f * (tileX + 1) / TilesX - 1.0f;
+				float top = 1.0f - 2.0f * tileY / TilesY;
+				float bottom = 1.0f - 2.0f * (tileY + 1) / TilesY;
+				// Points through the cluster, kept off its faces so rounding cannot move them
+				// into the next one, and the box around all of it
+				std::vector<XMFLOAT3> samples;
+				XMFLOAT3 boxMin(FLT_MAX, FLT_MAX, sliceNear);
+				XMFLOAT3 boxMax(-FLT_MAX, -FLT_MAX, sliceFar);
+				const float fractions[] = { 0.001f, 0.125f, 0.25f, 0.375f, 0.5f, 0.625f, 0.75f, 0.875f, 0.999f };
+				for (float w : fractions)
+				{
+					float depth = sliceNear + (sliceFar - sliceNear) * w;
+					for (float v : fractions)
+					{
+						for (float u : fractions)
+						{
+							float ndcX = left + (right - left) * u;
+							float ndcY = bottom + (top - bottom) * v;
+							samples.push_back(XMFLOAT3(ndcX * depth / projectionValues._11, ndcY * depth / projectionValues._22, depth));
+						}
+					}
+				}
+				for (float ndcX : { left, right })
+				{
+					for (float ndcY : { bottom, top })
+					{
+						for (float corner : { sliceNear, sliceFar })
+						{
+							float x = ndcX * corner / projectionValues._11;
+							float y = ndcY * corner / projectionValues._22;
+							boxMin = XMFLOAT3(std::min(boxMin.x, x), std::min(boxMin.y, y), boxMin.z);
+							boxMax = XMFLOAT3(std::max(boxMax.x, x), std::max(boxMax.y, y), boxMax.z);
+						}
+					}
+				}
+
+				const ClusterRange& range = ranges[clusters.GetClusterIndex(tileX, tileY, slice)];
+				std::vector<unsigned int> listed(indices.begin() + range.Offset, indices.begin() + range.Offset + range.Count);
+				CHECK(std::is_sorted(listed.begin(), listed.end()));
+				for (unsigned int light = 0; light < viewLights.size(); light++)
+				{
+					const ClusterLight& viewLight = viewLights[light];
+					bool isListed = std::binary_search(listed.begin(), listed.end(), light);
+					// Any light, or bounding sphere, that reaches into the cluster has to be listed
+					const XMFLOAT3& centre = sphereCentres[light];
+					float radiusSquared = sphereRadii[light] * sphereRadii[light];
+					bool lit = false;
+					bool inSphere = false;
+					for (const XMFLOAT3& sample : samples)
+					{
+						lit = lit || IsLit(viewLight, sample);
+						float sx = sample.x - centre.x;
+						float sy = sample.y - centre.y;
+						float sz = sample.z - centre.z;
+						inSphere = inSphere || sx * sx + sy * sy + sz * sz <= radiusSquared;
+					}
+					CHECK(!lit || inSphere);
+					CHECK(!inSphere || isListed);
+					mustBeListed += inSphere ? 1 : 0;
+					// and any light that is listed has to reach the box around it
+					float dx = std::max(std::max(boxMin.x - centre.x, 0.0f), centre.x - boxMax.x);
+					float dy = std::max(std::max(boxMin.y - centre.y, 0.0f), centre.y - boxMax.y);
+					float dz = std::max(std::max(boxMin.z - centre.z, 0.0f), centre.z - boxMax.z);
+					CHECK(!isListed || dx * dx + dy * dy + dz * dz <= radiusSquared * 1.0001f);
+					listedOutsideSamples += isListed && !inSphere ? 1 : 0;
+				}
+			}
+		}
+	}
+	// Otherwise the test above proves nothing
+	CHECK(mustBeListed > 1000);
+	CHECK_EQUAL(indices.size(), static_cast<size_t>(mustBeListed + listedOutsideSamples));
+	// Only the clusters the sphere just touches between the points tested, and the corners of
+	// boxes outside the clusters, are listed without a point in them
+	CHECK(listedOutsideSamples * 5 < mustBeListed);
+}
+
+TEST(LightClusters, ThreadPoolGivesTheSameResult)
+{
+	std::mt19937 random(13);
+	std::vector<ClusterLight> lights = CreateRandomLights(random, 500);
+	LightClusters serialClusters;
+	serialClusters.Build(lights, CreateView(), CreateProjection());
+	CHECK(!serialClusters.GetLightIndices().empty());
+	// Thread counts that do and do not divide the slices evenly
+	for (unsigned int threadCount : { 1u, 2u, 3u, 7u })
+	{
+		ThreadPool threadPool(threadCount);
+		LightClusters parallelClusters;
+		parallelClusters.Build(lights, CreateView(), CreateProjection(), &threadPool);
+		CHECK(serialClusters.GetLightIndices() == parallelClusters.GetLightIndices());
+		CHECK_EQUAL(serialClusters.GetClusterRanges().size(), parallelClusters.GetClusterRanges().size());
+		for (size_t cluster = 0; cluster < serialClusters.GetClusterRanges().size(); cluster++)
+		{
+			CHECK_EQUAL(serialClusters.GetClusterRanges()[cluster].Offset, parallelClusters.GetClusterRanges()[cluster].Offset);
+			CHECK_EQUAL(serialClusters.GetClusterRanges()[cluster].Count, parallelClusters.GetClusterRanges()[cluster].Count);
+		}
+		CHECK_EQUAL(serialClusters.GetStatistics().LightsInView, parallelClusters.GetStatistics().LightsInView);
+		CHECK_EQUAL(serialClusters.GetStatistics().MaximumLightsInCluster, parallelClusters.GetStatistics().MaximumLightsInCluster);
+	}
+}
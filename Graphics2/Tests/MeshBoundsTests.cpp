@@ -0,0 +1,117 @@
+#include "TestFramework.h"
+#include "MeshBounds.h"
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+static const float Tolerance = 0.0001f;
+
+static std::vector<VERTEX> CreateRandomVertices(std::mt19937& random, size_t count, float offset)
+{
+	std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+	std::vector<VERTEX> vertices(count);
+	for (VERTEX& vertex : vertices)
+	{
+		vertex.Position = XMFLOAT3(position(random) + offset, position(random) * 0.5f, position(random) * 2.0f - offset);
+		vertex.Normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
+		vertex.TexCoord = XMFLOAT2(0.0f, 0.0f);
+	}
+	return vertices;
+}
+
+static bool IsInside(const MeshBounds& bounds, const XMFLOAT3& point)
+{
+	bool inBox = point.x >= bounds.Minimum.x - Tolerance && point.x <= bounds.Maximum.x + Tolerance &&
+				 point.y >= bounds.Minimum.y - Tolerance && point.y <= bounds.Maximum.y + Tolerance &&
+				 point.z >= bounds.Minimum.z - Tolerance && point.z <= bounds.Maximum.z + Tolerance;
+	float x = point.x - bounds.Centre.x;
+	float y = point.y - bounds.Centre.y;
+	float z = point.z - bounds.Centre.z;
+	bool inSphere = std::sqrt(x * x + y * y + z * z) <= bounds.Radius + Tolerance;
+	return inBox && inSphere;
+}
+
+TEST(MeshBounds, FromVerticesEnclosesEveryVertex)
+{
+	CHECK(MeshBounds().IsEmpty());
+	CHECK(MeshBounds::FromVertices(nullptr, 0).IsEmpty());
+
+	std::mt19937 random(3);
+	std::vector<VERTEX> vertices = CreateRandomVertices(random, 500, 0.0f);
+	MeshBounds bounds = MeshBounds::FromVertices(vertices.data(), vertices.size());
+	CHECK(!bounds.IsEmpty());
+	bool touchesMinimumX = false;
+	bool touchesMaximumY = false;
+	for (const VERTEX& vertex : vertices)
+	{
+		CHECK(IsInside(bounds, vertex.Position));
+		touchesMinimumX = touchesMinimumX || vertex.Position.x == bounds.Minimum.x;
+		touchesMaximumY = touchesMaximumY || vertex.Position.y == bounds.Maximum.y;
+	}
+	// The box is the tightest box, and the sphere is centred on it
+	CHECK(touchesMinimumX);
+	CHECK(touchesMaximumY);
+	CHECK_NEAR((bounds.Minimum.z + bounds.Maximum.z) * 0.5f, bounds.Centre.z, Tolerance);
+
+	// A single vertex has a point for its bounds, which is not empty
+	MeshBounds point = MeshBounds::FromVertices(vertices.data(), 1);
+	CHECK(!point.IsEmpty());
+	CHECK_EQUAL(0.0f, point.Radius);
+}
+
+TEST(MeshBounds, MergeEnclosesBoth)
+{
+	std::mt19937 random(5);
+	for (int pair = 0; pair < 20; pair++)
+	{
+		std::vector<VERTEX> first = CreateRandomVertices(random, 50, 0.0f);
+		std::vector<VERTEX> second = CreateRandomVertices(random, 50, static_cast<float>(pair * 3));
+		MeshBounds merged = MeshBounds::FromVertices(first.data(), first.size());
+		merged.Merge(MeshBounds::FromVertices(second.data(), second.size()));
+		for (const std::vector<VERTEX>* vertices : { &first, &second })
+		{
+			for (const VERTEX& vertex : *vertices)
+			{
+				CHECK(IsInside(merged, vertex.Position));
+			}
+		}
+	}
+
+	// Empty bounds change nothing, and take whatever is merged into them
+	std::vector<VERTEX> vertices = CreateRandomVertices(random, 10, 0.0f);
+	MeshBounds bounds = MeshBounds::FromVertices(vertices.data(), vertices.size());
+	MeshBounds merged = bounds;
+	merged.Merge(MeshBounds());
+	CHECK_EQUAL(bounds.Radius, merged.Radius);
+	CHECK_EQUAL(bounds.Minimum.x, merged.Minimum.x);
+	MeshBounds empty;
+	empty.Merge(bounds);
+	CHECK_EQUAL(bounds.Radius, empty.Radius);
+	CHECK_EQUAL(bounds.Maximum.z, empty.Maximum.z);
+}
+
+TEST(MeshBounds, TransformEnclosesTheTransformedVertices)
+{
+	std::mt19937 random(7);
+	std::vector<VERTEX> vertices = CreateRandomVertices(random, 200, 2.0f);
+	MeshBounds bounds = MeshBounds::FromVertices(vertices.data(), vertices.size());
+	XMMATRIX transformations[] =
+	{
+		XMMatrixTranslation(100.0f, -5.0f, 3.0f),
+		XMMatrixRotationY(0.7f) * XMMatrixTranslation(-20.0f, 0.0f, 40.0f),
+		XMMatrixScaling(2.0f, 0.5f, 3.0f) * XMMatrixRotationY(-2.1f) * XMMatrixTranslation(0.0f, 10.0f, 0.0f)
+	};
+	for (XMMATRIX transformation : transformations)
+	{
+		MeshBounds transformed = bounds.Transform(transformation);
+		for (const VERTEX& vertex : vertices)
+		{
+			XMFLOAT3 position;
+			XMStoreFloat3(&position, XMVector3TransformCoord(XMLoadFloat3(&vertex.Position), transformation));
+			CHECK(IsInside(transformed, position));
+		}
+	}
+	CHECK(MeshBounds().Transform(XMMatrixTranslation(1.0f, 2.0f, 3.0f)).IsEmpty());
+}
@@ -0,0 +1,239 @@
+#include "TestFramework.h"
+#include "MeshOptimiser.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+typedef std::array<float, 9> TrianglePositions;
+
+// A size x size grid of cells in the xz plane, with the triangles in random order
+static void CreateShuffledGrid(int size, std::vector<VERTEX>& vertices, std::vector<unsigned int>& indices)
+{
+	vertices.clear();
+	indices.clear();
+	for (int z = 0; z <= size; z++)
+	{
+		for (int x = 0; x <= size; x++)
+		{
+			VERTEX vertex;
+			vertex.Position = XMFLOAT3(static_cast<float>(x), 0.0f, static_cast<float>(z));
+			vertex.Normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
+			vertex.TexCoord = XMFLOAT2(static_cast<float>(x) / size, static_cast<float>(z) / size);
+			vertices.push_back(vertex);
+		}
+	}
+	std::vector<std::array<unsigned int, 3>> triangles;
+	for (int z = 0; z < size; z++)
+	{
+		for (int x = 0; x < size; x++)
+		{
+			unsigned int corner = z * (size + 1) + x;
+			triangles.push_back({ corner, corner + size + 1, corner + 1 });
+			triangles.push_back({ corner + 1, corner + size + 1, corner + size + 2 });
+		}
+	}
+	std::mt19937 random(11);
+	std::shuffle(triangles.begin(), triangles.end(), random);
+	for (const std::array<unsigned int, 3>& triangle : triangles)
+	{
+		indices.insert(indices.end(), triangle.begin(), triangle.end());
+	}
+}
+
+// A sphere split into latitude bands
+static void CreateSphere(int bands, std::vector<VERTEX>& vertices, std::vector<unsigned int>& indices)
+{
+	vertices.clear();
+	indices.clear();
+	const int segments = bands * 2;
+	const float pi = 3.14159265f;
+	for (int band = 0; band <= bands; band++)
+	{
+		float latitude = pi * band / bands;
+		for (int segment = 0; segment <= segments; segment++)
+		{
+			float longitude = 2.0f * pi * segment / segments;
+			VERTEX vertex;
+			vertex.Normal = XMFLOAT3(std::sin(latitude) * std::cos(longitude), std::cos(latitude), std::sin(latitude) * std::sin(longitude));
+			vertex.Position = XMFLOAT3(vertex.Normal.x * 5.0f, vertex.Normal.y * 5.0f, vertex.Normal.z * 5.0f);
+			vertex.TexCoord = XMFLOAT2(static_cast<float>(segment) / segments, static_cast<float>(band) / bands);
+			vertices.push_back(vertex);
+		}
+	}
+	for (int band = 0; band < bands; band++)
+	{
+		for (int segment = 0; segment < segments; segment++)
+		{
+			unsigned int corner = band * (segments + 1) + segment;
+			indices.insert(indices.end(), { corner, corner + 1, corner + segments + 1, corner + 1, corner + segments + 2, corner + segments + 1 });
+		}
+	}
+}
+
+// Each triangle by the positions of its corners, starting from the smallest so that the winding
+// is kept but the first corner does not matter, in a sorted list
+static std::vector<TrianglePositions> GetTriangles(const std::vector<VERTEX>& vertices, const std::vector<unsigned int>& indices)
+{
+	std::vector<TrianglePositions> triangles;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		std::array<XMFLOAT3, 3> corners = { vertices[indices[i]].Position, vertices[indices[i + 1]].Position, vertices[indices[i + 2]].Position };
+		auto less = [](const XMFLOAT3& a, const XMFLOAT3& b) { return a.x < b.x || (a.x == b.x && (a.y < b.y || (a.y == b.y && a.z < b.z))); };
+		size_t first = std::min_element(corners.begin(), corners.end(), less) - corners.begin();
+		TrianglePositions triangle;
+		for (size_t corner = 0; corner < 3; corner++)
+		{
+			const XMFLOAT3& position = corners[(first + corner) % 3];
+			triangle[corner * 3] = position.x;
+			triangle[corner * 3 + 1] = position.y;
+			triangle[corner * 3 + 2] = position.z;
+		}
+		triangles.push_back(triangle);
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+TEST(MeshOptimiser, CountTransformsUsesAFifoCache)
+{
+	// Every vertex is new
+	CHECK_EQUAL(static_cast<size_t>(6), MeshOptimiser::CountTransforms({ 0, 1, 2, 3, 4, 5 }, 6, 16));
+	// The second triangle reuses all of the first's
+	CHECK_EQUAL(static_cast<size_t>(3), MeshOptimiser::CountTransforms({ 0, 1, 2, 2, 1, 0 }, 3, 16));
+	// With room for three, vertex 0 has gone by the time it is used again
+	CHECK_EQUAL(static_cast<size_t>(5), MeshOptimiser::CountTransforms({ 0, 1, 2, 1, 3, 0 }, 4, 3));
+	// A FIFO cache does not move a vertex to the front when it is hit, so 0 still goes first
+	// (an LRU cache would keep it, and transform only four)
+	CHECK_EQUAL(static_cast<size_t>(5), MeshOptimiser::CountTransforms({ 0, 1, 2, 0, 3, 0 }, 4, 3));
+	CHECK_EQUAL(static_cast<size_t>(0), MeshOptimiser::CountTransforms({}, 0, 16));
+	CHECK_NEAR(0.5f, MeshOptimiser::GetAcmr(50, 100), 0.0001f);
+	CHECK_NEAR(1.25f, MeshOptimiser::GetAtvr(125, 100), 0.0001f);
+}
+
+TEST(MeshOptimiser, VertexCacheOrderReusesVertices)
+{
+	std::vector<VERTEX> vertices;
+	std::vector<unsigned int> indices;
+	CreateShuffledGrid(40, vertices, indices);
+	std::vector<TrianglePositions> triangles = GetTriangles(vertices, indices);
+	size_t triangleCount = indices.size() / 3;
+	float shuffledAcmr = MeshOptimiser::GetAcmr(MeshOptimiser::CountTransforms(indices, vertices.size(), MeshOptimiser::AnalysisCacheSize), triangleCount);
+
+	MeshOptimiser::OptimiseVertexCache(indices, vertices.size());
+	float optimisedAcmr = MeshOptimiser::GetAcmr(MeshOptimiser::CountTransforms(indices, vertices.size(), MeshOptimiser::AnalysisCacheSize), triangleCount);
+	// A grid has about one vertex for every two triangles, so the best possible is about 0.5
+	CHECK(shuffledAcmr > 2.0f);
+	CHECK(optimisedAcmr < 0.8f);
+	// The same triangles, wound the same way
+	CHECK(triangles == GetTriangles(vertices, indices));
+}
+
+TEST(MeshOptimiser, OverdrawOrderDrawsOuterClustersFirst)
+{
+	// Four patches that share no vertices: two near the centre and two far out, all facing
+	// away from it, with the inner ones first
+	std::vector<VERTEX> vertices;
+	std::vector<unsigned int> indices;
+	for (float distance : { 1.0f, -1.0f, 10.0f, -10.0f })
+	{
+		std::vector<VERTEX> patchVertices;
+		std::vector<unsigned int> patchIndices;
+		CreateShuffledGrid(4, patchVertices, patchIndices);
+		MeshOptimiser::OptimiseVertexCache(patchIndices, patchVertices.size());
+		unsigned int firstVertex = static_cast<unsigned int>(vertices.size());
+		for (VERTEX vertex : patchVertices)
+		{
+			vertex.Position.y = distance;
+			vertices.push_back(vertex);
+		}
+		// The grid faces +y, so the patches below the centre are wound the other way
+		for (size_t i = 0; i < patchIndices.size(); i += 3)
+		{
+			indices.push_back(firstVertex + patchIndices[i]);
+			indices.push_back(firstVertex + patchIndices[distance < 0.0f ? i + 2 : i + 1]);
+			indices.push_back(firstVertex + patchIndices[distance < 0.0f ? i + 1 : i + 2]);
+		}
+	}
+	std::vector<TrianglePositions> triangles = GetTriangles(vertices, indices);
+	size_t transformsBefore = MeshOptimiser::CountTransforms(indices, vertices.size(), MeshOptimiser::AnalysisCacheSize);
+
+	MeshOptimiser::OptimiseOverdraw(vertices, indices);
+	CHECK(triangles == GetTriangles(vertices, indices));
+	// Nothing is shared between the patches, so moving them costs nothing
+	CHECK_EQUAL(transformsBefore, MeshOptimiser::CountTransforms(indices, vertices.size(), MeshOptimiser::AnalysisCacheSize));
+	size_t half = indices.size() / 2;
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		float distance = std::fabs(vertices[indices[i]].Position.y);
+		CHECK_EQUAL(i < half ? 10.0f : 1.0f, distance);
+	}
+}
+
+TEST(MeshOptimiser, OverdrawOrderKeepsTheCacheResult)
+{
+	std::vector<VERTEX> vertices;
+	std::vector<unsigned int> indices;
+	CreateSphere(24, vertices, indices);
+	MeshOptimiser::OptimiseVertexCache(indices, vertices.size());
+	std::vector<unsigned int> cacheOrder = indices;
+	std::vector<TrianglePositions> triangles = GetTriangles(vertices, indices);
+	size_t transformsBefore = MeshOptimiser::CountTransforms(indices, vertices.size(), MeshOptimiser::AnalysisCacheSize);
+
+	// Reordered, but no more than the threshold above the cache order's ACMR
+	MeshOptimiser::OptimiseOverdraw(vertices, indices);
+	CHECK(indices != cacheOrder);
+	CHECK(triangles == GetTriangles(vertices, indices));
+	size_t transformsAfter = MeshOptimiser::CountTransforms(indices, vertices.size(), MeshOptimiser::AnalysisCacheSize);
+	CHECK(transformsAfter <= transformsBefore * MeshOptimiser::OverdrawAcmrThreshold);
+
+	// With no increase allowed at all, the ACMR cannot get any worse
+	indices = cacheOrder;
+	MeshOptimiser::OptimiseOverdraw(vertices, indices, 1.0f);
+	CHECK(triangles == GetTriangles(vertices, indices));
+	CHECK(MeshOptimiser::CountTransforms(indices, vertices.size(), MeshOptimiser::AnalysisCacheSize) <= transformsBefore);
+
+	// With no limit, the pass does reorder the sphere, and at a cost the limit would not allow
+	indices = cacheOrder;
+	MeshOptimiser::OptimiseOverdraw(vertices, indices, 1000.0f);
+	CHECK(MeshOptimiser::CountTransforms(indices, vertices.size(), MeshOptimiser::AnalysisCacheSize) > transformsAfter);
+}
+
+TEST(MeshOptimiser, OptimiseWeldsAndReorders)
+{
+	// Every triangle with its own three vertices, as many importers give them
+	std::vector<VERTEX> gridVertices;
+	std::vector<unsigned int> gridIndices;
+	CreateShuffledGrid(32, gridVertices, gridIndices);
+	std::vector<VERTEX> vertices;
+	std::vector<unsigned int> indices;
+	for (unsigned int index : gridIndices)
+	{
+		indices.push_back(static_cast<unsigned int>(vertices.size()));
+		vertices.push_back(gridVertices[index]);
+	}
+	std::vector<TrianglePositions> triangles = GetTriangles(vertices, indices);
+
+	MeshOptimisationStatistics statistics = {};
+	MeshOptimiser::Optimise(vertices, indices, statistics);
+	CHECK(triangles == GetTriangles(vertices, indices));
+	CHECK_EQUAL(gridIndices.size(), statistics.VertexCountBefore);
+	CHECK_EQUAL(gridVertices.size(), statistics.VertexCountAfter);
+	CHECK_EQUAL(gridVertices.size(), vertices.size());
+	CHECK_EQUAL(gridIndices.size() / 3, statistics.TriangleCount);
+	CHECK_NEAR(3.0f, MeshOptimiser::GetAcmr(statistics.TransformCountBefore, statistics.TriangleCount), 0.0001f);
+	CHECK(MeshOptimiser::GetAcmr(statistics.TransformCountAfter, statistics.TriangleCount) < 0.8f);
+	// The vertices are in the order they are first used
+	unsigned int nextNew = 0;
+	for (unsigned int index : indices)
+	{
+		CHECK(index <= nextNew);
+		if (index == nextNew)
+		{
+			nextNew++;
+		}
+	}
+}
@@ -0,0 +1,159 @@
+#include "TestFramework.h"
+#include "ModelCache.h"
+#include "VertexPacker.h"
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#if defined(GRAPHICS2_HAVE_ASSIMP)
+#include "ModelImporter.h"
+#endif
+
+using namespace DirectX;
+
+// A wavy grid of size x size cells as a model, and the same grid as an OBJ file for Assimp
+static ModelData CreateGridModel(int size, const std::wstring& objFileName)
+{
+	ModelData model;
+	model.Materials.resize(1);
+	model.Materials[0].Name = L"Grid";
+	model.SubMeshes.resize(1);
+	ModelSubMeshData& subMesh = model.SubMeshes[0];
+	subMesh.MaterialIndex = 0;
+	std::string obj;
+	char line[256];
+	for (int z = 0; z <= size; z++)
+	{
+		for (int x = 0; x <= size; x++)
+		{
+			VERTEX vertex;
+			vertex.Position = XMFLOAT3(static_cast<float>(x), std::sin(x * 0.1f) * std::cos(z * 0.1f), static_cast<float>(z));
+			vertex.Normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
+			vertex.TexCoord = XMFLOAT2(static_cast<float>(x) / size, static_cast<float>(z) / size);
+			subMesh.Vertices.push_back(vertex);
+			snprintf(line, sizeof(line), "v %g %g %g\nvn 0 1 0\nvt %g %g\n", vertex.Position.x, vertex.Position.y, vertex.Position.z, vertex.TexCoord.x, vertex.TexCoord.y);
+			obj += line;
+		}
+	}
+	for (int z = 0; z < size; z++)
+	{
+		for (int x = 0; x < size; x++)
+		{
+			unsigned int topLeft = z * (size + 1) + x;
+			unsigned int bottomLeft = topLeft + size + 1;
+			subMesh.Indices.insert(subMesh.Indices.end(), { topLeft, topLeft + 1, bottomLeft, bottomLeft, topLeft + 1, bottomLeft + 1 });
+			// OBJ numbers its vertices from 1
+			snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u\nf %u/%u/%u %u/%u/%u %u/%u/%u\n",
+					 topLeft + 1, topLeft + 1, topLeft + 1, topLeft + 2, topLeft + 2, topLeft + 2, bottomLeft + 1, bottomLeft + 1, bottomLeft + 1,
+					 bottomLeft + 1, bottomLeft + 1, bottomLeft + 1, topLeft + 2, topLeft + 2, topLeft + 2, bottomLeft + 2, bottomLeft + 2, bottomLeft + 2);
+			obj += line;
+		}
+	}
+	WriteTestFile(objFileName, obj.data(), obj.size());
+	model.RootNode = std::make_shared<Node>();
+	model.RootNode->AddMesh(0);
+	return model;
+}
+
+// Loading a model as far as the buffers given to Direct3D: from the baked file with the
+// streams used where they are in the mapped file, from the baked file with the streams copied
+// out first (as ModelCache used to), and (if Assimp was found) by importing the model file.
+// The files are in the operating system's file cache after the first run, so this is the
+// cost of a warm start rather than of reading the disk.
+BENCHMARK(ModelCache, Load)
+{
+	std::wstring directory = CreateTestDirectory("ModelCacheBenchmark");
+	ModelCache cache(directory + L"/Cache");
+	printf("    %10s %10s %12s %12s %12s\n", "vertices", "file MB", "mapped ms", "copied ms", "Assimp ms");
+	for (int size = 64; size <= 1024; size *= 4)
+	{
+		std::wstring modelName = directory + L"/Grid" + std::to_wstring(size) + L".obj";
+		ModelData model = CreateGridModel(size, modelName);
+		cache.WriteModel(modelName, model);
+		PackedGeometry packed;
+
+		double mappedMilliseconds = TimeMilliseconds(5, [&]()
+		{
+			std::shared_ptr<ModelData> read = cache.ReadModel(modelName);
+			for (const ModelSubMeshData& subMesh : read->SubMeshes)
+			{
+				VertexPacker::Pack(subMesh.GetVertices(), subMesh.GetVertexCount(), subMesh.GetIndices(), subMesh.GetIndexCount(), false, packed);
+			}
+		});
+		double copiedMilliseconds = TimeMilliseconds(5, [&]()
+		{
+			std::shared_ptr<ModelData> read = cache.ReadModel(modelName);
+			for (const ModelSubMeshData& subMesh : read->SubMeshes)
+			{
+				std::vector<VERTEX> vertices(subMesh.GetVertices(), subMesh.GetVertices() + subMesh.GetVertexCount());
+				std::vector<unsigned int> indices(subMesh.GetIndices(), subMesh.GetIndices() + subMesh.GetIndexCount());
+				VertexPacker::Pack(vertices.data(), vertices.size(), indices.data(), indices.size(), false, packed);
+			}
+		});
+		char assimpColumn[32] = "n/a";
+#if defined(GRAPHICS2_HAVE_ASSIMP)
+		double assimpMilliseconds = TimeMilliseconds(2, [&]()
+		{
+			std::shared_ptr<ModelData> imported = ModelImporter::Import(modelName);
+			for (const ModelSubMeshData& subMesh : imported->SubMeshes)
+			{
+				VertexPacker::Pack(subMesh.GetVertices(), subMesh.GetVertexCount(), subMesh.GetIndices(), subMesh.GetIndexCount(), false, packed);
+			}
+		});
+		snprintf(assimpColumn, sizeof(assimpColumn), "%.2f", assimpMilliseconds);
+#endif
+		MappedFile bakedFile;
+		bakedFile.Open(cache.GetCacheFileName(modelName));
+		printf("    %10zu %10.1f %12.3f %12.3f %12s\n", model.SubMeshes[0].Vertices.size(), bakedFile.GetSize() / (1024.0 * 1024.0),
+			   mappedMilliseconds, copiedMilliseconds, assimpColumn);
+	}
+#if !defined(GRAPHICS2_HAVE_ASSIMP)
+	printf("    Assimp was not found, so importing is not timed\n");
+#endif
+}
+
+// The sample model that comes with the game, imported through Assimp against read from the
+// cache.  Without Assimp there is no way to bake it, so this needs Assimp to run.
+BENCHMARK(ModelCache, LoadSampleModel)
+{
+#if defined(GRAPHICS2_HAVE_ASSIMP)
+	std::wstring modelName = L"" GRAPHICS2_SAMPLE_MODEL;
+	std::wstring directory = CreateTestDirectory("ModelCacheSampleBenchmark");
+	ModelCache cache(directory + L"/Cache");
+	PackedGeometry packed;
+	std::shared_ptr<ModelData> imported;
+	double assimpMilliseconds = TimeMilliseconds(2, [&]()
+	{
+		imported = ModelImporter::Import(modelName);
+		for (const ModelSubMeshData& subMesh : imported->SubMeshes)
+		{
+			VertexPacker::Pack(subMesh.GetVertices(), subMesh.GetVertexCount(), subMesh.GetIndices(), subMesh.GetIndexCount(), false, packed);
+		}
+	});
+	if (imported == nullptr || !cache.WriteModel(modelName, *imported))
+	{
+		printf("    The sample model could not be imported and baked\n");
+		return;
+	}
+	double cachedMilliseconds = TimeMilliseconds(10, [&]()
+	{
+		std::shared_ptr<ModelData> read = cache.ReadModel(modelName);
+		for (const ModelSubMeshData& subMesh : read->SubMeshes)
+		{
+			VertexPacker::Pack(subMesh.GetVertices(), subMesh.GetVertexCount(), subMesh.GetIndices(), subMesh.GetIndexCount(), false, packed);
+		}
+	});
+	cache.SetVerifySource(true);
+	double verifiedMilliseconds = TimeMilliseconds(10, [&]() { cache.ReadModel(modelName); });
+	size_t vertexCount = 0;
+	for (const ModelSubMeshData& subMesh : imported->SubMeshes)
+	{
+		vertexCount += subMesh.GetVertexCount();
+	}
+	printf("    %-14s %10s %12s %12s %14s %10s\n", "model", "vertices", "Assimp ms", "cached ms", "verified ms", "speed-up");
+	printf("    %-14s %10zu %12.2f %12.3f %14.3f %9.1fx\n", "Bonanza.3ds", vertexCount, assimpMilliseconds, cachedMilliseconds,
+		   verifiedMilliseconds, assimpMilliseconds / cachedMilliseconds);
+#else
+	printf("    Assimp was not found, so the sample model cannot be imported or baked\n");
+#endif
+}
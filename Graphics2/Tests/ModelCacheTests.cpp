@@ -0,0 +1,275 @@
+#include "TestFramework.h"
+#include "ModelCache.h"
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <vector>
+
+using namespace DirectX;
+
+// Where ModelCache.cpp puts things in a baked file, for the tests that damage one
+static const size_t VersionOffset = 4;
+static const size_t SubMeshesOffsetOffset = 56;
+
+static std::vector<unsigned char> ReadFile(const std::wstring& fileName)
+{
+	MappedFile file;
+	if (!file.Open(fileName))
+	{
+		return std::vector<unsigned char>();
+	}
+	const unsigned char * data = static_cast<const unsigned char *>(file.GetData());
+	return std::vector<unsigned char>(data, data + file.GetSize());
+}
+
+// Two materials, two sub-meshes and three nodes, with names that do not fit in one byte
+static ModelData CreateModel()
+{
+	ModelData model;
+	model.Materials.resize(2);
+	model.Materials[0].Name = L"Stone";
+	model.Materials[0].DiffuseColour = XMFLOAT4(0.5f, 0.4f, 0.3f, 1.0f);
+	model.Materials[0].SpecularColour = XMFLOAT4(0.1f, 0.1f, 0.1f, 1.0f);
+	model.Materials[0].Shininess = 8.0f;
+	model.Materials[0].Opacity = 1.0f;
+	model.Materials[0].TextureName = L"Textures\\Stone.png";
+	model.Materials[1].Name = L"Gl\u00e4s \u03b1";
+	model.Materials[1].DiffuseColour = XMFLOAT4(0.8f, 0.9f, 1.0f, 1.0f);
+	model.Materials[1].SpecularColour = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+	model.Materials[1].Shininess = 64.0f;
+	model.Materials[1].Opacity = 0.25f;
+	model.SubMeshes.resize(2);
+	for (unsigned int subMesh = 0; subMesh < 2; subMesh++)
+	{
+		ModelSubMeshData& data = model.SubMeshes[subMesh];
+		data.MaterialIndex = 1 - subMesh;
+		for (unsigned int i = 0; i < 5 + subMesh * 7; i++)
+		{
+			VERTEX vertex;
+			vertex.Position = XMFLOAT3(static_cast<float>(i), static_cast<float>(subMesh), -0.5f * i);
+			vertex.Normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
+			vertex.TexCoord = XMFLOAT2(0.1f * i, 1.0f - 0.1f * i);
+			data.Vertices.push_back(vertex);
+		}
+		for (unsigned int i = 0; i + 2 < data.Vertices.size(); i++)
+		{
+			data.Indices.insert(data.Indices.end(), { i, i + 1, i + 2 });
+		}
+	}
+	model.RootNode = std::make_shared<Node>();
+	model.RootNode->SetName(L"Root");
+	std::shared_ptr<Node> body = std::make_shared<Node>();
+	body->SetName(L"Body");
+	body->AddMesh(0);
+	body->AddMesh(1);
+	body->SetTransformation(XMFLOAT4X4(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 2.0f, 0.0f, 0.0f, 0.0f, 0.0f, 3.0f, 0.0f, 4.0f, 5.0f, 6.0f, 1.0f));
+	std::shared_ptr<Node> wheel = std::make_shared<Node>();
+	wheel->SetName(L"Wheel");
+	wheel->AddMesh(1);
+	body->AddChild(wheel);
+	model.RootNode->AddChild(body);
+	model.OptimisationStatistics.VertexCountBefore = 20;
+	model.OptimisationStatistics.VertexCountAfter = 17;
+	model.OptimisationStatistics.TriangleCount = 13;
+	model.OptimisationStatistics.TransformCountBefore = 39;
+	model.OptimisationStatistics.TransformCountAfter = 17;
+	return model;
+}
+
+static bool SameNodes(Node& expected, Node& actual)
+{
+	if (expected.GetName() != actual.GetName() ||
+		expected.GetMeshCount() != actual.GetMeshCount() ||
+		expected.GetChildrenCount() != actual.GetChildrenCount() ||
+		memcmp(&expected.GetTransformation(), &actual.GetTransformation(), sizeof(XMFLOAT4X4)) != 0)
+	{
+		return false;
+	}
+	for (unsigned int i = 0; i < expected.GetMeshCount(); i++)
+	{
+		if (expected.GetMesh(i) != actual.GetMesh(i))
+		{
+			return false;
+		}
+	}
+	for (unsigned int i = 0; i < expected.GetChildrenCount(); i++)
+	{
+		if (!SameNodes(*expected.GetChild(i), *actual.GetChild(i)))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Writes the model file the baked model is made from, and bakes the model
+static std::wstring WriteBakedModel(const std::wstring& directory, ModelCache& cache, const ModelData& model)
+{
+	std::wstring modelName = directory + L"/Model.obj";
+	const char source[] = "# Stands in for the model file\nv 0 0 0\n";
+	WriteTestFile(modelName, source, sizeof(source) - 1);
+	CHECK(cache.WriteModel(modelName, model));
+	return modelName;
+}
+
+TEST(ModelCache, RoundTrip)
+{
+	std::wstring directory = CreateTestDirectory("ModelCache");
+	ModelCache cache(directory + L"/Cache");
+	ModelData model = CreateModel();
+	std::wstring modelName = WriteBakedModel(directory, cache, model);
+	CHECK(!std::filesystem::exists(cache.GetCacheFileName(modelName) + L".tmp"));
+
+	std::shared_ptr<ModelData> read = cache.ReadModel(modelName);
+	CHECK(read != nullptr);
+	if (read == nullptr)
+	{
+		return;
+	}
+	CHECK_EQUAL(model.Materials.size(), read->Materials.size());
+	for (size_t i = 0; i < model.Materials.size() && i < read->Materials.size(); i++)
+	{
+		CHECK(model.Materials[i].Name == read->Materials[i].Name);
+		CHECK(model.Materials[i].TextureName == read->Materials[i].TextureName);
+		CHECK(memcmp(&model.Materials[i].DiffuseColour, &read->Materials[i].DiffuseColour, sizeof(XMFLOAT4)) == 0);
+		CHECK(memcmp(&model.Materials[i].SpecularColour, &read->Materials[i].SpecularColour, sizeof(XMFLOAT4)) == 0);
+		CHECK_EQUAL(model.Materials[i].Shininess, read->Materials[i].Shininess);
+		CHECK_EQUAL(model.Materials[i].Opacity, read->Materials[i].Opacity);
+	}
+	CHECK_EQUAL(model.SubMeshes.size(), read->SubMeshes.size());
+	for (size_t i = 0; i < model.SubMeshes.size() && i < read->SubMeshes.size(); i++)
+	{
+		const ModelSubMeshData& expected = model.SubMeshes[i];
+		const ModelSubMeshData& actual = read->SubMeshes[i];
+		CHECK_EQUAL(expected.MaterialIndex, actual.MaterialIndex);
+		CHECK_EQUAL(expected.Vertices.size(), actual.GetVertexCount());
+		CHECK_EQUAL(expected.Indices.size(), actual.GetIndexCount());
+		CHECK(memcmp(expected.Vertices.data(), actual.GetVertices(), expected.Vertices.size() * sizeof(VERTEX)) == 0);
+		CHECK(memcmp(expected.Indices.data(), actual.GetIndices(), expected.Indices.size() * sizeof(unsigned int)) == 0);
+		// The streams are used where they are in the mapped file, not copied out of it
+		CHECK(actual.Vertices.empty() && actual.Indices.empty());
+		const unsigned char * fileStart = static_cast<const unsigned char *>(read->MappedStorage->GetData());
+		const unsigned char * vertices = reinterpret_cast<const unsigned char *>(actual.GetVertices());
+		CHECK(vertices > fileStart && vertices < fileStart + read->MappedStorage->GetSize());
+	}
+	CHECK(SameNodes(*model.RootNode, *read->RootNode));
+	CHECK(memcmp(&model.OptimisationStatistics, &read->OptimisationStatistics, sizeof(MeshOptimisationStatistics)) == 0);
+
+	// A model read back from the cache can be baked again, and gives the same file
+	std::vector<unsigned char> firstFile = ReadFile(cache.GetCacheFileName(modelName));
+	ModelCache otherCache(directory + L"/OtherCache");
+	CHECK(otherCache.WriteModel(modelName, *read));
+	CHECK(firstFile == ReadFile(otherCache.GetCacheFileName(modelName)));
+}
+
+TEST(ModelCache, RejectsStaleFiles)
+{
+	std::wstring directory = CreateTestDirectory("ModelCache");
+	ModelCache cache(directory + L"/Cache");
+	std::wstring modelName = WriteBakedModel(directory, cache, CreateModel());
+	std::wstring cacheFileName = cache.GetCacheFileName(modelName);
+	std::vector<unsigned char> goodFile = ReadFile(cacheFileName);
+	CHECK(cache.ReadModel(modelName) != nullptr);
+
+	std::vector<unsigned char> contents = goodFile;
+	contents[0] = 'X';
+	WriteTestFile(cacheFileName, contents.data(), contents.size());
+	CHECK(cache.ReadModel(modelName) == nullptr);
+
+	contents = goodFile;
+	contents[VersionOffset]++;
+	WriteTestFile(cacheFileName, contents.data(), contents.size());
+	CHECK(cache.ReadModel(modelName) == nullptr);
+
+	// Another model's baked file, under this model's name
+	std::wstring otherModelName = directory + L"/Other.obj";
+	WriteTestFile(otherModelName, "# Stands in for the model file\nv 0 0 0\n", 39);
+	WriteTestFile(cache.GetCacheFileName(otherModelName), goodFile.data(), goodFile.size());
+	CHECK(cache.ReadModel(otherModelName) == nullptr);
+
+	// The model file has changed since it was baked
+	WriteTestFile(cacheFileName, goodFile.data(), goodFile.size());
+	CHECK(cache.ReadModel(modelName) != nullptr);
+	const char changedSource[] = "# Stands in for the model file\nv 0 0 1\n";
+	std::filesystem::file_time_type bakedTime = std::filesystem::last_write_time(modelName);
+	WriteTestFile(modelName, changedSource, sizeof(changedSource) - 1);
+	std::filesystem::last_write_time(modelName, bakedTime + std::chrono::seconds(2));
+	CHECK(cache.ReadModel(modelName) == nullptr);
+
+	// And without a model file there is nothing to check the baked file against
+	std::filesystem::remove(modelName);
+	CHECK(cache.ReadModel(modelName) == nullptr);
+}
+
+TEST(ModelCache, OnlyHashesTheModelFileWhenItLooksChanged)
+{
+	std::wstring directory = CreateTestDirectory("ModelCache");
+	ModelCache cache(directory + L"/Cache");
+	std::wstring modelName = WriteBakedModel(directory, cache, CreateModel());
+	std::filesystem::file_time_type bakedTime = std::filesystem::last_write_time(modelName);
+
+	// Touched but not changed, the contents are checked and still match
+	std::filesystem::last_write_time(modelName, bakedTime + std::chrono::seconds(10));
+	CHECK(cache.ReadModel(modelName) != nullptr);
+
+	// Changed without changing the size or the time, which only hashing every time notices
+	const char changedSource[] = "# Stands in for the model file\nv 0 0 1\n";
+	WriteTestFile(modelName, changedSource, sizeof(changedSource) - 1);
+	std::filesystem::last_write_time(modelName, bakedTime);
+	CHECK(cache.ReadModel(modelName) != nullptr);
+	cache.SetVerifySource(true);
+	CHECK(cache.ReadModel(modelName) == nullptr);
+	cache.SetVerifySource(false);
+
+	// A different size is always checked
+	const char longerSource[] = "# Stands in for the model file\nv 0 0 10\n";
+	WriteTestFile(modelName, longerSource, sizeof(longerSource) - 1);
+	std::filesystem::last_write_time(modelName, bakedTime);
+	CHECK(cache.ReadModel(modelName) == nullptr);
+}
+
+TEST(ModelCache, RejectsDamagedSections)
+{
+	std::wstring directory = CreateTestDirectory("ModelCache");
+	ModelCache cache(directory + L"/Cache");
+	std::wstring modelName = WriteBakedModel(directory, cache, CreateModel());
+	std::wstring cacheFileName = cache.GetCacheFileName(modelName);
+	std::vector<unsigned char> goodFile = ReadFile(cacheFileName);
+
+	// Cut short anywhere, the file is not used
+	for (size_t size : { static_cast<size_t>(0), static_cast<size_t>(16), goodFile.size() / 4, goodFile.size() / 2, goodFile.size() - 1 })
+	{
+		WriteTestFile(cacheFileName, goodFile.data(), size);
+		CHECK(cache.ReadModel(modelName) == nullptr);
+	}
+
+	// The sub-mesh table moved off its 16 byte boundary
+	std::vector<unsigned char> contents = goodFile;
+	uint64_t subMeshesOffset;
+	memcpy(&subMeshesOffset, &contents[SubMeshesOffsetOffset], sizeof(uint64_t));
+	uint64_t misaligned = subMeshesOffset + 4;
+	memcpy(&contents[SubMeshesOffsetOffset], &misaligned, sizeof(uint64_t));
+	WriteTestFile(cacheFileName, contents.data(), contents.size());
+	CHECK(cache.ReadModel(modelName) == nullptr);
+
+	// A sub-mesh whose vertices are misaligned, or run past the end of the file.  The first
+	// field of each entry in the sub-mesh table is the offset of its vertices.
+	const std::function<uint64_t(uint64_t)> changes[] = { [](uint64_t offset) { return offset + 8; },
+														  [&](uint64_t) { return (goodFile.size() & ~static_cast<uint64_t>(15)) - 16; },
+														  [](uint64_t offset) { return offset + (static_cast<uint64_t>(1) << 40); } };
+	for (const std::function<uint64_t(uint64_t)>& change : changes)
+	{
+		contents = goodFile;
+		uint64_t verticesOffset;
+		memcpy(&verticesOffset, &contents[static_cast<size_t>(subMeshesOffset)], sizeof(uint64_t));
+		verticesOffset = change(verticesOffset);
+		memcpy(&contents[static_cast<size_t>(subMeshesOffset)], &verticesOffset, sizeof(uint64_t));
+		WriteTestFile(cacheFileName, contents.data(), contents.size());
+		CHECK(cache.ReadModel(modelName) == nullptr);
+	}
+
+	// Undamaged, it is used again
+	WriteTestFile(cacheFileName, goodFile.data(), goodFile.size());
+	CHECK(cache.ReadModel(modelName) != nullptr);
+}
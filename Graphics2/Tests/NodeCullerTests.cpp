@@ -0,0 +1,156 @@
+#include "TestFramework.h"
+#include "NodeCuller.h"
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+// The bounds of a 2 x 2 x 2 cube centred on centre
+static MeshBounds CreateCubeBounds(const XMFLOAT3& centre)
+{
+	VERTEX corners[2] = {};
+	corners[0].Position = XMFLOAT3(centre.x - 1.0f, centre.y - 1.0f, centre.z - 1.0f);
+	corners[1].Position = XMFLOAT3(centre.x + 1.0f, centre.y + 1.0f, centre.z + 1.0f);
+	return MeshBounds::FromVertices(corners, 2);
+}
+
+static std::shared_ptr<Node> CreateNode(const std::wstring& name, const XMFLOAT3& position)
+{
+	std::shared_ptr<Node> node = std::make_shared<Node>();
+	node->SetName(name);
+	XMFLOAT4X4 transformation;
+	XMStoreFloat4x4(&transformation, XMMatrixTranslation(position.x, position.y, position.z));
+	node->SetTransformation(transformation);
+	return node;
+}
+
+// At the origin looking along +z, with a 90 degree field of view and the far plane at z = 100
+static Frustum CreateFrustum()
+{
+	XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 1.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	return Frustum(view * XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.0f, 1.0f, 100.0f));
+}
+
+// A test scene.  Every sub-mesh is a cube at the origin of its node except sub-mesh 3, which
+// is off to the side:
+//
+//   Root
+//     Behind (z = -50)       sub-meshes 0, 1
+//       BehindChild          sub-mesh 2
+//     Ahead (z = 50)         sub-meshes 0, 3 (3 is at x = 500, so out of view)
+//       AheadChild (y = 5)   sub-mesh 1
+//         Inner              sub-mesh 2
+//     Far (z = 1000)         sub-mesh 0
+struct TestScene
+{
+	std::shared_ptr<Node>				Root;
+	std::vector<MeshBounds>				SubMeshBounds;
+
+	TestScene()
+	{
+		SubMeshBounds = { CreateCubeBounds(XMFLOAT3(0.0f, 0.0f, 0.0f)), CreateCubeBounds(XMFLOAT3(0.0f, 0.0f, 0.0f)),
+						  CreateCubeBounds(XMFLOAT3(0.0f, 0.0f, 0.0f)), CreateCubeBounds(XMFLOAT3(500.0f, 0.0f, 0.0f)) };
+		Root = CreateNode(L"Root", XMFLOAT3(0.0f, 0.0f, 0.0f));
+		std::shared_ptr<Node> behind = CreateNode(L"Behind", XMFLOAT3(0.0f, 0.0f, -50.0f));
+		behind->AddMesh(0);
+		behind->AddMesh(1);
+		std::shared_ptr<Node> behindChild = CreateNode(L"BehindChild", XMFLOAT3(0.0f, 0.0f, 0.0f));
+		behindChild->AddMesh(2);
+		behind->AddChild(behindChild);
+		std::shared_ptr<Node> ahead = CreateNode(L"Ahead", XMFLOAT3(0.0f, 0.0f, 50.0f));
+		ahead->AddMesh(0);
+		ahead->AddMesh(3);
+		std::shared_ptr<Node> aheadChild = CreateNode(L"AheadChild", XMFLOAT3(0.0f, 5.0f, 0.0f));
+		aheadChild->AddMesh(1);
+		std::shared_ptr<Node> inner = CreateNode(L"Inner", XMFLOAT3(0.0f, 0.0f, 0.0f));
+		inner->AddMesh(2);
+		aheadChild->AddChild(inner);
+		ahead->AddChild(aheadChild);
+		std::shared_ptr<Node> far = CreateNode(L"Far", XMFLOAT3(0.0f, 0.0f, 1000.0f));
+		far->AddMesh(0);
+		Root->AddChild(behind);
+		Root->AddChild(ahead);
+		Root->AddChild(far);
+		NodeCuller::CalculateBounds(*Root, SubMeshBounds);
+	}
+};
+
+TEST(NodeCuller, BoundsEncloseTheChildrenWhereTheyArePlaced)
+{
+	TestScene scene;
+	const MeshBounds& rootBounds = scene.Root->GetBounds();
+	CHECK_NEAR(-51.0f, rootBounds.Minimum.z, 0.0001f);
+	CHECK_NEAR(1001.0f, rootBounds.Maximum.z, 0.0001f);
+	CHECK_NEAR(501.0f, rootBounds.Maximum.x, 0.0001f);
+	CHECK_NEAR(6.0f, rootBounds.Maximum.y, 0.0001f);
+	// Each node's bounds are in its own space, before its transformation
+	const MeshBounds& aheadBounds = scene.Root->GetChild(1)->GetBounds();
+	CHECK_NEAR(-1.0f, aheadBounds.Minimum.z, 0.0001f);
+	CHECK_NEAR(6.0f, aheadBounds.Maximum.y, 0.0001f);
+	CHECK(scene.Root->GetChild(1)->GetChild(0)->GetChild(0)->GetBounds().Maximum.y < 1.5f);
+}
+
+TEST(NodeCuller, CountsWhatIsCulledAndDrawn)
+{
+	TestScene scene;
+	NodeCuller culler;
+	std::map<std::wstring, std::vector<unsigned int>> visited;
+	std::map<std::wstring, XMFLOAT4X4> transformations;
+	culler.Cull(*scene.Root, XMMatrixIdentity(), true, CreateFrustum(), scene.SubMeshBounds,
+				[](unsigned int) { return true; },
+				[&](Node& node, FXMMATRIX nodeTransformation, const std::vector<unsigned int>& meshIndices)
+	{
+		visited[node.GetName()] = meshIndices;
+		XMStoreFloat4x4(&transformations[node.GetName()], nodeTransformation);
+	});
+
+	// Behind and Far are rejected without looking at what is below them, and sub-mesh 3 of
+	// Ahead is out of view on its own
+	MeshCullingStatistics statistics = culler.TakeStatistics();
+	CHECK_EQUAL(2u, statistics.NodesCulled);
+	CHECK_EQUAL(1u, statistics.SubMeshesCulled);
+	CHECK_EQUAL(3u, statistics.SubMeshesDrawn);
+	CHECK_EQUAL(static_cast<size_t>(3), visited.size());
+	CHECK(visited[L"Ahead"] == std::vector<unsigned int>({ 0 }));
+	CHECK(visited[L"AheadChild"] == std::vector<unsigned int>({ 1 }));
+	CHECK(visited[L"Inner"] == std::vector<unsigned int>({ 2 }));
+	// The transformations are accumulated down the tree
+	CHECK_NEAR(5.0f, transformations[L"Inner"]._42, 0.0001f);
+	CHECK_NEAR(50.0f, transformations[L"Inner"]._43, 0.0001f);
+
+	// Taking the counts starts them again
+	statistics = culler.TakeStatistics();
+	CHECK_EQUAL(0u, statistics.NodesCulled + statistics.SubMeshesCulled + statistics.SubMeshesDrawn);
+}
+
+TEST(NodeCuller, VisitsEverythingWithoutTesting)
+{
+	TestScene scene;
+	NodeCuller culler;
+	unsigned int visitedMeshes = 0;
+	culler.Cull(*scene.Root, XMMatrixIdentity(), false, CreateFrustum(), scene.SubMeshBounds,
+				[](unsigned int) { return true; },
+				[&](Node&, FXMMATRIX, const std::vector<unsigned int>& meshIndices) { visitedMeshes += static_cast<unsigned int>(meshIndices.size()); });
+	MeshCullingStatistics statistics = culler.TakeStatistics();
+	CHECK_EQUAL(8u, visitedMeshes);
+	CHECK_EQUAL(8u, statistics.SubMeshesDrawn);
+	CHECK_EQUAL(0u, statistics.NodesCulled + statistics.SubMeshesCulled);
+}
+
+TEST(NodeCuller, FilteredSubMeshesAreNotCounted)
+{
+	TestScene scene;
+	NodeCuller culler;
+	std::vector<unsigned int> visitedMeshes;
+	// Only sub-meshes 0 and 3, as the opaque pass would skip the transparent ones
+	culler.Cull(*scene.Root, XMMatrixIdentity(), true, CreateFrustum(), scene.SubMeshBounds,
+				[](unsigned int meshIndex) { return meshIndex == 0 || meshIndex == 3; },
+				[&](Node&, FXMMATRIX, const std::vector<unsigned int>& meshIndices) { visitedMeshes.insert(visitedMeshes.end(), meshIndices.begin(), meshIndices.end()); });
+	MeshCullingStatistics statistics = culler.TakeStatistics();
+	CHECK(visitedMeshes == std::vector<unsigned int>({ 0 }));
+	CHECK_EQUAL(1u, statistics.SubMeshesDrawn);
+	CHECK_EQUAL(1u, statistics.SubMeshesCulled);
+	CHECK_EQUAL(2u, statistics.NodesCulled);
+}
@@ -0,0 +1,76 @@
+#include "TestFramework.h"
+#include "OcclusionCuller.h"
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace DirectX;
+
+// Rolling hills, 1024 cells across, with the camera low down in a valley so that the hills in
+// front hide much of what is behind them
+static std::vector<VERTEX> CreateHills(int cells, float cellSize)
+{
+	std::vector<VERTEX> vertices;
+	vertices.reserve(static_cast<size_t>(cells + 1) * (cells + 1));
+	for (int z = 0; z <= cells; z++)
+	{
+		for (int x = 0; x <= cells; x++)
+		{
+			VERTEX vertex = {};
+			vertex.Position = XMFLOAT3((x - cells / 2) * cellSize,
+									   40.0f * std::sin(x * 0.02f) * std::sin(z * 0.015f) + 10.0f * std::cos(x * 0.07f + z * 0.05f),
+									   (cells / 2 - z) * cellSize);
+			vertices.push_back(vertex);
+		}
+	}
+	return vertices;
+}
+
+// What one frame of occlusion culling costs (drawing the terrain's occluder and testing a box
+// for each object) against how many of the objects it saves drawing.  Objects stand on the
+// terrain in a regular grid.
+BENCHMARK(OcclusionCuller, CostAgainstBenefit)
+{
+	const int cells = 1024;
+	const float cellSize = 2.0f;
+	std::vector<VERTEX> vertices = CreateHills(cells, cellSize);
+	XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0.0f, 12.0f, -900.0f, 1.0f), XMVectorSet(0.0f, 5.0f, 0.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMMATRIX viewProjection = view * XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 1.0f, 5000.0f);
+
+	std::vector<XMFLOAT3> boxMinimums;
+	std::vector<XMFLOAT3> boxMaximums;
+	const int verticesPerRow = cells + 1;
+	for (int z = 8; z < cells; z += 16)
+	{
+		for (int x = 8; x < cells; x += 16)
+		{
+			const XMFLOAT3& ground = vertices[static_cast<size_t>(z) * verticesPerRow + x].Position;
+			boxMinimums.push_back(XMFLOAT3(ground.x - 2.0f, ground.y, ground.z - 2.0f));
+			boxMaximums.push_back(XMFLOAT3(ground.x + 2.0f, ground.y + 6.0f, ground.z + 2.0f));
+		}
+	}
+
+	printf("    %10s %6s %10s %10s %10s %12s\n", "occluder", "SSE", "draw ms", "test ms", "boxes", "occluded");
+	for (int occluderCells = 16; occluderCells <= 128; occluderCells *= 2)
+	{
+		std::shared_ptr<OccluderMesh> occluder = OcclusionCuller::CreateHeightfieldOccluder(vertices, verticesPerRow, occluderCells);
+		for (bool simd : { false, true })
+		{
+			OcclusionCuller culler;
+			culler.SetSimdEnabled(simd);
+			culler.AddOccluder(occluder);
+			double drawMilliseconds = TimeMilliseconds(20, [&]() { culler.BeginFrame(viewProjection); });
+			unsigned int occluded = 0;
+			double testMilliseconds = TimeMilliseconds(20, [&]()
+			{
+				occluded = 0;
+				for (size_t i = 0; i < boxMinimums.size(); i++)
+				{
+					occluded += culler.IsBoxVisible(boxMinimums[i], boxMaximums[i]) ? 0 : 1;
+				}
+			});
+			printf("    %7dx%-2d %6s %10.3f %10.3f %10zu %11.1f%%\n", occluderCells, occluderCells, simd ? "yes" : "no",
+				   drawMilliseconds, testMilliseconds, boxMinimums.size(), 100.0 * occluded / boxMinimums.size());
+		}
+	}
+}
@@ -0,0 +1,280 @@
+#include "TestFramework.h"
+#include "OcclusionCuller.h"
+#include <cmath>
+#include <vector>
+
+using namespace DirectX;
+
+static const int Width = 256;
+static const int Height = 128;
+
+static XMMATRIX CreateViewProjection(const XMFLOAT3& eye, const XMFLOAT3& focus)
+{
+	XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(eye.x, eye.y, eye.z, 1.0f), XMVectorSet(focus.x, focus.y, focus.z, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	return view * XMMatrixPerspectiveFovLH(XM_PIDIV4, static_cast<float>(Width) / Height, 1.0f, 1000.0f);
+}
+
+// A quad of two triangles, corners in order around it
+static OccluderMesh CreateQuad(const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2, const XMFLOAT3& p3, bool findNeighbours = true)
+{
+	OccluderMesh quad;
+	quad.Positions = { p0, p1, p2, p3 };
+	quad.Indices = { 0, 1, 2, 0, 2, 3 };
+	XMStoreFloat4x4(&quad.WorldTransformation, XMMatrixIdentity());
+	if (findNeighbours)
+	{
+		OcclusionCuller::FindNeighbours(quad);
+	}
+	return quad;
+}
+
+// A wall 20 wide and 10 high, facing a camera at the origin from 20 away
+static OccluderMesh CreateWall(bool findNeighbours = true)
+{
+	return CreateQuad(XMFLOAT3(-10.0f, -5.0f, 20.0f), XMFLOAT3(-10.0f, 5.0f, 20.0f), XMFLOAT3(10.0f, 5.0f, 20.0f), XMFLOAT3(10.0f, -5.0f, 20.0f), findNeighbours);
+}
+
+static XMFLOAT4 ToScreen(FXMMATRIX viewProjection, const XMFLOAT3& position)
+{
+	XMFLOAT4 clip;
+	XMStoreFloat4(&clip, XMVector3Transform(XMLoadFloat3(&position), viewProjection));
+	return XMFLOAT4((clip.x / clip.w * 0.5f + 0.5f) * Width, (0.5f - clip.y / clip.w * 0.5f) * Height, clip.z / clip.w, 1.0f);
+}
+
+// A bumpy grid of terrain vertices, centred on the origin
+static std::vector<VERTEX> CreateTerrain(int cells, float cellSize)
+{
+	std::vector<VERTEX> vertices;
+	for (int z = 0; z <= cells; z++)
+	{
+		for (int x = 0; x <= cells; x++)
+		{
+			VERTEX vertex = {};
+			vertex.Position = XMFLOAT3((x - cells / 2) * cellSize, 3.0f * std::sin(x * 0.7f) * std::cos(z * 0.4f), (cells / 2 - z) * cellSize);
+			vertices.push_back(vertex);
+		}
+	}
+	return vertices;
+}
+
+TEST(OcclusionCuller, WallHidesWhatIsBehindIt)
+{
+	OcclusionCuller culler(Width, Height);
+	OccluderMesh wall = CreateWall();
+	culler.BeginFrame(CreateViewProjection(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 1.0f)));
+	culler.DrawOccluder(wall);
+	CHECK_EQUAL(2u, culler.GetStatistics().TrianglesDrawn);
+
+	CHECK(!culler.IsBoxVisible(XMFLOAT3(-2.0f, -1.0f, 30.0f), XMFLOAT3(2.0f, 1.0f, 32.0f)));
+	// In front of the wall, beside it and above it
+	CHECK(culler.IsBoxVisible(XMFLOAT3(-2.0f, -1.0f, 10.0f), XMFLOAT3(2.0f, 1.0f, 12.0f)));
+	CHECK(culler.IsBoxVisible(XMFLOAT3(20.0f, -1.0f, 30.0f), XMFLOAT3(24.0f, 1.0f, 32.0f)));
+	CHECK(culler.IsBoxVisible(XMFLOAT3(-2.0f, 9.0f, 30.0f), XMFLOAT3(2.0f, 11.0f, 32.0f)));
+	// Partly through the wall
+	CHECK(culler.IsBoxVisible(XMFLOAT3(-2.0f, -1.0f, 19.0f), XMFLOAT3(2.0f, 1.0f, 32.0f)));
+	CHECK_EQUAL(5u, culler.GetStatistics().BoxesTested);
+	CHECK_EQUAL(1u, culler.GetStatistics().BoxesOccluded);
+}
+
+TEST(OcclusionCuller, OnlyWritesPixelsTheOccluderCoversCompletely)
+{
+	OcclusionCuller culler(Width, Height);
+	OccluderMesh wall = CreateWall();
+	XMMATRIX viewProjection = CreateViewProjection(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 1.0f));
+	culler.BeginFrame(viewProjection);
+	culler.DrawOccluder(wall);
+	XMFLOAT4 topLeft = ToScreen(viewProjection, wall.Positions[1]);
+	XMFLOAT4 bottomRight = ToScreen(viewProjection, wall.Positions[3]);
+	const std::vector<float>& depth = culler.GetDepthBuffer();
+	unsigned int written = 0;
+	for (int y = 0; y < Height; y++)
+	{
+		for (int x = 0; x < Width; x++)
+		{
+			bool inside = x >= topLeft.x && x + 1 <= bottomRight.x && y >= topLeft.y && y + 1 <= bottomRight.y;
+			float pixel = depth[static_cast<size_t>(y) * Width + x];
+			if (inside)
+			{
+				// Including the pixels along the diagonal, which neither triangle covers alone
+				CHECK_NEAR(topLeft.z, pixel, 0.0001f);
+				CHECK(pixel >= topLeft.z);
+				written++;
+			}
+			else
+			{
+				CHECK_EQUAL(1.0f, pixel);
+			}
+		}
+	}
+	CHECK(written > 1000);
+
+	// Without its neighbours, the pixels the two triangles only cover together are left empty
+	OcclusionCuller alone(Width, Height);
+	OccluderMesh wallAlone = CreateWall(false);
+	alone.BeginFrame(viewProjection);
+	alone.DrawOccluder(wallAlone);
+	unsigned int writtenAlone = 0;
+	for (float pixel : alone.GetDepthBuffer())
+	{
+		writtenAlone += pixel < 1.0f ? 1 : 0;
+	}
+	CHECK(writtenAlone < written);
+	CHECK(writtenAlone > written / 2);
+}
+
+TEST(OcclusionCuller, GroundHidesWhatIsBelowIt)
+{
+	const int cells = 32;
+	std::vector<VERTEX> vertices = CreateTerrain(cells, 10.0f);
+	for (VERTEX& vertex : vertices)
+	{
+		vertex.Position.y = 0.0f;
+	}
+	std::shared_ptr<OccluderMesh> ground = OcclusionCuller::CreateHeightfieldOccluder(vertices, cells + 1, 8);
+	OcclusionCuller culler(Width, Height);
+	culler.AddOccluder(ground);
+	// Standing on the ground looking along it, so the ground also crosses the near plane
+	culler.BeginFrame(CreateViewProjection(XMFLOAT3(0.0f, 2.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 50.0f)));
+	CHECK_EQUAL(1u, culler.GetStatistics().OccludersDrawn);
+
+	CHECK(!culler.IsBoxVisible(XMFLOAT3(-2.0f, -5.0f, 40.0f), XMFLOAT3(2.0f, -3.0f, 44.0f)));
+	CHECK(!culler.IsBoxVisible(XMFLOAT3(-20.0f, -8.0f, 60.0f), XMFLOAT3(-10.0f, -6.0f, 70.0f)));
+	CHECK(culler.IsBoxVisible(XMFLOAT3(-2.0f, 0.5f, 40.0f), XMFLOAT3(2.0f, 2.0f, 44.0f)));
+	// Half buried
+	CHECK(culler.IsBoxVisible(XMFLOAT3(-2.0f, -1.0f, 40.0f), XMFLOAT3(2.0f, 1.0f, 44.0f)));
+	// Past the far edge of the ground
+	CHECK(culler.IsBoxVisible(XMFLOAT3(-2.0f, -5.0f, 200.0f), XMFLOAT3(2.0f, -3.0f, 204.0f)));
+
+	// Once the ground is released, nothing is hidden
+	ground.reset();
+	culler.BeginFrame(CreateViewProjection(XMFLOAT3(0.0f, 2.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 50.0f)));
+	CHECK_EQUAL(0u, culler.GetStatistics().OccludersDrawn);
+	CHECK(culler.IsBoxVisible(XMFLOAT3(-2.0f, -5.0f, 40.0f), XMFLOAT3(2.0f, -3.0f, 44.0f)));
+}
+
+TEST(OcclusionCuller, ClipsOccludersAtTheNearPlane)
+{
+	OcclusionCuller culler(Width, Height);
+	// A slope that starts behind the camera and rises away from it
+	OccluderMesh slope = CreateQuad(XMFLOAT3(-50.0f, -20.0f, -10.0f), XMFLOAT3(-50.0f, 20.0f, 50.0f), XMFLOAT3(50.0f, 20.0f, 50.0f), XMFLOAT3(50.0f, -20.0f, -10.0f));
+	culler.BeginFrame(CreateViewProjection(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 1.0f)));
+	culler.DrawOccluder(slope);
+	for (float pixel : culler.GetDepthBuffer())
+	{
+		CHECK(pixel >= 0.0f && pixel <= 1.0f);
+	}
+	// Where the camera looks up at (0, 10, 45), the slope is at a distance of 30
+	CHECK(!culler.IsBoxVisible(XMFLOAT3(-1.0f, 9.0f, 44.0f), XMFLOAT3(1.0f, 11.0f, 46.0f)));
+	CHECK(culler.IsBoxVisible(XMFLOAT3(-1.0f, 5.0f, 20.0f), XMFLOAT3(1.0f, 7.0f, 22.0f)));
+	// A box across the near plane is always visible, even if it is also behind the slope
+	CHECK(culler.IsBoxVisible(XMFLOAT3(-1.0f, 9.0f, -1.0f), XMFLOAT3(1.0f, 11.0f, 46.0f)));
+
+	// An occluder wholly behind the camera draws nothing
+	OcclusionCuller behindCuller(Width, Height);
+	OccluderMesh behind = CreateQuad(XMFLOAT3(-10.0f, -5.0f, -20.0f), XMFLOAT3(-10.0f, 5.0f, -20.0f), XMFLOAT3(10.0f, 5.0f, -20.0f), XMFLOAT3(10.0f, -5.0f, -20.0f));
+	behindCuller.BeginFrame(CreateViewProjection(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 1.0f)));
+	behindCuller.DrawOccluder(behind);
+	for (float pixel : behindCuller.GetDepthBuffer())
+	{
+		CHECK_EQUAL(1.0f, pixel);
+	}
+}
+
+TEST(OcclusionCuller, BoxesJustPastTheSilhouetteAreVisible)
+{
+	OcclusionCuller culler(Width, Height);
+	OccluderMesh wall = CreateWall();
+	culler.BeginFrame(CreateViewProjection(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 1.0f)));
+	culler.DrawOccluder(wall);
+	// Slide a box behind the wall out past its right hand edge, a small fraction of a pixel at a
+	// time.  The wall's edge is at x / z = 0.5, so a box from z = 30 pokes out once its right
+	// hand side is past x = 15.  A pixel is about 0.2 across at that distance.
+	unsigned int hidden = 0;
+	for (float right = 12.0f; right < 17.0f; right += 0.01f)
+	{
+		bool visible = culler.IsBoxVisible(XMFLOAT3(right - 2.0f, -1.0f, 30.0f), XMFLOAT3(right, 1.0f, 31.0f));
+		if (right > 15.0f)
+		{
+			CHECK(visible);
+		}
+		else if (right < 14.5f)
+		{
+			CHECK(!visible);
+		}
+		hidden += visible ? 0 : 1;
+	}
+	CHECK(hidden >= 250);
+
+	// The same along the wall's top edge, at y / z = 0.25
+	for (float top = 6.0f; top < 9.0f; top += 0.01f)
+	{
+		bool visible = culler.IsBoxVisible(XMFLOAT3(-1.0f, top - 2.0f, 30.0f), XMFLOAT3(1.0f, top, 31.0f));
+		if (top > 7.5f)
+		{
+			CHECK(visible);
+		}
+	}
+}
+
+TEST(OcclusionCuller, SimdAndScalarDrawTheSameDepth)
+{
+	const int cells = 64;
+	std::vector<VERTEX> vertices = CreateTerrain(cells, 4.0f);
+	std::shared_ptr<OccluderMesh> terrain = OcclusionCuller::CreateHeightfieldOccluder(vertices, cells + 1, 16);
+	XMMATRIX viewProjection = CreateViewProjection(XMFLOAT3(-30.0f, 8.0f, -140.0f), XMFLOAT3(10.0f, 0.0f, 0.0f));
+	OcclusionCuller simdCuller(Width, Height);
+	simdCuller.BeginFrame(viewProjection);
+	simdCuller.DrawOccluder(*terrain);
+	OcclusionCuller scalarCuller(Width, Height);
+	scalarCuller.SetSimdEnabled(false);
+	scalarCuller.BeginFrame(viewProjection);
+	scalarCuller.DrawOccluder(*terrain);
+	CHECK(simdCuller.GetDepthBuffer() == scalarCuller.GetDepthBuffer());
+	unsigned int written = 0;
+	for (float pixel : simdCuller.GetDepthBuffer())
+	{
+		written += pixel < 1.0f ? 1 : 0;
+	}
+	CHECK(written > Width * Height / 4);
+}
+
+TEST(OcclusionCuller, HeightfieldOccluderIsUnderTheTerrain)
+{
+	const int cells = 32;
+	std::vector<VERTEX> vertices = CreateTerrain(cells, 2.0f);
+	for (int occluderCells : { 4, 8, 32, 100 })
+	{
+		std::shared_ptr<OccluderMesh> occluder = OcclusionCuller::CreateHeightfieldOccluder(vertices, cells + 1, occluderCells);
+		int used = occluderCells < cells ? occluderCells : cells;
+		CHECK_EQUAL(static_cast<size_t>((used + 1) * (used + 1)), occluder->Positions.size());
+		CHECK_EQUAL(static_cast<size_t>(used * used * 6), occluder->Indices.size());
+		// Every terrain vertex is on or above the occluder, which is flat between its vertices
+		// along each triangle
+		for (size_t i = 0; i < occluder->Indices.size(); i += 3)
+		{
+			const XMFLOAT3& p0 = occluder->Positions[occluder->Indices[i]];
+			const XMFLOAT3& p1 = occluder->Positions[occluder->Indices[i + 1]];
+			const XMFLOAT3& p2 = occluder->Positions[occluder->Indices[i + 2]];
+			float area = (p1.x - p0.x) * (p2.z - p0.z) - (p1.z - p0.z) * (p2.x - p0.x);
+			for (const VERTEX& vertex : vertices)
+			{
+				const XMFLOAT3& p = vertex.Position;
+				float u = ((p.x - p0.x) * (p2.z - p0.z) - (p.z - p0.z) * (p2.x - p0.x)) / area;
+				float v = ((p1.x - p0.x) * (p.z - p0.z) - (p1.z - p0.z) * (p.x - p0.x)) / area;
+				if (u < -0.0001f || v < -0.0001f || u + v > 1.0001f)
+				{
+					continue;
+				}
+				CHECK(p0.y + u * (p1.y - p0.y) + v * (p2.y - p0.y) <= p.y + 0.0001f);
+			}
+		}
+		// Every edge inside the grid has a neighbour, and the ones round the outside do not
+		size_t outside = 0;
+		for (unsigned int neighbour : occluder->Neighbours)
+		{
+			outside += neighbour == OccluderMesh::NoNeighbour ? 1 : 0;
+		}
+		CHECK_EQUAL(occluder->Indices.size(), occluder->Neighbours.size());
+		CHECK_EQUAL(static_cast<size_t>(used * 4), outside);
+	}
+}
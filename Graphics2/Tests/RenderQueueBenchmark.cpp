@@ -0,0 +1,71 @@
+#include "TestFramework.h"
+#include "RenderQueue.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+	class NullSink : public RenderCommandSink
+	{
+	public:
+		virtual void SetPipeline(const void *) {}
+		virtual void SetMaterialConstantBuffer(const void *) {}
+		virtual void SetTexture(const void *) {}
+		virtual void SetGeometry(const void *, unsigned int, const void *, unsigned int, const void *) {}
+		virtual void Draw(const DrawPacket&, const void *) {}
+	};
+}
+
+// Flush time (including the radix sort) against std::sort of the same keys, and the state changes
+// made by the sorted queue against binding every state for every draw, as MeshRenderer used to
+BENCHMARK(RenderQueue, SortAndStateChanges)
+{
+	const int pipelineCount = 4;
+	const int materialCount = 200;
+	static int pipelines[pipelineCount];
+	static int materials[materialCount];
+	std::mt19937 random(3);
+	NullSink sink;
+
+	printf("    %8s %10s %12s %14s %14s\n", "draws", "flush ms", "std::sort ms", "state changes", "unsorted");
+	for (unsigned int drawCount = 1000; drawCount <= 100000; drawCount *= 10)
+	{
+		std::vector<DrawPacket> packets(drawCount);
+		std::vector<uint64_t> keys(drawCount);
+		for (unsigned int i = 0; i < drawCount; i++)
+		{
+			int pipeline = random() % pipelineCount;
+			int material = random() % materialCount;
+			DrawPacket& packet = packets[i];
+			packet = {};
+			packet.SortKey = RenderQueue::MakeSortKey(random() % 10 == 0, pipeline, material, (random() % 1000) / 1000.0f);
+			packet.Pipeline = &pipelines[pipeline];
+			packet.MaterialConstantBuffer = &materials[material];
+			packet.Texture = &materials[material];
+			packet.VertexBuffer = &materials[material];
+			keys[i] = packet.SortKey;
+		}
+
+		RenderQueue queue;
+		double flushMilliseconds = TimeMilliseconds(10, [&]()
+		{
+			for (const DrawPacket& packet : packets)
+			{
+				queue.Submit(packet, nullptr, 0);
+			}
+			queue.Flush(sink);
+		});
+		const RenderQueueStatistics& statistics = queue.GetStatistics();
+		unsigned int stateChanges = statistics.PipelineChanges + statistics.MaterialConstantBufferChanges + statistics.TextureChanges + statistics.GeometryChanges;
+
+		std::vector<uint64_t> sortedKeys;
+		double sortMilliseconds = TimeMilliseconds(10, [&]()
+		{
+			sortedKeys = keys;
+			std::sort(sortedKeys.begin(), sortedKeys.end());
+		});
+		printf("    %8u %10.3f %12.3f %14u %14u\n", drawCount, flushMilliseconds, sortMilliseconds, stateChanges, drawCount * 4);
+	}
+}
@@ -0,0 +1,210 @@
+#include "TestFramework.h"
+#include "RenderQueue.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Records what the queue asks for, so that the order of the draws and every state change can
+// be checked without a device
+class CountingSink : public RenderCommandSink
+{
+public:
+	virtual void BeginFlush(const void * constants, size_t constantsSize) { Constants = static_cast<const unsigned char *>(constants); ConstantsSize = constantsSize; }
+	virtual void SetPipeline(const void * pipeline) { PipelineSets++; Pipeline = pipeline; }
+	virtual void SetMaterialConstantBuffer(const void * constantBuffer) { MaterialSets++; Material = constantBuffer; }
+	virtual void SetTexture(const void * texture) { TextureSets++; Texture = texture; }
+	virtual void SetGeometry(const void * vertexBuffer, unsigned int, const void *, unsigned int, const void *) { GeometrySets++; VertexBuffer = vertexBuffer; }
+	virtual void Draw(const DrawPacket& packet, const void * constants)
+	{
+		// Whatever was last set must be what this packet asked for
+		CHECK(Pipeline == packet.Pipeline);
+		CHECK(Material == packet.MaterialConstantBuffer);
+		CHECK(Texture == packet.Texture);
+		CHECK(VertexBuffer == packet.VertexBuffer);
+		Keys.push_back(packet.SortKey);
+		DrawConstants.push_back(constants);
+	}
+
+	const unsigned char *					Constants = nullptr;
+	size_t									ConstantsSize = 0;
+	const void *							Pipeline = nullptr;
+	const void *							Material = nullptr;
+	const void *							Texture = nullptr;
+	const void *							VertexBuffer = nullptr;
+	unsigned int							PipelineSets = 0;
+	unsigned int							MaterialSets = 0;
+	unsigned int							TextureSets = 0;
+	unsigned int							GeometrySets = 0;
+	std::vector<uint64_t>					Keys;
+	std::vector<const void *>				DrawConstants;
+};
+
+// Stand-ins for the states; only their addresses matter
+static int Pipelines[4];
+static int Materials[8];
+static int Textures[8];
+static int Buffers[8];
+
+static DrawPacket CreatePacket(int pipeline, int material, float depth, bool transparent = false)
+{
+	DrawPacket packet = {};
+	packet.SortKey = RenderQueue::MakeSortKey(transparent, pipeline, material, depth);
+	packet.Pipeline = &Pipelines[pipeline];
+	packet.MaterialConstantBuffer = &Materials[material];
+	packet.Texture = &Textures[material];
+	packet.VertexBuffer = &Buffers[material];
+	packet.IndexCount = 3;
+	return packet;
+}
+
+TEST(RenderQueue, SortKeysOrderOpaqueThenTransparent)
+{
+	// Opaque draws are grouped by pipeline, then material, then nearest first
+	CHECK(RenderQueue::MakeSortKey(false, 0, 5, 0.9f) < RenderQueue::MakeSortKey(false, 1, 0, 0.1f));
+	CHECK(RenderQueue::MakeSortKey(false, 1, 2, 0.9f) < RenderQueue::MakeSortKey(false, 1, 3, 0.1f));
+	CHECK(RenderQueue::MakeSortKey(false, 1, 2, 0.1f) < RenderQueue::MakeSortKey(false, 1, 2, 0.2f));
+	// Transparent draws come after every opaque draw, furthest first whatever their state
+	CHECK(RenderQueue::MakeSortKey(false, 32767, 0xffffff, 1.0f) < RenderQueue::MakeSortKey(true, 0, 0, 0.0f));
+	CHECK(RenderQueue::MakeSortKey(true, 3, 3, 0.8f) < RenderQueue::MakeSortKey(true, 0, 0, 0.2f));
+	// Depth is clamped
+	CHECK_EQUAL(RenderQueue::MakeSortKey(false, 1, 1, 1.0f), RenderQueue::MakeSortKey(false, 1, 1, 7.0f));
+	CHECK_EQUAL(RenderQueue::MakeSortKey(false, 1, 1, 0.0f), RenderQueue::MakeSortKey(false, 1, 1, -7.0f));
+}
+
+TEST(RenderQueue, RadixSortMatchesAStableSort)
+{
+	std::mt19937 random(7);
+	for (size_t count : { 1u, 2u, 17u, 1000u, 5000u })
+	{
+		RenderQueue queue;
+		std::vector<uint64_t> keys;
+		std::vector<int> constants(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			// Few distinct keys, so that the stability of the sort matters, and some keys that
+			// only differ in their high bytes
+			DrawPacket packet = CreatePacket(random() % 4, random() % 8, (random() % 5) / 4.0f, random() % 3 == 0);
+			if (i % 7 == 0)
+			{
+				packet.SortKey ^= static_cast<uint64_t>(random() % 4) << 56;
+			}
+			constants[i] = static_cast<int>(i);
+			queue.Submit(packet, &constants[i], sizeof(int));
+			keys.push_back(packet.SortKey);
+		}
+		std::vector<size_t> order(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			order[i] = i;
+		}
+		std::stable_sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] < keys[b]; });
+
+		CountingSink sink;
+		queue.Flush(sink);
+		CHECK_EQUAL(count, sink.Keys.size());
+		CHECK_EQUAL(0u, queue.GetPacketCount());
+		for (size_t i = 0; i < count && i < sink.Keys.size(); i++)
+		{
+			CHECK_EQUAL(keys[order[i]], sink.Keys[i]);
+			// Equal keys stay in the order they were submitted
+			CHECK_EQUAL(static_cast<int>(order[i]), *static_cast<const int *>(sink.DrawConstants[i]));
+		}
+	}
+}
+
+TEST(RenderQueue, OnlySetsStatesThatChange)
+{
+	// Submitted in the worst order: every packet differs from the one before
+	RenderQueue queue;
+	for (int repeat = 0; repeat < 10; repeat++)
+	{
+		for (int pipeline = 0; pipeline < 2; pipeline++)
+		{
+			for (int material = 0; material < 4; material++)
+			{
+				queue.Submit(CreatePacket(pipeline, material, repeat / 10.0f), nullptr, 0);
+			}
+		}
+	}
+	CountingSink sink;
+	queue.Flush(sink);
+	const RenderQueueStatistics& statistics = queue.GetStatistics();
+	CHECK_EQUAL(80u, statistics.DrawCount);
+	// After sorting, each pipeline is set once, and each of its materials once
+	CHECK_EQUAL(2u, sink.PipelineSets);
+	CHECK_EQUAL(8u, sink.MaterialSets);
+	CHECK_EQUAL(8u, sink.TextureSets);
+	CHECK_EQUAL(8u, sink.GeometrySets);
+	CHECK_EQUAL(sink.PipelineSets, statistics.PipelineChanges);
+	CHECK_EQUAL(sink.MaterialSets, statistics.MaterialConstantBufferChanges);
+	CHECK_EQUAL(sink.TextureSets, statistics.TextureChanges);
+	CHECK_EQUAL(sink.GeometrySets, statistics.GeometryChanges);
+	CHECK_EQUAL(80u * 4 - (2 + 8 + 8 + 8), statistics.RedundantChangesSkipped);
+}
+
+TEST(RenderQueue, EveryFlushStartsWithNoStateSet)
+{
+	RenderQueue queue;
+	CountingSink sink;
+	for (int flush = 0; flush < 2; flush++)
+	{
+		queue.Submit(CreatePacket(0, 0, 0.5f), nullptr, 0);
+		queue.Flush(sink);
+		CHECK_EQUAL(1u, queue.GetStatistics().PipelineChanges);
+	}
+	CHECK_EQUAL(2u, sink.PipelineSets);
+
+	// An empty flush does not call the sink, and clears the statistics
+	queue.Flush(sink);
+	CHECK_EQUAL(0u, queue.GetStatistics().DrawCount);
+	CHECK_EQUAL(static_cast<size_t>(2), sink.Keys.size());
+}
+
+TEST(RenderQueue, ConstantsAreCopiedOnto256ByteBoundaries)
+{
+	RenderQueue queue;
+	std::vector<float> constants[3];
+	for (int i = 0; i < 3; i++)
+	{
+		constants[i].assign(20 + i * 50, static_cast<float>(i + 1));
+		queue.Submit(CreatePacket(0, i, 0.1f * i), constants[i].data(), constants[i].size() * sizeof(float));
+		// Overwriting the caller's copy does not change what is drawn
+		constants[i][0] = -1.0f;
+	}
+	CountingSink sink;
+	queue.Flush(sink);
+	for (int i = 0; i < 3; i++)
+	{
+		const unsigned char * drawConstants = static_cast<const unsigned char *>(sink.DrawConstants[i]);
+		CHECK(drawConstants >= sink.Constants && drawConstants < sink.Constants + sink.ConstantsSize);
+		CHECK_EQUAL(static_cast<size_t>(0), static_cast<size_t>(drawConstants - sink.Constants) % 256);
+		float first;
+		memcpy(&first, drawConstants, sizeof(float));
+		CHECK_EQUAL(static_cast<float>(i + 1), first);
+	}
+}
+
+TEST(RenderQueue, StateIdsAreNotShared)
+{
+	// Each owner of a state has its own id, including a copy, and assigning one owner to
+	// another keeps the id of the one assigned to
+	RenderStateId first;
+	RenderStateId second;
+	RenderStateId copy(first);
+	CHECK(first.Get() != second.Get());
+	CHECK(first.Get() != copy.Get());
+	unsigned int secondId = second.Get();
+	second = first;
+	CHECK_EQUAL(secondId, second.Get());
+
+	// An owner created where a destroyed one was gets a new id
+	unsigned int oldId;
+	{
+		std::unique_ptr<RenderStateId> owner(new RenderStateId());
+		oldId = owner->Get();
+	}
+	std::unique_ptr<RenderStateId> owner(new RenderStateId());
+	CHECK(owner->Get() != oldId);
+}
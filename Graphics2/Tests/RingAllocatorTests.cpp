@@ -0,0 +1,194 @@
+#include "TestFramework.h"
+#include "RingAllocator.h"
+#include <deque>
+#include <random>
+#include <vector>
+
+static const size_t Slot = RingAllocator::Alignment;
+
+TEST(RingAllocator, AlignsEveryAllocation)
+{
+	RingAllocator allocator(16 * Slot + 100);
+	// The capacity is rounded down to a whole number of slots
+	CHECK_EQUAL(16 * Slot, allocator.GetCapacity());
+	allocator.BeginFrame(0);
+	CHECK_EQUAL(static_cast<size_t>(0), allocator.Allocate(1));
+	CHECK_EQUAL(Slot, allocator.Allocate(Slot));
+	CHECK_EQUAL(2 * Slot, allocator.Allocate(Slot + 1));
+	// An empty allocation still gets a slot of its own
+	CHECK_EQUAL(4 * Slot, allocator.Allocate(0));
+	CHECK_EQUAL(5 * Slot, allocator.GetUsed());
+	allocator.EndFrame();
+}
+
+TEST(RingAllocator, ReturnsInvalidOffsetWhenFull)
+{
+	RingAllocator allocator(4 * Slot);
+	// Not in a frame
+	CHECK_EQUAL(RingAllocator::InvalidOffset, allocator.Allocate(16));
+
+	allocator.BeginFrame(0);
+	CHECK_EQUAL(RingAllocator::InvalidOffset, allocator.Allocate(5 * Slot));
+	for (size_t i = 0; i < 4; i++)
+	{
+		CHECK_EQUAL(i * Slot, allocator.Allocate(Slot));
+	}
+	CHECK_EQUAL(RingAllocator::InvalidOffset, allocator.Allocate(1));
+	allocator.EndFrame();
+
+	// Still full in the next frame, until the GPU is done with the first one
+	allocator.BeginFrame(1);
+	CHECK_EQUAL(RingAllocator::InvalidOffset, allocator.Allocate(1));
+	allocator.RetireFrames(0);
+	CHECK_EQUAL(static_cast<size_t>(0), allocator.Allocate(1));
+	allocator.EndFrame();
+
+	allocator.Reset();
+	CHECK_EQUAL(static_cast<size_t>(0), allocator.GetUsed());
+	CHECK_EQUAL(static_cast<size_t>(0), allocator.GetFramesInFlight());
+}
+
+TEST(RingAllocator, WrapsAroundToTheStart)
+{
+	RingAllocator allocator(4 * Slot);
+	allocator.BeginFrame(0);
+	allocator.Allocate(Slot);
+	allocator.EndFrame();
+	allocator.BeginFrame(1);
+	allocator.Allocate(2 * Slot);
+	allocator.EndFrame();
+	allocator.RetireFrames(0);
+
+	// One slot left at the end, and one free at the start
+	allocator.BeginFrame(2);
+	CHECK_EQUAL(3 * Slot, allocator.Allocate(Slot));
+	CHECK_EQUAL(static_cast<size_t>(0), allocator.Allocate(Slot));
+	CHECK_EQUAL(4 * Slot, allocator.GetUsed());
+	allocator.EndFrame();
+}
+
+TEST(RingAllocator, SkipsTheEndWhenAnAllocationDoesNotFit)
+{
+	RingAllocator allocator(4 * Slot);
+	allocator.BeginFrame(0);
+	allocator.Allocate(2 * Slot);
+	allocator.EndFrame();
+	allocator.BeginFrame(1);
+	allocator.Allocate(Slot);
+	allocator.EndFrame();
+
+	// One slot at the end, and none at the start until frame 0 is retired
+	allocator.BeginFrame(2);
+	CHECK_EQUAL(RingAllocator::InvalidOffset, allocator.Allocate(2 * Slot));
+	allocator.RetireFrames(0);
+	CHECK_EQUAL(static_cast<size_t>(0), allocator.Allocate(2 * Slot));
+	// The slot skipped at the end counts as used by this frame...
+	CHECK_EQUAL(4 * Slot, allocator.GetUsed());
+	allocator.EndFrame();
+
+	// ...and is given back with it
+	allocator.RetireFrames(1);
+	CHECK_EQUAL(3 * Slot, allocator.GetUsed());
+	allocator.RetireFrames(2);
+	CHECK_EQUAL(static_cast<size_t>(0), allocator.GetUsed());
+}
+
+TEST(RingAllocator, RetiresFramesInOrder)
+{
+	RingAllocator allocator(8 * Slot);
+	for (unsigned long long frame = 10; frame < 13; frame++)
+	{
+		allocator.BeginFrame(frame);
+		for (unsigned long long i = 10; i <= frame; i++)
+		{
+			allocator.Allocate(Slot);
+		}
+		allocator.EndFrame();
+	}
+	CHECK_EQUAL(6 * Slot, allocator.GetUsed());
+	CHECK_EQUAL(static_cast<size_t>(3), allocator.GetFramesInFlight());
+
+	allocator.RetireFrames(9);
+	CHECK_EQUAL(6 * Slot, allocator.GetUsed());
+	allocator.RetireFrames(10);
+	CHECK_EQUAL(5 * Slot, allocator.GetUsed());
+	// Retiring the same frame again gives nothing more back
+	allocator.RetireFrames(10);
+	CHECK_EQUAL(5 * Slot, allocator.GetUsed());
+	allocator.RetireFrames(11);
+	CHECK_EQUAL(3 * Slot, allocator.GetUsed());
+	CHECK_EQUAL(static_cast<size_t>(1), allocator.GetFramesInFlight());
+	allocator.RetireFrames(100);
+	CHECK_EQUAL(static_cast<size_t>(0), allocator.GetUsed());
+	CHECK_EQUAL(static_cast<size_t>(0), allocator.GetFramesInFlight());
+}
+
+TEST(RingAllocator, EmptyFramesInFlightDoNotStopTheBufferBeingUsedFromTheStart)
+{
+	RingAllocator allocator(4 * Slot);
+	allocator.BeginFrame(0);
+	allocator.Allocate(3 * Slot);
+	allocator.EndFrame();
+	allocator.RetireFrames(0);
+	// A frame that allocated nothing is still in flight, but nothing is in use
+	allocator.BeginFrame(1);
+	allocator.EndFrame();
+	allocator.BeginFrame(2);
+	CHECK_EQUAL(static_cast<size_t>(0), allocator.Allocate(4 * Slot));
+	allocator.EndFrame();
+	allocator.RetireFrames(1);
+	CHECK_EQUAL(4 * Slot, allocator.GetUsed());
+	allocator.RetireFrames(2);
+	CHECK_EQUAL(static_cast<size_t>(0), allocator.GetUsed());
+}
+
+// Frames of random allocations with the GPU a few frames behind.  Every allocation that
+// succeeds must be inside the buffer and must not overlap any allocation still in flight.
+TEST(RingAllocator, NeverOverlapsAllocationsInFlight)
+{
+	struct Range
+	{
+		unsigned long long					Frame;
+		size_t								Begin;
+		size_t								End;
+	};
+	const unsigned long long framesBehind = 2;
+	RingAllocator allocator(64 * Slot);
+	std::mt19937 random(11);
+	std::deque<Range> inFlight;
+	unsigned int failures = 0;
+	for (unsigned long long frame = 0; frame < 2000; frame++)
+	{
+		if (frame >= framesBehind)
+		{
+			allocator.RetireFrames(frame - framesBehind);
+			while (!inFlight.empty() && inFlight.front().Frame <= frame - framesBehind)
+			{
+				inFlight.pop_front();
+			}
+		}
+		allocator.BeginFrame(frame);
+		unsigned int allocationCount = random() % 12;
+		for (unsigned int i = 0; i < allocationCount; i++)
+		{
+			size_t size = 1 + random() % (6 * Slot);
+			size_t offset = allocator.Allocate(size);
+			if (offset == RingAllocator::InvalidOffset)
+			{
+				failures++;
+				continue;
+			}
+			CHECK_EQUAL(static_cast<size_t>(0), offset % Slot);
+			CHECK(offset + size <= allocator.GetCapacity());
+			for (const Range& range : inFlight)
+			{
+				CHECK(offset + size <= range.Begin || offset >= range.End);
+			}
+			inFlight.push_back({ frame, offset, offset + size });
+		}
+		allocator.EndFrame();
+		CHECK(allocator.GetUsed() <= allocator.GetCapacity());
+	}
+	// Otherwise the buffer was never under pressure
+	CHECK(failures > 0);
+}
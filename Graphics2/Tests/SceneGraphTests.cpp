@@ -0,0 +1,128 @@
+#include "TestFramework.h"
+#include "SceneGraph.h"
+#include <cstring>
+#include <vector>
+
+class TransformNode : public SceneNode
+{
+public:
+	TransformNode(wstring name) : SceneNode(name) {}
+
+	virtual bool Initialise() { return true; }
+	virtual void Render() {}
+	virtual void Shutdown() {}
+
+	inline const XMFLOAT4X4& GetCombinedWorldTransform() const { return _combinedWorldTransformation; }
+};
+
+// A root with many children of different depths, each of which moves a little
+static SceneGraphPointer BuildScene(std::vector<shared_ptr<TransformNode>>& leaves)
+{
+	SceneGraphPointer root = make_shared<SceneGraph>(L"Root");
+	for (int child = 0; child < 40; child++)
+	{
+		SceneNodePointer parent = root;
+		for (int depth = 0; depth <= child % 6; depth++)
+		{
+			SceneGraphPointer group = make_shared<SceneGraph>(L"Group");
+			group->SetWorldTransform(XMMatrixRotationY(child * 0.1f + depth) * XMMatrixTranslation(1.0f, depth * 0.5f, 0.0f));
+			parent->Add(group);
+			parent = group;
+		}
+		for (int leaf = 0; leaf < 3; leaf++)
+		{
+			shared_ptr<TransformNode> node = make_shared<TransformNode>(L"Leaf");
+			node->SetWorldTransform(XMMatrixScaling(1.0f + leaf, 1.0f, 1.0f) * XMMatrixTranslation(0.0f, 0.0f, leaf * 2.0f));
+			parent->Add(node);
+			leaves.push_back(node);
+		}
+	}
+	return root;
+}
+
+TEST(SceneGraph, ParallelUpdateMatchesSerialUpdateExactly)
+{
+	for (unsigned int threadCount : { 1u, 2u, 3u, 8u })
+	{
+		std::vector<shared_ptr<TransformNode>> serialLeaves;
+		std::vector<shared_ptr<TransformNode>> parallelLeaves;
+		SceneGraphPointer serialScene = BuildScene(serialLeaves);
+		SceneGraphPointer parallelScene = BuildScene(parallelLeaves);
+		ThreadPool threadPool(threadCount);
+
+		// Two frames, with part of the scene moved in between, so the changed-only path is covered
+		for (int frame = 0; frame < 2; frame++)
+		{
+			XMMATRIX rootTransformation = XMMatrixTranslation(0.0f, frame * 10.0f, 0.0f);
+			unsigned int serialCount = 0;
+			unsigned int parallelCount = 0;
+			serialScene->UpdateIfChanged(rootTransformation, frame == 0, serialCount);
+			parallelScene->UpdateIfChangedParallel(rootTransformation, frame == 0, parallelCount, threadPool);
+			CHECK_EQUAL(serialCount, parallelCount);
+			for (size_t i = 0; i < serialLeaves.size(); i++)
+			{
+				CHECK(memcmp(&serialLeaves[i]->GetCombinedWorldTransform(), &parallelLeaves[i]->GetCombinedWorldTransform(), sizeof(XMFLOAT4X4)) == 0);
+			}
+			serialLeaves[frame * 7]->SetWorldTransform(XMMatrixTranslation(5.0f, 0.0f, 0.0f));
+			parallelLeaves[frame * 7]->SetWorldTransform(XMMatrixTranslation(5.0f, 0.0f, 0.0f));
+		}
+	}
+}
+
+TEST(SceneGraph, RenamedNodesAreFoundByTheirNewName)
+{
+	// root -> group -> leaf
+	SceneGraphPointer root = make_shared<SceneGraph>(L"Root");
+	SceneGraphPointer group = make_shared<SceneGraph>(L"Group");
+	shared_ptr<TransformNode> leaf = make_shared<TransformNode>(L"Leaf");
+	group->Add(leaf);
+	root->Add(group);
+
+	leaf->SetName(L"Renamed Leaf");
+	group->SetName(L"Renamed Group");
+	CHECK(leaf->GetName() == L"Renamed Leaf");
+	CHECK(root->Find(L"Renamed Leaf") == leaf);
+	CHECK(root->Find(L"Renamed Group") == group);
+	CHECK(group->Find(L"Renamed Leaf") == leaf);
+	CHECK(root->Find(L"Leaf") == nullptr);
+	CHECK(root->Find(L"Group") == nullptr);
+	// The root is not in an index of its own
+	root->SetName(L"Renamed Root");
+	CHECK(root->Find(L"Renamed Root") == root);
+}
+
+TEST(SceneGraph, RemovingASubtreeRemovesItsNames)
+{
+	// root -> (group -> (first, inner -> second), other)
+	SceneGraphPointer root = make_shared<SceneGraph>(L"Root");
+	SceneGraphPointer group = make_shared<SceneGraph>(L"Group");
+	SceneGraphPointer inner = make_shared<SceneGraph>(L"Inner");
+	shared_ptr<TransformNode> first = make_shared<TransformNode>(L"First");
+	shared_ptr<TransformNode> second = make_shared<TransformNode>(L"Second");
+	shared_ptr<TransformNode> other = make_shared<TransformNode>(L"Other");
+	inner->Add(second);
+	group->Add(first);
+	group->Add(inner);
+	root->Add(group);
+	root->Add(other);
+	weak_ptr<TransformNode> secondReference = second;
+
+	root->Remove(group);
+	for (const wchar_t * name : { L"Group", L"First", L"Inner", L"Second" })
+	{
+		CHECK(root->Find(name) == nullptr);
+	}
+	CHECK(root->Find(L"Other") == other);
+	// The removed subtree keeps an index of its own
+	CHECK(group->Find(L"Second") == second);
+	// and renaming a node in it does not touch the graph it was removed from
+	second->SetName(L"Other");
+	CHECK(root->Find(L"Other") == other);
+	CHECK(group->Find(L"Other") == second);
+
+	// The graph does not keep the removed nodes alive
+	second = nullptr;
+	inner = nullptr;
+	group = nullptr;
+	CHECK(secondReference.expired());
+}
@@ -0,0 +1,111 @@
+#include "TestFramework.h"
+#include "SceneNameIndex.h"
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+// The index only compares and locks node pointers, never looks inside a node, so the nodes
+// here are stand-ins: pointers that share ownership of an int.  (SceneNode itself needs the
+// Direct3D headers.)
+static std::shared_ptr<SceneNode> CreateNode()
+{
+	std::shared_ptr<int> owner = std::make_shared<int>(0);
+	return std::shared_ptr<SceneNode>(owner, reinterpret_cast<SceneNode *>(owner.get()));
+}
+
+TEST(SceneNameIndex, InternsEachNameOnce)
+{
+	const std::wstring * name = SceneNameIndex::Intern(L"SceneNameIndex.Interned");
+	CHECK(name == SceneNameIndex::Intern(std::wstring(L"SceneNameIndex.") + L"Interned"));
+	CHECK(name == SceneNameIndex::Lookup(L"SceneNameIndex.Interned"));
+	CHECK(*name == L"SceneNameIndex.Interned");
+	CHECK(SceneNameIndex::Lookup(L"SceneNameIndex.NeverSeen") == nullptr);
+}
+
+TEST(SceneNameIndex, AddsFindsAndRemovesNodes)
+{
+	SceneNameIndex index;
+	std::shared_ptr<SceneNode> plane = CreateNode();
+	std::shared_ptr<SceneNode> tree = CreateNode();
+	index.Add(SceneNameIndex::Intern(L"Plane"), plane);
+	index.Add(SceneNameIndex::Intern(L"Tree"), tree);
+	CHECK_EQUAL(static_cast<size_t>(2), index.GetCount());
+	CHECK(index.Find(L"Plane") == plane);
+	CHECK(index.Find(L"Tree") == tree);
+	CHECK(index.Find(L"SceneNameIndex.NeverSeen") == nullptr);
+	// A name that has been interned but is not in this index
+	SceneNameIndex::Intern(L"Rock");
+	CHECK(index.Find(L"Rock") == nullptr);
+
+	index.Remove(SceneNameIndex::Intern(L"Plane"), plane);
+	CHECK_EQUAL(static_cast<size_t>(1), index.GetCount());
+	CHECK(index.Find(L"Plane") == nullptr);
+	CHECK(index.Find(L"Tree") == tree);
+	// Removing a node under a name it is not in changes nothing
+	index.Remove(SceneNameIndex::Intern(L"Plane"), tree);
+	CHECK(index.Find(L"Tree") == tree);
+}
+
+TEST(SceneNameIndex, KeepsEveryNodeWithTheSameName)
+{
+	SceneNameIndex index;
+	const std::wstring * name = SceneNameIndex::Intern(L"Leaf");
+	std::vector<std::shared_ptr<SceneNode>> leaves;
+	for (int i = 0; i < 3; i++)
+	{
+		leaves.push_back(CreateNode());
+		index.Add(name, leaves.back());
+	}
+	CHECK_EQUAL(static_cast<size_t>(3), index.GetCount());
+	// Removing one of them only removes that one, whichever Find was returning
+	for (size_t i = 0; i < leaves.size(); i++)
+	{
+		std::shared_ptr<SceneNode> found = index.Find(L"Leaf");
+		CHECK(std::find(leaves.begin() + i, leaves.end(), found) != leaves.end());
+		index.Remove(name, leaves[i]);
+		CHECK_EQUAL(leaves.size() - i - 1, index.GetCount());
+	}
+	CHECK(index.Find(L"Leaf") == nullptr);
+}
+
+TEST(SceneNameIndex, RenamesANode)
+{
+	SceneNameIndex index;
+	const std::wstring * oldName = SceneNameIndex::Intern(L"Leaf");
+	const std::wstring * newName = SceneNameIndex::Intern(L"Branch");
+	std::shared_ptr<SceneNode> renamed = CreateNode();
+	std::shared_ptr<SceneNode> other = CreateNode();
+	index.Add(oldName, renamed);
+	index.Add(oldName, other);
+
+	CHECK(index.Rename(oldName, newName, renamed));
+	CHECK_EQUAL(static_cast<size_t>(2), index.GetCount());
+	CHECK(index.Find(L"Branch") == renamed);
+	CHECK(index.Find(L"Leaf") == other);
+	// The node is no longer under its old name
+	CHECK(!index.Rename(oldName, newName, renamed));
+	index.Remove(oldName, renamed);
+	CHECK(index.Find(L"Branch") == renamed);
+	// and a node that is not in the index is not added by renaming it
+	CHECK(!index.Rename(oldName, newName, CreateNode()));
+	CHECK_EQUAL(static_cast<size_t>(2), index.GetCount());
+}
+
+TEST(SceneNameIndex, DoesNotKeepRemovedNodesAlive)
+{
+	SceneNameIndex index;
+	const std::wstring * name = SceneNameIndex::Intern(L"Leaf");
+	std::shared_ptr<SceneNode> kept = CreateNode();
+	std::shared_ptr<SceneNode> dropped = CreateNode();
+	std::weak_ptr<SceneNode> droppedReference = dropped;
+	index.Add(name, dropped);
+	index.Add(name, kept);
+	dropped.reset();
+	CHECK(droppedReference.expired());
+	// Find skips the entry for the node that has gone
+	CHECK(index.Find(L"Leaf") == kept);
+	// and removing any node with the name clears it out
+	index.Remove(name, kept);
+	CHECK_EQUAL(static_cast<size_t>(0), index.GetCount());
+	CHECK(index.Find(L"Leaf") == nullptr);
+}
@@ -0,0 +1,253 @@
+#include "TestFramework.h"
+#include "ShaderCache.h"
+#include "CacheFiles.h"
+#include "MappedFile.h"
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+// Compiles a shader into a description of what it was asked for, so that the tests can tell
+// which inputs a piece of byte code came from.  The entry point "Broken" fails to compile.
+class StubCompiler : public ShaderCompiler
+{
+public:
+	virtual std::string GetVersion() { return Version; }
+
+	virtual bool Compile(const ShaderCompileOptions& options, ShaderByteCode& byteCode, std::string& messages)
+	{
+		CompileCount++;
+		if (options.EntryPoint == "Broken")
+		{
+			messages = "error: Broken is not defined";
+			return false;
+		}
+		std::string text = Version + ":" + options.EntryPoint + ":" + options.Target;
+		for (const ShaderDefine& define : options.Defines)
+		{
+			text += ":" + define.Name + "=" + define.Value;
+		}
+		byteCode.assign(text.begin(), text.end());
+		return true;
+	}
+
+	std::string								Version = "stub 1.0";
+	unsigned int							CompileCount = 0;
+};
+
+static void WriteText(const std::wstring& fileName, const std::string& text)
+{
+	WriteTestFile(fileName, text.data(), text.size());
+}
+
+static std::string ToString(const ShaderByteCode& byteCode)
+{
+	return std::string(byteCode.begin(), byteCode.end());
+}
+
+// A shader that includes a header, which includes another
+static ShaderCompileOptions WriteShader(const std::wstring& directory)
+{
+	WriteText(directory + L"/Lighting.hlsli", "#include \"Constants.hlsli\"\nfloat4 Light() { return Ambient; }\n");
+	WriteText(directory + L"/Constants.hlsli", "cbuffer Frame { float4 Ambient; };\n");
+	WriteText(directory + L"/Shader.hlsl", "  #  include \"Lighting.hlsli\"\nfloat4 PS() : SV_Target { return Light(); }\n");
+	ShaderCompileOptions options;
+	options.FileName = directory + L"/Shader.hlsl";
+	options.EntryPoint = "PS";
+	options.Target = "ps_5_0";
+	options.Defines.push_back({ "QUALITY", "2" });
+	return options;
+}
+
+TEST(ShaderCache, HitsOnTheSameKey)
+{
+	std::wstring directory = CreateTestDirectory("ShaderCache");
+	ShaderCompileOptions options = WriteShader(directory);
+	std::shared_ptr<StubCompiler> compiler = std::make_shared<StubCompiler>();
+	std::string messages;
+	{
+		ShaderCache cache(compiler, directory + L"/Cache");
+		std::shared_ptr<const ShaderByteCode> first = cache.GetByteCode(options, messages);
+		std::shared_ptr<const ShaderByteCode> second = cache.GetByteCode(options, messages);
+		CHECK(first != nullptr);
+		// Shared within the process
+		CHECK(first == second);
+		CHECK_EQUAL(1u, compiler->CompileCount);
+		CHECK_EQUAL(1u, cache.GetStatistics().Compiles);
+		CHECK_EQUAL(1u, cache.GetStatistics().MemoryHits);
+	}
+	// And read back from disk by the next run
+	ShaderCache cache(compiler, directory + L"/Cache");
+	std::shared_ptr<const ShaderByteCode> byteCode = cache.GetByteCode(options, messages);
+	CHECK(byteCode != nullptr);
+	CHECK_EQUAL(std::string("stub 1.0:PS:ps_5_0:QUALITY=2"), ToString(*byteCode));
+	CHECK_EQUAL(1u, compiler->CompileCount);
+	CHECK_EQUAL(1u, cache.GetStatistics().DiskHits);
+}
+
+TEST(ShaderCache, MissesWhenAnInputChanges)
+{
+	std::wstring directory = CreateTestDirectory("ShaderCache");
+	ShaderCompileOptions options = WriteShader(directory);
+	std::shared_ptr<StubCompiler> compiler = std::make_shared<StubCompiler>();
+	ShaderCache cache(compiler, directory + L"/Cache");
+	uint64_t originalKey;
+	CHECK(cache.GetKey(options, originalKey));
+
+	// Each of these must give a new key, and the key must come back when the change is undone
+	auto checkChangesKey = [&](const char * what, const std::function<void()>& change, const std::function<void()>& undo)
+	{
+		uint64_t key;
+		change();
+		CHECK(cache.GetKey(options, key));
+		if (key == originalKey)
+		{
+			ReportFailure(__FILE__, __LINE__, std::string("the key did not change with ") + what);
+		}
+		undo();
+		CHECK(cache.GetKey(options, key));
+		CHECK_EQUAL(originalKey, key);
+	};
+	checkChangesKey("the source", [&]() { WriteText(directory + L"/Shader.hlsl", "#include \"Lighting.hlsli\"\nfloat4 PS() : SV_Target { return 1; }\n"); },
+					[&]() { WriteShader(directory); });
+	checkChangesKey("a nested include", [&]() { WriteText(directory + L"/Constants.hlsli", "cbuffer Frame { float4 Ambient; float4 Sun; };\n"); },
+					[&]() { WriteShader(directory); });
+	checkChangesKey("a define", [&]() { options.Defines[0].Value = "3"; }, [&]() { options.Defines[0].Value = "2"; });
+	checkChangesKey("an extra define", [&]() { options.Defines.push_back({ "SHADOWS", "" }); }, [&]() { options.Defines.pop_back(); });
+	checkChangesKey("the entry point", [&]() { options.EntryPoint = "Main"; }, [&]() { options.EntryPoint = "PS"; });
+	checkChangesKey("the target", [&]() { options.Target = "ps_5_1"; }, [&]() { options.Target = "ps_5_0"; });
+	checkChangesKey("the flags", [&]() { options.Flags = 1; }, [&]() { options.Flags = 0; });
+	checkChangesKey("the compiler version", [&]() { compiler->Version = "stub 1.1"; }, [&]() { compiler->Version = "stub 1.0"; });
+
+	// A changed include is compiled again, even with the old byte code in memory
+	std::string messages;
+	cache.GetByteCode(options, messages);
+	WriteText(directory + L"/Constants.hlsli", "cbuffer Frame { float4 Ambient; float4 Sun; };\n");
+	cache.GetByteCode(options, messages);
+	CHECK_EQUAL(2u, compiler->CompileCount);
+
+	// A missing include is part of the key, so the key changes when it turns up
+	WriteText(directory + L"/Shader.hlsl", "#include \"Missing.hlsli\"\n");
+	uint64_t missingKey;
+	CHECK(cache.GetKey(options, missingKey));
+	WriteText(directory + L"/Missing.hlsli", "// Here now\n");
+	uint64_t foundKey;
+	CHECK(cache.GetKey(options, foundKey));
+	CHECK(missingKey != foundKey);
+}
+
+TEST(ShaderCache, RecompilesWhenTheCacheFileIsDamaged)
+{
+	std::wstring directory = CreateTestDirectory("ShaderCache");
+	ShaderCompileOptions options = WriteShader(directory);
+	std::shared_ptr<StubCompiler> compiler = std::make_shared<StubCompiler>();
+	std::string messages;
+	uint64_t key;
+	std::wstring cacheFileName;
+	std::vector<unsigned char> goodFile;
+	{
+		ShaderCache cache(compiler, directory + L"/Cache");
+		cache.GetByteCode(options, messages);
+		CHECK(cache.GetKey(options, key));
+		cacheFileName = cache.GetCacheFileName(key);
+		MappedFile file;
+		CHECK(file.Open(cacheFileName));
+		const unsigned char * data = static_cast<const unsigned char *>(file.GetData());
+		goodFile.assign(data, data + file.GetSize());
+		CHECK(memcmp(data, "SHDC", 4) == 0);
+	}
+
+	// Each of these is rejected, compiled again, and replaced with a good file
+	auto checkRejected = [&](const char * what, const std::vector<unsigned char>& contents)
+	{
+		WriteTestFile(cacheFileName, contents.data(), contents.size());
+		unsigned int compileCount = compiler->CompileCount;
+		ShaderCache cache(compiler, directory + L"/Cache");
+		std::shared_ptr<const ShaderByteCode> byteCode = cache.GetByteCode(options, messages);
+		if (compiler->CompileCount != compileCount + 1 || byteCode == nullptr)
+		{
+			ReportFailure(__FILE__, __LINE__, std::string("a cache file with ") + what + " was used");
+		}
+		MappedFile file;
+		CHECK(file.Open(cacheFileName));
+		CHECK_EQUAL(goodFile.size(), file.GetSize());
+		CHECK(memcmp(file.GetData(), goodFile.data(), goodFile.size()) == 0);
+	};
+	std::vector<unsigned char> contents = goodFile;
+	contents[0] = 'X';
+	checkRejected("a bad magic number", contents);
+	contents = goodFile;
+	contents[4]++;
+	checkRejected("another version", contents);
+	contents = goodFile;
+	contents[8]++;
+	checkRejected("another key", contents);
+	contents.assign(goodFile.begin(), goodFile.end() - 3);
+	checkRejected("its byte code cut short", contents);
+	contents.assign(goodFile.begin(), goodFile.begin() + 10);
+	checkRejected("its header cut short", contents);
+	contents = goodFile;
+	contents.push_back(0);
+	checkRejected("extra bytes", contents);
+	contents.clear();
+	checkRejected("nothing in it", contents);
+}
+
+TEST(ShaderCache, FailuresAreNotCached)
+{
+	std::wstring directory = CreateTestDirectory("ShaderCache");
+	ShaderCompileOptions options = WriteShader(directory);
+	options.EntryPoint = "Broken";
+	std::shared_ptr<StubCompiler> compiler = std::make_shared<StubCompiler>();
+	ShaderCache cache(compiler, directory + L"/Cache");
+	std::string messages;
+	CHECK(cache.GetByteCode(options, messages) == nullptr);
+	CHECK(messages.find("Broken") != std::string::npos);
+	CHECK(cache.GetByteCode(options, messages) == nullptr);
+	CHECK_EQUAL(2u, compiler->CompileCount);
+	CHECK_EQUAL(2u, cache.GetStatistics().Failures);
+	uint64_t key;
+	CHECK(cache.GetKey(options, key));
+	CHECK(!std::filesystem::exists(cache.GetCacheFileName(key)));
+
+	// A source file that cannot be read is still handed to the compiler, to report the error
+	options.FileName = directory + L"/NotThere.hlsl";
+	CHECK(!cache.GetKey(options, key));
+	options.EntryPoint = "PS";
+	CHECK(cache.GetByteCode(options, messages) != nullptr);
+	CHECK_EQUAL(3u, compiler->CompileCount);
+}
+
+TEST(ShaderCache, WritesThroughATemporaryFile)
+{
+	std::wstring directory = CreateTestDirectory("ShaderCache");
+	std::wstring fileName = directory + L"/File.bin";
+
+	// A temporary file left behind by a run that stopped part way through is written over
+	WriteText(fileName + L".tmp", "partial");
+	CHECK(WriteWholeFile(fileName, "first", 5));
+	CHECK(!std::filesystem::exists(fileName + L".tmp"));
+	CHECK_EQUAL(static_cast<uintmax_t>(5), std::filesystem::file_size(fileName));
+
+	// An existing file is replaced as a whole
+	CHECK(WriteWholeFile(fileName, "second!", 7));
+	CHECK(!std::filesystem::exists(fileName + L".tmp"));
+	MappedFile file;
+	CHECK(file.Open(fileName));
+	CHECK_EQUAL(static_cast<size_t>(7), file.GetSize());
+	CHECK(memcmp(file.GetData(), "second!", 7) == 0);
+	file.Close();
+
+	// Nothing is left behind when the file cannot be written
+	CHECK(!WriteWholeFile(directory + L"/NoSuchDirectory/File.bin", "x", 1));
+	CHECK(!std::filesystem::exists(directory + L"/NoSuchDirectory"));
+
+	// The cache writes its files the same way
+	ShaderCompileOptions options = WriteShader(directory);
+	ShaderCache cache(std::make_shared<StubCompiler>(), directory + L"/Cache");
+	std::string messages;
+	cache.GetByteCode(options, messages);
+	uint64_t key;
+	CHECK(cache.GetKey(options, key));
+	CHECK(std::filesystem::exists(cache.GetCacheFileName(key)));
+	CHECK(!std::filesystem::exists(cache.GetCacheFileName(key) + L".tmp"));
+}
@@ -0,0 +1,219 @@
+#include "TestFramework.h"
+#include "StaticBatcher.h"
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+static ModelMaterialData CreateMaterial(const std::wstring& name)
+{
+	ModelMaterialData material = {};
+	material.Name = name;
+	material.DiffuseColour = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+	material.Opacity = 1.0f;
+	return material;
+}
+
+// A sub-mesh that is a single square in the z = 0 plane, with its normals pointing towards -z.
+// Its triangles are clockwise seen from -z, the way Direct3D draws front faces.
+static ModelSubMeshData CreateSquare(unsigned int materialIndex, float size)
+{
+	ModelSubMeshData subMesh;
+	subMesh.MaterialIndex = materialIndex;
+	const float corners[4][2] = { { 0.0f, 0.0f }, { 0.0f, 1.0f }, { 1.0f, 1.0f }, { 1.0f, 0.0f } };
+	for (const float * corner : corners)
+	{
+		VERTEX vertex;
+		vertex.Position = XMFLOAT3(corner[0] * size, corner[1] * size, 0.0f);
+		vertex.Normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
+		vertex.TexCoord = XMFLOAT2(corner[0], corner[1]);
+		subMesh.Vertices.push_back(vertex);
+	}
+	subMesh.Indices = { 0, 1, 2, 0, 2, 3 };
+	return subMesh;
+}
+
+static std::shared_ptr<Node> CreateNode(FXMMATRIX transformation)
+{
+	std::shared_ptr<Node> node = std::make_shared<Node>();
+	XMFLOAT4X4 values;
+	XMStoreFloat4x4(&values, transformation);
+	node->SetTransformation(values);
+	return node;
+}
+
+// A house with walls and a roof, the roof in a child node raised above the walls
+static std::shared_ptr<ModelData> CreateHouse()
+{
+	std::shared_ptr<ModelData> model = std::make_shared<ModelData>();
+	model->Materials = { CreateMaterial(L"Brick"), CreateMaterial(L"Tiles") };
+	model->SubMeshes = { CreateSquare(0, 4.0f), CreateSquare(1, 4.0f) };
+	model->RootNode = CreateNode(XMMatrixIdentity());
+	model->RootNode->AddMesh(0);
+	std::shared_ptr<Node> roof = CreateNode(XMMatrixTranslation(0.0f, 3.0f, 0.0f));
+	roof->AddMesh(1);
+	model->RootNode->AddChild(roof);
+	return model;
+}
+
+// A wall that shares its material with the house
+static std::shared_ptr<ModelData> CreateWall()
+{
+	std::shared_ptr<ModelData> model = std::make_shared<ModelData>();
+	model->Materials = { CreateMaterial(L"Brick") };
+	model->SubMeshes = { CreateSquare(0, 2.0f) };
+	model->RootNode = CreateNode(XMMatrixIdentity());
+	model->RootNode->AddMesh(0);
+	return model;
+}
+
+// The normal of a triangle, from its winding
+static XMVECTOR TriangleNormal(const ModelSubMeshData& subMesh, size_t firstIndex)
+{
+	XMVECTOR a = XMLoadFloat3(&subMesh.Vertices[subMesh.Indices[firstIndex]].Position);
+	XMVECTOR b = XMLoadFloat3(&subMesh.Vertices[subMesh.Indices[firstIndex + 1]].Position);
+	XMVECTOR c = XMLoadFloat3(&subMesh.Vertices[subMesh.Indices[firstIndex + 2]].Position);
+	return XMVector3Normalize(XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a)));
+}
+
+TEST(StaticBatcher, MergesEachMaterialIntoOneDraw)
+{
+	std::shared_ptr<ModelData> house = CreateHouse();
+	std::shared_ptr<ModelData> wall = CreateWall();
+	StaticBatcher batcher;
+	for (int i = 0; i < 3; i++)
+	{
+		CHECK(batcher.AddPlacement(house, XMMatrixTranslation(i * 10.0f, 0.0f, 0.0f)));
+		CHECK(batcher.AddPlacement(wall, XMMatrixTranslation(i * 10.0f, 0.0f, 5.0f)));
+	}
+	CHECK(batcher.AddPlacement(wall, XMMatrixTranslation(-10.0f, 0.0f, 5.0f)));
+	std::shared_ptr<ModelData> batch = batcher.Build();
+
+	// One sub-mesh (so one draw) for the bricks of every house and wall, and one for the roofs
+	CHECK_EQUAL(static_cast<size_t>(2), batch->SubMeshes.size());
+	CHECK_EQUAL(static_cast<size_t>(2), batch->Materials.size());
+	CHECK_EQUAL(static_cast<size_t>(2), batch->RootNode->GetMeshCount());
+	CHECK_EQUAL(static_cast<size_t>(0), batch->RootNode->GetChildrenCount());
+	for (unsigned int i = 0; i < batch->SubMeshes.size(); i++)
+	{
+		const ModelSubMeshData& subMesh = batch->SubMeshes[i];
+		CHECK_EQUAL(i, batch->RootNode->GetMesh(i));
+		const std::wstring& material = batch->Materials[subMesh.MaterialIndex].Name;
+		size_t squares = material == L"Brick" ? 7 : 3;
+		CHECK(material == L"Brick" || material == L"Tiles");
+		CHECK_EQUAL(squares * 4, subMesh.Vertices.size());
+		CHECK_EQUAL(squares * 6, subMesh.Indices.size());
+		for (unsigned int index : subMesh.Indices)
+		{
+			CHECK(index < subMesh.Vertices.size());
+		}
+	}
+	CHECK(batch->Materials[0].Name != batch->Materials[1].Name);
+
+	// 3 houses of 2 sub-meshes and 4 walls of 1, against a draw for each material
+	const StaticBatchStatistics& statistics = batcher.GetStatistics();
+	CHECK_EQUAL(7u, statistics.PlacementCount);
+	CHECK_EQUAL(10u, statistics.DrawsBefore);
+	CHECK_EQUAL(2u, statistics.DrawsAfter);
+	// Each model is counted once in the source sizes, and every placement in the batch
+	CHECK_EQUAL(3 * 4 * sizeof(VERTEX), statistics.SourceVertexBytes);
+	CHECK_EQUAL(3 * 6 * sizeof(unsigned int), statistics.SourceIndexBytes);
+	CHECK_EQUAL(10 * 4 * sizeof(VERTEX), statistics.BatchedVertexBytes);
+	CHECK_EQUAL(10 * 6 * sizeof(unsigned int), statistics.BatchedIndexBytes);
+}
+
+TEST(StaticBatcher, BakesThePlacementIntoPositionsAndNormals)
+{
+	std::shared_ptr<ModelData> house = CreateHouse();
+	// Scaled unevenly, turned and moved, so normals need the inverse transpose
+	XMMATRIX world = XMMatrixScaling(2.0f, 1.0f, 0.5f) * XMMatrixRotationY(0.7f) * XMMatrixTranslation(100.0f, 5.0f, -20.0f);
+	StaticBatcher batcher;
+	CHECK(batcher.AddPlacement(house, world));
+	std::shared_ptr<ModelData> batch = batcher.Build();
+	CHECK_EQUAL(static_cast<size_t>(2), batch->SubMeshes.size());
+
+	for (unsigned int i = 0; i < batch->SubMeshes.size(); i++)
+	{
+		// The roof is also moved by its node
+		bool roof = batch->Materials[batch->SubMeshes[i].MaterialIndex].Name == L"Tiles";
+		XMMATRIX transformation = roof ? XMMatrixTranslation(0.0f, 3.0f, 0.0f) * world : world;
+		const ModelSubMeshData& source = house->SubMeshes[roof ? 1 : 0];
+		const ModelSubMeshData& merged = batch->SubMeshes[i];
+		CHECK_EQUAL(source.Vertices.size(), merged.Vertices.size());
+		for (size_t vertex = 0; vertex < merged.Vertices.size(); vertex++)
+		{
+			XMFLOAT3 expected;
+			XMStoreFloat3(&expected, XMVector3TransformCoord(XMLoadFloat3(&source.Vertices[vertex].Position), transformation));
+			CHECK_NEAR(expected.x, merged.Vertices[vertex].Position.x, 0.0001f);
+			CHECK_NEAR(expected.y, merged.Vertices[vertex].Position.y, 0.0001f);
+			CHECK_NEAR(expected.z, merged.Vertices[vertex].Position.z, 0.0001f);
+			CHECK_NEAR(source.Vertices[vertex].TexCoord.x, merged.Vertices[vertex].TexCoord.x, 0.0f);
+			CHECK_NEAR(source.Vertices[vertex].TexCoord.y, merged.Vertices[vertex].TexCoord.y, 0.0f);
+		}
+		// The normals are still unit length and at right angles to the transformed square
+		XMVECTOR faceNormal = TriangleNormal(merged, 0);
+		for (const VERTEX& vertex : merged.Vertices)
+		{
+			XMVECTOR normal = XMLoadFloat3(&vertex.Normal);
+			CHECK_NEAR(1.0f, XMVectorGetX(XMVector3Length(normal)), 0.0001f);
+			CHECK_NEAR(1.0f, XMVectorGetX(XMVector3Dot(normal, faceNormal)), 0.0001f);
+		}
+	}
+}
+
+TEST(StaticBatcher, TurnsMirroredTrianglesRound)
+{
+	std::shared_ptr<ModelData> wall = CreateWall();
+	// Mirrored in one axis or three, and not mirrored (in two axes, which is a rotation)
+	const XMMATRIX placements[] =
+	{
+		XMMatrixScaling(-1.0f, 1.0f, 1.0f),
+		XMMatrixScaling(-1.0f, -1.0f, -1.0f) * XMMatrixTranslation(3.0f, 0.0f, 0.0f),
+		XMMatrixScaling(-1.0f, -1.0f, 1.0f),
+		XMMatrixRotationY(2.0f),
+	};
+	const bool mirrored[] = { true, true, false, false };
+	for (int i = 0; i < 4; i++)
+	{
+		StaticBatcher batcher;
+		CHECK(batcher.AddPlacement(wall, placements[i]));
+		std::shared_ptr<ModelData> batch = batcher.Build();
+		const ModelSubMeshData& merged = batch->SubMeshes[0];
+		const ModelSubMeshData& source = wall->SubMeshes[0];
+		CHECK_EQUAL(source.Indices.size(), merged.Indices.size());
+		for (size_t triangle = 0; triangle < merged.Indices.size(); triangle += 3)
+		{
+			// The first corner stays, and the other two are swapped if the placement is mirrored
+			CHECK_EQUAL(source.Indices[triangle], merged.Indices[triangle]);
+			CHECK_EQUAL(source.Indices[triangle + (mirrored[i] ? 2 : 1)], merged.Indices[triangle + 1]);
+			CHECK_EQUAL(source.Indices[triangle + (mirrored[i] ? 1 : 2)], merged.Indices[triangle + 2]);
+			// so the winding still agrees with the normals, as it does in the model
+			XMVECTOR normal = XMLoadFloat3(&merged.Vertices[merged.Indices[triangle]].Normal);
+			CHECK(XMVectorGetX(XMVector3Dot(TriangleNormal(merged, triangle), normal)) > 0.999f);
+		}
+	}
+	// (In the wall itself, the cross product of each triangle's edges points along its normals)
+	CHECK(XMVectorGetX(XMVector3Dot(TriangleNormal(wall->SubMeshes[0], 0), XMLoadFloat3(&wall->SubMeshes[0].Vertices[0].Normal))) > 0.999f);
+}
+
+TEST(StaticBatcher, LeavesOutModelsItCannotDraw)
+{
+	std::shared_ptr<ModelData> noMaterials = CreateWall();
+	noMaterials->Materials.clear();
+	std::shared_ptr<ModelData> noNodes = CreateWall();
+	noNodes->RootNode = nullptr;
+	StaticBatcher batcher;
+	CHECK(!batcher.AddPlacement(nullptr, XMMatrixIdentity()));
+	CHECK(!batcher.AddPlacement(noMaterials, XMMatrixIdentity()));
+	CHECK(!batcher.AddPlacement(noNodes, XMMatrixIdentity()));
+	CHECK(batcher.Build()->SubMeshes.empty());
+	CHECK_EQUAL(0u, batcher.GetStatistics().PlacementCount);
+	CHECK_EQUAL(0u, batcher.GetStatistics().DrawsBefore);
+	CHECK_EQUAL(0u, batcher.GetStatistics().DrawsAfter);
+
+	CHECK(batcher.AddPlacement(CreateWall(), XMMatrixIdentity()));
+	CHECK_EQUAL(static_cast<size_t>(1), batcher.Build()->SubMeshes.size());
+	CHECK_EQUAL(1u, batcher.GetStatistics().PlacementCount);
+}
@@ -0,0 +1,215 @@
+#include "TestFramework.h"
+#include "SubMeshSelector.h"
+#include "RenderQueue.h"
+#include <vector>
+
+using namespace DirectX;
+
+// Bounds of a unit box centred on a point
+static MeshBounds CreateBounds(float x, float y, float z)
+{
+	MeshBounds bounds;
+	XMFLOAT3 minimum(x - 0.5f, y - 0.5f, z - 0.5f);
+	XMFLOAT3 maximum(x + 0.5f, y + 0.5f, z + 0.5f);
+	bounds.Minimum = minimum;
+	bounds.Maximum = maximum;
+	bounds.Centre = XMFLOAT3(x, y, z);
+	bounds.Radius = 0.87f;
+	return bounds;
+}
+
+// A camera at the origin looking along +z, so the further away a point is, the larger its z
+static XMMATRIX CreateViewProjection()
+{
+	return XMMatrixLookAtLH(XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 1.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)) *
+		   XMMatrixPerspectiveFovLH(0.8f, 1.0f, 1.0f, 1000.0f);
+}
+
+// Records the draws in the order the queue makes them.  Each draw's constants are the z of
+// the centre of what it draws, in world space.
+class DrawOrderSink : public RenderCommandSink
+{
+public:
+	virtual void SetPipeline(const void *) {}
+	virtual void SetMaterialConstantBuffer(const void *) {}
+	virtual void SetTexture(const void *) {}
+	virtual void SetGeometry(const void *, unsigned int, const void *, unsigned int, const void *) {}
+	virtual void Draw(const DrawPacket& packet, const void * constants)
+	{
+		Distances.push_back(*static_cast<const float *>(constants));
+		Instanced.push_back(packet.InstanceCount > 0);
+	}
+
+	std::vector<float>				Distances;
+	std::vector<bool>				Instanced;
+};
+
+static int Pipeline;
+static int Buffers[8];
+
+// Submits the draws as MeshRenderer does, with the sort key the selector's depth gives
+static void Submit(RenderQueue& queue, const std::vector<SubMeshDraw>& draws, const std::vector<MeshBounds>& subMeshBounds, unsigned int instanceCount)
+{
+	for (const SubMeshDraw& draw : draws)
+	{
+		DrawPacket packet = {};
+		packet.SortKey = RenderQueue::MakeSortKey(draw.Transparent, 0, draw.MeshIndex, draw.Depth);
+		packet.Pipeline = &Pipeline;
+		packet.VertexBuffer = &Buffers[draw.MeshIndex];
+		packet.IndexCount = 3;
+		if (draw.Instanced)
+		{
+			packet.InstanceBuffer = &Buffers[7];
+			packet.InstanceCount = instanceCount;
+		}
+		XMFLOAT3 centre;
+		XMStoreFloat3(&centre, XMVector3TransformCoord(XMLoadFloat3(&subMeshBounds[draw.MeshIndex].Centre), XMLoadFloat4x4(&draw.WorldTransformation)));
+		queue.Submit(packet, &centre.z, sizeof(float));
+	}
+}
+
+TEST(SubMeshSelector, ClassifiesEachSubMeshOnceAtLoad)
+{
+	std::vector<float> opacities = { 1.0f, 0.5f, 1.0f, 0.99f, 0.0f };
+	std::vector<MeshBounds> bounds(opacities.size(), CreateBounds(0.0f, 0.0f, 10.0f));
+	SubMeshSelector selector;
+	selector.Classify(opacities, bounds);
+	CHECK(selector.HasTransparentSubMeshes());
+	CHECK(selector.GetOpaqueSubMeshes() == std::vector<unsigned int>({ 0, 2 }));
+	CHECK(selector.GetTransparentSubMeshes() == std::vector<unsigned int>({ 1, 3, 4 }));
+	for (unsigned int meshIndex = 0; meshIndex < opacities.size(); meshIndex++)
+	{
+		bool transparent = opacities[meshIndex] < 1.0f;
+		CHECK(selector.IsTransparent(meshIndex) == transparent);
+		CHECK(selector.IsSelected(meshIndex, SubMeshSelection::All));
+		CHECK(selector.IsSelected(meshIndex, SubMeshSelection::Opaque) == !transparent);
+		CHECK(selector.IsSelected(meshIndex, SubMeshSelection::Transparent) == transparent);
+	}
+	CHECK(!selector.IsSelected(static_cast<unsigned int>(opacities.size()), SubMeshSelection::All));
+
+	// Once classified, a material that changes its opacity does not change how it is drawn
+	// until the mesh is classified again
+	std::vector<float> changed(opacities.size(), 0.25f);
+	std::vector<unsigned int> meshIndices = { 0, 1, 2, 3, 4 };
+	XMFLOAT4X4 world;
+	XMStoreFloat4x4(&world, XMMatrixIdentity());
+	std::vector<SubMeshDraw> draws;
+	selector.AddDraws(meshIndices, XMMatrixIdentity(), CreateViewProjection(), &world, 1, SubMeshSelection::All, draws);
+	CHECK_EQUAL(opacities.size(), draws.size());
+	for (const SubMeshDraw& draw : draws)
+	{
+		CHECK(draw.Transparent == (opacities[draw.MeshIndex] < 1.0f));
+		CHECK(!draw.Instanced);
+	}
+	selector.Classify(changed, bounds);
+	CHECK(selector.GetOpaqueSubMeshes().empty());
+	CHECK_EQUAL(static_cast<size_t>(5), selector.GetTransparentSubMeshes().size());
+
+	// A mesh with nothing to blend
+	SubMeshSelector opaque;
+	opaque.Classify(std::vector<float>(3, 1.0f), bounds);
+	CHECK(!opaque.HasTransparentSubMeshes());
+}
+
+TEST(SubMeshSelector, SortsTransparentSubMeshesByTheirOwnCentres)
+{
+	// One opaque and two transparent sub-meshes, a long way apart along z, all in one node.
+	// Each transparent one is sorted by the centre of its own bounds, not by the object.
+	std::vector<MeshBounds> bounds = { CreateBounds(0.0f, 0.0f, 5.0f), CreateBounds(0.0f, 0.0f, 40.0f), CreateBounds(0.0f, 0.0f, 10.0f) };
+	SubMeshSelector selector;
+	selector.Classify({ 1.0f, 0.5f, 0.5f }, bounds);
+	XMMATRIX viewProjection = CreateViewProjection();
+	XMFLOAT4X4 world;
+	XMStoreFloat4x4(&world, XMMatrixTranslation(0.0f, 0.0f, 20.0f));
+	std::vector<SubMeshDraw> draws;
+	selector.AddDraws({ 0, 1, 2 }, XMMatrixIdentity(), viewProjection, &world, 1, SubMeshSelection::All, draws);
+	CHECK_EQUAL(static_cast<size_t>(3), draws.size());
+
+	float objectDepth = SubMeshSelector::GetDepth(XMLoadFloat4x4(&world) * viewProjection);
+	CHECK_NEAR(objectDepth, draws[0].Depth, 1e-6f);
+	CHECK(draws[1].Depth > objectDepth);
+	CHECK(draws[2].Depth < draws[1].Depth);
+	CHECK_NEAR(SubMeshSelector::GetDepth(viewProjection, XMFLOAT3(0.0f, 0.0f, 60.0f)), draws[1].Depth, 1e-6f);
+	CHECK_NEAR(SubMeshSelector::GetDepth(viewProjection, XMFLOAT3(0.0f, 0.0f, 30.0f)), draws[2].Depth, 1e-6f);
+
+	// Only the transparent ones, as when a mesh is drawn again for its blended parts
+	draws.clear();
+	selector.AddDraws({ 0, 1, 2 }, XMMatrixIdentity(), viewProjection, &world, 1, SubMeshSelection::Transparent, draws);
+	CHECK_EQUAL(static_cast<size_t>(2), draws.size());
+	CHECK(draws[0].Transparent && draws[1].Transparent);
+}
+
+TEST(SubMeshSelector, DrawsTransparentSubMeshesOnceForEachInstance)
+{
+	// Two opaque sub-meshes and one transparent one, drawn with three instances in one walk
+	std::vector<MeshBounds> bounds = { CreateBounds(0.0f, 0.0f, 0.0f), CreateBounds(0.0f, 1.0f, 0.0f), CreateBounds(0.0f, 0.0f, 1.0f) };
+	SubMeshSelector selector;
+	selector.Classify({ 1.0f, 1.0f, 0.5f }, bounds);
+	XMMATRIX viewProjection = CreateViewProjection();
+	XMMATRIX nodeTransformation = XMMatrixTranslation(0.0f, 0.0f, 2.0f);
+	XMFLOAT4X4 instances[3];
+	XMStoreFloat4x4(&instances[0], XMMatrixTranslation(0.0f, 0.0f, 30.0f));
+	XMStoreFloat4x4(&instances[1], XMMatrixTranslation(0.0f, 0.0f, 50.0f));
+	XMStoreFloat4x4(&instances[2], XMMatrixTranslation(0.0f, 0.0f, 10.0f));
+	std::vector<SubMeshDraw> draws;
+	selector.AddDraws({ 0, 1, 2 }, nodeTransformation, viewProjection, instances, 3, SubMeshSelection::All, draws);
+	CHECK_EQUAL(static_cast<size_t>(5), draws.size());
+
+	unsigned int instancedDraws = 0;
+	std::vector<float> transparentCentres;
+	for (const SubMeshDraw& draw : draws)
+	{
+		if (draw.Instanced)
+		{
+			// The shader applies each instance's transformation after the node's
+			instancedDraws++;
+			CHECK(!draw.Transparent);
+			CHECK_NEAR(2.0f, draw.WorldTransformation.m[3][2], 1e-6f);
+			continue;
+		}
+		CHECK(draw.Transparent);
+		CHECK_EQUAL(2u, draw.MeshIndex);
+		float centre = XMVectorGetZ(XMVector3TransformCoord(XMLoadFloat3(&bounds[2].Centre), XMLoadFloat4x4(&draw.WorldTransformation)));
+		transparentCentres.push_back(centre);
+		CHECK_NEAR(SubMeshSelector::GetDepth(viewProjection, XMFLOAT3(0.0f, 0.0f, centre)), draw.Depth, 1e-6f);
+	}
+	CHECK_EQUAL(2u, instancedDraws);
+	CHECK(transparentCentres == std::vector<float>({ 33.0f, 53.0f, 13.0f }));
+}
+
+TEST(SubMeshSelector, QueueDrawsTransparentSubMeshesOfEveryMeshBackToFront)
+{
+	// Two meshes whose transparent sub-meshes are interleaved in depth.  Whichever mesh
+	// submits first, the queue draws every opaque sub-mesh, then every transparent one,
+	// furthest first.
+	XMMATRIX viewProjection = CreateViewProjection();
+	std::vector<MeshBounds> treeBounds = { CreateBounds(0.0f, 0.0f, 0.0f), CreateBounds(0.0f, 0.0f, 5.0f), CreateBounds(0.0f, 0.0f, 45.0f) };
+	SubMeshSelector tree;
+	tree.Classify({ 1.0f, 0.5f, 0.5f }, treeBounds);
+	XMFLOAT4X4 treeWorld;
+	XMStoreFloat4x4(&treeWorld, XMMatrixTranslation(0.0f, 0.0f, 10.0f));
+
+	std::vector<MeshBounds> windowBounds = { CreateBounds(0.0f, 0.0f, 0.0f), CreateBounds(0.0f, 0.0f, -10.0f) };
+	SubMeshSelector window;
+	window.Classify({ 0.3f, 1.0f }, windowBounds);
+	XMFLOAT4X4 windowWorld[2];
+	XMStoreFloat4x4(&windowWorld[0], XMMatrixTranslation(0.0f, 0.0f, 40.0f));
+	XMStoreFloat4x4(&windowWorld[1], XMMatrixTranslation(3.0f, 0.0f, 25.0f));
+
+	RenderQueue queue;
+	std::vector<SubMeshDraw> draws;
+	window.AddDraws({ 0, 1 }, XMMatrixIdentity(), viewProjection, windowWorld, 2, SubMeshSelection::All, draws);
+	Submit(queue, draws, windowBounds, 2);
+	draws.clear();
+	tree.AddDraws({ 0, 1, 2 }, XMMatrixIdentity(), viewProjection, &treeWorld, 1, SubMeshSelection::All, draws);
+	Submit(queue, draws, treeBounds, 1);
+
+	DrawOrderSink sink;
+	queue.Flush(sink);
+	// The opaque draws: the tree's trunk and the windows' frames, drawn instanced
+	CHECK_EQUAL(static_cast<size_t>(6), sink.Distances.size());
+	CHECK(sink.Instanced == std::vector<bool>({ true, false, false, false, false, false }) ||
+		  sink.Instanced == std::vector<bool>({ false, true, false, false, false, false }));
+	std::vector<float> transparent(sink.Distances.begin() + 2, sink.Distances.end());
+	CHECK(transparent == std::vector<float>({ 55.0f, 40.0f, 25.0f, 15.0f }));
+}
@@ -0,0 +1,52 @@
+#include "TestFramework.h"
+#include "TerrainGrid.h"
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Build time should grow with the number of vertices, and the memory is compared with the
+// four vertices and six 32-bit indices per cell that the terrain used to be built with
+BENCHMARK(TerrainGrid, BuildTimeAndMemory)
+{
+	printf("    %8s %12s %12s %14s %14s\n", "size", "build ms", "ns/vertex", "memory MB", "per-cell MB");
+	for (int size = 256; size <= 2048; size *= 2)
+	{
+		TerrainGrid grid(size, 1.0f, 100.0f);
+		double milliseconds = TimeMilliseconds(3, [&grid]() { grid.Build(HeightMap()); });
+		double perCellBytes = static_cast<double>(size) * size * (4 * sizeof(VERTEX) + 6 * sizeof(unsigned int));
+		printf("    %8d %12.2f %12.2f %14.1f %14.1f\n", size, milliseconds,
+			   milliseconds * 1e6 / grid.GetVertexCount(),
+			   grid.GetMemoryUsed() / (1024.0 * 1024.0), perCellBytes / (1024.0 * 1024.0));
+	}
+}
+
+// Build time against thread count, from a height map the same size as the grid
+BENCHMARK(TerrainGrid, ParallelBuild)
+{
+	std::wstring directory = CreateTestDirectory("TerrainGridBenchmark");
+	unsigned int hardwareThreads = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+	printf("    %8s %8s %12s %10s\n", "size", "threads", "build ms", "speed-up");
+	for (int size = 1024; size <= 4096; size *= 2)
+	{
+		std::vector<uint16_t> samples(static_cast<size_t>(size) * size);
+		for (size_t i = 0; i < samples.size(); i++)
+		{
+			samples[i] = static_cast<uint16_t>((i * 2654435761u) >> 16);
+		}
+		std::wstring fileName = directory + L"/HeightMap" + std::to_wstring(size) + L".raw";
+		WriteTestFile(fileName, samples.data(), samples.size() * sizeof(uint16_t));
+		HeightMap heightMap;
+		heightMap.Load(fileName);
+
+		TerrainGrid grid(size, 1.0f, 100.0f);
+		double serialMilliseconds = TimeMilliseconds(2, [&]() { grid.Build(heightMap); });
+		printf("    %8d %8s %12.2f %10s\n", size, "serial", serialMilliseconds, "");
+		for (unsigned int threadCount = 1; threadCount <= hardwareThreads; threadCount *= 2)
+		{
+			ThreadPool threadPool(threadCount);
+			double milliseconds = TimeMilliseconds(2, [&]() { grid.Build(heightMap, &threadPool); });
+			printf("    %8d %8u %12.2f %9.2fx\n", size, threadCount, milliseconds, serialMilliseconds / milliseconds);
+		}
+	}
+}
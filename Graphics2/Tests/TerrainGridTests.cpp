@@ -0,0 +1,158 @@
+#include "TestFramework.h"
+#include "TerrainGrid.h"
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace DirectX;
+
+// Writes a width x width height map whose height rises along x and falls along z
+static std::wstring WriteSlopedHeightMap(int width)
+{
+	std::vector<uint16_t> samples(static_cast<size_t>(width) * width);
+	for (int z = 0; z < width; z++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			samples[static_cast<size_t>(z) * width + x] = static_cast<uint16_t>(1000 + x * 300 + z * 100);
+		}
+	}
+	std::wstring fileName = CreateTestDirectory("TerrainGrid") + L"/HeightMap.raw";
+	WriteTestFile(fileName, samples.data(), samples.size() * sizeof(uint16_t));
+	return fileName;
+}
+
+static XMFLOAT3 Subtract(const XMFLOAT3& a, const XMFLOAT3& b)
+{
+	return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+}
+
+static float Dot(const XMFLOAT3& a, const XMFLOAT3& b)
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+TEST(TerrainGrid, SharesVerticesBetweenCells)
+{
+	TerrainGrid grid(16, 2.0f, 100.0f);
+	grid.Build(HeightMap());
+	CHECK_EQUAL(17u * 17u, grid.GetVertexCount());
+	CHECK_EQUAL(16u * 16u * 6u, grid.GetIndexCount());
+	// The old layout had four vertices of its own for every cell
+	CHECK(grid.GetVertexCount() * 3 < 16u * 16u * 4u);
+}
+
+TEST(TerrainGrid, IndicesCoverEachCellWithTwoUpwardFacingTriangles)
+{
+	const int size = 8;
+	TerrainGrid grid(size, 1.0f, 10.0f);
+	grid.Build(HeightMap());
+	const std::vector<VERTEX>& vertices = grid.GetVertices();
+	const std::vector<unsigned int>& indices = grid.GetIndices();
+	for (unsigned int index : indices)
+	{
+		CHECK(index < grid.GetVertexCount());
+	}
+	for (size_t triangle = 0; triangle < indices.size() / 3; triangle++)
+	{
+		const XMFLOAT3& p0 = vertices[indices[triangle * 3]].Position;
+		const XMFLOAT3& p1 = vertices[indices[triangle * 3 + 1]].Position;
+		const XMFLOAT3& p2 = vertices[indices[triangle * 3 + 2]].Position;
+		XMFLOAT3 edge1 = Subtract(p1, p0);
+		XMFLOAT3 edge2 = Subtract(p2, p0);
+		// Every triangle is wound the same way, and covers half of a cell
+		float crossY = edge1.z * edge2.x - edge1.x * edge2.z;
+		CHECK_NEAR(0.5f, std::fabs(crossY) * 0.5f, 0.0001f);
+		CHECK(crossY > 0.0f);
+	}
+}
+
+TEST(TerrainGrid, FlatWithoutAHeightMap)
+{
+	TerrainGrid grid(4, 1.0f, 10.0f);
+	grid.Build(HeightMap());
+	for (const VERTEX& vertex : grid.GetVertices())
+	{
+		CHECK_EQUAL(0.0f, vertex.Position.y);
+		CHECK_NEAR(1.0f, vertex.Normal.y, 0.00001f);
+	}
+	// Centred on the origin, with the first row at +z
+	CHECK_NEAR(-2.0f, grid.GetVertices().front().Position.x, 0.00001f);
+	CHECK_NEAR(2.0f, grid.GetVertices().front().Position.z, 0.00001f);
+	CHECK_NEAR(2.0f, grid.GetVertices().back().Position.x, 0.00001f);
+	CHECK_NEAR(-2.0f, grid.GetVertices().back().Position.z, 0.00001f);
+}
+
+TEST(TerrainGrid, NormalsAreSmoothAndPerpendicularToASlope)
+{
+	const int size = 32;
+	HeightMap heightMap;
+	CHECK(heightMap.Load(WriteSlopedHeightMap(size)));
+	TerrainGrid grid(size, 1.0f, 2000.0f);
+	grid.Build(heightMap);
+	const std::vector<VERTEX>& vertices = grid.GetVertices();
+	int verticesPerRow = grid.GetVerticesPerRow();
+	// The height map is a plane, so away from the clamped last row and column every normal
+	// is the plane's normal
+	for (int z = 1; z < size - 1; z++)
+	{
+		for (int x = 1; x < size - 1; x++)
+		{
+			const VERTEX& vertex = vertices[z * verticesPerRow + x];
+			XMFLOAT3 alongX = Subtract(vertices[z * verticesPerRow + x + 1].Position, vertices[z * verticesPerRow + x - 1].Position);
+			XMFLOAT3 alongZ = Subtract(vertices[(z + 1) * verticesPerRow + x].Position, vertices[(z - 1) * verticesPerRow + x].Position);
+			CHECK_NEAR(1.0f, Dot(vertex.Normal, vertex.Normal), 0.0001f);
+			CHECK_NEAR(0.0f, Dot(vertex.Normal, alongX), 0.001f);
+			CHECK_NEAR(0.0f, Dot(vertex.Normal, alongZ), 0.001f);
+			CHECK(vertex.Normal.y > 0.0f);
+		}
+	}
+}
+
+TEST(TerrainGrid, RebuildingDoesNotReallocate)
+{
+	TerrainGrid grid(64, 1.0f, 10.0f);
+	grid.Build(HeightMap());
+	const VERTEX * vertices = grid.GetVertices().data();
+	const unsigned int * indices = grid.GetIndices().data();
+	size_t memoryUsed = grid.GetMemoryUsed();
+	grid.Build(HeightMap());
+	CHECK(vertices == grid.GetVertices().data());
+	CHECK(indices == grid.GetIndices().data());
+	CHECK_EQUAL(memoryUsed, grid.GetMemoryUsed());
+}
+
+TEST(TerrainGrid, ReleasingTheHeightsKeepsTheVertices)
+{
+	TerrainGrid grid(64, 1.0f, 10.0f);
+	grid.Build(HeightMap());
+	std::vector<VERTEX> vertices = grid.GetVertices();
+	size_t memoryUsed = grid.GetMemoryUsed();
+	grid.ReleaseHeights();
+	CHECK_EQUAL(memoryUsed - grid.GetVertexCount() * sizeof(float), grid.GetMemoryUsed());
+	CHECK(vertices.size() == grid.GetVertices().size());
+	CHECK(memcmp(vertices.data(), grid.GetVertices().data(), vertices.size() * sizeof(VERTEX)) == 0);
+	// and a later build still works
+	grid.Build(HeightMap());
+	CHECK(memcmp(vertices.data(), grid.GetVertices().data(), vertices.size() * sizeof(VERTEX)) == 0);
+}
+
+TEST(TerrainGrid, ParallelBuildMatchesSerialBuild)
+{
+	const int size = 100;
+	HeightMap heightMap;
+	CHECK(heightMap.Load(WriteSlopedHeightMap(73)));
+	TerrainGrid serialGrid(size, 1.5f, 300.0f);
+	serialGrid.Build(heightMap);
+	// Thread counts that do and do not divide the rows evenly
+	for (unsigned int threadCount : { 1u, 2u, 3u, 7u })
+	{
+		ThreadPool threadPool(threadCount);
+		TerrainGrid parallelGrid(size, 1.5f, 300.0f);
+		parallelGrid.Build(heightMap, &threadPool);
+		CHECK_EQUAL(serialGrid.GetVertexCount(), parallelGrid.GetVertexCount());
+		CHECK_EQUAL(serialGrid.GetIndexCount(), parallelGrid.GetIndexCount());
+		CHECK(memcmp(serialGrid.GetVertices().data(), parallelGrid.GetVertices().data(), serialGrid.GetVertexCount() * sizeof(VERTEX)) == 0);
+		CHECK(serialGrid.GetIndices() == parallelGrid.GetIndices());
+	}
+}
@@ -0,0 +1,47 @@
+#include "TestFramework.h"
+#include "TerrainQuadTree.h"
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace DirectX;
+
+// Triangles submitted and selection time for a camera flying low over a 1024 x 1024 terrain,
+// against the one draw of the whole grid that the terrain used to make
+BENCHMARK(TerrainQuadTree, TrianglesPerFrame)
+{
+	const int size = 1024;
+	// Rolling hills, so that the coarser levels of detail have some error
+	std::vector<uint16_t> samples(static_cast<size_t>(size + 1) * (size + 1));
+	for (int z = 0; z <= size; z++)
+	{
+		for (int x = 0; x <= size; x++)
+		{
+			float height = 0.5f + 0.25f * std::sin(x * 0.02f) * std::cos(z * 0.03f) + 0.05f * std::sin(x * 0.3f + z * 0.2f);
+			samples[static_cast<size_t>(z) * (size + 1) + x] = static_cast<uint16_t>(height * 65535.0f);
+		}
+	}
+	std::wstring fileName = CreateTestDirectory("TerrainQuadTreeBenchmark") + L"/HeightMap.raw";
+	WriteTestFile(fileName, samples.data(), samples.size() * sizeof(uint16_t));
+	HeightMap heightMap;
+	heightMap.Load(fileName);
+	TerrainGrid grid(size, 1.0f, 100.0f);
+	grid.SetBuildIndices(false);
+	grid.Build(heightMap);
+	TerrainQuadTree quadTree(grid, 64, 5);
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(0.785398f, 16.0f / 9.0f, 1.0f, 10000.0f);
+	float errorScale = 1080.0f / 2.0f * XMVectorGetY(projection.r[1]);
+	std::vector<TerrainChunkDraw> draws;
+
+	printf("    %10s %10s %10s %14s %12s\n", "height", "drawn", "culled", "triangles", "select us");
+	for (float height : { 20.0f, 100.0f, 400.0f, 1600.0f })
+	{
+		XMFLOAT3 camera(0.0f, height, -size * 0.5f);
+		XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(camera.x, camera.y, camera.z, 1.0f), XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		Frustum frustum(view * projection);
+		double milliseconds = TimeMilliseconds(100, [&]() { quadTree.Select(frustum, camera, errorScale, draws); });
+		printf("    %10.0f %10u %10u %14u %12.2f\n", height, quadTree.GetChunksDrawn(), quadTree.GetChunksCulled(),
+			   quadTree.GetTrianglesSubmitted(), milliseconds * 1000.0);
+	}
+	printf("    whole grid: %u triangles\n", static_cast<unsigned int>(size) * size * 2);
+}
@@ -0,0 +1,223 @@
+#include "TestFramework.h"
+#include "TerrainQuadTree.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+using namespace DirectX;
+
+static const int GridSize = 32;
+static const int ChunkSize = 8;
+static const int LodCount = 3;
+static const float CellSize = 4.0f;
+
+// A bumpy height map, so that every coarser level of detail has some error
+static void BuildBumpyGrid(TerrainGrid& grid)
+{
+	const int width = GridSize + 1;
+	std::vector<uint16_t> samples(static_cast<size_t>(width) * width);
+	for (int z = 0; z < width; z++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			float height = 0.5f + 0.2f * std::sin(x * 0.9f) * std::cos(z * 0.7f) + 0.1f * std::sin(x * z * 0.13f);
+			samples[static_cast<size_t>(z) * width + x] = static_cast<uint16_t>(height * 65535.0f);
+		}
+	}
+	std::wstring fileName = CreateTestDirectory("TerrainQuadTree") + L"/HeightMap.raw";
+	WriteTestFile(fileName, samples.data(), samples.size() * sizeof(uint16_t));
+	HeightMap heightMap;
+	heightMap.Load(fileName);
+	grid.Build(heightMap);
+}
+
+static Frustum CreateFrustum(const XMFLOAT3& eye, const XMFLOAT3& focus)
+{
+	XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(eye.x, eye.y, eye.z, 1.0f), XMVectorSet(focus.x, focus.y, focus.z, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(0.785398f, 16.0f / 9.0f, 1.0f, 10000.0f);
+	return Frustum(view * projection);
+}
+
+// The height of a chunk's level of detail at full resolution vertex t along one of its edges.
+// Between the level of detail's vertices, the edge is a straight line.
+static float GetEdgeHeight(const TerrainGrid& grid, int lod, int first, int last, int t, const std::function<int(int)>& vertexAt)
+{
+	int step = 1 << lod;
+	int start = first + (t - first) / step * step;
+	int end = std::min(start + step, last);
+	float startHeight = grid.GetVertices()[vertexAt(start)].Position.y;
+	if (end == start)
+	{
+		return startHeight;
+	}
+	float endHeight = grid.GetVertices()[vertexAt(end)].Position.y;
+	float u = static_cast<float>(t - start) / (end - start);
+	return startHeight * (1.0f - u) + endHeight * u;
+}
+
+TEST(TerrainQuadTree, CullsChunksOutsideTheFrustum)
+{
+	TerrainGrid grid(GridSize, CellSize, 50.0f);
+	grid.SetBuildIndices(false);
+	BuildBumpyGrid(grid);
+	TerrainQuadTree quadTree(grid, ChunkSize, LodCount);
+	CHECK_EQUAL(16, quadTree.GetChunkCount());
+	std::vector<TerrainChunkDraw> draws;
+
+	// From high above, looking down on the whole terrain
+	quadTree.Select(CreateFrustum(XMFLOAT3(0.0f, 400.0f, -1.0f), XMFLOAT3(0.0f, 0.0f, 0.0f)), XMFLOAT3(0.0f, 400.0f, -1.0f), 600.0f, draws);
+	CHECK_EQUAL(16u, quadTree.GetChunksDrawn());
+	CHECK_EQUAL(0u, quadTree.GetChunksCulled());
+
+	// Standing off one edge, looking away from the terrain
+	quadTree.Select(CreateFrustum(XMFLOAT3(0.0f, 10.0f, -80.0f), XMFLOAT3(0.0f, 10.0f, -200.0f)), XMFLOAT3(0.0f, 10.0f, -80.0f), 600.0f, draws);
+	CHECK_EQUAL(0u, quadTree.GetChunksDrawn());
+	CHECK_EQUAL(16u, quadTree.GetChunksCulled());
+	CHECK(draws.empty());
+
+	// Standing in one corner, looking along an edge, sees some of it
+	quadTree.Select(CreateFrustum(XMFLOAT3(-70.0f, 30.0f, -60.0f), XMFLOAT3(-70.0f, 20.0f, 60.0f)), XMFLOAT3(-70.0f, 30.0f, -60.0f), 600.0f, draws);
+	CHECK(quadTree.GetChunksDrawn() > 0);
+	CHECK(quadTree.GetChunksCulled() > 0);
+	CHECK_EQUAL(16u, quadTree.GetChunksDrawn() + quadTree.GetChunksCulled());
+	CHECK_EQUAL(static_cast<size_t>(quadTree.GetChunksDrawn()), draws.size());
+}
+
+TEST(TerrainQuadTree, SubmitsFewerTrianglesFurtherAway)
+{
+	TerrainGrid grid(GridSize, CellSize, 50.0f);
+	grid.SetBuildIndices(false);
+	BuildBumpyGrid(grid);
+	TerrainQuadTree quadTree(grid, ChunkSize, LodCount);
+	std::vector<TerrainChunkDraw> draws;
+
+	XMFLOAT3 nearCamera(0.0f, 60.0f, -1.0f);
+	quadTree.Select(CreateFrustum(nearCamera, XMFLOAT3(0.0f, 0.0f, 0.0f)), nearCamera, 600.0f, draws);
+	unsigned int nearTriangles = quadTree.GetTrianglesSubmitted();
+	unsigned int submitted = 0;
+	for (const TerrainChunkDraw& draw : draws)
+	{
+		submitted += draw.IndexCount / 3;
+	}
+	CHECK_EQUAL(submitted, nearTriangles);
+
+	XMFLOAT3 farCamera(0.0f, 3000.0f, -1.0f);
+	quadTree.Select(CreateFrustum(farCamera, XMFLOAT3(0.0f, 0.0f, 0.0f)), farCamera, 600.0f, draws);
+	CHECK_EQUAL(16u, quadTree.GetChunksDrawn());
+	CHECK(quadTree.GetTrianglesSubmitted() < nearTriangles);
+
+	// No error allowed at all gives the full resolution everywhere
+	quadTree.SetMaxPixelError(0.0f);
+	quadTree.Select(CreateFrustum(farCamera, XMFLOAT3(0.0f, 0.0f, 0.0f)), farCamera, 600.0f, draws);
+	CHECK(quadTree.GetTrianglesSubmitted() >= static_cast<unsigned int>(GridSize * GridSize * 2));
+}
+
+TEST(TerrainQuadTree, SkirtsCoverTheGapsBetweenLevelsOfDetail)
+{
+	TerrainGrid grid(GridSize, CellSize, 50.0f);
+	grid.SetBuildIndices(false);
+	BuildBumpyGrid(grid);
+	TerrainQuadTree quadTree(grid, ChunkSize, LodCount);
+	CHECK(quadTree.GetSkirtDepth() > 0.0f);
+	const int verticesPerRow = grid.GetVerticesPerRow();
+
+	// Every pair of neighbouring chunks, at every pair of levels of detail
+	float largestGap = 0.0f;
+	for (int lodA = 0; lodA < LodCount; lodA++)
+	{
+		for (int lodB = 0; lodB < LodCount; lodB++)
+		{
+			for (int line = ChunkSize; line < GridSize; line += ChunkSize)
+			{
+				for (int first = 0; first < GridSize; first += ChunkSize)
+				{
+					int last = first + ChunkSize;
+					// Both chunks on either side of the line span first to last along it
+					std::function<int(int)> alongColumn = [&](int z) { return z * verticesPerRow + line; };
+					std::function<int(int)> alongRow = [&](int x) { return line * verticesPerRow + x; };
+					for (int t = first; t <= last; t++)
+					{
+						float gap = std::fabs(GetEdgeHeight(grid, lodA, first, last, t, alongColumn) - GetEdgeHeight(grid, lodB, first, last, t, alongColumn));
+						largestGap = std::max(largestGap, gap);
+						CHECK(gap <= quadTree.GetSkirtDepth() + 0.0001f);
+						gap = std::fabs(GetEdgeHeight(grid, lodA, first, last, t, alongRow) - GetEdgeHeight(grid, lodB, first, last, t, alongRow));
+						largestGap = std::max(largestGap, gap);
+						CHECK(gap <= quadTree.GetSkirtDepth() + 0.0001f);
+					}
+				}
+			}
+		}
+	}
+	// Otherwise the test above proves nothing
+	CHECK(largestGap > 0.0f);
+
+	// Skirt vertices hang straight down from grid vertices on the chunk edges
+	const std::vector<VERTEX>& skirtVertices = quadTree.GetSkirtVertices();
+	CHECK(!skirtVertices.empty());
+	for (const VERTEX& skirtVertex : skirtVertices)
+	{
+		int x = static_cast<int>(std::lround(skirtVertex.Position.x / CellSize + GridSize / 2));
+		int z = static_cast<int>(std::lround(GridSize / 2 - skirtVertex.Position.z / CellSize));
+		CHECK(x % ChunkSize == 0 || z % ChunkSize == 0);
+		const VERTEX& gridVertex = grid.GetVertices()[z * verticesPerRow + x];
+		CHECK_NEAR(gridVertex.Position.y - quadTree.GetSkirtDepth(), skirtVertex.Position.y, 0.0001f);
+	}
+}
+
+TEST(TerrainQuadTree, SkirtsFaceOutOfTheirChunk)
+{
+	TerrainGrid grid(GridSize, CellSize, 50.0f);
+	grid.SetBuildIndices(false);
+	BuildBumpyGrid(grid);
+	TerrainQuadTree quadTree(grid, ChunkSize, LodCount);
+	std::vector<VERTEX> vertices = grid.GetVertices();
+	vertices.insert(vertices.end(), quadTree.GetSkirtVertices().begin(), quadTree.GetSkirtVertices().end());
+	const std::vector<unsigned int>& indices = quadTree.GetIndices();
+	for (unsigned int index : indices)
+	{
+		CHECK(index < vertices.size());
+	}
+
+	// Draw every chunk at each level of detail in turn
+	for (float maxPixelError : { 0.0f, 1000000.0f })
+	{
+		quadTree.SetMaxPixelError(maxPixelError);
+		std::vector<TerrainChunkDraw> draws;
+		XMFLOAT3 camera(0.0f, 400.0f, -1.0f);
+		quadTree.Select(CreateFrustum(camera, XMFLOAT3(0.0f, 0.0f, 0.0f)), camera, 600.0f, draws);
+		CHECK_EQUAL(16u, static_cast<unsigned int>(draws.size()));
+		for (const TerrainChunkDraw& draw : draws)
+		{
+			// The chunk's own surface is all on the inside of each of its skirt triangles
+			XMFLOAT3 centre(0.0f, 0.0f, 0.0f);
+			unsigned int surfaceVertexCount = 0;
+			for (unsigned int i = draw.StartIndex; i < draw.StartIndex + draw.IndexCount; i++)
+			{
+				if (indices[i] < grid.GetVertexCount())
+				{
+					centre.x += vertices[indices[i]].Position.x;
+					centre.z += vertices[indices[i]].Position.z;
+					surfaceVertexCount++;
+				}
+			}
+			centre.x /= surfaceVertexCount;
+			centre.z /= surfaceVertexCount;
+			for (unsigned int i = draw.StartIndex; i < draw.StartIndex + draw.IndexCount; i += 3)
+			{
+				if (indices[i] < grid.GetVertexCount() && indices[i + 1] < grid.GetVertexCount() && indices[i + 2] < grid.GetVertexCount())
+				{
+					continue;
+				}
+				const XMFLOAT3& p0 = vertices[indices[i]].Position;
+				const XMFLOAT3& p1 = vertices[indices[i + 1]].Position;
+				const XMFLOAT3& p2 = vertices[indices[i + 2]].Position;
+				XMFLOAT3 edge1(p1.x - p0.x, p1.y - p0.y, p1.z - p0.z);
+				XMFLOAT3 edge2(p2.x - p0.x, p2.y - p0.y, p2.z - p0.z);
+				float normalX = edge1.y * edge2.z - edge1.z * edge2.y;
+				float normalZ = edge1.x * edge2.y - edge1.y * edge2.x;
+				CHECK(normalX * (p0.x - centre.x) + normalZ * (p0.z - centre.z) > 0.0f);
+			}
+		}
+	}
+}
@@ -0,0 +1,164 @@
+#include "TestFramework.h"
+#include "TerrainTileCache.h"
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+
+static const int TileSize = 16;
+
+static std::wstring GetTileFileName(const std::wstring& directory, int x, int z)
+{
+	return directory + L"/Tile_" + std::to_wstring(x) + L"_" + std::to_wstring(z) + L".raw";
+}
+
+static void WriteTile(const std::wstring& directory, int x, int z)
+{
+	std::vector<uint16_t> samples(static_cast<size_t>(TileSize + 1) * (TileSize + 1), static_cast<uint16_t>(1000 * (x + 10) + z));
+	WriteTestFile(GetTileFileName(directory, x, z), samples.data(), samples.size() * sizeof(uint16_t));
+}
+
+static TerrainTileSettings CreateSettings(const std::wstring& directory)
+{
+	TerrainTileSettings settings;
+	settings.Directory = directory;
+	settings.TileSize = TileSize;
+	settings.CellSize = 1.0f;
+	settings.MaxHeight = 10.0f;
+	settings.PrefetchRadius = 1;
+	return settings;
+}
+
+// Updates the cache until the given number of tiles around the camera are visible, or a few
+// seconds have passed
+static bool WaitForVisibleTiles(TerrainTileCache& cache, const XMFLOAT3& cameraPosition, size_t count)
+{
+	auto giveUp = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+	while (std::chrono::steady_clock::now() < giveUp)
+	{
+		cache.Update(cameraPosition);
+		if (cache.GetVisibleTiles().size() >= count)
+		{
+			return true;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return false;
+}
+
+static void UpdateFor(TerrainTileCache& cache, const XMFLOAT3& cameraPosition, int milliseconds)
+{
+	auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds);
+	while (std::chrono::steady_clock::now() < end)
+	{
+		cache.Update(cameraPosition);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+TEST(TerrainTileCache, LoadsEachTileAroundTheCameraOnce)
+{
+	std::wstring directory = CreateTestDirectory("TerrainTileCache");
+	for (int z = -1; z <= 1; z++)
+	{
+		for (int x = -1; x <= 1; x++)
+		{
+			WriteTile(directory, x, z);
+		}
+	}
+	TerrainTileCache cache(CreateSettings(directory));
+	XMFLOAT3 camera(0.0f, 0.0f, 0.0f);
+	CHECK(WaitForVisibleTiles(cache, camera, 9));
+	CHECK_EQUAL(9u, cache.GetLoadCount());
+	CHECK_EQUAL(9u, cache.GetResidentTileCount());
+	for (const std::shared_ptr<TerrainTile>& tile : cache.GetVisibleTiles())
+	{
+		CHECK_NEAR(tile->X * static_cast<float>(TileSize), tile->Origin.x, 0.0001f);
+		CHECK_NEAR(tile->Z * static_cast<float>(TileSize), tile->Origin.z, 0.0001f);
+		CHECK(tile->BoundsMin.x < tile->Origin.x && tile->Origin.x < tile->BoundsMax.x);
+	}
+
+	// With the files gone, asking for any of the tiles again would fail
+	for (int z = -1; z <= 1; z++)
+	{
+		for (int x = -1; x <= 1; x++)
+		{
+			std::filesystem::remove(GetTileFileName(directory, x, z));
+		}
+	}
+	UpdateFor(cache, camera, 100);
+	CHECK_EQUAL(9u, cache.GetLoadCount());
+	CHECK_EQUAL(0u, cache.GetFailedLoadCount());
+	CHECK_EQUAL(static_cast<size_t>(9), cache.GetVisibleTiles().size());
+}
+
+TEST(TerrainTileCache, RetriesMissingTilesAfterADelay)
+{
+	std::wstring directory = CreateTestDirectory("TerrainTileCache");
+	TerrainTileSettings settings = CreateSettings(directory);
+	settings.PrefetchRadius = 0;
+	XMFLOAT3 camera(0.0f, 0.0f, 0.0f);
+
+	// A long delay: the tile is not asked for again while it lasts, even once it is there
+	settings.MissingTileRetryDelay = 1000.0f;
+	{
+		TerrainTileCache cache(settings);
+		UpdateFor(cache, camera, 50);
+		CHECK_EQUAL(1u, cache.GetFailedLoadCount());
+		WriteTile(directory, 0, 0);
+		UpdateFor(cache, camera, 50);
+		CHECK_EQUAL(1u, cache.GetFailedLoadCount());
+		CHECK_EQUAL(0u, cache.GetLoadCount());
+	}
+
+	// A short delay: the tile turns up soon after its file does
+	settings.MissingTileRetryDelay = 0.02f;
+	settings.Directory = CreateTestDirectory("TerrainTileCacheRetry");
+	{
+		TerrainTileCache cache(settings);
+		UpdateFor(cache, camera, 50);
+		unsigned long long failedLoadCount = cache.GetFailedLoadCount();
+		CHECK(failedLoadCount >= 1);
+		// Backing off, so nowhere near one failure per frame
+		CHECK(failedLoadCount < 10);
+		WriteTile(settings.Directory, 0, 0);
+		CHECK(WaitForVisibleTiles(cache, camera, 1));
+		CHECK_EQUAL(1u, cache.GetLoadCount());
+	}
+}
+
+TEST(TerrainTileCache, EvictsLeastRecentlyUsedTilesOverBudget)
+{
+	std::wstring directory = CreateTestDirectory("TerrainTileCache");
+	for (int x = -1; x <= 6; x++)
+	{
+		WriteTile(directory, x, 0);
+	}
+	TerrainTileSettings settings = CreateSettings(directory);
+	TerrainGrid grid(TileSize, 1.0f, 10.0f);
+	grid.SetBuildIndices(false);
+	grid.Build(HeightMap());
+	grid.ReleaseHeights();
+	// Room for four tiles, and only a row of tiles exists
+	settings.MemoryBudget = grid.GetMemoryUsed() * 4;
+	TerrainTileCache cache(settings);
+
+	for (int x = 0; x <= 5; x++)
+	{
+		XMFLOAT3 camera(x * static_cast<float>(TileSize), 0.0f, 0.0f);
+		CHECK(WaitForVisibleTiles(cache, camera, 3));
+		CHECK(cache.GetMemoryUsed() <= settings.MemoryBudget);
+		// Only the vertices of each tile are kept
+		CHECK_EQUAL(cache.GetResidentTileCount() * grid.GetVertexCount() * sizeof(VERTEX), cache.GetMemoryUsed());
+		// The tiles around the camera are never evicted
+		for (const std::shared_ptr<TerrainTile>& tile : cache.GetVisibleTiles())
+		{
+			CHECK(tile->X >= x - 1 && tile->X <= x + 1);
+		}
+	}
+	CHECK(cache.GetEvictionCount() > 0);
+	CHECK_EQUAL(cache.GetLoadCount(), cache.GetResidentTileCount() + cache.GetEvictionCount());
+}
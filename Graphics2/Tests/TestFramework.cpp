@@ -0,0 +1,83 @@
+#include "TestFramework.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+static int failureCount = 0;
+
+std::vector<TestCase>& GetTestCases()
+{
+	static std::vector<TestCase> testCases;
+	return testCases;
+}
+
+std::vector<TestCase>& GetBenchmarks()
+{
+	static std::vector<TestCase> benchmarks;
+	return benchmarks;
+}
+
+void ReportFailure(const char * file, int line, const std::string& message)
+{
+	printf("    %s(%d): check failed: %s\n", file, line, message.c_str());
+	failureCount++;
+}
+
+int RunTestCases(const std::vector<TestCase>& testCases, int argc, char ** argv)
+{
+	int failedCases = 0;
+	int casesRun = 0;
+	for (const TestCase& testCase : testCases)
+	{
+		bool selected = argc <= 1;
+		for (int i = 1; i < argc && !selected; i++)
+		{
+			selected = strcmp(argv[i], testCase.Group) == 0;
+		}
+		if (!selected)
+		{
+			continue;
+		}
+		printf("%s.%s\n", testCase.Group, testCase.Name);
+		fflush(stdout);
+		int failuresBefore = failureCount;
+		testCase.Function();
+		casesRun++;
+		if (failureCount != failuresBefore)
+		{
+			failedCases++;
+		}
+	}
+	printf("%d run, %d failed\n", casesRun, failedCases);
+	// Naming a group that does not exist is a mistake, not a pass
+	return failedCases == 0 && casesRun > 0 ? 0 : 1;
+}
+
+double TimeMilliseconds(unsigned int repeats, const std::function<void()>& task)
+{
+	task();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < repeats; i++)
+	{
+		task();
+	}
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / (repeats > 0 ? repeats : 1);
+}
+
+std::wstring CreateTestDirectory(const std::string& name)
+{
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / ("Graphics2Tests_" + name);
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(directory);
+	return directory.wstring();
+}
+
+bool WriteTestFile(const std::wstring& fileName, const void * data, size_t size)
+{
+	std::ofstream file(std::filesystem::path(fileName), std::ios::binary | std::ios::trunc);
+	file.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <cmath>
+#include <functional>
+#include <string>
+#include <vector>
+
+// A small test and benchmark runner for the parts of the engine that do not need a Direct3D
+// device.  Tests and benchmarks register themselves when the program starts:
+//
+//     TEST(RingAllocator, WrapsAround)
+//     {
+//         CHECK(...);
+//         CHECK_EQUAL(expected, actual);
+//     }
+//
+// Graphics2Tests runs every test, or only the groups named on the command line (CTest runs
+// each group as a test of its own).  A failed check is reported and the test carries on, so
+// one run shows every failure.  Graphics2Benchmarks works the same way for BENCHMARK bodies,
+// which print their own timings.
+
+struct TestCase
+{
+	const char *				Group;
+	const char *				Name;
+	void						(*Function)();
+};
+
+std::vector<TestCase>&			GetTestCases();
+std::vector<TestCase>&			GetBenchmarks();
+
+// Runs the cases whose group is named in argv (or all of them if none are), and returns the
+// process exit code
+int								RunTestCases(const std::vector<TestCase>& testCases, int argc, char ** argv);
+void							ReportFailure(const char * file, int line, const std::string& message);
+
+// The average time of one run of task, in milliseconds.  The task is run once first so that
+// caches and allocations are warmed up.
+double							TimeMilliseconds(unsigned int repeats, const std::function<void()>& task);
+
+// An empty directory under the system's temporary directory, for tests that write files
+std::wstring					CreateTestDirectory(const std::string& name);
+// Returns false if the file could not be written
+bool							WriteTestFile(const std::wstring& fileName, const void * data, size_t size);
+
+struct TestRegistration
+{
+	TestRegistration(std::vector<TestCase>& testCases, const char * group, const char * name, void (*function)())
+	{
+		testCases.push_back({ group, name, function });
+	}
+};
+
+#define TEST(group, name) \
+	static void group##_##name(); \
+	static TestRegistration group##_##name##_Registration(GetTestCases(), #group, #name, group##_##name); \
+	static void group##_##name()
+
+#define BENCHMARK(group, name) \
+	static void group##_##name(); \
+	static TestRegistration group##_##name##_Registration(GetBenchmarks(), #group, #name, group##_##name); \
+	static void group##_##name()
+
+#define CHECK(condition) \
+	do { if (!(condition)) { ReportFailure(__FILE__, __LINE__, #condition); } } while (false)
+
+#define CHECK_EQUAL(expected, actual) \
+	do { if (!((expected) == (actual))) { ReportFailure(__FILE__, __LINE__, #expected " == " #actual); } } while (false)
+
+#define CHECK_NEAR(expected, actual, tolerance) \
+	do { if (!(std::fabs((expected) - (actual)) <= (tolerance))) { ReportFailure(__FILE__, __LINE__, #expected " is near " #actual); } } while (false)
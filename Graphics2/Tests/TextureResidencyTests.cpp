@@ -0,0 +1,210 @@
+#include "TestFramework.h"
+#include "TextureResidency.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+static const size_t TextureSize = 1024 * 1024;
+
+// Records what the manager asks for.  The tests finish the loads themselves, in whatever order
+// and frame they want.
+class FakeTextureBackend : public TextureBackend
+{
+public:
+	std::vector<unsigned int>		Loads;
+	std::vector<std::wstring>		LoadNames;
+	std::vector<unsigned int>		Evictions;
+
+	void LoadTexture(unsigned int textureId, const std::wstring& textureName) override
+	{
+		Loads.push_back(textureId);
+		LoadNames.push_back(textureName);
+	}
+
+	void EvictTexture(unsigned int textureId) override
+	{
+		Evictions.push_back(textureId);
+	}
+
+	// Reports every load that has been started as finished
+	void FinishLoads(TextureResidencyManager& manager)
+	{
+		for (unsigned int textureId : Loads)
+		{
+			manager.TextureLoaded(textureId, TextureSize);
+		}
+		Loads.clear();
+	}
+};
+
+// Draws with each of the textures for one frame, then lets their loads finish
+static void DrawFrame(TextureResidencyManager& manager, FakeTextureBackend& backend, const std::vector<unsigned int>& textureIds)
+{
+	for (unsigned int textureId : textureIds)
+	{
+		manager.MarkUsed(textureId);
+	}
+	manager.Update();
+	backend.FinishLoads(manager);
+}
+
+TEST(TextureResidency, AddingANameAgainGivesTheSameId)
+{
+	FakeTextureBackend backend;
+	TextureResidencyManager manager(backend, 10 * TextureSize);
+	unsigned int brick = manager.AddTexture(L"Brick.png");
+	unsigned int grass = manager.AddTexture(L"Grass.png");
+	CHECK(brick != grass);
+	CHECK_EQUAL(brick, manager.AddTexture(L"Brick.png"));
+	CHECK(TextureResidency::NotLoaded == manager.GetResidency(brick));
+	CHECK(TextureResidency::Failed == manager.GetResidency(1000));
+}
+
+TEST(TextureResidency, OnlyTexturesDrawnWithAreLoaded)
+{
+	FakeTextureBackend backend;
+	TextureResidencyManager manager(backend, 10 * TextureSize);
+	unsigned int seen = manager.AddTexture(L"Seen.png");
+	unsigned int unseen = manager.AddTexture(L"Unseen.png");
+	manager.Update();
+	CHECK(backend.Loads.empty());
+
+	manager.MarkUsed(seen);
+	manager.Update();
+	CHECK(backend.Loads == std::vector<unsigned int>({ seen }));
+	CHECK(backend.LoadNames == std::vector<std::wstring>({ L"Seen.png" }));
+	CHECK(TextureResidency::Loading == manager.GetResidency(seen));
+	CHECK_EQUAL(1u, manager.GetStatistics().LoadingCount);
+
+	// Drawing with it again while it loads does not load it twice
+	manager.MarkUsed(seen);
+	manager.Update();
+	CHECK_EQUAL(static_cast<size_t>(1), backend.Loads.size());
+
+	backend.FinishLoads(manager);
+	CHECK(TextureResidency::Resident == manager.GetResidency(seen));
+	CHECK(TextureResidency::NotLoaded == manager.GetResidency(unseen));
+	const TextureStreamingStatistics& statistics = manager.GetStatistics();
+	CHECK_EQUAL(1u, statistics.ResidentCount);
+	CHECK_EQUAL(TextureSize, statistics.ResidentBytes);
+	CHECK_EQUAL(0u, statistics.LoadingCount);
+	CHECK_EQUAL(1u, statistics.LoadsStarted);
+}
+
+TEST(TextureResidency, LimitsTheLoadsInFlight)
+{
+	FakeTextureBackend backend;
+	TextureResidencyManager manager(backend, 100 * TextureSize);
+	manager.SetMaximumLoads(2);
+	std::vector<unsigned int> textureIds;
+	for (int i = 0; i < 5; i++)
+	{
+		textureIds.push_back(manager.AddTexture(L"Texture" + std::to_wstring(i) + L".png"));
+	}
+	for (unsigned int textureId : textureIds)
+	{
+		manager.MarkUsed(textureId);
+	}
+	manager.Update();
+	CHECK_EQUAL(static_cast<size_t>(2), backend.Loads.size());
+
+	// Nothing more starts until a load finishes
+	for (unsigned int textureId : textureIds)
+	{
+		manager.MarkUsed(textureId);
+	}
+	manager.Update();
+	CHECK_EQUAL(static_cast<size_t>(2), backend.Loads.size());
+
+	// Textures still in view are loaded as the earlier loads finish
+	for (int frame = 0; frame < 3; frame++)
+	{
+		DrawFrame(manager, backend, textureIds);
+	}
+	for (unsigned int textureId : textureIds)
+	{
+		CHECK(TextureResidency::Resident == manager.GetResidency(textureId));
+	}
+	CHECK_EQUAL(5u, manager.GetStatistics().LoadsStarted);
+}
+
+TEST(TextureResidency, EvictsTheLeastRecentlyDrawnOverTheBudget)
+{
+	FakeTextureBackend backend;
+	TextureResidencyManager manager(backend, 3 * TextureSize);
+	unsigned int a = manager.AddTexture(L"A.png");
+	unsigned int b = manager.AddTexture(L"B.png");
+	unsigned int c = manager.AddTexture(L"C.png");
+	unsigned int d = manager.AddTexture(L"D.png");
+	DrawFrame(manager, backend, { a, b, c });
+	// A is drawn with again, so B is now the least recently drawn
+	DrawFrame(manager, backend, { a, c });
+	CHECK(backend.Evictions.empty());
+
+	// D goes over the budget, and B is evicted the frame after D is loaded
+	DrawFrame(manager, backend, { a, d });
+	CHECK(backend.Evictions.empty());
+	CHECK_EQUAL(4 * TextureSize, manager.GetStatistics().ResidentBytes);
+	DrawFrame(manager, backend, { a, d });
+	CHECK(backend.Evictions == std::vector<unsigned int>({ b }));
+	CHECK(TextureResidency::NotLoaded == manager.GetResidency(b));
+	CHECK(TextureResidency::Resident == manager.GetResidency(c));
+	CHECK_EQUAL(3 * TextureSize, manager.GetStatistics().ResidentBytes);
+	CHECK_EQUAL(1u, manager.GetStatistics().Evictions);
+
+	// An evicted texture is loaded again when it is drawn with, and pushes out C
+	DrawFrame(manager, backend, { a, b, d });
+	DrawFrame(manager, backend, { a, b, d });
+	CHECK(backend.Evictions == std::vector<unsigned int>({ b, c }));
+	CHECK(TextureResidency::Resident == manager.GetResidency(b));
+	CHECK_EQUAL(5u, manager.GetStatistics().LoadsStarted);
+}
+
+TEST(TextureResidency, KeepsTexturesInViewOverTheBudget)
+{
+	FakeTextureBackend backend;
+	TextureResidencyManager manager(backend, 2 * TextureSize);
+	std::vector<unsigned int> textureIds;
+	for (int i = 0; i < 4; i++)
+	{
+		textureIds.push_back(manager.AddTexture(L"Texture" + std::to_wstring(i) + L".png"));
+	}
+	DrawFrame(manager, backend, textureIds);
+	DrawFrame(manager, backend, textureIds);
+	CHECK(backend.Evictions.empty());
+	CHECK_EQUAL(4u, manager.GetStatistics().ResidentCount);
+
+	// Once they are out of view, the budget is met again
+	DrawFrame(manager, backend, {});
+	CHECK_EQUAL(static_cast<size_t>(2), backend.Evictions.size());
+	CHECK_EQUAL(2 * TextureSize, manager.GetStatistics().ResidentBytes);
+
+	// Lowering the budget evicts more
+	manager.SetBudget(0);
+	DrawFrame(manager, backend, {});
+	CHECK_EQUAL(static_cast<size_t>(4), backend.Evictions.size());
+	CHECK_EQUAL(static_cast<size_t>(0), manager.GetStatistics().ResidentBytes);
+}
+
+TEST(TextureResidency, FailedTexturesAreNotTriedAgain)
+{
+	FakeTextureBackend backend;
+	TextureResidencyManager manager(backend, 10 * TextureSize);
+	unsigned int missing = manager.AddTexture(L"Missing.png");
+	manager.MarkUsed(missing);
+	manager.Update();
+	manager.TextureFailed(missing);
+	CHECK(TextureResidency::Failed == manager.GetResidency(missing));
+	CHECK_EQUAL(0u, manager.GetStatistics().LoadingCount);
+	backend.Loads.clear();
+	for (int frame = 0; frame < 3; frame++)
+	{
+		DrawFrame(manager, backend, { missing });
+	}
+	CHECK_EQUAL(1u, manager.GetStatistics().LoadsStarted);
+
+	// Reports for textures that are not loading are ignored
+	manager.TextureLoaded(missing, TextureSize);
+	CHECK(TextureResidency::Failed == manager.GetResidency(missing));
+	CHECK_EQUAL(static_cast<size_t>(0), manager.GetStatistics().ResidentBytes);
+}
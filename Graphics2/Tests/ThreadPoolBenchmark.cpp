@@ -0,0 +1,99 @@
+#include "TestFramework.h"
+#include "ThreadPool.h"
+#include <DirectXMath.h>
+#include <cstdio>
+#include <list>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Updated the same way as a SceneGraph: recursively, through lists of shared pointers
+	struct HierarchyNode
+	{
+		XMFLOAT4X4									Local;
+		XMFLOAT4X4									Combined;
+		std::list<std::shared_ptr<HierarchyNode>>	Children;
+
+		void Update(FXMMATRIX parentTransformation)
+		{
+			XMMATRIX combined = XMLoadFloat4x4(&Local) * parentTransformation;
+			XMStoreFloat4x4(&Combined, combined);
+			for (const std::shared_ptr<HierarchyNode>& child : Children)
+			{
+				child->Update(combined);
+			}
+		}
+	};
+
+	// A subtree with the given depth, and branching children at every level
+	std::shared_ptr<HierarchyNode> BuildSubtree(int depth, int branching)
+	{
+		std::shared_ptr<HierarchyNode> node = std::make_shared<HierarchyNode>();
+		XMStoreFloat4x4(&node->Local, XMMatrixRotationY(0.1f * depth) * XMMatrixTranslation(1.0f, 0.0f, 0.0f));
+		if (depth > 1)
+		{
+			for (int i = 0; i < branching; i++)
+			{
+				node->Children.push_back(BuildSubtree(depth - 1, branching));
+			}
+		}
+		return node;
+	}
+}
+
+// Update time against thread count for the root's subtrees handed to ParallelForEach, the way
+// SceneGraph::UpdateIfChangedParallel does it.  The wide hierarchy has many small subtrees and
+// the deep one a few large ones, each about 100,000 nodes in all.
+BENCHMARK(ThreadPool, SceneUpdateScaling)
+{
+	struct Shape
+	{
+		const char *	Name;
+		int				RootChildren;
+		int				Depth;
+		int				Branching;
+	};
+	const Shape shapes[] = { { "wide", 10000, 2, 9 }, { "deep", 6, 14, 2 } };
+	// Powers of two up to the number of cores, and the number of cores itself
+	unsigned int hardwareThreads = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threadCount = 1; threadCount < hardwareThreads; threadCount *= 2)
+	{
+		threadCounts.push_back(threadCount);
+	}
+	threadCounts.push_back(hardwareThreads);
+
+	printf("    %8s %8s %12s %10s\n", "shape", "threads", "update ms", "speed-up");
+	for (const Shape& shape : shapes)
+	{
+		std::vector<std::shared_ptr<HierarchyNode>> subtrees;
+		for (int i = 0; i < shape.RootChildren; i++)
+		{
+			subtrees.push_back(BuildSubtree(shape.Depth, shape.Branching));
+		}
+		double serialMilliseconds = TimeMilliseconds(10, [&]()
+		{
+			for (const std::shared_ptr<HierarchyNode>& subtree : subtrees)
+			{
+				subtree->Update(XMMatrixIdentity());
+			}
+		});
+		printf("    %8s %8s %12.2f %10s\n", shape.Name, "serial", serialMilliseconds, "");
+		for (unsigned int threadCount : threadCounts)
+		{
+			ThreadPool threadPool(threadCount);
+			double milliseconds = TimeMilliseconds(10, [&]()
+			{
+				threadPool.ParallelForEach(static_cast<unsigned int>(subtrees.size()), [&](unsigned int index)
+				{
+					subtrees[index]->Update(XMMatrixIdentity());
+				});
+			});
+			printf("    %8s %8u %12.2f %9.2fx\n", shape.Name, threadCount, milliseconds, serialMilliseconds / milliseconds);
+		}
+	}
+}
@@ -0,0 +1,147 @@
+#include "TestFramework.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+static const unsigned int ThreadCounts[] = { 1, 2, 3, 8 };
+static const unsigned int ItemCounts[] = { 0, 1, 2, 7, 100, 1001 };
+
+TEST(ThreadPool, ThreadCountIncludesTheCaller)
+{
+	CHECK_EQUAL(1u, ThreadPool(1).GetThreadCount());
+	CHECK_EQUAL(3u, ThreadPool(3).GetThreadCount());
+	unsigned int hardwareThreads = std::thread::hardware_concurrency();
+	CHECK_EQUAL(hardwareThreads > 0 ? hardwareThreads : 1u, ThreadPool().GetThreadCount());
+}
+
+TEST(ThreadPool, ParallelForCoversEveryIndexOnceInContiguousBands)
+{
+	for (unsigned int threadCount : ThreadCounts)
+	{
+		ThreadPool threadPool(threadCount);
+		for (unsigned int count : ItemCounts)
+		{
+			std::unique_ptr<std::atomic<int>[]> hits(new std::atomic<int>[count + 1]);
+			for (unsigned int i = 0; i <= count; i++)
+			{
+				hits[i] = 0;
+			}
+			std::atomic<unsigned int> bandCount(0);
+			threadPool.ParallelFor(count, [&](unsigned int begin, unsigned int end)
+			{
+				CHECK(begin < end);
+				CHECK(end <= count);
+				for (unsigned int i = begin; i < end; i++)
+				{
+					hits[i]++;
+				}
+				bandCount++;
+			});
+			for (unsigned int i = 0; i < count; i++)
+			{
+				CHECK_EQUAL(1, hits[i].load());
+			}
+			// No more bands than threads, and none at all for no work
+			CHECK(bandCount <= threadPool.GetThreadCount());
+			CHECK_EQUAL(count == 0, bandCount == 0);
+		}
+	}
+}
+
+TEST(ThreadPool, ParallelForEachCoversEveryIndexOnce)
+{
+	for (unsigned int threadCount : ThreadCounts)
+	{
+		ThreadPool threadPool(threadCount);
+		for (unsigned int count : ItemCounts)
+		{
+			std::unique_ptr<std::atomic<int>[]> hits(new std::atomic<int>[count + 1]);
+			for (unsigned int i = 0; i <= count; i++)
+			{
+				hits[i] = 0;
+			}
+			threadPool.ParallelForEach(count, [&](unsigned int index)
+			{
+				CHECK(index < count);
+				hits[index]++;
+			});
+			for (unsigned int i = 0; i < count; i++)
+			{
+				CHECK_EQUAL(1, hits[i].load());
+			}
+		}
+	}
+}
+
+// A result written per item and then combined in item order is the same whatever the thread
+// count, which is how the parallel scene graph update stays deterministic
+TEST(ThreadPool, PerItemResultsAreTheSameForAnyThreadCount)
+{
+	const unsigned int count = 500;
+	std::vector<float> expected(count);
+	for (unsigned int threadCount : ThreadCounts)
+	{
+		ThreadPool threadPool(threadCount);
+		std::vector<float> results(count);
+		threadPool.ParallelForEach(count, [&](unsigned int index)
+		{
+			float value = 1.0f;
+			for (unsigned int i = 0; i < index % 97; i++)
+			{
+				value = value * 1.0001f + 0.5f / (i + 1);
+			}
+			results[index] = value;
+		});
+		if (threadCount == 1)
+		{
+			expected = results;
+		}
+		CHECK(results == expected);
+	}
+}
+
+TEST(ThreadPool, NestedLoopsComplete)
+{
+	ThreadPool threadPool(4);
+	std::atomic<unsigned int> total(0);
+	threadPool.ParallelForEach(8, [&](unsigned int)
+	{
+		threadPool.ParallelFor(100, [&](unsigned int begin, unsigned int end)
+		{
+			total += end - begin;
+		});
+	});
+	CHECK_EQUAL(800u, total.load());
+}
+
+TEST(ThreadPool, BackgroundTasksAllRun)
+{
+	// With no workers, the task runs straight away on the caller
+	{
+		ThreadPool threadPool(1);
+		bool ran = false;
+		threadPool.SubmitBackground([&ran]() { ran = true; });
+		CHECK(ran);
+	}
+
+	// Tasks still queued when the pool is destroyed are run first, and the pool's parallel
+	// loops keep working while they are queued
+	std::atomic<int> backgroundCount(0);
+	{
+		ThreadPool threadPool(2);
+		for (int i = 0; i < 20; i++)
+		{
+			threadPool.SubmitBackground([&backgroundCount]()
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				backgroundCount++;
+			});
+		}
+		std::atomic<unsigned int> items(0);
+		threadPool.ParallelForEach(50, [&items](unsigned int) { items++; });
+		CHECK_EQUAL(50u, items.load());
+	}
+	CHECK_EQUAL(20, backgroundCount.load());
+}
@@ -0,0 +1,62 @@
+#include "TestFramework.h"
+#include "TransformHierarchy.h"
+#include <cstdio>
+#include <list>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+// The way SceneGraph holds its nodes: each composite has a list of shared pointers to its
+// children and updates them recursively through a virtual call
+class RecursiveNode
+{
+public:
+	virtual ~RecursiveNode() {}
+	virtual void Update(FXMMATRIX parentTransformation)
+	{
+		XMMATRIX combined = XMLoadFloat4x4(&_local) * parentTransformation;
+		XMStoreFloat4x4(&_combined, combined);
+		for (const std::shared_ptr<RecursiveNode>& child : _children)
+		{
+			child->Update(combined);
+		}
+	}
+
+	XMFLOAT4X4									_local;
+	XMFLOAT4X4									_combined;
+	std::list<std::shared_ptr<RecursiveNode>>	_children;
+};
+
+// 100,000 nodes, each with a random earlier node as its parent, updated by one linear pass over
+// the hierarchy's arrays and by walking the equivalent tree of list nodes
+BENCHMARK(TransformHierarchy, Update100kNodes)
+{
+	const int nodeCount = 100000;
+	std::mt19937 random(1);
+	TransformHierarchy hierarchy;
+	std::vector<TransformHierarchy::Handle> handles;
+	std::vector<std::shared_ptr<RecursiveNode>> recursiveNodes;
+	std::shared_ptr<RecursiveNode> recursiveRoot = std::make_shared<RecursiveNode>();
+	XMStoreFloat4x4(&recursiveRoot->_local, XMMatrixIdentity());
+	for (int i = 0; i < nodeCount; i++)
+	{
+		// Mostly children of recent nodes, with a few new top level nodes, like a typical scene
+		int parent = i == 0 || random() % 50 == 0 ? -1 : std::max(0, i - 1 - static_cast<int>(random() % 64));
+		XMMATRIX local = XMMatrixRotationY(i * 0.01f) * XMMatrixTranslation(1.0f, 0.0f, 0.0f);
+		handles.push_back(hierarchy.Add(parent < 0 ? TransformHierarchy::InvalidHandle : handles[parent]));
+		hierarchy.SetLocalTransform(handles.back(), local);
+
+		std::shared_ptr<RecursiveNode> node = std::make_shared<RecursiveNode>();
+		XMStoreFloat4x4(&node->_local, local);
+		(parent < 0 ? recursiveRoot : recursiveNodes[parent])->_children.push_back(node);
+		recursiveNodes.push_back(node);
+	}
+
+	double flatMilliseconds = TimeMilliseconds(20, [&]() { hierarchy.Update(XMMatrixIdentity()); });
+	double recursiveMilliseconds = TimeMilliseconds(20, [&]() { recursiveRoot->Update(XMMatrixIdentity()); });
+	printf("    %12s %12s %12s\n", "", "update ms", "ns/node");
+	printf("    %12s %12.3f %12.2f\n", "flat", flatMilliseconds, flatMilliseconds * 1e6 / nodeCount);
+	printf("    %12s %12.3f %12.2f\n", "recursive", recursiveMilliseconds, recursiveMilliseconds * 1e6 / nodeCount);
+}
@@ -0,0 +1,133 @@
+#include "TestFramework.h"
+#include "TransformHierarchy.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+static bool MatricesAreNear(FXMMATRIX a, CXMMATRIX b)
+{
+	XMFLOAT4X4 first;
+	XMFLOAT4X4 second;
+	XMStoreFloat4x4(&first, a);
+	XMStoreFloat4x4(&second, b);
+	for (int row = 0; row < 4; row++)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			if (std::fabs(first.m[row][column] - second.m[row][column]) > 0.0001f * std::max(1.0f, std::fabs(first.m[row][column])))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static XMMATRIX CreateLocalTransform(int seed)
+{
+	return XMMatrixRotationY(seed * 0.3f) * XMMatrixTranslation(seed * 1.0f, seed * 0.5f, -seed * 0.25f);
+}
+
+TEST(TransformHierarchy, WorldIsLocalTimesParentWorld)
+{
+	TransformHierarchy hierarchy;
+	TransformHierarchy::Handle root = hierarchy.Add();
+	TransformHierarchy::Handle child = hierarchy.Add(root);
+	TransformHierarchy::Handle grandchild = hierarchy.Add(child);
+	hierarchy.SetLocalTransform(root, CreateLocalTransform(1));
+	hierarchy.SetLocalTransform(child, CreateLocalTransform(2));
+	hierarchy.SetLocalTransform(grandchild, CreateLocalTransform(3));
+	XMMATRIX rootTransformation = XMMatrixTranslation(0.0f, 100.0f, 0.0f);
+	hierarchy.Update(rootTransformation);
+
+	CHECK(MatricesAreNear(CreateLocalTransform(1) * rootTransformation, hierarchy.GetWorldTransform(root)));
+	CHECK(MatricesAreNear(CreateLocalTransform(2) * CreateLocalTransform(1) * rootTransformation, hierarchy.GetWorldTransform(child)));
+	CHECK(MatricesAreNear(CreateLocalTransform(3) * CreateLocalTransform(2) * CreateLocalTransform(1) * rootTransformation, hierarchy.GetWorldTransform(grandchild)));
+	CHECK_EQUAL(child, hierarchy.GetParent(grandchild));
+	CHECK_EQUAL(TransformHierarchy::InvalidHandle, hierarchy.GetParent(root));
+}
+
+TEST(TransformHierarchy, RemovingANodeRemovesItsDescendants)
+{
+	//   0
+	//   +-- 1
+	//   |   +-- 3
+	//   |   |   +-- 6
+	//   |   +-- 4
+	//   +-- 2
+	//       +-- 5
+	TransformHierarchy hierarchy;
+	std::vector<TransformHierarchy::Handle> handles;
+	handles.push_back(hierarchy.Add());
+	handles.push_back(hierarchy.Add(handles[0]));
+	handles.push_back(hierarchy.Add(handles[0]));
+	handles.push_back(hierarchy.Add(handles[1]));
+	handles.push_back(hierarchy.Add(handles[1]));
+	handles.push_back(hierarchy.Add(handles[2]));
+	handles.push_back(hierarchy.Add(handles[3]));
+
+	std::vector<TransformHierarchy::Handle> removed;
+	hierarchy.Remove(handles[1], removed);
+	std::sort(removed.begin(), removed.end());
+	CHECK(removed == std::vector<TransformHierarchy::Handle>({ handles[1], handles[3], handles[4], handles[6] }));
+	CHECK_EQUAL(static_cast<size_t>(3), hierarchy.GetCount());
+	CHECK_EQUAL(handles[0], hierarchy.GetParent(handles[2]));
+	CHECK_EQUAL(handles[2], hierarchy.GetParent(handles[5]));
+
+	// The freed handles are used again, and the nodes that were kept are not disturbed
+	hierarchy.SetLocalTransform(handles[5], CreateLocalTransform(5));
+	TransformHierarchy::Handle added = hierarchy.Add(handles[5]);
+	CHECK(std::find(removed.begin(), removed.end(), added) != removed.end());
+	hierarchy.SetLocalTransform(added, CreateLocalTransform(7));
+	hierarchy.Update(XMMatrixIdentity());
+	CHECK(MatricesAreNear(CreateLocalTransform(5), hierarchy.GetWorldTransform(handles[5])));
+	CHECK(MatricesAreNear(CreateLocalTransform(7) * CreateLocalTransform(5), hierarchy.GetWorldTransform(added)));
+}
+
+// Random adds and removes, checked against working each world transform out from its chain of
+// parents
+TEST(TransformHierarchy, MatchesARecursiveUpdateAfterRandomEdits)
+{
+	TransformHierarchy hierarchy;
+	std::mt19937 random(42);
+	std::vector<TransformHierarchy::Handle> live;
+	std::vector<int> seeds;
+	for (int step = 0; step < 2000; step++)
+	{
+		if (!live.empty() && random() % 4 == 0)
+		{
+			std::vector<TransformHierarchy::Handle> removed;
+			hierarchy.Remove(live[random() % live.size()], removed);
+			for (TransformHierarchy::Handle handle : removed)
+			{
+				live.erase(std::find(live.begin(), live.end(), handle));
+			}
+			continue;
+		}
+		TransformHierarchy::Handle parent = live.empty() || random() % 8 == 0 ? TransformHierarchy::InvalidHandle : live[random() % live.size()];
+		TransformHierarchy::Handle handle = hierarchy.Add(parent);
+		if (static_cast<size_t>(handle) >= seeds.size())
+		{
+			seeds.resize(handle + 1);
+		}
+		seeds[handle] = step % 17;
+		hierarchy.SetLocalTransform(handle, CreateLocalTransform(seeds[handle]));
+		live.push_back(handle);
+	}
+	CHECK_EQUAL(live.size(), hierarchy.GetCount());
+
+	XMMATRIX rootTransformation = XMMatrixScaling(2.0f, 2.0f, 2.0f);
+	hierarchy.Update(rootTransformation);
+	for (TransformHierarchy::Handle handle : live)
+	{
+		XMMATRIX expected = XMMatrixIdentity();
+		for (TransformHierarchy::Handle node = handle; node != TransformHierarchy::InvalidHandle; node = hierarchy.GetParent(node))
+		{
+			expected = expected * CreateLocalTransform(seeds[node]);
+		}
+		expected = expected * rootTransformation;
+		CHECK(MatricesAreNear(expected, hierarchy.GetWorldTransform(handle)));
+	}
+}
@@ -0,0 +1,259 @@
+#include "TestFramework.h"
+#include "VertexPacker.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+static float PowerOfTwo(int exponent)
+{
+	return std::ldexp(1.0f, exponent);
+}
+
+// The angle between two unit vectors, worked out from the cross product so that it is still
+// accurate when they are very close
+static double AngleBetween(const XMFLOAT3& a, const XMFLOAT3& b)
+{
+	double crossX = static_cast<double>(a.y) * b.z - static_cast<double>(a.z) * b.y;
+	double crossY = static_cast<double>(a.z) * b.x - static_cast<double>(a.x) * b.z;
+	double crossZ = static_cast<double>(a.x) * b.y - static_cast<double>(a.y) * b.x;
+	double dot = static_cast<double>(a.x) * b.x + static_cast<double>(a.y) * b.y + static_cast<double>(a.z) * b.z;
+	return std::atan2(std::sqrt(crossX * crossX + crossY * crossY + crossZ * crossZ), dot);
+}
+
+TEST(VertexPacker, HalfRoundsToNearestEven)
+{
+	CHECK_EQUAL(0x3c00, VertexPacker::FloatToHalf(1.0f));
+	CHECK_EQUAL(0xc000, VertexPacker::FloatToHalf(-2.0f));
+	CHECK_EQUAL(0x3555, VertexPacker::FloatToHalf(1.0f / 3.0f));
+	CHECK_EQUAL(0x7bff, VertexPacker::FloatToHalf(65504.0f));
+	// Halfway between 1 and the next half rounds down to the even one, and halfway between
+	// that and the one after rounds up to the even one
+	CHECK_EQUAL(0x3c00, VertexPacker::FloatToHalf(1.0f + PowerOfTwo(-11)));
+	CHECK_EQUAL(0x3c02, VertexPacker::FloatToHalf(1.0f + 3.0f * PowerOfTwo(-11)));
+	CHECK_EQUAL(0x3c01, VertexPacker::FloatToHalf(1.0f + PowerOfTwo(-11) + PowerOfTwo(-20)));
+	// Rounding up the largest mantissa carries into the exponent
+	CHECK_EQUAL(0x4000, VertexPacker::FloatToHalf(2.0f - PowerOfTwo(-12)));
+
+	// Every half that is a number comes back as itself
+	for (uint32_t half = 0; half <= 0xffff; half++)
+	{
+		float value = VertexPacker::HalfToFloat(static_cast<uint16_t>(half));
+		if (!std::isnan(value))
+		{
+			CHECK_EQUAL(half, static_cast<uint32_t>(VertexPacker::FloatToHalf(value)));
+		}
+	}
+}
+
+TEST(VertexPacker, HalfDenormals)
+{
+	CHECK_EQUAL(0x0400, VertexPacker::FloatToHalf(PowerOfTwo(-14)));		// The smallest normal half
+	CHECK_EQUAL(0x03ff, VertexPacker::FloatToHalf(PowerOfTwo(-14) - PowerOfTwo(-24)));
+	CHECK_EQUAL(0x0001, VertexPacker::FloatToHalf(PowerOfTwo(-24)));		// The smallest denormal
+	CHECK_EQUAL(0x8001, VertexPacker::FloatToHalf(-PowerOfTwo(-24)));
+	CHECK_NEAR(PowerOfTwo(-24), VertexPacker::HalfToFloat(0x0001), 0.0f);
+	CHECK_NEAR(PowerOfTwo(-14) - PowerOfTwo(-24), VertexPacker::HalfToFloat(0x03ff), 0.0f);
+	// Half of the smallest denormal is a tie, so rounds to zero, and anything more rounds up
+	CHECK_EQUAL(0x0000, VertexPacker::FloatToHalf(PowerOfTwo(-25)));
+	CHECK_EQUAL(0x0001, VertexPacker::FloatToHalf(1.5f * PowerOfTwo(-25)));
+	CHECK_EQUAL(0x0002, VertexPacker::FloatToHalf(1.5f * PowerOfTwo(-24)));
+	// Smaller values, including float denormals, keep their sign
+	CHECK_EQUAL(0x0000, VertexPacker::FloatToHalf(PowerOfTwo(-30)));
+	CHECK_EQUAL(0x8000, VertexPacker::FloatToHalf(-PowerOfTwo(-30)));
+	CHECK_EQUAL(0x0000, VertexPacker::FloatToHalf(std::numeric_limits<float>::denorm_min()));
+	CHECK_EQUAL(0x8000, VertexPacker::FloatToHalf(-0.0f));
+}
+
+TEST(VertexPacker, HalfInfinitiesAndNaN)
+{
+	const float infinity = std::numeric_limits<float>::infinity();
+	CHECK_EQUAL(0x7c00, VertexPacker::FloatToHalf(infinity));
+	CHECK_EQUAL(0xfc00, VertexPacker::FloatToHalf(-infinity));
+	CHECK(VertexPacker::HalfToFloat(0x7c00) == infinity);
+	CHECK(VertexPacker::HalfToFloat(0xfc00) == -infinity);
+	// Too big for a half.  Halfway between the largest half and the next power of two rounds
+	// up to infinity, and anything less rounds down.
+	CHECK_EQUAL(0x7c00, VertexPacker::FloatToHalf(1.0e10f));
+	CHECK_EQUAL(0xfc00, VertexPacker::FloatToHalf(-1.0e10f));
+	CHECK_EQUAL(0x7c00, VertexPacker::FloatToHalf(65520.0f));
+	CHECK_EQUAL(0x7bff, VertexPacker::FloatToHalf(65519.0f));
+	// A NaN stays a NaN rather than becoming infinity
+	uint16_t nan = VertexPacker::FloatToHalf(std::numeric_limits<float>::quiet_NaN());
+	CHECK_EQUAL(0x7c00, nan & 0x7c00);
+	CHECK((nan & 0x03ff) != 0);
+	CHECK(std::isnan(VertexPacker::HalfToFloat(nan)));
+}
+
+TEST(VertexPacker, OctahedralNormalsAreAccurateOverTheSphere)
+{
+	// Normals spread evenly over the sphere, half of them in the folded lower hemisphere, and
+	// the axes and the seams of the fold
+	std::vector<XMFLOAT3> normals;
+	const int count = 100000;
+	for (int i = 0; i < count; i++)
+	{
+		float z = 1.0f - 2.0f * (i + 0.5f) / count;
+		float radius = std::sqrt(1.0f - z * z);
+		float angle = i * 2.39996323f;
+		normals.push_back(XMFLOAT3(radius * std::cos(angle), radius * std::sin(angle), z));
+	}
+	const float diagonal = std::sqrt(0.5f);
+	const XMFLOAT3 edges[] =
+	{
+		XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT3(-1.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f),
+		XMFLOAT3(0.0f, -1.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), XMFLOAT3(0.0f, 0.0f, -1.0f),
+		XMFLOAT3(diagonal, diagonal, 0.0f), XMFLOAT3(-diagonal, diagonal, 0.0f),
+		XMFLOAT3(diagonal, 0.0f, -diagonal), XMFLOAT3(0.0f, -diagonal, -diagonal),
+	};
+	normals.insert(normals.end(), std::begin(edges), std::end(edges));
+
+	double worstAngle = 0.0;
+	for (const XMFLOAT3& normal : normals)
+	{
+		int16_t encoded[2];
+		VertexPacker::EncodeOctahedral(normal, encoded);
+		XMFLOAT3 decoded = VertexPacker::DecodeOctahedral(encoded);
+		CHECK_NEAR(1.0f, decoded.x * decoded.x + decoded.y * decoded.y + decoded.z * decoded.z, 0.00001f);
+		// The fold must not move a normal into the other hemisphere
+		CHECK(normal.z >= -0.0001f || decoded.z < 0.0f);
+		CHECK(normal.z <= 0.0001f || decoded.z > 0.0f);
+		worstAngle = std::fmax(worstAngle, AngleBetween(normal, decoded));
+	}
+	// 0.0057 degrees.  Two snorm16 values leave about 0.0036 degrees at worst.
+	CHECK(worstAngle < 0.0001);
+
+	// A zero normal does not divide by zero
+	int16_t encoded[2];
+	VertexPacker::EncodeOctahedral(XMFLOAT3(0.0f, 0.0f, 0.0f), encoded);
+	CHECK_EQUAL(0, encoded[0]);
+	CHECK_EQUAL(0, encoded[1]);
+}
+
+TEST(VertexPacker, QuantizedPositionsAreAccurateToTheirBounds)
+{
+	// A box much longer in x than in y and z, away from the origin
+	std::mt19937 random(17);
+	std::uniform_real_distribution<float> x(900.0f, 1100.0f);
+	std::uniform_real_distribution<float> y(-0.5f, 0.5f);
+	std::uniform_real_distribution<float> z(-30.0f, -20.0f);
+	std::uniform_real_distribution<float> texCoord(-2.0f, 2.0f);
+	std::vector<VERTEX> vertices(5000);
+	std::vector<unsigned int> indices;
+	for (VERTEX& vertex : vertices)
+	{
+		vertex.Position = XMFLOAT3(x(random), y(random), z(random));
+		vertex.Normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
+		vertex.TexCoord = XMFLOAT2(texCoord(random), texCoord(random));
+		indices.push_back(static_cast<unsigned int>(indices.size()));
+	}
+	PackedGeometry packed;
+	VertexPacker::Pack(vertices.data(), vertices.size(), indices.data(), indices.size(), true, packed);
+	CHECK(packed.Quantized);
+	CHECK_EQUAL(static_cast<unsigned int>(sizeof(PackedVertex)), packed.VertexStride);
+	CHECK_EQUAL(vertices.size() * sizeof(PackedVertex), packed.Vertices.size());
+
+	// Each axis is accurate to half a step of 16 bits across its own extent
+	const PackedVertex * packedVertices = reinterpret_cast<const PackedVertex *>(packed.Vertices.data());
+	const float * scale = &packed.PositionScale.x;
+	const float * offset = &packed.PositionOffset.x;
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		const float * position = &vertices[i].Position.x;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float decoded = offset[axis] + scale[axis] * VertexPacker::Snorm16ToFloat(packedVertices[i].Position[axis]);
+			float tolerance = scale[axis] / 32767.0f * 0.5f + std::fabs(position[axis]) * 1.0e-6f;
+			CHECK_NEAR(position[axis], decoded, tolerance);
+		}
+		CHECK_EQUAL(32767, packedVertices[i].Position[3]);
+		CHECK_NEAR(vertices[i].TexCoord.x, VertexPacker::HalfToFloat(packedVertices[i].TexCoord[0]), 0.001f);
+		CHECK_NEAR(vertices[i].TexCoord.y, VertexPacker::HalfToFloat(packedVertices[i].TexCoord[1]), 0.001f);
+	}
+	CHECK_NEAR(100.0f, packed.PositionScale.x, 0.1f);
+	CHECK_NEAR(0.5f, packed.PositionScale.y, 0.01f);
+
+	// A sub-mesh that is flat in y keeps its height exactly
+	for (VERTEX& vertex : vertices)
+	{
+		vertex.Position.y = 3.25f;
+	}
+	VertexPacker::Pack(vertices.data(), vertices.size(), indices.data(), indices.size(), true, packed);
+	CHECK_NEAR(1.0f, packed.PositionScale.y, 0.0f);
+	packedVertices = reinterpret_cast<const PackedVertex *>(packed.Vertices.data());
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		CHECK_NEAR(3.25f, packed.PositionOffset.y + packed.PositionScale.y * VertexPacker::Snorm16ToFloat(packedVertices[i].Position[1]), 0.0f);
+	}
+}
+
+TEST(VertexPacker, UsesSixteenBitIndicesUpTo65536Vertices)
+{
+	for (size_t vertexCount : { static_cast<size_t>(65536), static_cast<size_t>(65537) })
+	{
+		std::vector<VERTEX> vertices(vertexCount);
+		memset(vertices.data(), 0, vertices.size() * sizeof(VERTEX));
+		// The last vertex, and the vertices either side of 65535
+		std::vector<unsigned int> indices = { 0, 65534, 65535, static_cast<unsigned int>(vertexCount - 1), 1, 2 };
+		PackedGeometry packed;
+		VertexPacker::Pack(vertices.data(), vertices.size(), indices.data(), indices.size(), false, packed);
+		unsigned int expectedSize = vertexCount <= 65536 ? 2 : 4;
+		CHECK_EQUAL(expectedSize, packed.IndexSize);
+		CHECK_EQUAL(indices.size() * expectedSize, packed.Indices.size());
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			unsigned int index;
+			if (packed.IndexSize == 2)
+			{
+				index = reinterpret_cast<const uint16_t *>(packed.Indices.data())[i];
+			}
+			else
+			{
+				index = reinterpret_cast<const uint32_t *>(packed.Indices.data())[i];
+			}
+			CHECK_EQUAL(indices[i], index);
+		}
+	}
+}
+
+TEST(VertexPacker, LargeTextureCoordinatesAreNotQuantized)
+{
+	std::vector<VERTEX> vertices(3);
+	memset(vertices.data(), 0, vertices.size() * sizeof(VERTEX));
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		vertices[i].Position = XMFLOAT3(static_cast<float>(i), 1.0f, 2.0f);
+		vertices[i].Normal = XMFLOAT3(0.0f, 0.0f, 1.0f);
+		vertices[i].TexCoord = XMFLOAT2(0.5f, 0.5f);
+	}
+	std::vector<unsigned int> indices = { 0, 1, 2 };
+
+	// Exactly at the limit, in either direction, is still quantized
+	PackedGeometry packed;
+	vertices[1].TexCoord = XMFLOAT2(VertexPacker::MaximumQuantizedTexCoord, -VertexPacker::MaximumQuantizedTexCoord);
+	VertexPacker::Pack(vertices.data(), vertices.size(), indices.data(), indices.size(), true, packed);
+	CHECK(packed.Quantized);
+
+	// Past it, in u or v, the vertices are kept as they are at full precision
+	const XMFLOAT2 largeTexCoords[] = { XMFLOAT2(2.5f, 0.0f), XMFLOAT2(0.0f, -2.5f), XMFLOAT2(100.0f, 100.0f) };
+	for (const XMFLOAT2& texCoord : largeTexCoords)
+	{
+		vertices[2].TexCoord = texCoord;
+		VertexPacker::Pack(vertices.data(), vertices.size(), indices.data(), indices.size(), true, packed);
+		CHECK(!packed.Quantized);
+		CHECK_EQUAL(static_cast<unsigned int>(sizeof(VERTEX)), packed.VertexStride);
+		CHECK_EQUAL(vertices.size() * sizeof(VERTEX), packed.Vertices.size());
+		CHECK(memcmp(vertices.data(), packed.Vertices.data(), packed.Vertices.size()) == 0);
+		CHECK_NEAR(1.0f, packed.PositionScale.x, 0.0f);
+		CHECK_NEAR(0.0f, packed.PositionOffset.x, 0.0f);
+	}
+
+	// Quantizing can also just be turned off
+	vertices[2].TexCoord = XMFLOAT2(0.5f, 0.5f);
+	VertexPacker::Pack(vertices.data(), vertices.size(), indices.data(), indices.size(), false, packed);
+	CHECK(!packed.Quantized);
+	CHECK(memcmp(vertices.data(), packed.Vertices.data(), packed.Vertices.size()) == 0);
+}
@@ -0,0 +1,102 @@
+#include "TextureResidency.h"
+#include <algorithm>
+
+TextureResidencyManager::TextureResidencyManager(TextureBackend& backend, size_t budgetBytes) :
+	_backend(backend),
+	_budgetBytes(budgetBytes)
+{
+}
+
+unsigned int TextureResidencyManager::AddTexture(const std::wstring& textureName)
+{
+	auto it = _textureIds.find(textureName);
+	if (it != _textureIds.end())
+	{
+		return it->second;
+	}
+	unsigned int textureId = static_cast<unsigned int>(_textures.size());
+	_textures.push_back({ textureName, TextureResidency::NotLoaded, 0, 0 });
+	_textureIds[textureName] = textureId;
+	return textureId;
+}
+
+void TextureResidencyManager::MarkUsed(unsigned int textureId)
+{
+	if (textureId < _textures.size())
+	{
+		_textures[textureId].LastUsedFrame = _frame;
+	}
+}
+
+void TextureResidencyManager::TextureLoaded(unsigned int textureId, size_t sizeInBytes)
+{
+	if (textureId >= _textures.size() || _textures[textureId].Residency != TextureResidency::Loading)
+	{
+		return;
+	}
+	TextureEntry& texture = _textures[textureId];
+	texture.Residency = TextureResidency::Resident;
+	texture.SizeInBytes = sizeInBytes;
+	_statistics.LoadingCount--;
+	_statistics.ResidentCount++;
+	_statistics.ResidentBytes += sizeInBytes;
+}
+
+void TextureResidencyManager::TextureFailed(unsigned int textureId)
+{
+	if (textureId >= _textures.size() || _textures[textureId].Residency != TextureResidency::Loading)
+	{
+		return;
+	}
+	// Failed textures are not tried again, so they keep the fallback texture
+	_textures[textureId].Residency = TextureResidency::Failed;
+	_statistics.LoadingCount--;
+}
+
+void TextureResidencyManager::Update()
+{
+	// Load the textures that were drawn with in the frame that has just finished
+	for (unsigned int i = 0; i < _textures.size() && _statistics.LoadingCount < _maximumLoads; i++)
+	{
+		TextureEntry& texture = _textures[i];
+		if (texture.Residency == TextureResidency::NotLoaded && texture.LastUsedFrame == _frame)
+		{
+			texture.Residency = TextureResidency::Loading;
+			_statistics.LoadingCount++;
+			_statistics.LoadsStarted++;
+			_backend.LoadTexture(i, texture.Name);
+		}
+	}
+
+	// Evict the least recently used textures until the budget is met.  Textures used in
+	// the frame that has just finished are kept.
+	if (_statistics.ResidentBytes > _budgetBytes)
+	{
+		std::vector<unsigned int> candidates;
+		for (unsigned int i = 0; i < _textures.size(); i++)
+		{
+			if (_textures[i].Residency == TextureResidency::Resident && _textures[i].LastUsedFrame < _frame)
+			{
+				candidates.push_back(i);
+			}
+		}
+		std::sort(candidates.begin(), candidates.end(),
+				  [this](unsigned int first, unsigned int second) { return _textures[first].LastUsedFrame < _textures[second].LastUsedFrame; });
+		for (size_t i = 0; i < candidates.size() && _statistics.ResidentBytes > _budgetBytes; i++)
+		{
+			TextureEntry& texture = _textures[candidates[i]];
+			texture.Residency = TextureResidency::NotLoaded;
+			_statistics.ResidentBytes -= texture.SizeInBytes;
+			_statistics.ResidentCount--;
+			_statistics.Evictions++;
+			texture.SizeInBytes = 0;
+			_backend.EvictTexture(candidates[i]);
+		}
+	}
+	_frame++;
+}
+
+TextureResidency TextureResidencyManager::GetResidency(unsigned int textureId) const
+{
+	return textureId < _textures.size() ? _textures[textureId].Residency : TextureResidency::Failed;
+}
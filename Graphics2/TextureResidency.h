@@ -0,0 +1,92 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Decides which material textures are held at full resolution.
+//
+// Textures start out not loaded, and materials draw with a fallback texture until theirs is
+// resident.  A texture is loaded the frame after it is first drawn with, so textures that are
+// never seen are never loaded.  Once the resident textures go over the memory budget, the ones
+// that were drawn with longest ago are evicted (and will be loaded again if they are drawn
+// with later).  Textures drawn with in the current frame are never evicted, so the budget can
+// be exceeded if that many textures are in view.
+//
+// The loading and evicting are done through a TextureBackend, so this class does not need
+// Direct3D and can be driven with a fake backend.  Everything here is called on one thread.
+
+class TextureBackend
+{
+public:
+	virtual ~TextureBackend() {}
+
+	// Start loading a texture.  The backend calls TextureLoaded or TextureFailed once it is done.
+	virtual void				LoadTexture(unsigned int textureId, const std::wstring& textureName) = 0;
+	// Free a resident texture.  Anything drawing with it goes back to the fallback texture.
+	virtual void				EvictTexture(unsigned int textureId) = 0;
+};
+
+enum class TextureResidency
+{
+	NotLoaded,
+	Loading,
+	Resident,
+	Failed
+};
+
+struct TextureStreamingStatistics
+{
+	size_t						ResidentBytes;
+	unsigned int				ResidentCount;
+	unsigned int				LoadingCount;
+	// Totals since the manager was created
+	unsigned int				LoadsStarted;
+	unsigned int				Evictions;
+};
+
+class TextureResidencyManager
+{
+public:
+	TextureResidencyManager(TextureBackend& backend, size_t budgetBytes);
+
+	// Returns the texture's id.  Adding the same name again gives the same id.
+	unsigned int				AddTexture(const std::wstring& textureName);
+	// Called each time something is drawn with the texture
+	void						MarkUsed(unsigned int textureId);
+
+	// Called by the backend
+	void						TextureLoaded(unsigned int textureId, size_t sizeInBytes);
+	void						TextureFailed(unsigned int textureId);
+
+	// Called once a frame, after the backend has reported any loads that have finished.
+	// Starts loading the textures that were drawn with since the last call and evicts
+	// textures until the budget is met.
+	void						Update();
+
+	inline void					SetBudget(size_t budgetBytes) { _budgetBytes = budgetBytes; }
+	inline size_t				GetBudget() const { return _budgetBytes; }
+	// The number of textures that can be loading at once.  Defaults to 4.
+	inline void					SetMaximumLoads(unsigned int maximumLoads) { _maximumLoads = maximumLoads; }
+	TextureResidency			GetResidency(unsigned int textureId) const;
+	inline const TextureStreamingStatistics&	GetStatistics() const { return _statistics; }
+
+private:
+	struct TextureEntry
+	{
+		std::wstring			Name;
+		TextureResidency		Residency;
+		size_t					SizeInBytes;
+		uint64_t				LastUsedFrame;		// 0 if never drawn with
+	};
+
+	TextureBackend&				_backend;
+	size_t						_budgetBytes;
+	unsigned int				_maximumLoads = 4;
+	std::vector<TextureEntry>	_textures;
+	std::unordered_map<std::wstring, unsigned int>	_textureIds;
+	// Frame 0 means never, so counting starts at 1
+	uint64_t					_frame = 1;
+	TextureStreamingStatistics	_statistics = {};
+};
@@ -0,0 +1,169 @@
+#include "TextureStreamer.h"
+#include "DirectXFramework.h"
+#include "WICTextureLoader.h"
+
+// WICTextureLoader only gives a few formats, so anything else is counted as 4 bytes a texel
+static size_t GetBytesPerTexel(DXGI_FORMAT format)
+{
+	switch (format)
+	{
+		case DXGI_FORMAT_R32G32B32A32_FLOAT:
+			return 16;
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:
+		case DXGI_FORMAT_R16G16B16A16_UNORM:
+			return 8;
+		case DXGI_FORMAT_R16_FLOAT:
+		case DXGI_FORMAT_R16_UNORM:
+		case DXGI_FORMAT_B5G6R5_UNORM:
+		case DXGI_FORMAT_B5G5R5A1_UNORM:
+			return 2;
+		case DXGI_FORMAT_R8_UNORM:
+		case DXGI_FORMAT_A8_UNORM:
+			return 1;
+		default:
+			return 4;
+	}
+}
+
+TextureStreamer::TextureStreamer(ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> deviceContext, ComPtr<ID3D11ShaderResourceView> fallbackTexture)
+{
+	_device = device;
+	_deviceContext = deviceContext;
+	_fallbackTexture = fallbackTexture;
+}
+
+TextureStreamer::StreamedTexture& TextureStreamer::GetTexture(unsigned int textureId)
+{
+	if (textureId >= _textures.size())
+	{
+		_textures.resize(textureId + 1);
+	}
+	return _textures[textureId];
+}
+
+void TextureStreamer::AddMaterial(unsigned int textureId, shared_ptr<Material> material)
+{
+	StreamedTexture& texture = GetTexture(textureId);
+	texture.Materials.push_back(material);
+	material->SetTexture(texture.Texture != nullptr ? texture.Texture : _fallbackTexture);
+}
+
+void TextureStreamer::LoadTexture(unsigned int textureId, const wstring& textureName)
+{
+	StreamedTexture& texture = GetTexture(textureId);
+	shared_ptr<promise<ComPtr<ID3D11ShaderResourceView>>> texturePromise = make_shared<promise<ComPtr<ID3D11ShaderResourceView>>>();
+	texture.DecodedTexture = texturePromise->get_future();
+	texture.Loading = true;
+	ComPtr<ID3D11Device> device = _device;
+	DirectXFramework::GetDXFramework()->GetThreadPool()->SubmitBackground([texturePromise, device, textureName]()
+	{
+		// WIC needs COM on every thread that uses it.  Without a device context, creating
+		// the texture is safe on any thread, but no mipmaps are made.
+		HRESULT comResult = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+		ComPtr<ID3D11ShaderResourceView> decodedTexture;
+		if (FAILED(CreateWICTextureFromFile(device.Get(), textureName.c_str(), nullptr, decodedTexture.GetAddressOf())))
+		{
+			decodedTexture = nullptr;
+		}
+		if (SUCCEEDED(comResult))
+		{
+			CoUninitialize();
+		}
+		texturePromise->set_value(decodedTexture);
+	});
+}
+
+void TextureStreamer::EvictTexture(unsigned int textureId)
+{
+	StreamedTexture& texture = GetTexture(textureId);
+	texture.Texture = nullptr;
+	SetMaterialTextures(texture, _fallbackTexture);
+}
+
+void TextureStreamer::CreateLoadedTextures(TextureResidencyManager& residencyManager)
+{
+	for (unsigned int textureId = 0; textureId < _textures.size(); textureId++)
+	{
+		StreamedTexture& texture = _textures[textureId];
+		if (!texture.Loading || texture.DecodedTexture.wait_for(chrono::seconds(0)) != future_status::ready)
+		{
+			continue;
+		}
+		texture.Loading = false;
+		ComPtr<ID3D11ShaderResourceView> decodedTexture = texture.DecodedTexture.get();
+		if (decodedTexture == nullptr)
+		{
+			residencyManager.TextureFailed(textureId);
+			continue;
+		}
+		size_t sizeInBytes;
+		texture.Texture = CreateMipmaps(decodedTexture, sizeInBytes);
+		SetMaterialTextures(texture, texture.Texture);
+		residencyManager.TextureLoaded(textureId, sizeInBytes);
+	}
+}
+
+void TextureStreamer::SetMaterialTextures(StreamedTexture& texture, ComPtr<ID3D11ShaderResourceView> shaderResourceView)
+{
+	// Materials that have been released are dropped from the list
+	vector<weak_ptr<Material>>::iterator it = texture.Materials.begin();
+	while (it != texture.Materials.end())
+	{
+		shared_ptr<Material> material = it->lock();
+		if (material == nullptr)
+		{
+			it = texture.Materials.erase(it);
+			continue;
+		}
+		material->SetTexture(shaderResourceView);
+		++it;
+	}
+}
+
+ComPtr<ID3D11ShaderResourceView> TextureStreamer::CreateMipmaps(ComPtr<ID3D11ShaderResourceView> decodedTexture, size_t& sizeInBytes)
+{
+	ComPtr<ID3D11Resource> resource;
+	decodedTexture->GetResource(resource.GetAddressOf());
+	ComPtr<ID3D11Texture2D> sourceTexture;
+	ThrowIfFailed(resource.As(&sourceTexture));
+	D3D11_TEXTURE2D_DESC textureDesc;
+	sourceTexture->GetDesc(&textureDesc);
+	size_t bytesPerTexel = GetBytesPerTexel(textureDesc.Format);
+	sizeInBytes = textureDesc.Width * textureDesc.Height * bytesPerTexel;
+
+	// Copy the decoded image into the top level of a texture with a full set of mipmaps,
+	// and have the GPU make the rest.  If the format cannot have mipmaps made for it, the
+	// texture is used as it is.
+	UINT formatSupport = 0;
+	if (FAILED(_device->CheckFormatSupport(textureDesc.Format, &formatSupport)) ||
+		(formatSupport & D3D11_FORMAT_SUPPORT_MIP_AUTOGEN) == 0)
+	{
+		return decodedTexture;
+	}
+	textureDesc.MipLevels = 0;
+	textureDesc.Usage = D3D11_USAGE_DEFAULT;
+	textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
+	textureDesc.CPUAccessFlags = 0;
+	textureDesc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
+	ComPtr<ID3D11Texture2D> mipmappedTexture;
+	ComPtr<ID3D11ShaderResourceView> shaderResourceView;
+	if (FAILED(_device->CreateTexture2D(&textureDesc, nullptr, mipmappedTexture.GetAddressOf())) ||
+		FAILED(_device->CreateShaderResourceView(mipmappedTexture.Get(), nullptr, shaderResourceView.GetAddressOf())))
+	{
+		return decodedTexture;
+	}
+	_deviceContext->CopySubresourceRegion(mipmappedTexture.Get(), 0, 0, 0, 0, sourceTexture.Get(), 0, nullptr);
+	_deviceContext->GenerateMips(shaderResourceView.Get());
+
+	mipmappedTexture->GetDesc(&textureDesc);
+	sizeInBytes = 0;
+	for (UINT level = 0; level < textureDesc.MipLevels; level++)
+	{
+		size_t width = textureDesc.Width >> level;
+		size_t height = textureDesc.Height >> level;
+		width = width > 0 ? width : 1;
+		height = height > 0 ? height : 1;
+		sizeInBytes += width * height * bytesPerTexel;
+	}
+	return shaderResourceView;
+}
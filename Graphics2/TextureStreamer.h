@@ -0,0 +1,45 @@
+#pragma once
+#include "core.h"
+#include "DirectXCore.h"
+#include "Mesh.h"
+#include "TextureResidency.h"
+#include <future>
+
+// The Direct3D side of texture streaming (see TextureResidency.h).  Texture files are read and
+// decoded on a worker thread.  The mipmaps are then made on the device thread, and the new
+// texture is given to every material that uses it.  When a texture is evicted, its materials
+// go back to the fallback texture.
+
+class TextureStreamer : public TextureBackend
+{
+public:
+	TextureStreamer(ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> deviceContext, ComPtr<ID3D11ShaderResourceView> fallbackTexture);
+
+	// The material is drawn with the fallback texture until the texture is resident
+	void								AddMaterial(unsigned int textureId, shared_ptr<Material> material);
+
+	void								LoadTexture(unsigned int textureId, const wstring& textureName) override;
+	void								EvictTexture(unsigned int textureId) override;
+
+	// Called on the device thread.  Finishes the textures that have been read and reports
+	// them to the residency manager.  Never waits for a texture that is still being read.
+	void								CreateLoadedTextures(TextureResidencyManager& residencyManager);
+
+private:
+	struct StreamedTexture
+	{
+		vector<weak_ptr<Material>>		Materials;
+		ComPtr<ID3D11ShaderResourceView>	Texture;
+		bool							Loading = false;
+		future<ComPtr<ID3D11ShaderResourceView>>	DecodedTexture;
+	};
+
+	ComPtr<ID3D11Device>				_device;
+	ComPtr<ID3D11DeviceContext>			_deviceContext;
+	ComPtr<ID3D11ShaderResourceView>	_fallbackTexture;
+	vector<StreamedTexture>				_textures;
+
+	StreamedTexture&					GetTexture(unsigned int textureId);
+	void								SetMaterialTextures(StreamedTexture& texture, ComPtr<ID3D11ShaderResourceView> shaderResourceView);
+	ComPtr<ID3D11ShaderResourceView>	CreateMipmaps(ComPtr<ID3D11ShaderResourceView> decodedTexture, size_t& sizeInBytes);
+};
@@ -1,11 +1,17 @@
-cbuffer ConstantBuffer
+// The constants are split by how often they change.  These must match ConstantBuffers.h.
+
+// Camera and lights, set once a frame
+cbuffer FrameConstants : register(b0)
 {
-    float4x4 completeTransformation;
-    float4x4 worldTransformation;    
 	float4 cameraPosition;
     float4 lightVector;			// the light's vector
     float4 lightColor;			// the light's color
     float4 ambientColor;		// the ambient light's color
+}
+
+// Set once for each material
+cbuffer MaterialConstants : register(b1)
+{
     float4 diffuseCoefficient;	// The diffuse reflection cooefficient
 	float4 specularCoefficient;	// The specular reflection cooefficient
 	float  shininess;			// The shininess factor
@@ -13,7 +19,39 @@ cbuffer ConstantBuffer
 	float2 padding;
 }
 
-Texture2D Texture;
+// Set for every draw
+cbuffer ObjectConstants : register(b2)
+{
+    float4x4 completeTransformation;
+    float4x4 worldTransformation;    
+	float4 positionScale;		// Only used for quantized vertices
+	float4 positionOffset;
+}
+
+// The layout of the light clusters, set once a frame
+cbuffer ClusterConstants : register(b3)
+{
+	uint4 clusterCounts;		// Tiles across, tiles down, slices and lights
+	float2 clusterTileScale;	// Takes a pixel position to a tile
+	float clusterSliceScale;	// slice = log(view depth) * clusterSliceScale + clusterSliceBias
+	float clusterSliceBias;
+}
+
+// The same as ClusterLight in LightClusters.h
+struct ClusterLight
+{
+	float3 position;
+	float range;
+	float3 colour;
+	float spotCosine;			// -1 or less for a point light
+	float3 direction;
+	float padding;
+};
+
+Texture2D Texture : register(t0);
+StructuredBuffer<ClusterLight> clusterLights : register(t1);
+StructuredBuffer<uint2> clusterRanges : register(t2);		// The offset and count of each cluster's light indices
+StructuredBuffer<uint> clusterLightIndices : register(t3);
 SamplerState ss;
 
 struct VertexShaderInput
@@ -23,6 +61,35 @@ struct VertexShaderInput
 	float2 TexCoord : TEXCOORD;
 };
 
+// Used when a mesh is drawn once for many instances.  Each instance's world transform
+// comes from a second vertex buffer, and the constant buffer holds the view * projection
+// transform in completeTransformation.  worldTransformation holds the transform of the
+// mesh's node, which is applied before the instance's transform.
+struct InstancedVertexShaderInput
+{
+	float3 Position : POSITION;
+	float3 Normal : NORMAL;
+	float2 TexCoord : TEXCOORD;
+	float4x4 InstanceWorld : WORLD;
+};
+
+// Used for sub-meshes packed by VertexPacker.  The position is relative to the sub-mesh's
+// bounding box, the normal is octahedrally encoded and the texture coordinates are half floats.
+struct QuantizedVertexShaderInput
+{
+	float4 Position : POSITION;
+	float2 Normal : NORMAL;
+	float2 TexCoord : TEXCOORD;
+};
+
+struct QuantizedInstancedVertexShaderInput
+{
+	float4 Position : POSITION;
+	float2 Normal : NORMAL;
+	float2 TexCoord : TEXCOORD;
+	float4x4 InstanceWorld : WORLD;
+};
+
 struct PixelShaderInput
 {
 	float4 Position : SV_POSITION;
@@ -42,6 +109,46 @@ PixelShaderInput VShader(VertexShaderInput vin)
 	return output;
 }
 
+PixelShaderInput VShaderInstanced(InstancedVertexShaderInput vin)
+{
+	PixelShaderInput output;
+
+	float4 position = mul(mul(worldTransformation, float4(vin.Position, 1.0f)), vin.InstanceWorld);
+	output.Position = mul(completeTransformation, position);
+	output.PositionWS = position;
+	output.NormalWS = float4(mul(mul((float3x3)worldTransformation, vin.Normal), (float3x3)vin.InstanceWorld), 1.0f);
+	output.TexCoord = vin.TexCoord;
+	return output;
+}
+
+// The same as VertexPacker::DecodeOctahedral
+float3 DecodeOctahedral(float2 encoded)
+{
+	float3 normal = float3(encoded.x, encoded.y, 1.0f - abs(encoded.x) - abs(encoded.y));
+	float fold = saturate(-normal.z);
+	normal.xy += normal.xy >= 0.0f ? -fold : fold;
+	return normalize(normal);
+}
+
+PixelShaderInput VShaderQuantized(QuantizedVertexShaderInput vin)
+{
+	VertexShaderInput unpacked;
+	unpacked.Position = positionOffset.xyz + vin.Position.xyz * positionScale.xyz;
+	unpacked.Normal = DecodeOctahedral(vin.Normal);
+	unpacked.TexCoord = vin.TexCoord;
+	return VShader(unpacked);
+}
+
+PixelShaderInput VShaderQuantizedInstanced(QuantizedInstancedVertexShaderInput vin)
+{
+	InstancedVertexShaderInput unpacked;
+	unpacked.Position = positionOffset.xyz + vin.Position.xyz * positionScale.xyz;
+	unpacked.Normal = DecodeOctahedral(vin.Normal);
+	unpacked.TexCoord = vin.TexCoord;
+	unpacked.InstanceWorld = vin.InstanceWorld;
+	return VShaderInstanced(unpacked);
+}
+
 float4 PShader(PixelShaderInput input) : SV_TARGET
 {
 	float4 viewDirection = normalize(cameraPosition - input.PositionWS);
@@ -57,6 +164,34 @@ float4 PShader(PixelShaderInput input) : SV_TARGET
 	float RdotV = max(0, dot(R, viewDirection));
 	float4 specular = saturate(lightColor * pow(RdotV, shininess) * specularCoefficient);
 
+	// Add the point and spot lights in this pixel's cluster.  SV_POSITION holds the pixel
+	// position in xy and the view depth in w.
+	uint3 cluster = uint3(input.Position.xy * clusterTileScale, clamp(log(input.Position.w) * clusterSliceScale + clusterSliceBias, 0.0f, clusterCounts.z - 1.0f));
+	cluster.xy = min(cluster.xy, clusterCounts.xy - 1);
+	uint2 clusterRange = clusterRanges[(cluster.z * clusterCounts.y + cluster.y) * clusterCounts.x + cluster.x];
+	float3 clusterDiffuse = float3(0.0f, 0.0f, 0.0f);
+	float3 clusterSpecular = float3(0.0f, 0.0f, 0.0f);
+	for (uint i = 0; i < clusterRange.y; i++)
+	{
+		ClusterLight light = clusterLights[clusterLightIndices[clusterRange.x + i]];
+		float3 toLight = light.position - input.PositionWS.xyz;
+		float distanceToLight = length(toLight);
+		toLight /= max(distanceToLight, 0.0001f);
+		// Falls smoothly to nothing at the light's range
+		float falloff = saturate(1.0f - distanceToLight * distanceToLight / (light.range * light.range));
+		float attenuation = falloff * falloff;
+		if (light.spotCosine > -1.0f)
+		{
+			attenuation *= smoothstep(light.spotCosine, lerp(light.spotCosine, 1.0f, 0.1f), dot(-toLight, light.direction));
+		}
+		float lightNdotL = max(0, dot(adjustedNormal.xyz, toLight));
+		float3 lightR = 2 * lightNdotL * adjustedNormal.xyz - toLight;
+		clusterDiffuse += light.colour * lightNdotL * attenuation;
+		clusterSpecular += light.colour * pow(max(0, dot(lightR, viewDirection.xyz)), shininess) * attenuation;
+	}
+	diffuse = saturate(diffuse + float4(clusterDiffuse, 0.0f) * diffuseCoefficient);
+	specular = saturate(specular + float4(clusterSpecular, 0.0f) * specularCoefficient);
+
 	// Calculate ambient lighting
 	float4 ambientLight = ambientColor * diffuseCoefficient;
 
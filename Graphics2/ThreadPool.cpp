@@ -0,0 +1,150 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	_stopping = false;
+	if (threadCount == 0)
+	{
+		threadCount = std::thread::hardware_concurrency();
+	}
+	// The calling thread counts as one of the threads
+	for (unsigned int i = 1; i < threadCount; i++)
+	{
+		_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_taskAvailable.notify_all();
+	for (std::thread& worker : _workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::ParallelFor(unsigned int count, const std::function<void(unsigned int, unsigned int)>& task)
+{
+	if (count == 0)
+	{
+		return;
+	}
+	unsigned int bandCount = GetThreadCount() < count ? GetThreadCount() : count;
+	if (bandCount == 1)
+	{
+		task(0, count);
+		return;
+	}
+
+	std::atomic<unsigned int> remaining(bandCount - 1);
+	std::mutex doneMutex;
+	std::condition_variable done;
+
+	// Hand all but the first band to the workers
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (unsigned int band = 1; band < bandCount; band++)
+		{
+			unsigned int begin = static_cast<unsigned int>((static_cast<unsigned long long>(count) * band) / bandCount);
+			unsigned int end = static_cast<unsigned int>((static_cast<unsigned long long>(count) * (band + 1)) / bandCount);
+			_tasks.emplace_back([&task, &remaining, &doneMutex, &done, begin, end]()
+			{
+				task(begin, end);
+				// Decrement under the lock so that ParallelFor cannot return (and destroy
+				// doneMutex) between the decrement and the notify
+				std::lock_guard<std::mutex> doneLock(doneMutex);
+				if (--remaining == 0)
+				{
+					done.notify_one();
+				}
+			});
+		}
+	}
+	_taskAvailable.notify_all();
+
+	// Do the first band on this thread, then help out with anything still queued
+	task(0, static_cast<unsigned int>(count / bandCount));
+	while (remaining > 0 && RunPendingTask())
+	{
+	}
+
+	std::unique_lock<std::mutex> doneLock(doneMutex);
+	done.wait(doneLock, [&remaining]() { return remaining == 0; });
+}
+
+void ThreadPool::ParallelForEach(unsigned int count, const std::function<void(unsigned int)>& task)
+{
+	// One band per thread, with each band pulling items from a shared counter
+	std::atomic<unsigned int> next(0);
+	unsigned int threadCount = GetThreadCount() < count ? GetThreadCount() : count;
+	ParallelFor(threadCount, [&task, &next, count](unsigned int, unsigned int)
+	{
+		unsigned int index;
+		while ((index = next++) < count)
+		{
+			task(index);
+		}
+	});
+}
+
+void ThreadPool::SubmitBackground(std::function<void()> task)
+{
+	if (_workers.empty())
+	{
+		task();
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_backgroundTasks.push_back(std::move(task));
+	}
+	_taskAvailable.notify_one();
+}
+
+void ThreadPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_taskAvailable.wait(lock, [this]() { return _stopping || !_tasks.empty() || !_backgroundTasks.empty(); });
+			if (!_tasks.empty())
+			{
+				task = std::move(_tasks.front());
+				_tasks.pop_front();
+			}
+			else if (!_backgroundTasks.empty())
+			{
+				task = std::move(_backgroundTasks.front());
+				_backgroundTasks.pop_front();
+			}
+			else
+			{
+				// Only reached when stopping
+				return;
+			}
+		}
+		task();
+	}
+}
+
+bool ThreadPool::RunPendingTask()
+{
+	std::function<void()> task;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_tasks.empty())
+		{
+			return false;
+		}
+		task = std::move(_tasks.front());
+		_tasks.pop_front();
+	}
+	task();
+	return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads that can be used to split independent work (for example,
+// rows of the terrain grid) across the available cores.  The thread calling ParallelFor
+// also does a share of the work and does not return until all of the work is complete.
+
+class ThreadPool
+{
+public:
+	// A thread count of 0 uses one thread per hardware core
+	ThreadPool(unsigned int threadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Number of threads that share the work, including the calling thread
+	inline unsigned int			GetThreadCount() const { return static_cast<unsigned int>(_workers.size()) + 1; }
+
+	// Split the range [0, count) into one contiguous band per thread and call task(begin, end)
+	// for each band.  Blocks until every band has been processed.
+	void						ParallelFor(unsigned int count, const std::function<void(unsigned int, unsigned int)>& task);
+
+	// Call task(index) for every index in [0, count).  Rather than being split into fixed bands,
+	// each thread takes the next index as soon as it is free, so items that take very different
+	// amounts of time (for example scene graph subtrees of different sizes) still balance out.
+	// Blocks until every item has been processed.
+	void						ParallelForEach(unsigned int count, const std::function<void(unsigned int)>& task);
+
+	// Run a long task (for example loading a file) on a worker without waiting for it.  Work
+	// from ParallelFor is always taken first, and the thread calling ParallelFor never picks
+	// these up, so background work cannot hold up a frame for long.  Queued background tasks
+	// are still run when the pool is destroyed.  With no workers, the task is run straight away.
+	void						SubmitBackground(std::function<void()> task);
+
+private:
+	std::vector<std::thread>	_workers;
+	std::deque<std::function<void()>> _tasks;
+	std::deque<std::function<void()>> _backgroundTasks;
+	std::mutex					_mutex;
+	std::condition_variable		_taskAvailable;
+	bool						_stopping;
+
+	void						WorkerLoop();
+	bool						RunPendingTask();
+};
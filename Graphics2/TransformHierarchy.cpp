@@ -0,0 +1,87 @@
+#include "TransformHierarchy.h"
+
+using namespace DirectX;
+
+TransformHierarchy::TransformHierarchy()
+{
+}
+
+TransformHierarchy::Handle TransformHierarchy::Add(Handle parent)
+{
+	Handle handle;
+	if (!_freeHandles.empty())
+	{
+		handle = _freeHandles.back();
+		_freeHandles.pop_back();
+	}
+	else
+	{
+		handle = static_cast<Handle>(_handleIndices.size());
+		_handleIndices.push_back(-1);
+	}
+
+	// Appending keeps the parent before the child
+	int index = static_cast<int>(_parents.size());
+	_handleIndices[handle] = index;
+	_parents.push_back(parent == InvalidHandle ? -1 : _handleIndices[parent]);
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+	_localTransformations.push_back(identity);
+	_worldTransformations.push_back(identity);
+	_indexHandles.push_back(handle);
+	return handle;
+}
+
+void TransformHierarchy::Remove(Handle handle, std::vector<Handle>& removed)
+{
+	int first = _handleIndices[handle];
+	size_t count = _parents.size();
+
+	// Descendants always come after the node, and a node is removed if its parent is,
+	// so one pass from the node onwards finds the whole subtree.  The nodes that are
+	// kept are moved down in place, which keeps parents before their children.
+	std::vector<int> newIndices(count - first, -1);
+	int target = first;
+	for (size_t index = first; index < count; index++)
+	{
+		int parent = _parents[index];
+		bool removeNode = index == static_cast<size_t>(first) ||
+						  (parent >= first && newIndices[parent - first] < 0);
+		if (removeNode)
+		{
+			Handle removedHandle = _indexHandles[index];
+			_handleIndices[removedHandle] = -1;
+			_freeHandles.push_back(removedHandle);
+			removed.push_back(removedHandle);
+			continue;
+		}
+
+		newIndices[index - first] = target;
+		_parents[target] = parent >= first ? newIndices[parent - first] : parent;
+		_localTransformations[target] = _localTransformations[index];
+		_worldTransformations[target] = _worldTransformations[index];
+		_indexHandles[target] = _indexHandles[index];
+		_handleIndices[_indexHandles[target]] = target;
+		target++;
+	}
+	_parents.resize(target);
+	_localTransformations.resize(target);
+	_worldTransformations.resize(target);
+	_indexHandles.resize(target);
+}
+
+void TransformHierarchy::SetLocalTransform(Handle handle, FXMMATRIX localTransformation)
+{
+	XMStoreFloat4x4(&_localTransformations[_handleIndices[handle]], localTransformation);
+}
+
+void TransformHierarchy::Update(FXMMATRIX rootTransformation)
+{
+	size_t count = _parents.size();
+	for (size_t index = 0; index < count; index++)
+	{
+		int parent = _parents[index];
+		XMMATRIX parentTransformation = parent < 0 ? rootTransformation : XMLoadFloat4x4(&_worldTransformations[parent]);
+		XMStoreFloat4x4(&_worldTransformations[index], XMLoadFloat4x4(&_localTransformations[index]) * parentTransformation);
+	}
+}
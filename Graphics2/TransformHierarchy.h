@@ -0,0 +1,50 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+
+// Local and world transforms for a hierarchy of nodes, held in contiguous arrays rather than in
+// the nodes themselves.  Nodes are kept in an order where every parent comes before its
+// children, so all of the world transforms can be worked out in one linear pass.
+//
+// Nodes are referred to by handles, which stay the same when other nodes are removed.  The
+// arrays are indexed by a separate dense index, which can change.
+//
+// No DirectX device is needed, so the update can be timed on its own.
+
+class TransformHierarchy
+{
+public:
+	typedef int								Handle;
+	static const Handle						InvalidHandle = -1;
+
+	TransformHierarchy();
+
+	// Adds a node with an identity local transform.  The parent must already be in the hierarchy.
+	Handle									Add(Handle parent = InvalidHandle);
+
+	// Removes a node and all of its descendants.  The handles removed are appended to removed.
+	void									Remove(Handle handle, std::vector<Handle>& removed);
+
+	void									SetLocalTransform(Handle handle, DirectX::FXMMATRIX localTransformation);
+	inline DirectX::XMMATRIX				GetWorldTransform(Handle handle) const { return DirectX::XMLoadFloat4x4(&_worldTransformations[_handleIndices[handle]]); }
+	inline Handle							GetParent(Handle handle) const { int parent = _parents[_handleIndices[handle]]; return parent < 0 ? InvalidHandle : _indexHandles[parent]; }
+
+	// world = local * parent world, with rootTransformation used as the parent of top level nodes
+	void									Update(DirectX::FXMMATRIX rootTransformation);
+
+	// Dense access, in update order
+	inline size_t							GetCount() const { return _parents.size(); }
+	inline Handle							GetHandle(size_t index) const { return _indexHandles[index]; }
+	inline const DirectX::XMFLOAT4X4&		GetWorldTransformAt(size_t index) const { return _worldTransformations[index]; }
+
+private:
+	// Indexed by dense index
+	std::vector<int>						_parents;					// -1 for top level nodes
+	std::vector<DirectX::XMFLOAT4X4>		_localTransformations;
+	std::vector<DirectX::XMFLOAT4X4>		_worldTransformations;
+	std::vector<Handle>						_indexHandles;
+
+	// Indexed by handle
+	std::vector<int>						_handleIndices;				// -1 for free handles
+	std::vector<Handle>						_freeHandles;
+};
@@ -0,0 +1,13 @@
+#pragma once
+#include <DirectXMath.h>
+
+// The vertex format shared by the mesh and terrain renderers.  This is kept in its own
+// header (with no Windows or Direct3D dependencies) so that geometry can be built by code
+// that does not have access to a device.
+
+struct VERTEX
+{
+	DirectX::XMFLOAT3 Position;
+	DirectX::XMFLOAT3 Normal;
+	DirectX::XMFLOAT2 TexCoord;
+};
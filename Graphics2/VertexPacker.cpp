@@ -0,0 +1,229 @@
+#include "VertexPacker.h"
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+// At this size, half floats are still accurate to better than a thousandth
+const float VertexPacker::MaximumQuantizedTexCoord = 2.0f;
+
+void VertexPacker::Pack(const VERTEX * vertices, size_t vertexCount, const unsigned int * indices, size_t indexCount, bool quantize, PackedGeometry& packed)
+{
+
+	// A 16-bit index can reach vertices 0 to 65535
+	packed.IndexSize = vertexCount <= 65536 ? 2 : 4;
+	packed.Indices.resize(indexCount * packed.IndexSize);
+	if (packed.IndexSize == 2)
+	{
+		uint16_t * index = reinterpret_cast<uint16_t *>(packed.Indices.data());
+		for (size_t i = 0; i < indexCount; i++)
+		{
+			index[i] = static_cast<uint16_t>(indices[i]);
+		}
+	}
+	else if (indexCount > 0)
+	{
+		memcpy(packed.Indices.data(), indices, indexCount * sizeof(unsigned int));
+	}
+
+	packed.Quantized = quantize && vertexCount > 0;
+	XMFLOAT3 minimum = vertexCount > 0 ? vertices[0].Position : XMFLOAT3(0.0f, 0.0f, 0.0f);
+	XMFLOAT3 maximum = minimum;
+	for (size_t i = 0; i < vertexCount && packed.Quantized; i++)
+	{
+		const VERTEX& vertex = vertices[i];
+		if (fabsf(vertex.TexCoord.x) > MaximumQuantizedTexCoord || fabsf(vertex.TexCoord.y) > MaximumQuantizedTexCoord)
+		{
+			packed.Quantized = false;
+		}
+		minimum.x = fminf(minimum.x, vertex.Position.x);
+		minimum.y = fminf(minimum.y, vertex.Position.y);
+		minimum.z = fminf(minimum.z, vertex.Position.z);
+		maximum.x = fmaxf(maximum.x, vertex.Position.x);
+		maximum.y = fmaxf(maximum.y, vertex.Position.y);
+		maximum.z = fmaxf(maximum.z, vertex.Position.z);
+	}
+
+	if (!packed.Quantized)
+	{
+		packed.VertexStride = sizeof(VERTEX);
+		packed.PositionScale = XMFLOAT3(1.0f, 1.0f, 1.0f);
+		packed.PositionOffset = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		packed.Vertices.resize(vertexCount * sizeof(VERTEX));
+		if (vertexCount > 0)
+		{
+			memcpy(packed.Vertices.data(), vertices, vertexCount * sizeof(VERTEX));
+		}
+		return;
+	}
+
+	// Positions are scaled so that the bounding box fills the range -1 to 1.  A box that is
+	// flat in one direction keeps a scale of 1 in that direction.
+	packed.PositionOffset = XMFLOAT3((minimum.x + maximum.x) * 0.5f, (minimum.y + maximum.y) * 0.5f, (minimum.z + maximum.z) * 0.5f);
+	packed.PositionScale = XMFLOAT3((maximum.x - minimum.x) * 0.5f, (maximum.y - minimum.y) * 0.5f, (maximum.z - minimum.z) * 0.5f);
+	if (packed.PositionScale.x <= 0.0f)
+	{
+		packed.PositionScale.x = 1.0f;
+	}
+	if (packed.PositionScale.y <= 0.0f)
+	{
+		packed.PositionScale.y = 1.0f;
+	}
+	if (packed.PositionScale.z <= 0.0f)
+	{
+		packed.PositionScale.z = 1.0f;
+	}
+
+	packed.VertexStride = sizeof(PackedVertex);
+	packed.Vertices.resize(vertexCount * sizeof(PackedVertex));
+	PackedVertex * packedVertex = reinterpret_cast<PackedVertex *>(packed.Vertices.data());
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const VERTEX& vertex = vertices[i];
+		packedVertex->Position[0] = FloatToSnorm16((vertex.Position.x - packed.PositionOffset.x) / packed.PositionScale.x);
+		packedVertex->Position[1] = FloatToSnorm16((vertex.Position.y - packed.PositionOffset.y) / packed.PositionScale.y);
+		packedVertex->Position[2] = FloatToSnorm16((vertex.Position.z - packed.PositionOffset.z) / packed.PositionScale.z);
+		packedVertex->Position[3] = 32767;
+		EncodeOctahedral(vertex.Normal, packedVertex->Normal);
+		packedVertex->TexCoord[0] = FloatToHalf(vertex.TexCoord.x);
+		packedVertex->TexCoord[1] = FloatToHalf(vertex.TexCoord.y);
+		packedVertex++;
+	}
+}
+
+void VertexPacker::AddStatistics(const PackedGeometry& packed, size_t vertexCount, size_t indexCount, GeometryMemoryStatistics& statistics)
+{
+	statistics.VertexCount += vertexCount;
+	statistics.IndexCount += indexCount;
+	statistics.UnpackedVertexBytes += vertexCount * sizeof(VERTEX);
+	statistics.UnpackedIndexBytes += indexCount * sizeof(unsigned int);
+	statistics.PackedVertexBytes += packed.Vertices.size();
+	statistics.PackedIndexBytes += packed.Indices.size();
+}
+
+int16_t VertexPacker::FloatToSnorm16(float value)
+{
+	float clamped = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+	return static_cast<int16_t>(roundf(clamped * 32767.0f));
+}
+
+float VertexPacker::Snorm16ToFloat(int16_t value)
+{
+	// -32768 and -32767 both mean -1, as they do on the GPU
+	float result = value / 32767.0f;
+	return result < -1.0f ? -1.0f : result;
+}
+
+uint16_t VertexPacker::FloatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+	int exponent = static_cast<int>((bits >> 23) & 0xff);
+	uint32_t mantissa = bits & 0x7fffff;
+	if (exponent == 0xff)
+	{
+		// Infinity or NaN
+		return sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0);
+	}
+	int halfExponent = exponent - 127 + 15;
+	if (halfExponent >= 31)
+	{
+		// Too big, so becomes infinity
+		return sign | 0x7c00;
+	}
+	uint32_t half;
+	uint32_t remainder;
+	uint32_t halfway;
+	if (halfExponent <= 0)
+	{
+		// Too small for a normal half, so becomes a denormal (or zero)
+		if (halfExponent < -10)
+		{
+			return sign;
+		}
+		mantissa |= 0x800000;
+		int shift = 14 - halfExponent;
+		half = mantissa >> shift;
+		remainder = mantissa & ((1u << shift) - 1);
+		halfway = 1u << (shift - 1);
+	}
+	else
+	{
+		half = (static_cast<uint32_t>(halfExponent) << 10) | (mantissa >> 13);
+		remainder = mantissa & 0x1fff;
+		halfway = 0x1000;
+	}
+	// Round to nearest, ties to even.  Carrying into the exponent gives the right answer,
+	// including rounding up to infinity.
+	if (remainder > halfway || (remainder == halfway && (half & 1) != 0))
+	{
+		half++;
+	}
+	return sign | static_cast<uint16_t>(half);
+}
+
+float VertexPacker::HalfToFloat(uint16_t value)
+{
+	uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1f;
+	uint32_t mantissa = value & 0x3ff;
+	if (exponent == 0)
+	{
+		// Zero or a denormal
+		float result = mantissa / 16777216.0f;
+		return sign != 0 ? -result : result;
+	}
+	uint32_t bits;
+	if (exponent == 31)
+	{
+		bits = sign | 0x7f800000 | (mantissa << 13);
+	}
+	else
+	{
+		bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+	}
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+void VertexPacker::EncodeOctahedral(const XMFLOAT3& normal, int16_t encoded[2])
+{
+	// Project onto the octahedron |x| + |y| + |z| = 1, then fold the lower half over the upper
+	float length = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+	if (length <= 0.0f)
+	{
+		encoded[0] = 0;
+		encoded[1] = 0;
+		return;
+	}
+	float u = normal.x / length;
+	float v = normal.y / length;
+	if (normal.z < 0.0f)
+	{
+		float foldedU = (1.0f - fabsf(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+		float foldedV = (1.0f - fabsf(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+		u = foldedU;
+		v = foldedV;
+	}
+	encoded[0] = FloatToSnorm16(u);
+	encoded[1] = FloatToSnorm16(v);
+}
+
+XMFLOAT3 VertexPacker::DecodeOctahedral(const int16_t encoded[2])
+{
+	// The same as DecodeOctahedral in TexturedShaders.hlsl
+	float x = Snorm16ToFloat(encoded[0]);
+	float y = Snorm16ToFloat(encoded[1]);
+	float z = 1.0f - fabsf(x) - fabsf(y);
+	if (z < 0.0f)
+	{
+		float unfoldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float unfoldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = unfoldedX;
+		y = unfoldedY;
+	}
+	float length = sqrtf(x * x + y * y + z * z);
+	return XMFLOAT3(x / length, y / length, z / length);
+}
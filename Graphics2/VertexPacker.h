@@ -0,0 +1,67 @@
+#pragma once
+#include "Vertex.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Packs a sub-mesh's vertices and indices into the buffers that are given to Direct3D.
+//
+// Indices are stored as 16-bit values whenever every vertex can be reached with one, which
+// halves the index buffer for nearly every sub-mesh.  Vertices are either copied as they are
+// (a 32 byte VERTEX) or, if quantizing is asked for, packed into a 16 byte PackedVertex:
+//   - the position as snorm16, relative to the sub-mesh's bounding box
+//   - the normal octahedrally encoded into two snorm16 values
+//   - the texture coordinates as half floats
+// The vertex shader undoes the position scaling with the PositionScale and PositionOffset
+// given here.  Sub-meshes whose texture coordinates are too large to keep enough precision as
+// half floats are left unquantized.
+
+struct PackedVertex
+{
+	int16_t						Position[4];		// w is always 32767 (1.0), so this can be read as R16G16B16A16_SNORM
+	int16_t						Normal[2];
+	uint16_t					TexCoord[2];
+};
+
+struct PackedGeometry
+{
+	std::vector<unsigned char>	Vertices;
+	std::vector<unsigned char>	Indices;
+	unsigned int				VertexStride;
+	unsigned int				IndexSize;			// 2 or 4 bytes
+	bool						Quantized;
+	// For quantized vertices, position = PositionOffset + PositionScale * decoded position
+	DirectX::XMFLOAT3			PositionScale;
+	DirectX::XMFLOAT3			PositionOffset;
+};
+
+// The memory used by a mesh's vertex and index buffers, compared with plain VERTEX structures
+// and 32-bit indices.  Bytes per vertex is PackedVertexBytes / VertexCount.
+struct GeometryMemoryStatistics
+{
+	size_t						VertexCount;
+	size_t						IndexCount;
+	size_t						UnpackedVertexBytes;
+	size_t						UnpackedIndexBytes;
+	size_t						PackedVertexBytes;
+	size_t						PackedIndexBytes;
+};
+
+class VertexPacker
+{
+public:
+	// Texture coordinates larger than this stop a sub-mesh being quantized
+	static const float			MaximumQuantizedTexCoord;
+
+	// Takes pointers rather than vectors so that sub-meshes read from a baked model can be
+	// packed straight from the mapped file
+	static void					Pack(const VERTEX * vertices, size_t vertexCount, const unsigned int * indices, size_t indexCount, bool quantize, PackedGeometry& packed);
+	static void					AddStatistics(const PackedGeometry& packed, size_t vertexCount, size_t indexCount, GeometryMemoryStatistics& statistics);
+
+	static int16_t				FloatToSnorm16(float value);
+	static float				Snorm16ToFloat(int16_t value);
+	static uint16_t				FloatToHalf(float value);
+	static float				HalfToFloat(uint16_t value);
+	static void					EncodeOctahedral(const DirectX::XMFLOAT3& normal, int16_t encoded[2]);
+	static DirectX::XMFLOAT3	DecodeOctahedral(const int16_t encoded[2]);
+};